@@ -4,11 +4,39 @@
 #define I2C_SDA_PIN 21
 #define I2C_SCL_PIN 22
 
-// ---------------- I2C (NAU7802 scale) ----------------
+// ---------------- ADC front-end ----------------
+// Load cell ADC the firmware is built for (see src/modules/adc_driver.h).
+// ScaleManager is specialised for the chosen driver at compile time.
+#define SCALE_ADC_NAU7802  0   // I2C, 10/20 SPS
+#define SCALE_ADC_HX711    1   // 2-wire serial, 10/80 SPS (RATE pin)
+#define SCALE_ADC_ADS1232  2   // 2-wire serial, 10/80 SPS (SPEED pin)
+#define SCALE_ADC_EMULATED 3   // no hardware: synthetic conversions (bench tests)
+#ifndef SCALE_ADC
+#define SCALE_ADC SCALE_ADC_NAU7802
+#endif
+
+// I2C (NAU7802 scale)
 // Per provided mapping: SDA -> GPIO16, SCL -> GPIO17, DRDY -> GPIO27
 #define SCALE_SDA_PIN 16
 #define SCALE_SCL_PIN 17
+
+// HX711 / ADS1232: DOUT doubles as data ready (low when a conversion waits).
+// The rate pin selects 80 SPS while weighing and 10 SPS while dozing; 255 if
+// it is strapped on the board (then both rates are the strapped one).
+#define SERIAL_ADC_DOUT_PIN 16
+#define SERIAL_ADC_SCK_PIN 17
+#define SERIAL_ADC_RATE_PIN 25
+#define SERIAL_ADC_STRAPPED_SPS 10   // used when SERIAL_ADC_RATE_PIN is 255
+#define ADS1232_PDWN_PIN 255         // 255: tied high on the board
+
+// Data-ready line for the idle light-sleep wake.
+#if SCALE_ADC == SCALE_ADC_HX711 || SCALE_ADC == SCALE_ADC_ADS1232
+#define SCALE_DRDY_PIN SERIAL_ADC_DOUT_PIN
+#define SCALE_DRDY_ACTIVE_HIGH 0
+#else
 #define SCALE_DRDY_PIN 27
+#define SCALE_DRDY_ACTIVE_HIGH 1
+#endif
 
 // ---------------- Calibration ----------------
 // Default calibration factor (grams per ADC count).
@@ -17,6 +45,7 @@
 // Calibration factor meaning: ADC counts per gram (not grams per count).
 // Start with ~15.0 for many common 5–50kg load cells on NAU7802.
 // Increase if your reading is too low; decrease if too high.
+// HX711/ADS1232 boards have a different full scale: measure their factor.
 #define SCALE_CAL_FACTOR_DEFAULT -13.48f
 
 // ---------------- LCD parameters ----------------
@@ -31,10 +60,75 @@
 #define RFID2_ADDR_DEFAULT 0x28
 #define RFID2_ADDR_FALLBACK 0x29
 #define RFID_RST_PIN 255
+// IRQ line (active low) if wired; the RFID2 unit's Grove cable has none.
+// 255: the reader is polled on a timer while the station dozes.
+#define RFID_IRQ_PIN 255
+
+// ---------------- RFID capture ----------------
+// The reader is polled for the whole weigh-in cycle (not only after the
+// weight is stable). A scan is bound to the next stable weight if it is no
+// older than this window; otherwise it is dropped.
+#define RFID_PIPELINED             1
+#define RFID_BIND_WINDOW_MS        15000
+// A card read again within this window is treated as the same presentation
+// (a double tap; a card left on the reader is halted and read only once).
+// After it, the same fisher can weigh again.
+#define RFID_DUP_WINDOW_MS         2000
+
+// ---------------- RFID directory ----------------
+// Local table of known cards (UID -> display name, blocked flag) on LittleFS,
+// kept current with delta syncs from the server while the scale is idle.
+#define ID_DIRECTORY_PATH            "/iddir.bin"
+#define ID_DIRECTORY_SYNC_URL        "https://fishcore.ph/scaleDirectory/1"
+#define ID_DIRECTORY_SYNC_PERIOD_MS  (15UL * 60UL * 1000UL)
+// 1: cards missing from a non-empty directory are rejected at the scale.
+// 0: unknown cards are still uploaded (the server has the final say).
+#define ID_DIRECTORY_REJECT_UNKNOWN  0
+// How long a "Card blocked"/"Unknown card" notice stays on row 1.
+#define ID_NOTICE_MS                 2000
 
 // ---------------- WiFi ----------------
 #define WIFI_SSID "Bili ka wifi mo 4G"
 #define WIFI_PASS "P@ssw0rd549859!"
+// One reconnect attempt before an upload gives up.
+#define WIFI_RECONNECT_TIMEOUT_MS  2500
+// Config portal (no usable credentials at boot): AP+STA, served from its own
+// task on core 0 while the scale keeps weighing. Same priority as loop(),
+// which runs on core 1; below the Wi-Fi and lwIP tasks it shares core 0 with.
+#define WIFI_PORTAL_TASK_PRIO      1
+#define WIFI_PORTAL_TASK_STACK     6144
+#define WIFI_PORTAL_POLL_MS        20        // handleClient() period
+#define WIFI_PORTAL_RETRY_MS       60000UL   // saved/fallback network retried, no phone on the AP
+#define WIFI_PORTAL_LINGER_MS      10000     // portal stays up after a join (status page)
+// Longest loop() iteration while the portal is serving (serial 'm',
+// loop_portal): one averaged ADC read (~1.6 s) and one upload (~0.5 s),
+// what an iteration costs without the portal.
+#define LOOP_BUDGET_MS             2500
+
+// ---------------- Upload ----------------
+// GET <UPLOAD_BASE_URL>/<UPLOAD_ID>/<card id>/<UPLOAD_SCALE_ID>/<kg>
+#define UPLOAD_BASE_URL            "https://fishcore.ph/uploadWeightIns"
+#define UPLOAD_HOST                "fishcore.ph"
+#define UPLOAD_PORT                443
+#define UPLOAD_ID                  1
+#define UPLOAD_SCALE_ID            1
+#define UPLOAD_HTTP_TIMEOUT_MS     6000
+// Tries per weigh-in on transient failures (connect, timeout, HTTP 5xx/429).
+// The loop blocks while retrying; 1 = no retry.
+#define UPLOAD_ATTEMPTS            1
+#define UPLOAD_RETRY_BACKOFF_MS    1000      // doubled per retry, plus up to 50% jitter
+// Open the upload connection when a load is placed (DNS + TLS while the
+// weight settles) and hold it for the card scan; 0 = connect on send.
+#ifndef UPLOAD_PREWARM
+#define UPLOAD_PREWARM             1
+#endif
+#define UPLOAD_PREWARM_HOLD_MS     30000     // dropped when no upload uses it by then
+#define UPLOAD_DNS_TTL_MS          300000UL  // longest a resolved UPLOAD_HOST is reused
+// Weigh-ins taken without Wi-Fi (config portal up, network down) wait in RAM
+// and go out one per idle loop once the station is online; the oldest is
+// dropped when full.
+#define UPLOAD_QUEUE_LEN           32
+#define UPLOAD_QUEUE_RETRY_MS      30000     // after a failed flush
 
 // ---------------- Weight detection/stability ----------------
 #define WEIGHT_DETECT_THRESHOLD_KG 0.05f     // weight present threshold
@@ -48,6 +142,9 @@
 // and use that as the displayed/recorded weight.
 #define WEIGHING_TIMEOUT_MS        3000
 
+// Minimum loop() period (start to start).
+#define LOOP_PERIOD_MS             100
+
 // ---------------- Display / minimum effective weight ----------------
 // Treat anything at or below this as zero (e.g. tray weight).
 // 0.30 kg = 300 g
@@ -55,3 +152,123 @@
 
 // Optional fine clamp to avoid -0.00 when very close to zero
 #define DISPLAY_ZERO_CLAMP_KG      0.005f
+
+// ---------------- Runtime parameters ----------------
+// STABLE_STDDEV_KG, STABLE_MIN_MS, WEIGHING_TIMEOUT_MS, NO_ID_ZERO_TIMEOUT_MS,
+// MIN_EFFECTIVE_WEIGHT_KG, LOOP_PERIOD_MS and the ADC's weighing rate are
+// defaults: a named profile and per-station overrides in NVS take over at
+// runtime, without a reboot (serial 'u', /params; station_params.h).
+#define PARAMS_PROFILE             "default"  // with nothing in NVS
+#define PARAMS_MAX_SAVED_PROFILES  4          // "save <name>" slots beside the built-ins
+// POST /params takes HTTP Basic auth with these (plain HTTP: keep it on a
+// trusted network). An empty password turns it off: serial 'u' only.
+#define PARAMS_HTTP_USER           "admin"
+#ifndef PARAMS_HTTP_PASSWORD
+#define PARAMS_HTTP_PASSWORD       ""
+#endif
+
+// ---------------- Logging ----------------
+// Events below this level compile out (LOG_LEVEL_DEBUG/INFO/WARN/ERROR/OFF).
+#ifndef FISHCORE_LOG_LEVEL
+#define FISHCORE_LOG_LEVEL         LOG_LEVEL_INFO
+#endif
+// 0: binary frames (decode with tools/log_decode.py), 1: text lines
+// formatted by the drain task.
+#ifndef FISHCORE_LOG_TEXT
+#define FISHCORE_LOG_TEXT          0
+#endif
+#define LOG_RING_RECORDS           128       // power of two, 20 bytes each
+#define LOG_DRAIN_PERIOD_MS        20
+
+// ---------------- ADC trace capture ----------------
+// Raw conversions + FSM/RFID events for offline replay (serial 'r', GET /trace).
+#define ADC_TRACE_PATH             "/trace.bin"
+#define ADC_TRACE_MAX_BYTES        (512UL * 1024UL)  // ~70 min at 20 SPS
+
+// ---------------- Weigh-in history ----------------
+// Every weigh-in is appended to a log on LittleFS (src/modules/weigh_log.h)
+// for per-card and per-period queries (serial 'y', GET /history). Segments
+// of WEIGHLOG_SEGMENT_RECORDS 12-byte records; the oldest segment is dropped
+// once there are WEIGHLOG_MAX_SEGMENTS, or when starting a segment would
+// leave less than WEIGHLOG_RESERVE_BYTES free for the rest of LittleFS (a
+// full ADC trace, the RFID directory and its staged copy during a sync).
+// The default keeps 45k..49k weigh-ins in 576 KB of the 1408 KB partition;
+// [env:esp32dev_history] flashes partitions_history.csv (2496 KB) and keeps
+// 32 segments, 127k..131k weigh-ins.
+#define WEIGHLOG_DIR               "/wlog"
+#define WEIGHLOG_SEGMENT_RECORDS   4096      // 48 KB per segment file
+#ifndef WEIGHLOG_MAX_SEGMENTS
+#define WEIGHLOG_MAX_SEGMENTS      12
+#endif
+#define WEIGHLOG_RESERVE_BYTES     (ADC_TRACE_MAX_BYTES + 128UL * 1024UL)
+#define WEIGHLOG_MAX_CARDS         2048      // distinct cards kept; 2 bytes of RAM each
+#define WEIGHLOG_QUERY_LIMIT       200       // records listed per query (totals count all)
+#define WEIGHLOG_NTP_SERVER        "pool.ntp.org"  // record times are UTC from SNTP
+
+// ---------------- Idle power ----------------
+// After POWER_IDLE_AFTER_MS with an empty scale and no pending scan the
+// station dozes: NAU7802 at 10 SPS, Wi-Fi modem sleep (DTIM), and
+// automatic light sleep while it waits for each conversion (needs a core
+// with CONFIG_PM_ENABLE and tickless idle; modem sleep only otherwise).
+// POWER_WAKE_CONFIRM conversions above the detect threshold, a card or
+// serial input bring it back to the normal loop.
+#ifndef POWER_IDLE_SLEEP
+#define POWER_IDLE_SLEEP           1
+#endif
+#define POWER_IDLE_AFTER_MS        20000
+#define POWER_WAKE_CONFIRM         2
+#define POWER_RFID_POLL_MS         300       // reader poll while dozing (no IRQ)
+// Whole-station current estimates (mA) for the 'p' report and /metrics,
+// not measurements: set them from a USB meter reading of your board.
+#define POWER_MA_ACTIVE            120.0f    // CPU on, Wi-Fi no power save
+#define POWER_MA_DOZE              45.0f     // CPU on between sleeps, modem sleep
+#define POWER_MA_SLEEP             22.0f     // auto light sleep, DTIM wakes (LCD backlight on)
+
+// ---------------- Vibration ----------------
+// Serial 'v' with a load on the platform: spectra at the ADC's fastest rate
+// (NAU7802 320 SPS), then notch/comb stages for the weighing average, kept
+// in NVS. A run that finds nothing clears them.
+#define VIB_FFT_LOG2N              9         // 512-point blocks, 0.625 Hz bins at 320 SPS
+#define VIB_BLOCKS                 4         // averaged; ~6.4 s at 320 SPS
+#define VIB_MIN_HZ                 1.0f      // slower sway is left to the stability check
+#define VIB_PEAK_RATIO             20.0f     // peak bin over the median bin (13 dB)
+#define VIB_MIN_AMPLITUDE_G        2.0f      // smaller vibration is not worth a stage
+#define VIB_NOTCH_BW_HZ            1.0f      // notch -3 dB width at the weighing rate
+#define VIB_MIN_NOTCH_HZ           0.5f      // aliases closer to DC settle too slowly
+
+// ---------------- Temperature compensation ----------------
+// The NAU7802's internal temperature sensor, read between weighing reads,
+// drives a learned zero and span correction (src/modules/temp_comp.h).
+// The sensor conversion is the datasheet's typical one: 109 mV at 25 C and
+// 360 uV/C, read at gain 1 against the 3.3 V LDO reference. The
+// differential full scale is +-0.5 VREF / gain, so 2^23 counts = 1.65 V:
+// 554,155 counts at 25 C and 1,830 counts/C. The model only uses
+// temperature differences, so the offset only moves the reported C; adjust
+// it against a thermometer.
+#define NAU7802_TEMP_COUNTS_25C    554155L
+#define NAU7802_TEMP_COUNTS_PER_C  1830.2f
+#define TEMPCOMP_SAMPLE_MS         60000UL   // temperature read; zero point when idle
+#define TEMPCOMP_SAVE_MS           (30UL * 60UL * 1000UL)  // model to NVS at most this often
+#define TEMPCOMP_MEMORY_POINTS     1440.0f   // zero points weigh 1/e after this many (a day)
+#define TEMPCOMP_MIN_POINTS        20.0f     // weighted zero points before the slope is used
+#define TEMPCOMP_MIN_SPREAD_C      1.0f      // and their temperatures' std deviation
+#define TEMPCOMP_MAX_ZERO_G_PER_C  20.0f     // steeper fits are not used (a bad fit)
+#define TEMPCOMP_SPAN_MIN_DELTA_C  3.0f      // span points this far apart before a span slope
+#define TEMPCOMP_MAX_SPAN_PPM_PER_C 1000.0f
+#define TEMPCOMP_REF_KG            10.0f     // serial 's': reference mass on the platform
+
+// ---------------- Self benchmark ----------------
+// Serial 'b': ADC, LCD, RFID, I2C, Wi-Fi and TLS timings on site.
+// BENCH_URL gets one GET; the directory sync has no side effects (an upload
+// would record a weigh-in). Point it at a local stand-in to take the
+// backend out of the numbers; http:// skips TLS.
+#ifndef BENCH_URL
+#define BENCH_URL                  ID_DIRECTORY_SYNC_URL
+#endif
+#define BENCH_ADC_MS               2000      // conversions counted for this long
+#define BENCH_REPEAT               20        // LCD cells, RFID polls, I2C probes
+#define BENCH_WIFI_TIMEOUT_MS      8000
+
+// ---------------- Diagnostics ----------------
+// Heap health sample period (free heap, min free heap, largest free block).
+#define HEAP_SAMPLE_PERIOD_MS      (15UL * 60UL * 1000UL)
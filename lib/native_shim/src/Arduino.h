@@ -0,0 +1,226 @@
+#pragma once
+// Host-native stand-in for the Arduino-ESP32 core: the subset the firmware
+// uses, backed by virtual time (see shim.h).
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "shim.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+#define F(s) (s)
+#define digitalPinToInterrupt(p) (p)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// SNTP (esp32-hal-time): getLocalTime() fails until the clock has been set,
+// here by shim::setWallClock().
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char *server1, const char *server2 = nullptr,
+                const char *server3 = nullptr);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+template <class T>
+T constrain(T v, T lo, T hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+class String {
+ public:
+  String(const char *s = "") : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(int v, unsigned char base = 10) : s_(fmtInt_((long)v, base)) {}
+  explicit String(unsigned int v, unsigned char base = 10) : s_(fmtUInt_((unsigned long)v, base)) {}
+  explicit String(long v, unsigned char base = 10) : s_(fmtInt_(v, base)) {}
+  explicit String(unsigned long v, unsigned char base = 10) : s_(fmtUInt_(v, base)) {}
+  explicit String(float v, unsigned int decimals = 2) : s_(fmtFloat_(v, decimals)) {}
+  explicit String(double v, unsigned int decimals = 2) : s_(fmtFloat_(v, decimals)) {}
+
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  const char *c_str() const { return s_.c_str(); }
+  const std::string &str() const { return s_; }
+  bool reserve(unsigned int n) {
+    s_.reserve(n);
+    return true;
+  }
+
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : '\0'; }
+  char &operator[](unsigned int i) { return s_[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String &operator=(const char *s) {
+    s_ = s ? s : "";
+    return *this;
+  }
+  String &operator+=(const String &o) {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(const char *o) {
+    s_ += o ? o : "";
+    return *this;
+  }
+  String &operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  bool concat(const String &o) {
+    s_ += o.s_;
+    return true;
+  }
+
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + (b ? b : "")); }
+  friend String operator+(const char *a, const String &b) { return String((a ? a : "") + b.s_); }
+  friend String operator+(const String &a, char c) { return String(a.s_ + c); }
+
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+  bool operator!=(const char *o) const { return !(*this == o); }
+  bool operator<(const String &o) const { return s_ < o.s_; }
+  bool equals(const String &o) const { return s_ == o.s_; }
+
+  String substring(unsigned int from) const { return substring(from, length()); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > s_.size()) return String();
+    if (to > s_.size()) to = (unsigned int)s_.size();
+    if (to < from) return String();
+    return String(s_.substr(from, to - from));
+  }
+  int indexOf(char c, unsigned int from = 0) const {
+    const size_t p = s_.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int indexOf(const char *t, unsigned int from = 0) const {
+    const size_t p = s_.find(t, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  bool startsWith(const char *p) const { return s_.rfind(p, 0) == 0; }
+  bool endsWith(const char *p) const {
+    const size_t n = strlen(p);
+    return s_.size() >= n && s_.compare(s_.size() - n, n, p) == 0;
+  }
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+
+ private:
+  static std::string fmtInt_(long v, unsigned char base);
+  static std::string fmtUInt_(unsigned long v, unsigned char base);
+  static std::string fmtFloat_(double v, unsigned int decimals);
+  std::string s_;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t w = 0;
+    for (size_t i = 0; i < n; ++i) w += write(buf[i]);
+    return w;
+  }
+  size_t write(const char *s) { return write(reinterpret_cast<const uint8_t *>(s), strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+  size_t println() { return write("\r\n"); }
+  template <class T>
+  size_t println(const T &v) {
+    const size_t n = print(v);
+    return n + println();
+  }
+  size_t println(double v, int decimals) {
+    const size_t n = print(v, decimals);
+    return n + println();
+  }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual size_t readBytes(char *buf, size_t n);
+  size_t readBytes(uint8_t *buf, size_t n) { return readBytes(reinterpret_cast<char *>(buf), n); }
+  String readStringUntil(char terminator);
+  void setTimeout(unsigned long ms) { timeoutMs_ = ms; }
+
+ protected:
+  unsigned long timeoutMs_ = 1000;
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  int availableForWrite() { return 128; }
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+ public:
+  void restart();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getHeapSize();
+  // Host wall-clock based (not virtual) so Metrics timers measure host CPU.
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getSketchSize() { return 0; }
+  uint32_t getFreeSketchSpace() { return 0; }
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+};
+extern EspClass ESP;
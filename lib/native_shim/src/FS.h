@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+// Flash filesystem stand-in mapped onto a host directory (shim::setFsRoot).
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+ public:
+  File() = default;
+  File(std::shared_ptr<FILE> f, const std::string &name, bool append = false)
+      : f_(std::move(f)), name_(name), append_(append) {}
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  size_t read(uint8_t *buf, size_t n);
+  int read() override;
+  int peek() override;
+  int available() override;
+  void flush() override;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close() { f_.reset(); }
+  operator bool() const { return f_ != nullptr; }
+  const char *name() const { return name_.c_str(); }
+  bool isDirectory() const { return false; }
+
+ private:
+  std::shared_ptr<FILE> f_;
+  std::string name_;
+  bool append_ = false;
+};
+
+class FS {
+ public:
+  File open(const char *path, const char *mode = "r", bool create = false);
+  File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,35 @@
+#pragma once
+#include <WiFi.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// HTTP client stand-in: GET() is answered by the handler installed with
+// shim::setHttpHandler() and advances virtual time by its latency. A client
+// that is not already connected pays the TLS connect cost first.
+class HTTPClient {
+ public:
+  bool begin(WiFiClient &client, const String &url);
+  bool begin(const String &url);
+  void end();
+  void setTimeout(uint16_t timeoutMs) { timeoutMs_ = timeoutMs; }
+  void setConnectTimeout(int32_t ms) { (void)ms; }
+  void setReuse(bool reuse) { (void)reuse; }
+  void useHTTP10(bool on = true) { (void)on; }
+  int GET();
+  int getSize() const { return (int)body_.length(); }
+  String getString() { return body_; }
+  Stream *getStreamPtr();
+  bool connected() { return client_ != nullptr && client_->connected(); }
+  static String errorToString(int error);
+
+ private:
+  WiFiClient *client_ = nullptr;
+  String url_;
+  String body_;
+  uint16_t timeoutMs_ = 5000;
+  Stream *stream_ = nullptr;
+};
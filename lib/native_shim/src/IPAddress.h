@@ -0,0 +1,16 @@
+#pragma once
+#include <Arduino.h>
+
+class IPAddress {
+ public:
+  IPAddress() = default;
+  IPAddress(uint32_t addr) : addr_(addr) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+      : addr_((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+  operator uint32_t() const { return addr_; }
+  uint8_t operator[](int i) const { return (uint8_t)(addr_ >> (8 * i)); }
+  String toString() const;
+
+ private:
+  uint32_t addr_ = 0;
+};
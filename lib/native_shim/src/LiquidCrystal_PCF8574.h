@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+
+// 20x4 character LCD stand-in: keeps the frame in memory (shim::lcdRow) and
+// counts the I2C traffic a PCF8574 backpack would generate (4 bytes/char).
+class LiquidCrystal_PCF8574 : public Print {
+ public:
+  explicit LiquidCrystal_PCF8574(uint8_t addr) : addr_(addr) {}
+  void begin(int cols, int rows);
+  void setBacklight(int brightness) { (void)brightness; }
+  void setCursor(int col, int row);
+  void clear();
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  uint8_t addr_;
+  int col_ = 0;
+  int row_ = 0;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <Wire.h>
+
+// MFRC522 stand-in: cards come from shim::presentCard(). A card is reported
+// once per presentation (after PICC_HaltA it stays silent until it leaves the
+// field), like a real halted PICC.
+class MFRC522_I2C {
+ public:
+  struct Uid {
+    uint8_t size;
+    uint8_t uidByte[10];
+    uint8_t sak;
+  };
+  Uid uid = {};
+
+  MFRC522_I2C(uint8_t chipAddress, uint8_t resetPowerDownPin, TwoWire *wire = &Wire);
+  void PCD_Init();
+  bool PICC_IsNewCardPresent();
+  bool PICC_ReadCardSerial();
+  uint8_t PICC_HaltA();
+  void PCD_StopCrypto1() {}
+  void PCD_WriteRegister(uint8_t reg, uint8_t value);
+  uint8_t PCD_ReadRegister(uint8_t reg);
+
+ private:
+  uint8_t addr_;
+  TwoWire *wire_;
+  int current_ = -1;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+
+// NVS stand-in: namespaces/keys live in process memory.
+class Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false);
+  void end() { ns_.clear(); }
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putString(const char *key, const char *value);
+  size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+  String getString(const char *key, const String &defaultValue = String());
+  size_t getString(const char *key, char *value, size_t maxLen);
+
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get_(key, defaultValue); }
+  size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  int32_t getInt(const char *key, int32_t defaultValue = 0) { return get_(key, defaultValue); }
+  size_t putFloat(const char *key, float value) { return putBytes(key, &value, sizeof(value)); }
+  float getFloat(const char *key, float defaultValue = NAN) { return get_(key, defaultValue); }
+  size_t putBool(const char *key, bool value) { return putBytes(key, &value, sizeof(value)); }
+  bool getBool(const char *key, bool defaultValue = false) { return get_(key, defaultValue); }
+
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+
+ private:
+  template <class T>
+  T get_(const char *key, T def) {
+    T v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+  }
+  std::string ns_;
+  bool readOnly_ = false;
+};
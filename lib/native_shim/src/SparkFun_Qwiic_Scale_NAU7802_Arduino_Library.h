@@ -0,0 +1,84 @@
+#pragma once
+#include <Wire.h>
+
+// NAU7802 stand-in driven by shim::loadCell(). Conversions are produced at
+// the configured sample rate in virtual time; the averaging/zero/weight
+// helpers follow the SparkFun library's semantics (blocking averages wait for
+// new conversions, advancing virtual time).
+
+enum NAU7802_Gain_Values {
+  NAU7802_GAIN_128 = 0b111,
+  NAU7802_GAIN_64 = 0b110,
+  NAU7802_GAIN_32 = 0b101,
+  NAU7802_GAIN_16 = 0b100,
+  NAU7802_GAIN_8 = 0b011,
+  NAU7802_GAIN_4 = 0b010,
+  NAU7802_GAIN_2 = 0b001,
+  NAU7802_GAIN_1 = 0b000,
+};
+
+enum NAU7802_SPS_Values {
+  NAU7802_SPS_320 = 0b111,
+  NAU7802_SPS_80 = 0b011,
+  NAU7802_SPS_40 = 0b010,
+  NAU7802_SPS_20 = 0b001,
+  NAU7802_SPS_10 = 0b000,
+};
+
+enum NAU7802_Channels {
+  NAU7802_CHANNEL_1 = 0,
+  NAU7802_CHANNEL_2 = 1,
+};
+
+enum Scale_Registers {
+  NAU7802_PU_CTRL = 0x00,
+  NAU7802_CTRL1,
+  NAU7802_CTRL2,
+  NAU7802_I2C_CONTROL = 0x11,
+};
+
+enum I2C_Control_Bits {
+  NAU7802_I2C_CONTROL_BGPCP = 0,
+  NAU7802_I2C_CONTROL_TS = 1,
+};
+
+class NAU7802 {
+ public:
+  bool begin(TwoWire &wirePort = Wire, bool reset = true);
+  bool isConnected();
+  bool available();
+  int32_t getReading();
+  int32_t getAverage(uint8_t samplesToTake, unsigned long timeout_ms = 1000);
+
+  bool setGain(uint8_t gainValue);
+  bool setSampleRate(uint8_t rate);
+  bool setChannel(uint8_t channelNumber);
+  bool calibrateAFE();
+  bool powerUp();
+  bool powerDown();
+
+  void calculateZeroOffset(uint8_t averageAmount = 8, unsigned long timeout_ms = 1000);
+  void setZeroOffset(int32_t newZeroOffset) { zeroOffset_ = newZeroOffset; }
+  int32_t getZeroOffset() const { return zeroOffset_; }
+  void calculateCalibrationFactor(float weightOnScale, uint8_t averageAmount = 8, unsigned long timeout_ms = 1000);
+  void setCalibrationFactor(float f) { calibrationFactor_ = f; }
+  float getCalibrationFactor() const { return calibrationFactor_; }
+  float getWeight(bool allowNegativeWeights = false, uint8_t samplesToTake = 8, unsigned long timeout_ms = 1000);
+
+  bool setBit(uint8_t bitNumber, uint8_t registerAddress);
+  bool clearBit(uint8_t bitNumber, uint8_t registerAddress);
+  bool getBit(uint8_t bitNumber, uint8_t registerAddress);
+  uint8_t getRegister(uint8_t registerAddress);
+  bool setRegister(uint8_t registerAddress, uint8_t value);
+
+  uint32_t samplePeriodUs() const;
+  uint64_t nextReadyUs() const;  // shim: when DRDY goes high
+
+ private:
+  TwoWire *wire_ = nullptr;
+  uint8_t rate_ = NAU7802_SPS_10;
+  uint8_t regs_[0x20] = {};
+  int32_t zeroOffset_ = 0;
+  float calibrationFactor_ = 1.0f;
+  uint64_t lastConversion_ = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <WiFi.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef enum { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_DELETE } HTTPMethod;
+
+// WebServer stand-in: routes are dispatched by shim::webRequest() instead of
+// a socket; handleClient() is a no-op.
+class WebServer {
+ public:
+  typedef std::function<void()> THandlerFunction;
+
+  explicit WebServer(int port = 80);
+  ~WebServer();
+  void begin() { running_ = true; }
+  void stop() { running_ = false; }
+  void close() { running_ = false; }
+  void handleClient() {}
+
+  void on(const String &uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void on(const String &uri, HTTPMethod method, THandlerFunction fn);
+  void onNotFound(THandlerFunction fn) { notFound_ = fn; }
+
+  String uri() const { return uri_; }
+  HTTPMethod method() const { return method_; }
+  String arg(const String &name) const;
+  bool hasArg(const String &name) const;
+  int args() const { return (int)args_.size(); }
+
+  void send(int code, const char *contentType, const String &content);
+  void send(int code, const char *contentType = nullptr, const char *content = "") {
+    send(code, contentType, String(content));
+  }
+  void setContentLength(size_t len) { (void)len; }
+  void sendHeader(const String &name, const String &value, bool first = false);
+  // Basic auth against shim::setWebCredentials(); 401 to ask for it.
+  bool authenticate(const char *user, const char *password);
+  void requestAuthentication();
+  void sendContent(const String &content) { body_ += content; }
+  void sendContent(const char *content, size_t len) { body_ += String(std::string(content, len)); }
+  template <typename T>
+  size_t streamFile(T &file, const String &contentType, int code = 200) {
+    std::string data;
+    uint8_t buf[256];
+    size_t n;
+    while ((n = file.read(buf, sizeof(buf))) > 0) data.append(reinterpret_cast<const char *>(buf), n);
+    send(code, contentType.c_str(), String(data));
+    return data.size();
+  }
+
+  // Used by shim::webRequest().
+  int dispatch_(HTTPMethod method, const std::string &uri,
+                const std::vector<std::pair<std::string, std::string>> &args, std::string *body);
+
+ private:
+  struct Route {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+  };
+  std::vector<Route> routes_;
+  THandlerFunction notFound_;
+  bool running_ = false;
+  String uri_;
+  HTTPMethod method_ = HTTP_GET;
+  std::vector<std::pair<std::string, std::string>> args_;
+  int code_ = 0;
+  String body_;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "WiFiClient.h"
+
+// Wi-Fi stand-in: availability and connect delay come from
+// shim::setWifiAvailable(); connecting completes in virtual time.
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+class WiFiClass {
+ public:
+  wl_status_t status();
+  bool mode(wifi_mode_t m);
+  wifi_mode_t getMode() const { return mode_; }
+  bool setAutoReconnect(bool on) { (void)on; return true; }
+  wl_status_t begin(const char *ssid, const char *pass = nullptr);
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  bool reconnect();
+  void macAddress(uint8_t *mac);
+  String macAddress();
+  bool softAP(const char *ssid, const char *pass = nullptr);
+  bool softAPdisconnect(bool wifiOff = false);
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  uint8_t softAPgetStationNum();
+  IPAddress localIP();
+  int8_t RSSI() { return -58; }
+  bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+  bool setSleep(wifi_ps_type_t type) {
+    ps_ = type;
+    return true;
+  }
+  bool getSleep() const { return ps_ != WIFI_PS_NONE; }
+  wifi_ps_type_t getSleepType() const { return ps_; }
+  int hostByName(const char *host, IPAddress &result);
+
+ private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  wifi_ps_type_t ps_ = WIFI_PS_MIN_MODEM;
+  bool connecting_ = false;
+  uint64_t connectAtUs_ = 0;
+};
+
+extern WiFiClass WiFi;
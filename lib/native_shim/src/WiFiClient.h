@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+#include "IPAddress.h"
+
+// TCP client stand-in. connect() costs shim::setTlsConnectMs() of virtual
+// time and succeeds while Wi-Fi is up; no bytes flow (HTTPClient is shimmed
+// at the request level).
+class WiFiClient : public Stream {
+ public:
+  virtual ~WiFiClient() {}
+  virtual int connect(IPAddress ip, uint16_t port);
+  virtual int connect(const char *host, uint16_t port);
+  virtual void stop() { connected_ = false; }
+  virtual uint8_t connected() { return connected_ ? 1 : 0; }
+  size_t write(uint8_t c) override { (void)c; return 1; }
+  size_t write(const uint8_t *buf, size_t n) override { (void)buf; return n; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void setTimeout(uint32_t s) { (void)s; }
+  operator bool() { return connected_; }
+
+ protected:
+  bool connected_ = false;
+};
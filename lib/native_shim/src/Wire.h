@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+// I2C bus stand-in: devices listed with shim::setI2cDevices() ACK their
+// address; transactions and bytes are counted per bus.
+class TwoWire : public Stream {
+ public:
+  explicit TwoWire(int bus = 0) : bus_(bus) {}
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  void setClock(uint32_t hz) { clockHz_ = hz; }
+  uint32_t getClock() const { return clockHz_; }
+  void beginTransmission(uint8_t addr);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t addr, uint8_t n, bool sendStop = true);
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t n) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int bus() const { return bus_; }
+
+ private:
+  int bus_;
+  uint8_t addr_ = 0;
+  uint32_t clockHz_ = 100000;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
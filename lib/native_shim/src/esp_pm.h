@@ -0,0 +1,17 @@
+#pragma once
+// Power management stand-in: esp_pm_configure() with light_sleep_enable
+// turns time blocked in delay() into light sleep (shim::lightSleepUs()).
+// shim::setPmSupported(false) models a build without CONFIG_PM_ENABLE.
+#include <esp_sleep.h>
+
+#ifndef ESP_ERR_NOT_SUPPORTED
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#endif
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_esp32_t;
+
+esp_err_t esp_pm_configure(const void *config);
@@ -0,0 +1,11 @@
+#pragma once
+// Sleep wake-source stand-in. Light sleep itself is automatic (esp_pm.h):
+// while it is enabled, time blocked in delay() counts as light sleep.
+#include <cstdint>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uartNum);
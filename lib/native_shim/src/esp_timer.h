@@ -0,0 +1,5 @@
+#pragma once
+// 64-bit microsecond timer since boot, on virtual time like micros().
+#include <cstdint>
+
+int64_t esp_timer_get_time();
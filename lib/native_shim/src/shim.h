@@ -0,0 +1,148 @@
+#pragma once
+// Control surface of the host-native hardware shims ([env:native]).
+//
+// The firmware sees the usual Arduino/ESP32 headers; host programs use this
+// header to drive virtual time, the simulated load cell, card presentations,
+// Wi-Fi state and HTTP responses.
+//
+// Time is virtual: millis()/micros() return shim time and delay() advances it,
+// so a 3 s stability window costs microseconds of host CPU. Nothing here is
+// thread-safe; one simulated station per process (or per thread with care).
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace shim {
+
+// ---------------- Virtual time ----------------
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+void resetTime(uint64_t us = 0);
+// Real time instead: millis() follows the host clock from here on and
+// delay() sleeps (for programs that talk to real servers).
+void setRealTime(bool on);
+
+// ---------------- NAU7802 load cell model ----------------
+struct LoadCellModel {
+  int32_t offsetCounts = 8000;        // raw counts with an empty scale
+  float countsPerGram = -13.48f;      // matches SCALE_CAL_FACTOR_DEFAULT
+  float noiseCounts = 6.0f;           // gaussian noise, 1 sigma
+  // Load in grams as a function of virtual time (us).
+  std::function<float(uint64_t)> loadGrams = [](uint64_t) { return 0.0f; };
+  bool present = true;
+  // Temperature (C) over virtual time and what it does to the bridge: the
+  // zero moves by zeroCountsPerC, the span by spanPerC (relative), both
+  // from 25 C. The NAU7802's sensor reads it as the datasheet describes its
+  // output (typical mV at 25 C, uV/C), converted at gain 1 with a full scale
+  // of vrefMv / 2, independently of the firmware's NAU7802_TEMP_COUNTS_*.
+  std::function<float(uint64_t)> tempC = [](uint64_t) { return 25.0f; };
+  float zeroCountsPerC = 0.0f;
+  float spanPerC = 0.0f;
+  float tempMv25C = 109.0f;
+  float tempUvPerC = 360.0f;
+  float vrefMv = 3300.0f;
+};
+LoadCellModel &loadCell();
+// Raw counts the model produces at time t (without noise).
+int32_t loadCellCountsAt(uint64_t us);
+// The NAU7802 temperature sensor's counts at time t (gain 1, without noise).
+int32_t loadCellTempCountsAt(uint64_t us);
+// Conversions delivered so far (getReading calls that returned new data).
+uint64_t loadCellConversions();
+// Virtual time the next conversion is ready (now if one is waiting).
+uint64_t loadCellNextReadyUs();
+// GPIO the DRDY output is wired to (-1: not wired). digitalRead() on it is
+// HIGH while a conversion is waiting.
+void setDrdyPin(int pin);
+int drdyPin();
+
+// ---------------- Serial-interface ADCs (HX711, ADS1232) ----------------
+// Bit-banged part on GPIOs, driven by loadCell() like the NAU7802 stand-in:
+// DOUT is low while a conversion waits, SCK rising edges shift it out MSB
+// first (24 bits, then extra pulses), the rate pin selects 10 (low) or
+// 80 SPS (high; ratePin -1: 10 SPS). ADS1232: a 26th pulse starts an offset
+// calibration that holds DOUT high for ~8 conversions. Replaces the NAU7802
+// as the source of loadCellNextReadyUs()/DRDY while set.
+enum class SerialAdc { None, Hx711, Ads1232 };
+void setSerialAdc(SerialAdc kind, int doutPin, int sckPin, int ratePin);
+// Level last written with digitalWrite().
+int pinLevel(int pin);
+
+// ---------------- System ----------------
+// ESP.restart() calls; the host keeps running through them.
+uint32_t restarts();
+// Wall clock as SNTP would set it: Unix seconds at the current virtual time,
+// then following virtual time. 0: not set (getLocalTime() fails).
+void setWallClock(uint32_t unixS);
+
+// ---------------- Light sleep ----------------
+// Virtual time spent in delay() while esp_pm_configure() has automatic
+// light sleep on, and the number of such waits.
+uint64_t lightSleepUs();
+uint64_t lightSleeps();
+// false: esp_pm_configure() fails as without CONFIG_PM_ENABLE (default true).
+void setPmSupported(bool on);
+
+// ---------------- RFID ----------------
+// Presents a card (UID bytes) to the reader between [fromUs, toUs).
+void presentCard(const std::vector<uint8_t> &uid, uint64_t fromUs, uint64_t toUs);
+void clearCards();
+
+// ---------------- I2C ----------------
+// Devices answering on bus 0 (LCD + RFID) and bus 1 (NAU7802).
+void setI2cDevices(int bus, const std::vector<uint8_t> &addrs);
+uint64_t i2cTransactions(int bus);
+uint64_t i2cBytes(int bus);
+void resetI2cCounters();
+
+// ---------------- LCD ----------------
+std::string lcdRow(int row);
+uint64_t lcdCharsWritten();
+
+// ---------------- Wi-Fi / HTTP ----------------
+void setWifiAvailable(bool up, uint32_t connectDelayMs = 300);
+// Phones associated with the station's own access point (softAPgetStationNum).
+void setApStations(uint8_t n);
+// WiFi.begin() calls so far.
+uint32_t wifiBegins();
+void setTlsConnectMs(uint32_t ms);
+// WiFi.hostByName() cost (default 20 ms) and how often it was called.
+void setDnsMs(uint32_t ms);
+uint32_t dnsLookups();
+
+struct HttpResponse {
+  int code = 200;
+  std::string body;
+  uint32_t latencyMs = 80;  // advanced in virtual time by GET()
+};
+using HttpHandler = std::function<HttpResponse(const std::string &url)>;
+void setHttpHandler(HttpHandler h);
+// URLs requested through HTTPClient::GET, in order.
+const std::vector<std::string> &httpRequests();
+void clearHttpRequests();
+
+// Invokes a route registered on a WebServer instance (method "GET"/"POST").
+// Returns the status code; the response body is stored in *body.
+int webRequest(const std::string &method, const std::string &uri,
+               const std::vector<std::pair<std::string, std::string>> &args, std::string *body);
+// Basic auth credentials sent with the following webRequest() calls; empty
+// user: none.
+void setWebCredentials(const std::string &user, const std::string &password);
+
+// ---------------- Serial ----------------
+void serialInput(const std::string &bytes);
+void setSerialEcho(bool echo);  // copy Serial output to stdout
+const std::string &serialOutput();
+void clearSerialOutput();
+
+// ---------------- Flash filesystem ----------------
+// LittleFS is mapped to this host directory (default /tmp/fishcore_shimfs).
+void setFsRoot(const std::string &dir);
+// Partition size LittleFS.totalBytes() reports (default 1408 KB, the
+// default table). Files take whole 4 KB blocks, each directory a metadata
+// pair; a write that needs a block past it stops short, as on ENOSPC.
+void setFsCapacity(size_t bytes);
+
+} // namespace shim
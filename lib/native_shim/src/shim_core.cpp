@@ -0,0 +1,265 @@
+// Arduino core, Serial, ESP, FreeRTOS and heap stand-ins on virtual time.
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <random>
+
+namespace {
+uint64_t g_nowUs = 0;
+bool g_realTime = false;
+std::chrono::steady_clock::time_point g_realEpoch;
+std::deque<char> g_serialIn;
+std::string g_serialOut;
+bool g_serialEcho = false;
+std::mt19937 g_rng(12345);
+
+// Automatic light sleep (esp_pm_configure) and its totals.
+constexpr uint64_t kWakeUpUs = 250;  // clock/flash restart after wake
+bool g_pmSupported = true;
+bool g_autoLightSleep = false;
+uint64_t g_sleepUs = 0;
+uint64_t g_sleeps = 0;
+uint32_t g_restarts = 0;
+uint32_t g_wallClockS = 0;  // at g_wallClockUs; 0: not set
+uint64_t g_wallClockUs = 0;
+} // namespace
+
+namespace shim {
+uint64_t nowUs() {
+  if (!g_realTime) return g_nowUs;
+  return g_nowUs + (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - g_realEpoch)
+                       .count();
+}
+void advanceUs(uint64_t us) {
+  if (g_realTime) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    g_nowUs += us;
+  }
+}
+void resetTime(uint64_t us) {
+  g_nowUs = us;
+  g_realEpoch = std::chrono::steady_clock::now();
+}
+void setRealTime(bool on) {
+  g_nowUs = nowUs();
+  g_realTime = on;
+  g_realEpoch = std::chrono::steady_clock::now();
+}
+
+void serialInput(const std::string &bytes) {
+  for (char c : bytes) g_serialIn.push_back(c);
+}
+void setSerialEcho(bool echo) { g_serialEcho = echo; }
+const std::string &serialOutput() { return g_serialOut; }
+void clearSerialOutput() { g_serialOut.clear(); }
+uint64_t lightSleepUs() { return g_sleepUs; }
+uint64_t lightSleeps() { return g_sleeps; }
+void setPmSupported(bool on) { g_pmSupported = on; }
+uint32_t restarts() { return g_restarts; }
+void setWallClock(uint32_t unixS) {
+  g_wallClockS = unixS;
+  g_wallClockUs = nowUs();
+}
+} // namespace shim
+
+unsigned long millis() { return (unsigned long)(shim::nowUs() / 1000); }
+unsigned long micros() { return (unsigned long)shim::nowUs(); }
+// Blocked in delay(): with automatic light sleep on, the idle task puts the
+// chip to sleep for the whole wait and it pays the wake-up on return.
+void delay(unsigned long ms) {
+  if (g_autoLightSleep && ms > 0) {
+    g_sleepUs += (uint64_t)ms * 1000;
+    g_sleeps++;
+    shim::advanceUs((uint64_t)ms * 1000 + kWakeUpUs);
+    return;
+  }
+  shim::advanceUs((uint64_t)ms * 1000);
+}
+void delayMicroseconds(unsigned int us) { shim::advanceUs(us); }
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+// digitalRead/digitalWrite: shim_periph.cpp (DRDY and the serial ADC pins).
+void attachInterrupt(uint8_t, void (*)(), int) {}
+void detachInterrupt(uint8_t) {}
+
+// ---------------- Light sleep ----------------
+esp_err_t esp_sleep_enable_uart_wakeup(int) { return ESP_OK; }
+
+esp_err_t esp_pm_configure(const void *config) {
+  if (!g_pmSupported) return ESP_ERR_NOT_SUPPORTED;
+  g_autoLightSleep = static_cast<const esp_pm_config_esp32_t *>(config)->light_sleep_enable;
+  return ESP_OK;
+}
+
+long random(long max) { return max <= 0 ? 0 : (long)(g_rng() % (unsigned long)max); }
+long random(long min, long max) { return max <= min ? min : min + random(max - min); }
+void randomSeed(unsigned long seed) { g_rng.seed((uint32_t)seed); }
+
+void configTime(long, int, const char *, const char *, const char *) {}
+
+bool getLocalTime(struct tm *info, uint32_t) {
+  if (g_wallClockS == 0) return false;
+  const time_t t = (time_t)(g_wallClockS + (shim::nowUs() - g_wallClockUs) / 1000000);
+  localtime_r(&t, info);
+  return true;
+}
+
+// ---------------- String ----------------
+std::string String::fmtInt_(long v, unsigned char base) {
+  if (v < 0 && base == 10) return "-" + fmtUInt_((unsigned long)(-v), base);
+  return fmtUInt_((unsigned long)v, base);
+}
+
+std::string String::fmtUInt_(unsigned long v, unsigned char base) {
+  if (base < 2 || base > 16) base = 10;
+  char buf[72];
+  int i = (int)sizeof(buf) - 1;
+  buf[i] = '\0';
+  do {
+    buf[--i] = "0123456789ABCDEF"[v % base];
+    v /= base;
+  } while (v != 0 && i > 0);
+  return std::string(buf + i);
+}
+
+std::string String::fmtFloat_(double v, unsigned int decimals) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  return buf;
+}
+
+void String::trim() {
+  const size_t b = s_.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) {
+    s_.clear();
+    return;
+  }
+  const size_t e = s_.find_last_not_of(" \t\r\n");
+  s_ = s_.substr(b, e - b + 1);
+}
+
+void String::toLowerCase() {
+  for (char &c : s_) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+  for (char &c : s_) c = (char)toupper((unsigned char)c);
+}
+
+// ---------------- Print / Stream ----------------
+size_t Print::printf(const char *fmt, ...) {
+  char small[128];
+  va_list ap;
+  va_start(ap, fmt);
+  const int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write(reinterpret_cast<const uint8_t *>(small), (size_t)n);
+  std::string big((size_t)n + 1, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&big[0], big.size(), fmt, ap);
+  va_end(ap);
+  return write(reinterpret_cast<const uint8_t *>(big.data()), (size_t)n);
+}
+
+size_t Stream::readBytes(char *buf, size_t n) {
+  size_t got = 0;
+  while (got < n) {
+    const int c = read();
+    if (c < 0) break;
+    buf[got++] = (char)c;
+  }
+  return got;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string s;
+  int c;
+  while ((c = read()) >= 0 && c != terminator) s += (char)c;
+  return String(s);
+}
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t n) {
+  g_serialOut.append(reinterpret_cast<const char *>(buf), n);
+  // Keep the capture bounded for long simulated runs.
+  if (g_serialOut.size() > (1u << 20)) g_serialOut.erase(0, g_serialOut.size() - (1u << 19));
+  if (g_serialEcho) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+int HardwareSerial::available() { return (int)g_serialIn.size(); }
+
+int HardwareSerial::read() {
+  if (g_serialIn.empty()) return -1;
+  const char c = g_serialIn.front();
+  g_serialIn.pop_front();
+  return (uint8_t)c;
+}
+
+int HardwareSerial::peek() { return g_serialIn.empty() ? -1 : (uint8_t)g_serialIn.front(); }
+
+// ---------------- ESP ----------------
+EspClass ESP;
+
+void EspClass::restart() { g_restarts++; }
+uint32_t EspClass::getFreeHeap() { return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMinFreeHeap() { return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMaxAllocHeap() { return (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getHeapSize() { return 327680; }
+
+// Cycle counter on virtual time at 240 MHz, so Metrics timers report what
+// the device would spend in delays and bus waits rather than host CPU time.
+uint32_t EspClass::getCycleCount() { return (uint32_t)(shim::nowUs() * 240); }
+
+int64_t esp_timer_get_time() { return (int64_t)shim::nowUs(); }
+
+size_t heap_caps_get_free_size(uint32_t) { return 180000; }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return 170000; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return 110000; }
+
+// ---------------- FreeRTOS ----------------
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t) {
+  static int dummy;
+  if (handle) *handle = &dummy;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  static int loopTask;
+  return &loopTask;
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t period) {
+  const TickType_t next = *previousWake + period;
+  const TickType_t now = (TickType_t)millis();
+  if ((int32_t)(next - now) > 0) delay(next - now);
+  *previousWake = next;
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
@@ -0,0 +1,134 @@
+// LittleFS stand-in on a host directory.
+#include <LittleFS.h>
+
+#include <algorithm>
+#include <filesystem>
+
+namespace {
+constexpr size_t kBlock = 4096;
+constexpr size_t kUnknown = (size_t)-1;
+
+std::string g_root = "/tmp/fishcore_shimfs";
+size_t g_capacity = 1408 * 1024;
+size_t g_used = kUnknown;  // recounted after removes, renames and truncations
+
+std::string hostPath(const char *path) { return g_root + (path[0] == '/' ? "" : "/") + path; }
+size_t blocks(size_t bytes) { return (bytes + kBlock - 1) / kBlock; }
+} // namespace
+
+namespace shim {
+void setFsRoot(const std::string &dir) {
+  g_root = dir;
+  g_used = kUnknown;
+}
+void setFsCapacity(size_t bytes) { g_capacity = bytes; }
+} // namespace shim
+
+LittleFSFS LittleFS;
+
+bool LittleFSFS::begin(bool, const char *, uint8_t, const char *) {
+  std::error_code ec;
+  std::filesystem::create_directories(g_root, ec);
+  return !ec;
+}
+
+bool LittleFSFS::format() {
+  std::error_code ec;
+  std::filesystem::remove_all(g_root, ec);
+  g_used = kUnknown;
+  return begin();
+}
+
+size_t LittleFSFS::totalBytes() { return g_capacity; }
+
+size_t LittleFSFS::usedBytes() {
+  if (g_used != kUnknown) return g_used;
+  size_t n = 2 * kBlock;  // root metadata pair
+  std::error_code ec;
+  for (const auto &e : std::filesystem::recursive_directory_iterator(g_root, ec)) {
+    if (e.is_regular_file()) n += blocks((size_t)e.file_size()) * kBlock;
+    else if (e.is_directory()) n += 2 * kBlock;
+  }
+  g_used = n;
+  return n;
+}
+
+namespace fs {
+
+size_t File::write(const uint8_t *buf, size_t n) {
+  if (!f_) return 0;
+  const size_t size = this->size();
+  const size_t pos = append_ ? size : position();
+  const size_t grow = blocks(std::max(size, pos + n)) - blocks(size);
+  const size_t used = LittleFS.usedBytes();
+  if (grow > 0 && used + grow * kBlock > g_capacity) {
+    // Out of space: fill what is left of the last block.
+    const size_t room = g_capacity >= used ? (g_capacity - used) / kBlock : 0;
+    n = std::min(n, (blocks(size) + room) * kBlock - std::min(pos, (blocks(size) + room) * kBlock));
+  }
+  const size_t written = fwrite(buf, 1, n, f_.get());
+  g_used = used + (blocks(std::max(size, pos + written)) - blocks(size)) * kBlock;
+  return written;
+}
+size_t File::read(uint8_t *buf, size_t n) { return f_ ? fread(buf, 1, n, f_.get()) : 0; }
+int File::read() { return f_ ? fgetc(f_.get()) : -1; }
+
+int File::peek() {
+  if (!f_) return -1;
+  const int c = fgetc(f_.get());
+  if (c != EOF) ungetc(c, f_.get());
+  return c;
+}
+
+int File::available() { return f_ ? (int)(size() - position()) : 0; }
+void File::flush() {
+  if (f_) fflush(f_.get());
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!f_) return false;
+  const int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+  return fseek(f_.get(), (long)pos, whence) == 0;
+}
+
+size_t File::position() const { return f_ ? (size_t)ftell(f_.get()) : 0; }
+
+size_t File::size() const {
+  if (!f_) return 0;
+  const long cur = ftell(f_.get());
+  fseek(f_.get(), 0, SEEK_END);
+  const long end = ftell(f_.get());
+  fseek(f_.get(), cur, SEEK_SET);
+  return (size_t)end;
+}
+
+File FS::open(const char *path, const char *mode, bool) {
+  const char *m = "rb";
+  if (mode[0] == 'w') m = (mode[1] == '+') ? "w+b" : "w+b";
+  else if (mode[0] == 'a') m = "a+b";
+  else if (mode[1] == '+') m = "r+b";
+  FILE *f = fopen(hostPath(path).c_str(), m);
+  if (f == nullptr) return File();
+  if (mode[0] == 'w') g_used = kUnknown;
+  return File(std::shared_ptr<FILE>(f, fclose), path, mode[0] == 'a');
+}
+
+bool FS::exists(const char *path) { return std::filesystem::exists(hostPath(path)); }
+
+bool FS::remove(const char *path) {
+  g_used = kUnknown;
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  g_used = kUnknown;
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  std::error_code ec;
+  g_used = kUnknown;
+  return std::filesystem::create_directories(hostPath(path), ec) || !ec;
+}
+
+} // namespace fs
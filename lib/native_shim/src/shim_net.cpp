@@ -0,0 +1,327 @@
+// Wi-Fi, TCP/TLS, HTTP client, WebServer and Preferences stand-ins.
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WebServer.h>
+#include <WiFi.h>
+
+#include <map>
+#include <vector>
+
+namespace {
+bool g_wifiAvailable = true;
+uint32_t g_wifiConnectDelayMs = 300;
+uint8_t g_apStations = 0;
+uint32_t g_wifiBegins = 0;
+uint32_t g_tlsConnectMs = 350;
+uint32_t g_dnsMs = 20;
+uint32_t g_dnsLookups = 0;
+
+shim::HttpHandler g_httpHandler = [](const std::string &) { return shim::HttpResponse{}; };
+std::vector<std::string> g_httpRequests;
+
+std::vector<WebServer *> g_servers;
+std::string g_webUser;
+std::string g_webPassword;
+
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> g_nvs;
+
+// Read-only Stream over an HTTP response body.
+class BodyStream : public Stream {
+ public:
+  explicit BodyStream(const String &body) : body_(body.str()) {}
+  size_t write(uint8_t) override { return 0; }
+  int available() override { return (int)(body_.size() - pos_); }
+  int read() override { return pos_ < body_.size() ? (uint8_t)body_[pos_++] : -1; }
+  int peek() override { return pos_ < body_.size() ? (uint8_t)body_[pos_] : -1; }
+
+ private:
+  std::string body_;
+  size_t pos_ = 0;
+};
+
+std::string hostOf(const std::string &url) {
+  size_t b = url.find("://");
+  b = (b == std::string::npos) ? 0 : b + 3;
+  const size_t e = url.find_first_of(":/", b);
+  return url.substr(b, e == std::string::npos ? std::string::npos : e - b);
+}
+} // namespace
+
+namespace shim {
+void setWifiAvailable(bool up, uint32_t connectDelayMs) {
+  g_wifiAvailable = up;
+  g_wifiConnectDelayMs = connectDelayMs;
+}
+void setApStations(uint8_t n) { g_apStations = n; }
+uint32_t wifiBegins() { return g_wifiBegins; }
+void setTlsConnectMs(uint32_t ms) { g_tlsConnectMs = ms; }
+void setDnsMs(uint32_t ms) { g_dnsMs = ms; }
+uint32_t dnsLookups() { return g_dnsLookups; }
+void setHttpHandler(HttpHandler h) { g_httpHandler = std::move(h); }
+const std::vector<std::string> &httpRequests() { return g_httpRequests; }
+void clearHttpRequests() { g_httpRequests.clear(); }
+
+int webRequest(const std::string &method, const std::string &uri,
+               const std::vector<std::pair<std::string, std::string>> &args, std::string *body) {
+  const HTTPMethod m = method == "POST" ? HTTP_POST : HTTP_GET;
+  for (WebServer *s : g_servers) {
+    const int code = s->dispatch_(m, uri, args, body);
+    if (code != 0) return code;
+  }
+  return 0;  // no server listening
+}
+void setWebCredentials(const std::string &user, const std::string &password) {
+  g_webUser = user;
+  g_webPassword = password;
+}
+} // namespace shim
+
+// ---------------- WiFi ----------------
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+wl_status_t WiFiClass::status() {
+  if (!connecting_ || !g_wifiAvailable) return WL_DISCONNECTED;
+  return shim::nowUs() >= connectAtUs_ ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::mode(wifi_mode_t m) {
+  mode_ = m;
+  if (m == WIFI_AP || m == WIFI_OFF) connecting_ = false;
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char *, const char *) {
+  g_wifiBegins++;
+  connecting_ = true;
+  connectAtUs_ = shim::nowUs() + (uint64_t)g_wifiConnectDelayMs * 1000;
+  return status();
+}
+
+bool WiFiClass::disconnect(bool, bool) {
+  connecting_ = false;
+  return true;
+}
+
+bool WiFiClass::reconnect() {
+  begin(nullptr);
+  return true;
+}
+
+void WiFiClass::macAddress(uint8_t *mac) {
+  const uint8_t m[6] = {0x24, 0x6F, 0x28, 0xA1, 0xB2, 0xC3};
+  memcpy(mac, m, 6);
+}
+
+String WiFiClass::macAddress() { return String("24:6F:28:A1:B2:C3"); }
+
+bool WiFiClass::softAP(const char *, const char *) {
+  if (mode_ == WIFI_OFF) mode_ = WIFI_AP;
+  return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool) { return true; }
+
+uint8_t WiFiClass::softAPgetStationNum() { return mode_ == WIFI_AP || mode_ == WIFI_AP_STA ? g_apStations : 0; }
+
+IPAddress WiFiClass::localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress(); }
+
+int WiFiClass::hostByName(const char *, IPAddress &result) {
+  if (status() != WL_CONNECTED) return 0;
+  g_dnsLookups++;
+  delay(g_dnsMs);
+  result = IPAddress(203, 0, 113, 10);
+  return 1;
+}
+
+int WiFiClient::connect(IPAddress, uint16_t) {
+  if (WiFi.status() != WL_CONNECTED) return 0;
+  delay(g_tlsConnectMs);
+  connected_ = true;
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+  return connect(ip, port);
+}
+
+// ---------------- HTTPClient ----------------
+bool HTTPClient::begin(WiFiClient &client, const String &url) {
+  client_ = &client;
+  url_ = url;
+  return url.startsWith("http");
+}
+
+bool HTTPClient::begin(const String &url) {
+  static WiFiClient plain;
+  return begin(plain, url);
+}
+
+void HTTPClient::end() {
+  delete stream_;
+  stream_ = nullptr;
+  // Keep-alive: a connected client stays connected for reuse.
+}
+
+int HTTPClient::GET() {
+  if (client_ == nullptr) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!client_->connected() && !client_->connect(hostOf(url_.str()).c_str(), 443)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  g_httpRequests.push_back(url_.str());
+  const shim::HttpResponse r = g_httpHandler(url_.str());
+  if (r.latencyMs > timeoutMs_) {
+    delay(timeoutMs_);
+    client_->stop();
+    return HTTPC_ERROR_READ_TIMEOUT;
+  }
+  delay(r.latencyMs);
+  if (r.code <= 0) client_->stop();
+  body_ = String(r.body);
+  return r.code;
+}
+
+Stream *HTTPClient::getStreamPtr() {
+  delete stream_;
+  stream_ = new BodyStream(body_);
+  return stream_;
+}
+
+String HTTPClient::errorToString(int error) {
+  switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return String("connection refused");
+    case HTTPC_ERROR_NOT_CONNECTED: return String("not connected");
+    case HTTPC_ERROR_CONNECTION_LOST: return String("connection lost");
+    case HTTPC_ERROR_READ_TIMEOUT: return String("read Timeout");
+    default: return String();
+  }
+}
+
+// ---------------- WebServer ----------------
+WebServer::WebServer(int) { g_servers.push_back(this); }
+
+WebServer::~WebServer() {
+  for (size_t i = 0; i < g_servers.size(); ++i) {
+    if (g_servers[i] == this) {
+      g_servers.erase(g_servers.begin() + (long)i);
+      break;
+    }
+  }
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn) {
+  routes_.push_back({uri, method, fn});
+}
+
+String WebServer::arg(const String &name) const {
+  for (const auto &a : args_) {
+    if (a.first == name.str()) return String(a.second);
+  }
+  return String();
+}
+
+bool WebServer::hasArg(const String &name) const {
+  for (const auto &a : args_) {
+    if (a.first == name.str()) return true;
+  }
+  return false;
+}
+
+void WebServer::send(int code, const char *, const String &content) {
+  code_ = code;
+  body_ = content;
+}
+
+void WebServer::sendHeader(const String &, const String &, bool) {}
+
+bool WebServer::authenticate(const char *user, const char *password) {
+  return !g_webUser.empty() && g_webUser == user && g_webPassword == password;
+}
+
+void WebServer::requestAuthentication() { send(401, "text/plain", String("Unauthorized")); }
+
+int WebServer::dispatch_(HTTPMethod method, const std::string &uri,
+                         const std::vector<std::pair<std::string, std::string>> &args, std::string *body) {
+  if (!running_) return 0;
+  uri_ = String(uri);
+  method_ = method;
+  args_ = args;
+  code_ = 0;
+  body_ = "";
+  THandlerFunction fn = notFound_;
+  for (const Route &r : routes_) {
+    if (r.uri.str() == uri && (r.method == HTTP_ANY || r.method == method)) {
+      fn = r.fn;
+      break;
+    }
+  }
+  if (!fn) return 0;
+  fn();
+  if (body) *body = body_.str();
+  return code_;
+}
+
+// ---------------- Preferences ----------------
+bool Preferences::begin(const char *name, bool readOnly) {
+  ns_ = name;
+  readOnly_ = readOnly;
+  if (readOnly && g_nvs.find(ns_) == g_nvs.end()) {
+    ns_.clear();
+    return false;  // like NVS: a missing namespace cannot be opened read-only
+  }
+  g_nvs[ns_];
+  return true;
+}
+
+bool Preferences::clear() {
+  if (ns_.empty() || readOnly_) return false;
+  g_nvs[ns_].clear();
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (ns_.empty() || readOnly_) return false;
+  return g_nvs[ns_].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) { return !ns_.empty() && g_nvs[ns_].count(key) > 0; }
+
+size_t Preferences::putString(const char *key, const char *value) {
+  const size_t n = strlen(value);
+  putBytes(key, value, n + 1);
+  return n;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue) {
+  if (!isKey(key)) return defaultValue;
+  const auto &v = g_nvs[ns_][key];
+  return String(std::string(v.begin(), v.end()).c_str());
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen) {
+  return getBytes(key, value, maxLen);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (ns_.empty() || readOnly_) return 0;
+  const uint8_t *p = static_cast<const uint8_t *>(value);
+  g_nvs[ns_][key] = std::vector<uint8_t>(p, p + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  if (!isKey(key)) return 0;
+  const auto &v = g_nvs[ns_][key];
+  if (v.size() > maxLen) return 0;
+  memcpy(buf, v.data(), v.size());
+  return v.size();
+}
+
+size_t Preferences::getBytesLength(const char *key) { return isKey(key) ? g_nvs[ns_][key].size() : 0; }
@@ -0,0 +1,382 @@
+// I2C bus, LCD, NAU7802, HX711/ADS1232 (GPIO) and MFRC522 stand-ins.
+#include <LiquidCrystal_PCF8574.h>
+#include <MFRC522_I2C.h>
+#include <SparkFun_Qwiic_Scale_NAU7802_Arduino_Library.h>
+#include <Wire.h>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+constexpr int kLcdCols = 20;
+constexpr int kLcdRows = 4;
+
+std::vector<uint8_t> g_devices[2] = {{0x27, 0x28}, {0x2A}};
+uint64_t g_i2cTx[2] = {};
+uint64_t g_i2cBytes[2] = {};
+
+char g_lcd[kLcdRows][kLcdCols];
+uint64_t g_lcdChars = 0;
+
+shim::LoadCellModel g_cell;
+uint64_t g_conversions = 0;
+const NAU7802 *g_adc = nullptr;  // last begin(); drives DRDY
+int g_drdyPin = -1;
+std::mt19937 g_noiseRng(777);
+std::normal_distribution<float> g_noise(0.0f, 1.0f);
+
+// Bit-banged HX711/ADS1232 (shim::setSerialAdc).
+struct SerialAdcModel {
+  shim::SerialAdc kind = shim::SerialAdc::None;
+  int dout = -1, sck = -1, rate = -1;
+  uint32_t periodUs = 100000;
+  uint64_t lastConversion = 0;  // index of the last conversion taken
+  uint64_t busyUntilUs = 0;     // ADS1232 offset calibration
+  uint32_t value = 0;           // conversion being shifted out
+  int pulses = 0;               // SCK rising edges since it was latched
+
+  bool ready(uint64_t now) const {
+    return kind != shim::SerialAdc::None && now >= busyUntilUs && now / periodUs > lastConversion;
+  }
+  uint64_t nextReadyUs(uint64_t now) const {
+    if (ready(now)) return now;
+    const uint64_t next = (lastConversion + 1) * periodUs;
+    return std::max(next, busyUntilUs);
+  }
+};
+SerialAdcModel g_serial;
+uint8_t g_pinLevel[64] = {};
+
+struct Presentation {
+  std::vector<uint8_t> uid;
+  uint64_t fromUs;
+  uint64_t toUs;
+  bool halted;
+};
+std::vector<Presentation> g_cards;
+
+void countI2c(int bus, size_t bytes) {
+  if (bus < 0 || bus > 1) return;
+  g_i2cTx[bus]++;
+  g_i2cBytes[bus] += bytes;
+}
+} // namespace
+
+namespace shim {
+LoadCellModel &loadCell() { return g_cell; }
+uint64_t loadCellConversions() { return g_conversions; }
+
+uint64_t loadCellNextReadyUs() {
+  if (g_serial.kind != SerialAdc::None) return g_serial.nextReadyUs(nowUs());
+  if (g_adc == nullptr) return UINT64_MAX;
+  return g_adc->nextReadyUs();
+}
+
+void setDrdyPin(int pin) { g_drdyPin = pin; }
+int drdyPin() { return g_drdyPin; }
+
+int32_t loadCellCountsAt(uint64_t us) {
+  const float dT = g_cell.tempC(us) - 25.0f;
+  return g_cell.offsetCounts +
+         (int32_t)lroundf(g_cell.zeroCountsPerC * dT +
+                          g_cell.loadGrams(us) * g_cell.countsPerGram * (1.0f + g_cell.spanPerC * dT));
+}
+
+int32_t loadCellTempCountsAt(uint64_t us) {
+  const float mv = g_cell.tempMv25C + (g_cell.tempC(us) - 25.0f) * g_cell.tempUvPerC / 1000.0f;
+  return (int32_t)lroundf(mv / (0.5f * g_cell.vrefMv) * 8388608.0f);  // 2^23 counts = vref / 2 at gain 1
+}
+
+void setSerialAdc(SerialAdc kind, int doutPin, int sckPin, int ratePin) {
+  g_serial = SerialAdcModel();
+  g_serial.kind = kind;
+  g_serial.dout = doutPin;
+  g_serial.sck = sckPin;
+  g_serial.rate = ratePin;
+  g_serial.periodUs = ratePin >= 0 && pinLevel(ratePin) == HIGH ? 12500 : 100000;
+  g_serial.lastConversion = nowUs() / g_serial.periodUs;
+  g_serial.pulses = 25;  // idle: DOUT follows data ready
+}
+
+int pinLevel(int pin) { return pin >= 0 && pin < 64 ? g_pinLevel[pin] : LOW; }
+
+void presentCard(const std::vector<uint8_t> &uid, uint64_t fromUs, uint64_t toUs) {
+  g_cards.push_back({uid, fromUs, toUs, false});
+}
+void clearCards() { g_cards.clear(); }
+
+void setI2cDevices(int bus, const std::vector<uint8_t> &addrs) {
+  if (bus >= 0 && bus <= 1) g_devices[bus] = addrs;
+}
+uint64_t i2cTransactions(int bus) { return (bus >= 0 && bus <= 1) ? g_i2cTx[bus] : 0; }
+uint64_t i2cBytes(int bus) { return (bus >= 0 && bus <= 1) ? g_i2cBytes[bus] : 0; }
+void resetI2cCounters() {
+  g_i2cTx[0] = g_i2cTx[1] = 0;
+  g_i2cBytes[0] = g_i2cBytes[1] = 0;
+}
+
+std::string lcdRow(int row) {
+  if (row < 0 || row >= kLcdRows) return "";
+  return std::string(g_lcd[row], kLcdCols);
+}
+uint64_t lcdCharsWritten() { return g_lcdChars; }
+} // namespace shim
+
+// ---------------- GPIO ----------------
+int digitalRead(uint8_t pin) {
+  const uint64_t now = shim::nowUs();
+  if ((int)pin == g_serial.dout && g_serial.kind != shim::SerialAdc::None) {
+    if (g_serial.pulses >= 1 && g_serial.pulses <= 24) return (g_serial.value >> (24 - g_serial.pulses)) & 1;
+    return g_serial.ready(now) ? LOW : HIGH;
+  }
+  if ((int)pin == shim::drdyPin()) return shim::loadCellNextReadyUs() <= now ? HIGH : LOW;
+  return LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  const uint8_t was = pin < 64 ? g_pinLevel[pin] : LOW;
+  if (pin < 64) g_pinLevel[pin] = val ? HIGH : LOW;
+  SerialAdcModel &m = g_serial;
+  if (m.kind == shim::SerialAdc::None) return;
+  const uint64_t now = shim::nowUs();
+
+  if ((int)pin == m.rate && was != val) {
+    m.periodUs = val ? 12500 : 100000;
+    m.lastConversion = now / m.periodUs;  // the conversion in flight restarts
+    return;
+  }
+  if ((int)pin != m.sck || !val || was) return;  // SCK rising edges only
+
+  if (m.pulses >= 25 && m.ready(now)) {
+    // First edge of a read: latch the waiting conversion.
+    m.lastConversion = now / m.periodUs;
+    int32_t counts = shim::loadCellCountsAt(now) + (int32_t)lroundf(g_noise(g_noiseRng) * g_cell.noiseCounts);
+    counts = std::max(-0x800000, std::min(0x7FFFFF, counts));
+    m.value = (uint32_t)counts & 0xFFFFFF;
+    m.pulses = 1;
+    g_conversions++;
+    return;
+  }
+  if (m.pulses < 25) {
+    m.pulses++;
+    return;
+  }
+  // Pulses after the 25th: HX711 gain/channel select (ignored); ADS1232
+  // offset calibration on the 26th.
+  if (++m.pulses == 26 && m.kind == shim::SerialAdc::Ads1232) {
+    m.busyUntilUs = now + 8ull * m.periodUs + m.periodUs / 8;
+    m.lastConversion = m.busyUntilUs / m.periodUs;
+  }
+}
+
+// ---------------- TwoWire ----------------
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+bool TwoWire::begin(int, int, uint32_t frequency) {
+  if (frequency) clockHz_ = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t addr) { addr_ = addr; }
+
+uint8_t TwoWire::endTransmission(bool) {
+  countI2c(bus_, 1);
+  const auto &devs = g_devices[bus_ & 1];
+  return std::find(devs.begin(), devs.end(), addr_) != devs.end() ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t n, bool) {
+  countI2c(bus_, n);
+  return 0;
+}
+
+size_t TwoWire::write(uint8_t) { return 1; }
+size_t TwoWire::write(const uint8_t *, size_t n) { return n; }
+
+// ---------------- LCD ----------------
+void LiquidCrystal_PCF8574::begin(int, int) { clear(); }
+
+void LiquidCrystal_PCF8574::setCursor(int col, int row) {
+  col_ = col;
+  row_ = row;
+  countI2c(0, 4);
+}
+
+void LiquidCrystal_PCF8574::clear() {
+  memset(g_lcd, ' ', sizeof(g_lcd));
+  col_ = row_ = 0;
+  countI2c(0, 4);
+  delay(2);  // HD44780 clear takes ~1.5 ms
+}
+
+size_t LiquidCrystal_PCF8574::write(uint8_t c) {
+  if (row_ >= 0 && row_ < kLcdRows && col_ >= 0 && col_ < kLcdCols) g_lcd[row_][col_] = (char)c;
+  col_++;
+  g_lcdChars++;
+  countI2c(0, 4);  // two nibbles, each strobed with EN high/low
+  return 1;
+}
+
+// ---------------- NAU7802 ----------------
+bool NAU7802::begin(TwoWire &wirePort, bool) {
+  wire_ = &wirePort;
+  lastConversion_ = shim::nowUs() / samplePeriodUs();
+  g_adc = this;
+  return isConnected();
+}
+
+bool NAU7802::isConnected() {
+  if (wire_ == nullptr) return false;
+  wire_->beginTransmission(0x2A);
+  return g_cell.present && wire_->endTransmission() == 0;
+}
+
+uint32_t NAU7802::samplePeriodUs() const {
+  switch (rate_) {
+    case NAU7802_SPS_320: return 3125;
+    case NAU7802_SPS_80: return 12500;
+    case NAU7802_SPS_40: return 25000;
+    case NAU7802_SPS_20: return 50000;
+    default: return 100000;
+  }
+}
+
+uint64_t NAU7802::nextReadyUs() const {
+  const uint64_t now = shim::nowUs();
+  if (now / samplePeriodUs() > lastConversion_) return now;
+  return (lastConversion_ + 1) * samplePeriodUs();
+}
+
+bool NAU7802::available() {
+  countI2c(1, 1);
+  return shim::nowUs() / samplePeriodUs() > lastConversion_;
+}
+
+int32_t NAU7802::getReading() {
+  countI2c(1, 3);
+  lastConversion_ = shim::nowUs() / samplePeriodUs();
+  g_conversions++;
+  // The latest completed conversion: the load when it finished, not when
+  // it is read (a late read must not shift a vibration's phase).
+  const uint64_t t = lastConversion_ * samplePeriodUs();
+  const int32_t noise = (int32_t)lroundf(g_noise(g_noiseRng) * g_cell.noiseCounts);
+  // Temperature sensor selected (gain 1): the PGA's noise is the same.
+  if (getBit(NAU7802_I2C_CONTROL_TS, NAU7802_I2C_CONTROL)) return shim::loadCellTempCountsAt(t) + noise;
+  return shim::loadCellCountsAt(t) + noise;
+}
+
+int32_t NAU7802::getAverage(uint8_t samplesToTake, unsigned long timeout_ms) {
+  long total = 0;
+  uint8_t acquired = 0;
+  const unsigned long start = millis();
+  while (true) {
+    if (available()) {
+      total += getReading();
+      if (++acquired == samplesToTake) break;
+    }
+    if (millis() - start > timeout_ms) return 0;
+    delay(1);
+  }
+  return (int32_t)(total / samplesToTake);
+}
+
+bool NAU7802::setGain(uint8_t gainValue) {
+  regs_[NAU7802_CTRL1] = (regs_[NAU7802_CTRL1] & 0xF8) | (gainValue & 0x07);
+  return true;
+}
+
+bool NAU7802::setSampleRate(uint8_t rate) {
+  rate_ = rate;
+  lastConversion_ = shim::nowUs() / samplePeriodUs();
+  return true;
+}
+
+bool NAU7802::setChannel(uint8_t) { return true; }
+
+bool NAU7802::calibrateAFE() {
+  delay(5);
+  return true;
+}
+
+bool NAU7802::powerUp() { return true; }
+bool NAU7802::powerDown() { return true; }
+
+void NAU7802::calculateZeroOffset(uint8_t averageAmount, unsigned long timeout_ms) {
+  setZeroOffset(getAverage(averageAmount, timeout_ms));
+}
+
+void NAU7802::calculateCalibrationFactor(float weightOnScale, uint8_t averageAmount, unsigned long timeout_ms) {
+  const int32_t onScale = getAverage(averageAmount, timeout_ms);
+  setCalibrationFactor((onScale - zeroOffset_) / weightOnScale);
+}
+
+float NAU7802::getWeight(bool allowNegativeWeights, uint8_t samplesToTake, unsigned long timeout_ms) {
+  int32_t onScale = getAverage(samplesToTake, timeout_ms);
+  if (!allowNegativeWeights && onScale < zeroOffset_) onScale = zeroOffset_;
+  return (onScale - zeroOffset_) / calibrationFactor_;
+}
+
+bool NAU7802::setBit(uint8_t bitNumber, uint8_t reg) {
+  regs_[reg & 0x1F] |= (uint8_t)(1 << bitNumber);
+  countI2c(1, 2);
+  return true;
+}
+
+bool NAU7802::clearBit(uint8_t bitNumber, uint8_t reg) {
+  regs_[reg & 0x1F] &= (uint8_t)~(1 << bitNumber);
+  countI2c(1, 2);
+  return true;
+}
+
+bool NAU7802::getBit(uint8_t bitNumber, uint8_t reg) { return (regs_[reg & 0x1F] >> bitNumber) & 1; }
+uint8_t NAU7802::getRegister(uint8_t reg) { return regs_[reg & 0x1F]; }
+
+bool NAU7802::setRegister(uint8_t reg, uint8_t value) {
+  regs_[reg & 0x1F] = value;
+  countI2c(1, 2);
+  return true;
+}
+
+// ---------------- MFRC522 ----------------
+MFRC522_I2C::MFRC522_I2C(uint8_t chipAddress, uint8_t, TwoWire *wire) : addr_(chipAddress), wire_(wire) {}
+
+void MFRC522_I2C::PCD_Init() { countI2c(0, 16); }
+
+bool MFRC522_I2C::PICC_IsNewCardPresent() {
+  countI2c(0, 8);  // REQA round trip
+  delayMicroseconds(900);
+  const uint64_t now = shim::nowUs();
+  for (size_t i = 0; i < g_cards.size(); ++i) {
+    Presentation &p = g_cards[i];
+    if (now >= p.fromUs && now < p.toUs && !p.halted) {
+      current_ = (int)i;
+      return true;
+    }
+  }
+  current_ = -1;
+  return false;
+}
+
+bool MFRC522_I2C::PICC_ReadCardSerial() {
+  if (current_ < 0) return false;
+  countI2c(0, 16);  // anticollision + select
+  delayMicroseconds(2500);
+  const Presentation &p = g_cards[current_];
+  uid.size = (uint8_t)std::min<size_t>(p.uid.size(), sizeof(uid.uidByte));
+  memcpy(uid.uidByte, p.uid.data(), uid.size);
+  uid.sak = 0x08;
+  return true;
+}
+
+uint8_t MFRC522_I2C::PICC_HaltA() {
+  if (current_ >= 0) g_cards[current_].halted = true;
+  countI2c(0, 6);
+  return 0;
+}
+
+void MFRC522_I2C::PCD_WriteRegister(uint8_t, uint8_t) { countI2c(0, 2); }
+uint8_t MFRC522_I2C::PCD_ReadRegister(uint8_t) {
+  countI2c(0, 2);
+  return 0;
+}
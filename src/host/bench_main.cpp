@@ -0,0 +1,359 @@
+// Host benchmark for the weighing firmware ([env:native]).
+//
+// Part 1 boots the real setup()/loop() against the shims and runs scripted
+// weigh-ins in virtual time: load placed, card held, stable weight uploaded,
+// load removed. Its latency histograms are virtual time, i.e. what the
+// device would spend waiting on the ADC, LCD and network. Part 2 times the
+// loop-body building blocks (LCD row cache, RFID poll, ADC read, directory
+// lookup, metrics/log writes, weight formatting) in host ns/op.
+//
+//   pio run -e native && .pio/build/native/program [cycles] [--gap-s S] [--scan-s S] [--trace out.bin]
+//
+// --gap-s sets the time between crates (default 20 s); with gaps longer than
+// POWER_IDLE_AFTER_MS the station dozes in between, and the report shows
+// time per power mode, wake latencies and the estimated average current.
+// --scan-s sets when the card is held, in seconds after the crate lands
+// (default 1: while the load settles; 6 or more: after it is stable, with
+// the station asking for the ID); "scan -> upload GET" is measured from then.
+// Build with -DUPLOAD_PREWARM=0 for the numbers without the pre-warmed
+// upload connection.
+// --trace records the scenario with serial 'r' and copies the ADC trace to
+// out.bin, e.g. to try the replay tool without hardware.
+//
+// After the day the serial 'b' self benchmark runs once; its report is
+// printed with the metrics.
+//
+// Exit status is non-zero when the scenario does not upload every weigh-in
+// with the right ID and weight, or the self benchmark misses a section or
+// moves the calibration, so CI can run it as a smoke test.
+// `pio test -e native` builds src/ with the test suites, which bring their
+// own main().
+#ifndef PIO_UNIT_TESTING
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Wire.h>
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/event_log.h"
+#include "modules/id_directory.h"
+#include "modules/lcd_display.h"
+#include "modules/metrics.h"
+#include "modules/power.h"
+#include "modules/rfid2.h"
+#include "modules/scale.h"
+#include "shim.h"
+
+void setup();
+void loop();
+extern ScaleManager scale;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+bool g_selfBenchOk = true;
+
+double elapsedNs(Clock::time_point t0) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+template <typename Fn>
+void bench(const char *name, uint32_t iters, Fn fn) {
+  fn();  // warm caches / lazy init
+  const Clock::time_point t0 = Clock::now();
+  for (uint32_t i = 0; i < iters; ++i) fn();
+  printf("  %-36s %10.1f ns/op  (%u iters)\n", name, elapsedNs(t0) / iters, (unsigned)iters);
+}
+
+std::string freshFsRoot(const char *name) {
+  const std::string dir = (std::filesystem::temp_directory_path() / "fishcore_bench" / name).string();
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+  std::filesystem::create_directories(dir, ec);
+  shim::setFsRoot(dir);
+  return dir;
+}
+
+// UID i as the firmware prints it (4 bytes, upper-case hex).
+std::vector<uint8_t> uidBytes(uint32_t i) {
+  return {(uint8_t)(0x04), (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i};
+}
+
+std::string uidHex(uint32_t i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "04%06X", (unsigned)(i & 0xFFFFFF));
+  return buf;
+}
+
+std::string directoryBody(uint32_t cards) {
+  std::string body = "v 1 full\n";
+  char line[64];
+  for (uint32_t i = 0; i < cards; ++i) {
+    snprintf(line, sizeof(line), "+%s %02x Fisher %u\n", uidHex(i).c_str(), (i % 50 == 49) ? 1 : 0, (unsigned)i);
+    body += line;
+  }
+  return body + ". " + std::to_string(cards) + "\n";
+}
+
+bool isDirectoryUrl(const std::string &url) { return url.rfind(ID_DIRECTORY_SYNC_URL, 0) == 0; }
+
+// ---------------- Part 2: microbenchmarks ----------------
+void runMicro() {
+  printf("microbenchmarks (host time)\n");
+  shim::resetTime(0);
+  freshFsRoot("micro");
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+
+  LCDDisplay lcd;
+  uint8_t addr = 0;
+  lcd.begin(Wire, addr);
+  bench("LCDDisplay::printLine (unchanged)", 200000, [&] { lcd.printLine(0, "Weight  12.34 kg"); });
+  uint32_t n = 0;
+  bench("LCDDisplay::printLine (changed)", 20000, [&] {
+    char line[LCD_COLS + 1];
+    snprintf(line, sizeof(line), "Weight %6.2f kg", (n++ % 1000) / 100.0f);
+    lcd.printLine(0, line);
+  });
+
+  char l0[LCD_COLS + 1];
+  float kg = 0.0f;
+  bench("snprintf weight line", 200000, [&] {
+    snprintf(l0, sizeof(l0), "Weight %6.2f kg", kg);
+    kg += 0.01f;
+  });
+
+  RFID2 rfid;
+  rfid.begin(Wire);
+  char id[RFID2::kIdLen];
+  bench("RFID2::poll (no card)", 200000, [&] { rfid.poll(id); });
+
+  ScaleManager scale;
+  scale.begin();
+  bench("ScaleManager::getWeightKg", 2000, [&] { scale.getWeightKg(true); });
+
+  // Directory with 5000 cards, looked up through the same sync path as the device.
+  const uint32_t kCards = 5000;
+  const std::string body = directoryBody(kCards);
+  shim::setHttpHandler([&](const std::string &) { return shim::HttpResponse{200, body, 40}; });
+  shim::setWifiAvailable(true, 100);
+  WiFi.begin("bench", "bench");
+  delay(200);
+  IdDirectory dir;
+  dir.begin();
+  dir.sync();
+  printf("  (directory: %u cards)\n", (unsigned)dir.size());
+  uint32_t k = 0;
+  IdDirectory::Entry entry;
+  bench("IdDirectory::lookup (known)", 50000, [&] {
+    const std::string uid = uidHex((k++ * 7919) % kCards);
+    dir.lookup(uid.c_str(), &entry);
+  });
+  bench("IdDirectory::lookup (unknown)", 50000, [&] { dir.lookup("DEADBEEF", &entry); });
+
+  uint32_t us = 1;
+  bench("Metrics::recordUs", 1000000, [&] { Metrics::recordUs(Metrics::AdcRead, us++ & 0xFFFF); });
+
+  // The drain task does not run on the host, so after the first
+  // LOG_RING_RECORDS writes every call takes the full-ring (drop) path.
+  const Clock::time_point t0 = Clock::now();
+  const uint32_t kFill = LOG_RING_RECORDS / 2;
+  for (uint32_t i = 0; i < kFill; ++i) EventLog::write(EventLog::LogBench, 1, i, 0, 0);
+  printf("  %-36s %10.1f ns/op  (%u iters)\n", "EventLog::write (enqueue)", elapsedNs(t0) / kFill, (unsigned)kFill);
+  bench("EventLog::write (ring full)", 1000000, [&] { EventLog::write(EventLog::LogBench, 1, 1, 0, 0); });
+  printf("\n");
+}
+
+// ---------------- Part 1: virtual-time weigh-in scenario ----------------
+struct Cycle {
+  uint64_t placeUs;
+  uint64_t scanUs;
+  float grams;
+  std::string uid;
+  uint64_t uploadUs = 0;
+  std::string url;
+};
+
+// A crate dropped on the platform: overshoot and a damped bounce around the
+// final load, then a slow creep.
+float crateGrams(float grams, double t) {
+  if (t < 0) return 0.0f;
+  const double bounce = 0.35 * exp(-t / 0.6) * cos(2.0 * M_PI * 3.0 * t);
+  const double creep = 0.002 * (1.0 - exp(-t / 4.0));
+  return (float)(grams * (1.0 + bounce + creep));
+}
+
+int runScenario(uint32_t cycles, uint32_t gapS, uint32_t scanS, const char *tracePath) {
+  printf("weigh-in scenario (virtual time, %u cycles, %u s apart, card at +%u s, pre-warm %s)\n", (unsigned)cycles,
+         (unsigned)gapS, (unsigned)scanS, UPLOAD_PREWARM ? "on" : "off");
+  shim::resetTime(0);
+  const std::string fsRoot = freshFsRoot("scenario");
+  shim::setWifiAvailable(true, 400);
+  shim::setTlsConnectMs(350);
+  shim::clearHttpRequests();
+  shim::setDrdyPin(SCALE_DRDY_PIN);
+#if SCALE_ADC == SCALE_ADC_HX711 || SCALE_ADC == SCALE_ADC_ADS1232
+  shim::setSerialAdc(SCALE_ADC == SCALE_ADC_HX711 ? shim::SerialAdc::Hx711 : shim::SerialAdc::Ads1232,
+                     SERIAL_ADC_DOUT_PIN, SERIAL_ADC_SCK_PIN, SERIAL_ADC_RATE_PIN);
+#endif
+
+  const uint64_t kBootUs = 20ull * 1000 * 1000;
+  const uint64_t kPeriodUs = (uint64_t)gapS * 1000 * 1000;
+  const uint64_t kHoldUs = 12ull * 1000 * 1000;
+
+  std::vector<Cycle> plan;
+  for (uint32_t i = 0; i < cycles; ++i) {
+    Cycle c;
+    c.placeUs = kBootUs + i * kPeriodUs;
+    c.grams = 4000.0f + 750.0f * (float)(i % 13);
+    c.uid = uidHex(100 + i);
+    c.scanUs = c.placeUs + (uint64_t)scanS * 1000000;
+    plan.push_back(c);
+    // Card held for 3 s.
+    shim::presentCard(uidBytes(100 + i), c.scanUs, c.scanUs + 3000000);
+  }
+
+  shim::loadCell().loadGrams = [&](uint64_t now) -> float {
+    for (const Cycle &c : plan) {
+      if (now >= c.placeUs && now < c.placeUs + kHoldUs) return crateGrams(c.grams, (now - c.placeUs) / 1e6);
+    }
+    return 0.0f;
+  };
+
+  const std::string dirBody = directoryBody(1000);
+  size_t nextUpload = 0;
+  shim::setHttpHandler([&](const std::string &url) {
+    if (isDirectoryUrl(url)) return shim::HttpResponse{200, dirBody, 120};
+    if (nextUpload < plan.size()) {
+      plan[nextUpload].uploadUs = shim::nowUs();
+      plan[nextUpload].url = url;
+    }
+    nextUpload++;
+    return shim::HttpResponse{200, "OK", 90};
+  });
+
+  const Clock::time_point t0 = Clock::now();
+  setup();
+  if (tracePath != nullptr) shim::serialInput("r");
+  uint64_t loops = 0;
+  const uint64_t endUs = kBootUs + cycles * kPeriodUs;
+  while (shim::nowUs() < endUs) {
+    loop();
+    loops++;
+  }
+  const double hostNs = elapsedNs(t0);
+  if (tracePath != nullptr) {
+    shim::serialInput("r");
+    loop();
+    std::error_code ec;
+    std::filesystem::copy_file(fsRoot + ADC_TRACE_PATH, tracePath, std::filesystem::copy_options::overwrite_existing,
+                               ec);
+    printf("  trace                 %s\n", ec ? "copy failed" : tracePath);
+  }
+
+  // Serial 'b' after the day: every section reports and the calibration
+  // is left as it was.
+  const long zeroBefore = scale.zeroOffset();
+  const float calBefore = scale.calFactor();
+  shim::clearSerialOutput();
+  shim::serialInput("b");
+  loop();
+  const std::string benchOut = shim::serialOutput();
+  for (const char *section : {"bench: adc", "bench: lcd", "bench: rfid", "bench: i2c", "bench: wifi", "bench: tls"}) {
+    g_selfBenchOk &= benchOut.find(section) != std::string::npos;
+  }
+  g_selfBenchOk &= benchOut.find("FAILED") == std::string::npos && scale.zeroOffset() == zeroBefore &&
+                   scale.calFactor() == calBefore;
+
+  int failures = 0;
+  double sumLatency = 0.0;
+  double sumScan = 0.0;
+  for (size_t i = 0; i < plan.size(); ++i) {
+    const Cycle &c = plan[i];
+    // .../uploadWeightIns/1/<uid>/1/<kg>; the weight may be off by the
+    // creep and noise the model adds, so compare with a 1% tolerance.
+    const std::string expected = "/" + c.uid + "/1/";
+    const size_t at = c.url.find(expected);
+    const float kg = at == std::string::npos ? -1.0f : strtof(c.url.c_str() + at + expected.size(), nullptr);
+    if (c.uploadUs == 0 || at == std::string::npos || fabsf(kg * 1000.0f - c.grams) > c.grams * 0.01f) {
+      failures++;
+      printf("  cycle %zu: expected ...%s%.2f, got %s\n", i, expected.c_str(), c.grams / 1000.0f,
+             c.url.empty() ? "(no upload)" : c.url.c_str());
+      continue;
+    }
+    sumLatency += (c.uploadUs - c.placeUs) / 1e6;
+    sumScan += (c.uploadUs - c.scanUs) / 1e6;
+  }
+
+  const double virtualS = shim::nowUs() / 1e6;
+  printf("  virtual time          %10.1f s\n", virtualS);
+  printf("  host time             %10.1f ms  (%.0fx real time)\n", hostNs / 1e6, virtualS * 1e9 / hostNs);
+  printf("  loop() iterations     %10llu  (%.1f us host each)\n", (unsigned long long)loops, hostNs / 1e3 / (double)loops);
+  printf("  uploads               %10zu / %zu\n", nextUpload, plan.size());
+  if (failures < (int)plan.size()) {
+    const double ok = (double)(plan.size() - failures);
+    printf("  place -> upload       %10.2f s mean (virtual)\n", sumLatency / ok);
+    printf("  scan -> upload GET    %10.3f s mean (virtual)\n", sumScan / ok);
+  }
+  printf("  DNS lookups           %10u\n", (unsigned)shim::dnsLookups());
+  printf("  ADC conversions       %10llu\n", (unsigned long long)shim::loadCellConversions());
+  printf("  I2C bytes bus0/bus1   %10llu / %llu\n", (unsigned long long)shim::i2cBytes(0),
+         (unsigned long long)shim::i2cBytes(1));
+  printf("  LCD chars written     %10llu\n", (unsigned long long)shim::lcdCharsWritten());
+  printf("  light sleep           %10.1f s in %llu sleeps\n", shim::lightSleepUs() / 1e6,
+         (unsigned long long)shim::lightSleeps());
+
+  // The same histograms the device serves on /metrics, from the virtual run.
+  std::string metrics;
+  if (shim::webRequest("GET", "/metrics", {}, &metrics) == 200) {
+    printf("  /metrics              %10zu bytes\n", metrics.size());
+  }
+  printf("\nself benchmark (serial 'b', virtual time)%s\n%s\n", g_selfBenchOk ? "" : ": FAILED", benchOut.c_str());
+  shim::clearSerialOutput();
+  Metrics::printText(Serial);
+  Power::printText(Serial);
+  printf("%s\n", shim::serialOutput().c_str());
+  // The model and the handler point into this frame.
+  shim::loadCell().loadGrams = [](uint64_t) { return 0.0f; };
+  shim::setHttpHandler([](const std::string &) { return shim::HttpResponse{}; });
+  return failures;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t cycles = 20;
+  uint32_t gapS = 20;
+  uint32_t scanS = 1;
+  const char *tracePath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (strcmp(argv[i], "--gap-s") == 0 && i + 1 < argc) {
+      gapS = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--scan-s") == 0 && i + 1 < argc) {
+      scanS = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else {
+      cycles = (uint32_t)strtoul(argv[i], nullptr, 10);
+    }
+  }
+  const int failures = runScenario(cycles, gapS < 15 ? 15 : gapS, scanS > 8 ? 8 : scanS, tracePath);
+  runMicro();
+  if (failures != 0) {
+    printf("FAIL: %d of %u weigh-ins not uploaded correctly\n", failures, (unsigned)cycles);
+    return 1;
+  }
+  if (!g_selfBenchOk) {
+    printf("FAIL: self benchmark report incomplete or calibration changed\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
+
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,675 @@
+// Fleet load generator for the upload backend ([env:fleet]).
+//
+// Runs N scales as N processes. Each one runs the firmware's own
+// WiFiManager, IdDirectory and Uploader against the shims, on real time
+// (shim::setRealTime), and the shim's HTTP handler forwards every request to
+// --server over a real socket (TLS unverified when https, as setInsecure()
+// does on the device). Point it at tools/ingest_standin.py, or at a staging
+// backend.
+//
+// The day is scripted per dock, in simulated seconds, and played back --speed
+// times faster; request latencies, timeouts and retry backoff stay real:
+//   - background weigh-ins, Poisson at --rate per scale per hour
+//   - boats landing (--boats-per-hour per dock): every scale on the dock
+//     weighs --crates-per-boat crates back to back
+//   - the directory sync every ID_DIRECTORY_SYNC_PERIOD_MS
+//   - Wi-Fi outages per dock (weigh-ins fail with "No internet"; the driver
+//     reconnects when the AP returns)
+//   - power outages per dock: the scales reboot when power returns, so a
+//     whole dock connects and syncs at once (boot storm); weigh-ins while
+//     the dock is dark are lost
+// --power-outage-at / --wifi-outage-at force a site-wide outage at a given
+// simulated second, for a reproducible storm.
+//
+// The report covers weigh-in outcomes, client-side latency percentiles,
+// requests per weigh-in (retries), peak requests per second with and without
+// retries, and the peak right after power returns. --timeline writes one CSV
+// row per second.
+//
+//   pio run -e fleet && .pio/build/fleet/program --server http://127.0.0.1:8080
+//       [--scales 50] [--docks 5] [--duration-s 3600] [--speed 60] [--rate 30]
+//       [--boats-per-hour 2] [--crates-per-boat 8] [--wifi-outages-per-day 4]
+//       [--power-outages-per-day 1] [--power-outage-at S] [--wifi-outage-at S]
+//       [--outage-s 120] [--attempts 1] [--backoff-ms 1000] [--cards 2000]
+//       [--seed 1] [--timeline out.csv]
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "modules/id_directory.h"
+#include "modules/uploader.h"
+#include "modules/wifi_manager.h"
+#include "shim.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  std::string server = "http://127.0.0.1:8080";
+  int scales = 50;
+  int docks = 5;
+  double durationS = 3600.0;
+  double speed = 60.0;
+  double ratePerHour = 30.0;
+  double boatsPerHour = 2.0;
+  int cratesPerBoat = 8;
+  double wifiOutagesPerDay = 4.0;
+  double powerOutagesPerDay = 1.0;
+  std::vector<double> powerOutageAt;
+  std::vector<double> wifiOutageAt;
+  double outageS = 120.0;  // length of the forced outages
+  Uploader::Policy policy;
+  uint32_t cards = 2000;
+  uint32_t seed = 1;
+  const char *timeline = nullptr;
+};
+
+// ---------------- Real HTTP client ----------------
+struct Target {
+  bool tls = false;
+  std::string host;
+  std::string port;
+};
+
+bool parseServer(const std::string &url, Target &t) {
+  std::string rest;
+  if (url.rfind("https://", 0) == 0) {
+    t.tls = true;
+    rest = url.substr(8);
+  } else if (url.rfind("http://", 0) == 0) {
+    rest = url.substr(7);
+  } else {
+    return false;
+  }
+  rest = rest.substr(0, rest.find('/'));
+  const size_t colon = rest.find(':');
+  t.host = rest.substr(0, colon);
+  t.port = colon == std::string::npos ? (t.tls ? "443" : "80") : rest.substr(colon + 1);
+  return !t.host.empty();
+}
+
+// Path and query of a firmware URL ("https://fishcore.ph/a/b?c" -> "/a/b?c").
+std::string pathOf(const std::string &url) {
+  const size_t scheme = url.find("://");
+  const size_t slash = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+  return slash == std::string::npos ? "/" : url.substr(slash);
+}
+
+int remainingMs(Clock::time_point deadline) {
+  return (int)std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+}
+
+// GET over a fresh connection (the firmware does not reuse connections).
+// Errors map to the HTTPClient codes the firmware would see.
+shim::HttpResponse fetch(const Target &t, const std::string &path, uint32_t timeoutMs) {
+  static SSL_CTX *ctx = nullptr;
+  shim::HttpResponse r;
+  r.latencyMs = 0;  // real time has already passed
+  r.code = HTTPC_ERROR_CONNECTION_REFUSED;
+  const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+  addrinfo hints{}, *ai = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(t.host.c_str(), t.port.c_str(), &hints, &ai) != 0 || ai == nullptr) return r;
+  const int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0) {
+    freeaddrinfo(ai);
+    return r;
+  }
+
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+  freeaddrinfo(ai);
+  if (rc != 0 && errno == EINPROGRESS) {
+    pollfd p{fd, POLLOUT, 0};
+    rc = poll(&p, 1, remainingMs(deadline)) == 1 ? 0 : -1;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (rc == 0 && (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)) rc = -1;
+  }
+  if (rc != 0) {
+    close(fd);
+    return r;
+  }
+  fcntl(fd, F_SETFL, 0);
+  const int waitMs = std::max(1, remainingMs(deadline));
+  timeval tv{waitMs / 1000, (waitMs % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  SSL *ssl = nullptr;
+  if (t.tls) {
+    if (ctx == nullptr) {
+      ctx = SSL_CTX_new(TLS_client_method());
+      SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+    ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, t.host.c_str());
+    if (SSL_connect(ssl) != 1) {
+      SSL_free(ssl);
+      close(fd);
+      ERR_clear_error();
+      return r;
+    }
+  }
+
+  const std::string req = "GET " + path + " HTTP/1.0\r\nHost: " + t.host + "\r\nConnection: close\r\n\r\n";
+  const int sent = ssl ? SSL_write(ssl, req.data(), (int)req.size()) : (int)send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+
+  std::string resp;
+  bool timedOut = false;
+  char buf[4096];
+  while (sent == (int)req.size()) {
+    errno = 0;
+    const int n = ssl ? SSL_read(ssl, buf, sizeof(buf)) : (int)recv(fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      resp.append(buf, (size_t)n);
+      if (remainingMs(deadline) == 0) timedOut = true;
+      if (timedOut) break;
+      continue;
+    }
+    timedOut = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    break;
+  }
+  if (ssl) {
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    ERR_clear_error();
+  }
+  close(fd);
+
+  int code = 0;
+  if (timedOut) {
+    r.code = HTTPC_ERROR_READ_TIMEOUT;
+  } else if (sscanf(resp.c_str(), "HTTP/%*s %d", &code) == 1 && code > 0) {
+    r.code = code;
+    const size_t body = resp.find("\r\n\r\n");
+    r.body = body == std::string::npos ? std::string() : resp.substr(body + 4);
+  } else {
+    r.code = HTTPC_ERROR_CONNECTION_LOST;
+  }
+  return r;
+}
+
+// ---------------- Records (child -> parent over a pipe) ----------------
+enum Kind : uint8_t { KRequest, KWeighIn, KLost, KBoot };
+enum RequestFlags : uint8_t { FlagRetry = 0x01, FlagDirectory = 0x02 };
+
+// 16 bytes; writes up to PIPE_BUF are atomic, so children share one pipe.
+struct Record {
+  uint32_t ms;     // since the shared epoch
+  uint16_t scale;
+  uint8_t kind;
+  uint8_t flag;    // KRequest: RequestFlags; KWeighIn: Uploader::Status; KBoot: 1 = config portal
+  int16_t code;    // KRequest: HTTP code or HTTPC_ERROR_*; KWeighIn: attempts
+  uint16_t reserved;
+  uint32_t durMs;
+};
+static_assert(sizeof(Record) == 16, "Record layout");
+
+// ---------------- Schedule ----------------
+enum EvType : uint8_t { WeighIn, Sync, WifiDown, WifiUp, PowerOff, PowerOn };
+
+struct Ev {
+  double t;  // simulated seconds
+  EvType type;
+};
+
+struct Outage {
+  int dock;  // -1: every dock
+  double fromS, toS;
+  bool power;
+};
+
+std::vector<Outage> planOutages(const Config &cfg, std::mt19937 &rng) {
+  std::vector<Outage> out;
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  for (int d = 0; d < cfg.docks; ++d) {
+    for (int power = 0; power <= 1; ++power) {
+      const double perDay = power ? cfg.powerOutagesPerDay : cfg.wifiOutagesPerDay;
+      if (perDay <= 0) continue;
+      std::exponential_distribution<double> gap(perDay / 86400.0);
+      for (double t = gap(rng); t < cfg.durationS; t += gap(rng)) {
+        // Wi-Fi blips 30 s..5 min, power cuts 1..10 min
+        const double len = power ? 60.0 + 540.0 * u(rng) : 30.0 + 270.0 * u(rng);
+        out.push_back({d, t, t + len, power != 0});
+      }
+    }
+  }
+  for (double t : cfg.powerOutageAt) out.push_back({-1, t, t + cfg.outageS, true});
+  for (double t : cfg.wifiOutageAt) out.push_back({-1, t, t + cfg.outageS, false});
+  return out;
+}
+
+std::vector<double> planBoats(const Config &cfg, int dock, std::mt19937 &rng) {
+  std::vector<double> boats;
+  if (cfg.boatsPerHour <= 0) return boats;
+  std::mt19937 dockRng(rng() + (uint32_t)dock);
+  std::exponential_distribution<double> gap(cfg.boatsPerHour / 3600.0);
+  for (double t = gap(dockRng); t < cfg.durationS; t += gap(dockRng)) boats.push_back(t);
+  return boats;
+}
+
+std::vector<Ev> planScale(const Config &cfg, int scale, const std::vector<double> &boats,
+                          const std::vector<Outage> &outages) {
+  std::mt19937 rng(cfg.seed * 7919u + (uint32_t)scale);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  const int dock = scale % cfg.docks;
+  std::vector<Ev> ev;
+
+  if (cfg.ratePerHour > 0) {
+    std::exponential_distribution<double> gap(cfg.ratePerHour / 3600.0);
+    for (double t = gap(rng); t < cfg.durationS; t += gap(rng)) ev.push_back({t, WeighIn});
+  }
+  for (double boat : boats) {
+    // Crates from one boat, one every 20-40 s once the scale's fisher is up.
+    double t = boat + 60.0 * u(rng);
+    for (int i = 0; i < cfg.cratesPerBoat && t < cfg.durationS; ++i, t += 20.0 + 20.0 * u(rng)) {
+      ev.push_back({t, WeighIn});
+    }
+  }
+  const double syncS = ID_DIRECTORY_SYNC_PERIOD_MS / 1000.0;
+  for (double t = syncS * u(rng); t < cfg.durationS; t += syncS) ev.push_back({t, Sync});
+  for (const Outage &o : outages) {
+    if (o.dock >= 0 && o.dock != dock) continue;
+    ev.push_back({o.fromS, o.power ? PowerOff : WifiDown});
+    // A scale on a generator comes back a few seconds after the mains.
+    ev.push_back({o.toS + (o.power ? 5.0 * u(rng) : 0.0), o.power ? PowerOn : WifiUp});
+  }
+  std::stable_sort(ev.begin(), ev.end(), [](const Ev &a, const Ev &b) { return a.t < b.t; });
+  return ev;
+}
+
+// ---------------- One scale (child process) ----------------
+Clock::time_point g_epoch;
+int g_pipe = -1;
+uint16_t g_scale = 0;
+int g_sendRequests = 0;  // requests made by the current Uploader::send()
+
+uint32_t sinceEpochMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - g_epoch).count();
+}
+
+void emit(Kind kind, uint8_t flag, int code, uint32_t durMs) {
+  Record rec{sinceEpochMs(), g_scale, kind, flag, (int16_t)code, 0, durMs};
+  if (write(g_pipe, &rec, sizeof(rec)) != (ssize_t)sizeof(rec)) _exit(2);
+}
+
+void runScale(const Config &cfg, const Target &target, int scale, const std::vector<Ev> &plan) {
+  g_scale = (uint16_t)scale;
+  shim::setRealTime(true);
+  shim::setTlsConnectMs(0);  // the handshake happens for real in fetch()
+  randomSeed(cfg.seed * 104729u + (uint32_t)scale);
+  std::mt19937 rng(cfg.seed * 31u + (uint32_t)scale);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  const auto joinDelayMs = [&] { return (uint32_t)(800 + 1700 * u(rng)); };  // association + DHCP
+
+  const std::string fsRoot =
+      (std::filesystem::temp_directory_path() / "fishcore_fleet" / std::to_string(scale)).string();
+  std::error_code ec;
+  std::filesystem::remove_all(fsRoot, ec);
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+
+  shim::setHttpHandler([&](const std::string &url) {
+    const bool directory = url.rfind(ID_DIRECTORY_SYNC_URL, 0) == 0;
+    const uint8_t flags = (directory ? FlagDirectory : 0) | (!directory && g_sendRequests++ > 0 ? FlagRetry : 0);
+    const Clock::time_point t0 = Clock::now();
+    shim::HttpResponse r = fetch(target, pathOf(url), UPLOAD_HTTP_TIMEOUT_MS);
+    emit(KRequest, flags, r.code,
+         (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0).count());
+    return r;
+  });
+
+  WiFiManager wifi;
+  IdDirectory directory;
+  Uploader uploader;
+  bool wifiUp = true;
+  bool powered = true;
+
+  // What setupHardware() does for the network: join (or fall back to the
+  // portal), then the boot-time directory sync.
+  const auto boot = [&] {
+    const Clock::time_point t0 = Clock::now();
+    shim::setWifiAvailable(wifiUp, joinDelayMs());
+    WiFi.disconnect();
+    wifi = WiFiManager();
+    directory = IdDirectory();
+    WiFiManager::Credentials creds;
+    creds.ssid = String(WIFI_SSID);
+    creds.password = String(WIFI_PASS);
+    wifi.saveCredentials(creds);  // provisioned through the portal long ago
+    const bool ok = wifi.begin(8000, creds);
+    uploader.begin(wifi, scale + 1);
+    uploader.setPolicy(cfg.policy);
+    directory.begin();
+    if (ok) directory.sync();
+    emit(KBoot, wifi.isConfigPortalActive() ? 1 : 0, 0,
+         (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0).count());
+  };
+
+  boot();
+  for (const Ev &e : plan) {
+    std::this_thread::sleep_until(g_epoch + std::chrono::microseconds((int64_t)(e.t / cfg.speed * 1e6)));
+    switch (e.type) {
+      case WeighIn: {
+        if (!powered) {
+          emit(KLost, 0, 0, 0);
+          break;
+        }
+        char uid[16];
+        snprintf(uid, sizeof(uid), "04%06X", (unsigned)(rng() % cfg.cards));
+        const float kg = (float)(3.0 + 22.0 * u(rng));
+        g_sendRequests = 0;
+        const Clock::time_point t0 = Clock::now();
+        const Uploader::Result r = uploader.send(uid, kg);
+        emit(KWeighIn, (uint8_t)r.status, r.attempts,
+             (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t0).count());
+        break;
+      }
+      case Sync:
+        if (powered && wifi.isConnected()) directory.sync();
+        break;
+      case WifiDown:
+        wifiUp = false;
+        shim::setWifiAvailable(false);
+        break;
+      case WifiUp:
+        wifiUp = true;
+        shim::setWifiAvailable(true, joinDelayMs());
+        if (powered && !wifi.isConfigPortalActive()) WiFi.reconnect();  // driver auto-reconnect
+        break;
+      case PowerOff:
+        powered = false;
+        break;
+      case PowerOn:
+        powered = true;
+        boot();
+        break;
+    }
+  }
+}
+
+// ---------------- Report (parent) ----------------
+double pct(std::vector<uint32_t> &v, double q) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1)))];
+}
+
+void printLatency(const char *name, std::vector<uint32_t> &v) {
+  printf("  %-22s p50 %6.0f  p95 %6.0f  p99 %6.0f  max %6.0f ms  (n=%zu)\n", name, pct(v, 0.50), pct(v, 0.95),
+         pct(v, 0.99), pct(v, 1.0), v.size());
+}
+
+const char *statusName(uint8_t s) {
+  switch ((Uploader::Status)s) {
+    case Uploader::Status::Ok: return "ok";
+    case Uploader::Status::HttpError: return "http_error";
+    case Uploader::Status::NoWifi: return "no_wifi";
+    case Uploader::Status::ConnectFailed: return "connect_failed";
+    case Uploader::Status::BeginFailed: return "begin_failed";
+    case Uploader::Status::GetFailed: return "get_failed";
+  }
+  return "?";
+}
+
+std::string codeName(int code) {
+  switch (code) {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "refused";
+    case HTTPC_ERROR_CONNECTION_LOST: return "conn_lost";
+    case HTTPC_ERROR_READ_TIMEOUT: return "timeout";
+    default: return std::to_string(code);
+  }
+}
+
+struct Second {
+  uint32_t requests = 0, retries = 0, directory = 0, ok = 0, failed = 0, boots = 0;
+};
+
+void report(const Config &cfg, const std::vector<Record> &recs, const std::vector<Outage> &outages) {
+  std::vector<uint32_t> reqAll, reqUpload, weighOk, boot;
+  std::map<std::string, uint32_t> codes;
+  std::map<uint8_t, uint32_t> status;
+  std::vector<Second> secs;
+  uint32_t requests = 0, retries = 0, uploads = 0, weighIns = 0, lost = 0, boots = 0, portal = 0, retried = 0;
+
+  for (const Record &r : recs) {
+    const size_t s = r.ms / 1000;
+    if (secs.size() <= s) secs.resize(s + 1);
+    switch (r.kind) {
+      case KRequest:
+        requests++;
+        secs[s].requests++;
+        codes[codeName(r.code)]++;
+        reqAll.push_back(r.durMs);
+        if (r.flag & FlagDirectory) {
+          secs[s].directory++;
+        } else {
+          uploads++;
+          reqUpload.push_back(r.durMs);
+        }
+        if (r.flag & FlagRetry) {
+          retries++;
+          secs[s].retries++;
+        }
+        break;
+      case KWeighIn:
+        weighIns++;
+        status[r.flag]++;
+        if (r.code > 1) retried++;
+        if (r.flag == (uint8_t)Uploader::Status::Ok) {
+          secs[s].ok++;
+          weighOk.push_back(r.durMs);
+        } else {
+          secs[s].failed++;
+        }
+        break;
+      case KLost:
+        lost++;
+        break;
+      case KBoot:
+        boots++;
+        secs[s].boots++;
+        boot.push_back(r.durMs);
+        if (r.flag) portal++;
+        break;
+    }
+  }
+
+  printf("weigh-ins                %u  (+%u lost while the dock had no power)\n", weighIns, lost);
+  for (const auto &kv : status) {
+    printf("  %-22s %6u  %5.1f%%\n", statusName(kv.first), kv.second, weighIns ? 100.0 * kv.second / weighIns : 0.0);
+  }
+  printf("  retried                %6u  (%.2f upload requests per weigh-in)\n", retried,
+         weighIns ? (double)uploads / weighIns : 0.0);
+  printf("boots                    %u  (%u stuck in the config portal)\n", boots, portal);
+  printf("requests                 %u  (%u uploads, %u directory, %u retries = %.1f%%)\n", requests, uploads,
+         requests - uploads, retries, requests ? 100.0 * retries / requests : 0.0);
+  printf("  codes                 ");
+  for (const auto &kv : codes) printf(" %s %u", kv.first.c_str(), kv.second);
+  printf("\nclient latency\n");
+  printLatency("request (all)", reqAll);
+  printLatency("upload request", reqUpload);
+  printLatency("weigh-in (send)", weighOk);
+  printLatency("boot (join + sync)", boot);
+
+  uint32_t peak = 0, peakFirst = 0;
+  size_t peakAt = 0;
+  for (size_t s = 0; s < secs.size(); ++s) {
+    if (secs[s].requests > peak) {
+      peak = secs[s].requests;
+      peakAt = s;
+    }
+    peakFirst = std::max(peakFirst, secs[s].requests - secs[s].retries);
+  }
+  const double runS = cfg.durationS / cfg.speed;
+  printf("requests/s               mean %.1f, peak %u at %zus (%u without retries)\n", requests / runS, peak, peakAt,
+         peakFirst);
+
+  // Storms: the 10 s after each power restore.
+  for (const Outage &o : outages) {
+    if (!o.power || o.toS >= cfg.durationS) continue;
+    const size_t from = (size_t)(o.toS / cfg.speed);
+    uint32_t stormPeak = 0, stormReq = 0;
+    for (size_t s = from; s < std::min(secs.size(), from + 10); ++s) {
+      stormPeak = std::max(stormPeak, secs[s].requests);
+      stormReq += secs[s].requests;
+    }
+    if (o.dock < 0) {
+      printf("power back at %7.0f s    all docks: %u requests in 10 s, peak %u/s\n", o.toS, stormReq, stormPeak);
+    } else {
+      printf("power back at %7.0f s    dock %d: %u requests in 10 s, peak %u/s\n", o.toS, o.dock, stormReq, stormPeak);
+    }
+  }
+
+  if (cfg.timeline != nullptr) {
+    FILE *f = fopen(cfg.timeline, "w");
+    if (f != nullptr) {
+      fprintf(f, "second,requests,retries,directory,weighins_ok,weighins_failed,boots\n");
+      for (size_t s = 0; s < secs.size(); ++s) {
+        const Second &x = secs[s];
+        fprintf(f, "%zu,%u,%u,%u,%u,%u,%u\n", s, x.requests, x.retries, x.directory, x.ok, x.failed, x.boots);
+      }
+      fclose(f);
+      printf("timeline                 %s\n", cfg.timeline);
+    }
+  }
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage: fleet --server http[s]://host:port [--scales N] [--docks N] [--duration-s S] [--speed X]\n"
+          "             [--rate per-scale/h] [--boats-per-hour N] [--crates-per-boat N]\n"
+          "             [--wifi-outages-per-day N] [--power-outages-per-day N] [--power-outage-at S]\n"
+          "             [--wifi-outage-at S] [--outage-s S] [--attempts N] [--backoff-ms MS] [--cards N]\n"
+          "             [--seed N] [--timeline out.csv]\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Config cfg;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool v = i + 1 < argc;
+    if (a == "--server" && v) cfg.server = argv[++i];
+    else if (a == "--scales" && v) cfg.scales = atoi(argv[++i]);
+    else if (a == "--docks" && v) cfg.docks = atoi(argv[++i]);
+    else if (a == "--duration-s" && v) cfg.durationS = atof(argv[++i]);
+    else if (a == "--speed" && v) cfg.speed = atof(argv[++i]);
+    else if (a == "--rate" && v) cfg.ratePerHour = atof(argv[++i]);
+    else if (a == "--boats-per-hour" && v) cfg.boatsPerHour = atof(argv[++i]);
+    else if (a == "--crates-per-boat" && v) cfg.cratesPerBoat = atoi(argv[++i]);
+    else if (a == "--wifi-outages-per-day" && v) cfg.wifiOutagesPerDay = atof(argv[++i]);
+    else if (a == "--power-outages-per-day" && v) cfg.powerOutagesPerDay = atof(argv[++i]);
+    else if (a == "--power-outage-at" && v) cfg.powerOutageAt.push_back(atof(argv[++i]));
+    else if (a == "--wifi-outage-at" && v) cfg.wifiOutageAt.push_back(atof(argv[++i]));
+    else if (a == "--outage-s" && v) cfg.outageS = atof(argv[++i]);
+    else if (a == "--attempts" && v) cfg.policy.attempts = (uint8_t)atoi(argv[++i]);
+    else if (a == "--backoff-ms" && v) cfg.policy.backoffMs = (uint32_t)atoi(argv[++i]);
+    else if (a == "--cards" && v) cfg.cards = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--seed" && v) cfg.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--timeline" && v) cfg.timeline = argv[++i];
+    else return usage();
+  }
+  Target target;
+  if (!parseServer(cfg.server, target) || cfg.scales < 1 || cfg.docks < 1 || cfg.speed <= 0 || cfg.cards == 0) {
+    return usage();
+  }
+  cfg.docks = std::min(cfg.docks, cfg.scales);
+
+  std::mt19937 rng(cfg.seed);
+  const std::vector<Outage> outages = planOutages(cfg, rng);
+  std::vector<std::vector<double>> boats;
+  for (int d = 0; d < cfg.docks; ++d) boats.push_back(planBoats(cfg, d, rng));
+
+  printf("fleet: %d scales on %d docks -> %s, %.0f s simulated at %.0fx (%.0f s), %u attempt(s), backoff %u ms\n",
+         cfg.scales, cfg.docks, cfg.server.c_str(), cfg.durationS, cfg.speed, cfg.durationS / cfg.speed,
+         (unsigned)cfg.policy.attempts, (unsigned)cfg.policy.backoffMs);
+  printf("       %.0f weigh-ins/h per scale, %.1f boats/h per dock x %d crates, %zu outage(s) planned\n\n",
+         cfg.ratePerHour, cfg.boatsPerHour, cfg.cratesPerBoat, outages.size());
+  fflush(stdout);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  g_epoch = Clock::now() + std::chrono::milliseconds(200);  // every child starts on the same tick
+  std::vector<pid_t> children;
+  for (int s = 0; s < cfg.scales; ++s) {
+    const std::vector<Ev> plan = planScale(cfg, s, boats[s % cfg.docks], outages);
+    const pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      g_pipe = fds[1];
+      std::this_thread::sleep_until(g_epoch);
+      runScale(cfg, target, s, plan);
+      _exit(0);
+    }
+    children.push_back(pid);
+  }
+  close(fds[1]);
+
+  std::vector<Record> recs;
+  Record rec;
+  size_t got = 0;
+  for (;;) {
+    const ssize_t n = read(fds[0], reinterpret_cast<char *>(&rec) + got, sizeof(rec) - got);
+    if (n <= 0) break;
+    got += (size_t)n;
+    if (got == sizeof(rec)) {
+      recs.push_back(rec);
+      got = 0;
+    }
+  }
+  close(fds[0]);
+  int failedChildren = 0;
+  for (pid_t pid : children) {
+    int st = 0;
+    waitpid(pid, &st, 0);
+    if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) failedChildren++;
+  }
+
+  report(cfg, recs, outages);
+  if (failedChildren != 0) printf("\n%d scale process(es) failed\n", failedChildren);
+
+  // The server's own view, when it is the stand-in.
+  const shim::HttpResponse stats = fetch(target, "/stats", 3000);
+  if (stats.code == 200) printf("\nserver /stats\n%s", stats.body.c_str());
+  return failedChildren != 0 ? 1 : 0;
+}
@@ -0,0 +1,379 @@
+// Offline replay of ADC traces ([env:replay]) for threshold tuning.
+//
+// Reads a trace recorded with serial 'r' (GET /trace), rebuilds the weights
+// loop() saw from the raw conversions and runs them through WeighFsm for
+// every combination of the parameter grid. Each run is scored against
+// placements found in the raw data:
+//
+//   placement   the raw weight (5-sample median) stays above --gt-min-kg for
+//               at least 1 s; its reference weight is the median of the
+//               settled part (last 40 %, minus the removal transient)
+//   missed      placements with no upload
+//   false       uploads outside any placement, or a second upload for one
+//   error       uploaded kg minus the reference
+//   commit      placement start -> stable/timeout commit
+//
+// Runs are ranked by missed + false, then by whether p95 |error| is within
+// --tol-g, then by mean time to commit (throughput).
+//
+//   pio run -e replay
+//   .pio/build/replay/program trace.bin [--stddev 0.003:0.012:0.001]
+//       [--stable-ms 500:3000:250] [--timeout-ms 1500:6000:500]
+//       [--min-kg 0.3] [--tol-g 20] [--gt-min-kg 0.3] [--auto-id] [--top 15]
+//
+// Grid values are lo:hi:step or comma lists. Without --auto-id, recorded
+// RFID scans gate uploads like on the device (bind window included); with
+// it, an ID is always waiting, which measures the filter alone.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/adc_trace.h"
+#include "modules/scale.h"
+#include "modules/weigh_fsm.h"
+
+namespace {
+
+struct Sample {
+  uint32_t ms;
+  float kg;  // |weight| with the calibration in force at the time
+};
+
+// One getWeightKg() as seen by loop().
+struct Read {
+  uint32_t ms;
+  float kg;
+};
+
+struct Placement {
+  uint32_t startMs;
+  uint32_t endMs;
+  float refKg;
+};
+
+struct Trace {
+  std::vector<Sample> samples;
+  std::vector<Read> reads;
+  std::vector<uint32_t> scans;
+  std::vector<std::pair<uint32_t, uint8_t>> states;
+  long zero = 0;
+  float cal = SCALE_CAL_FACTOR_DEFAULT;
+};
+
+bool loadTrace(const char *path, Trace &t) {
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> d;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) d.insert(d.end(), buf, buf + n);
+  fclose(f);
+
+  AdcTrace::FileHeader h;
+  if (d.size() < sizeof(h)) return false;
+  memcpy(&h, d.data(), sizeof(h));
+  if (h.magic != AdcTrace::kMagic || h.version != AdcTrace::kVersion) {
+    fprintf(stderr, "%s: not an ADC trace (or unsupported version)\n", path);
+    return false;
+  }
+
+  uint32_t ms = h.startMs;
+  size_t p = sizeof(h);
+  long sumCounts = 0;
+  uint32_t groupN = 0;
+  while (p + 3 <= d.size()) {
+    const uint8_t tag = d[p];
+    ms += (uint32_t)(d[p + 1] | (d[p + 2] << 8));
+    p += 3;
+    switch (tag) {
+      case AdcTrace::TagSample: {
+        if (p + 3 > d.size()) return true;
+        int32_t c = d[p] | (d[p + 1] << 8) | (d[p + 2] << 16);
+        if (c & 0x800000) c |= ~0xFFFFFF;  // sign-extend 24 bits
+        p += 3;
+        t.samples.push_back({ms, fabsf((c - t.zero) / t.cal / 1000.0f)});
+        sumCounts += c;
+        groupN++;
+        break;
+      }
+      case AdcTrace::TagWeight:
+        // Incomplete groups mean the ADC timed out; loop() saw 0 kg.
+        t.reads.push_back({ms, groupN == 0 ? 0.0f : ScaleManager::countsToKg((int32_t)(sumCounts / (long)groupN), t.zero, t.cal)});
+        sumCounts = 0;
+        groupN = 0;
+        break;
+      case AdcTrace::TagCal: {
+        if (p + 8 > d.size()) return true;
+        int32_t z;
+        memcpy(&z, &d[p], 4);
+        memcpy(&t.cal, &d[p + 4], 4);
+        t.zero = z;
+        p += 8;
+        break;
+      }
+      case AdcTrace::TagState:
+        if (p + 1 > d.size()) return true;
+        t.states.push_back({ms, d[p]});
+        p += 1;
+        break;
+      case AdcTrace::TagRfid:
+        if (p + 1 > d.size() || p + 1 + d[p] > d.size()) return true;
+        t.scans.push_back(ms);
+        p += 1 + d[p];
+        break;
+      case AdcTrace::TagTime:
+        if (p + 4 > d.size()) return true;
+        memcpy(&ms, &d[p], 4);
+        p += 4;
+        break;
+      default:
+        fprintf(stderr, "%s: bad record tag 0x%02X at offset %zu, stopping\n", path, tag, p - 3);
+        return true;
+    }
+  }
+  return true;
+}
+
+float median(std::vector<float> v) {
+  if (v.empty()) return 0.0f;
+  std::nth_element(v.begin(), v.begin() + (long)(v.size() / 2), v.end());
+  return v[v.size() / 2];
+}
+
+// Placements from the raw conversions, independent of the FSM parameters.
+std::vector<Placement> findPlacements(const Trace &t, float minKg) {
+  std::vector<Placement> out;
+  const size_t n = t.samples.size();
+  std::vector<float> kg(n);
+  for (size_t i = 0; i < n; ++i) kg[i] = t.samples[i].kg;
+
+  std::vector<float> med(n);
+  for (size_t i = 0; i < n; ++i) {
+    std::vector<float> w;
+    for (size_t j = i >= 2 ? i - 2 : 0; j <= i + 2 && j < n; ++j) w.push_back(kg[j]);
+    med[i] = median(w);
+  }
+
+  size_t i = 0;
+  while (i < n) {
+    if (med[i] <= minKg) {
+      i++;
+      continue;
+    }
+    size_t j = i;
+    // Merge dips shorter than 500 ms (fish flapping, a hand on the tray).
+    while (j + 1 < n) {
+      if (med[j + 1] > minKg) {
+        j++;
+        continue;
+      }
+      size_t k = j + 1;
+      while (k < n && med[k] <= minKg) k++;
+      if (k < n && t.samples[k].ms - t.samples[j].ms < 500) {
+        j = k;
+        continue;
+      }
+      break;
+    }
+    const uint32_t startMs = t.samples[i].ms, endMs = t.samples[j].ms;
+    if (endMs - startMs >= 1000) {
+      std::vector<float> settled;
+      const uint32_t from = startMs + (uint32_t)((endMs - startMs) * 0.6);
+      for (size_t k = i; k <= j; ++k) {
+        if (t.samples[k].ms >= from && t.samples[k].ms + 300 <= endMs) settled.push_back(kg[k]);
+      }
+      if (!settled.empty()) out.push_back({startMs, endMs, median(settled)});
+    }
+    i = j + 1;
+  }
+  return out;
+}
+
+struct Result {
+  WeighFsm::Params params;
+  int uploads = 0;
+  int missed = 0;
+  int falseTriggers = 0;
+  double meanCommitS = 0.0;
+  double p95CommitS = 0.0;
+  double meanAbsErrG = 0.0;
+  double p95AbsErrG = 0.0;
+  double maxAbsErrG = 0.0;
+};
+
+double percentile(std::vector<double> v, double q) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5))];
+}
+
+Result run(const Trace &t, const std::vector<Placement> &placements, const WeighFsm::Params &p, bool autoId) {
+  Result r;
+  r.params = p;
+  WeighFsm fsm(p);
+
+  size_t nextScan = 0;
+  bool pending = false;
+  uint32_t pendingMs = 0;
+  uint32_t commitMs = 0;
+  std::vector<int> perPlacement(placements.size(), 0);
+  std::vector<double> commitS, errG;
+
+  for (const Read &rd : t.reads) {
+    while (nextScan < t.scans.size() && t.scans[nextScan] <= rd.ms) {
+      pending = true;
+      pendingMs = t.scans[nextScan++];
+    }
+    if (pending && rd.ms - pendingMs > RFID_BIND_WINDOW_MS) pending = false;
+
+    const bool idReady = fsm.state() == WeighFsm::AskId && (autoId || pending);
+    const WeighFsm::Event ev = fsm.update(rd.kg, rd.ms, idReady);
+    if (ev == WeighFsm::Stable || ev == WeighFsm::TimedOut) commitMs = rd.ms;
+    if (ev != WeighFsm::IdBound) continue;
+
+    pending = false;
+    r.uploads++;
+    int match = -1;
+    for (size_t k = 0; k < placements.size(); ++k) {
+      if (commitMs >= placements[k].startMs && commitMs <= placements[k].endMs) {
+        match = (int)k;
+        break;
+      }
+    }
+    if (match < 0 || perPlacement[match]++ > 0) {
+      r.falseTriggers++;
+      continue;
+    }
+    commitS.push_back((commitMs - placements[match].startMs) / 1000.0);
+    errG.push_back(fabs((fsm.stableKg() - placements[match].refKg) * 1000.0));
+  }
+
+  for (int c : perPlacement) r.missed += (c == 0);
+  if (!commitS.empty()) {
+    double sc = 0, se = 0;
+    for (double v : commitS) sc += v;
+    for (double v : errG) se += v;
+    r.meanCommitS = sc / (double)commitS.size();
+    r.meanAbsErrG = se / (double)errG.size();
+    r.p95CommitS = percentile(commitS, 0.95);
+    r.p95AbsErrG = percentile(errG, 0.95);
+    r.maxAbsErrG = *std::max_element(errG.begin(), errG.end());
+  }
+  return r;
+}
+
+std::vector<double> parseGrid(const char *spec) {
+  std::vector<double> v;
+  double lo, hi, step;
+  if (strchr(spec, ':') != nullptr && sscanf(spec, "%lf:%lf:%lf", &lo, &hi, &step) == 3 && step > 0) {
+    for (double x = lo; x <= hi + step * 1e-6; x += step) v.push_back(x);
+    return v;
+  }
+  std::string s(spec);
+  size_t b = 0;
+  while (b <= s.size()) {
+    const size_t e = s.find(',', b);
+    v.push_back(atof(s.substr(b, e == std::string::npos ? std::string::npos : e - b).c_str()));
+    if (e == std::string::npos) break;
+    b = e + 1;
+  }
+  return v;
+}
+
+void printRow(const char *tag, const Result &r, int placements) {
+  printf("%-8s %7.4f %6u %7u %6.2f %4d/%-4d %4d %4d %7.2f %7.2f %7.1f %7.1f %7.1f\n", tag, r.params.stableStddevKg,
+         (unsigned)r.params.stableMinMs, (unsigned)r.params.weighingTimeoutMs, r.params.minEffectiveKg, r.uploads,
+         placements, r.missed, r.falseTriggers, r.meanCommitS, r.p95CommitS, r.meanAbsErrG, r.p95AbsErrG,
+         r.maxAbsErrG);
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage: replay <trace.bin> [--stddev G] [--stable-ms G] [--timeout-ms G] [--min-kg G]\n"
+          "              [--tol-g N] [--gt-min-kg KG] [--auto-id] [--top N]\n"
+          "  G = lo:hi:step or a,b,c\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) return usage();
+  const WeighFsm::Params defaults;
+  std::vector<double> stddev = parseGrid("0.003:0.012:0.001");
+  std::vector<double> stableMs = parseGrid("500:3000:250");
+  std::vector<double> timeoutMs = parseGrid("1500:6000:500");
+  std::vector<double> minKg = {defaults.minEffectiveKg};
+  double tolG = 20.0, gtMinKg = MIN_EFFECTIVE_WEIGHT_KG;
+  bool autoId = false;
+  int top = 15;
+  const char *path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool hasVal = i + 1 < argc;
+    if (a == "--stddev" && hasVal) stddev = parseGrid(argv[++i]);
+    else if (a == "--stable-ms" && hasVal) stableMs = parseGrid(argv[++i]);
+    else if (a == "--timeout-ms" && hasVal) timeoutMs = parseGrid(argv[++i]);
+    else if (a == "--min-kg" && hasVal) minKg = parseGrid(argv[++i]);
+    else if (a == "--tol-g" && hasVal) tolG = atof(argv[++i]);
+    else if (a == "--gt-min-kg" && hasVal) gtMinKg = atof(argv[++i]);
+    else if (a == "--top" && hasVal) top = atoi(argv[++i]);
+    else if (a == "--auto-id") autoId = true;
+    else if (a[0] != '-' && path == nullptr) path = argv[i];
+    else return usage();
+  }
+  if (path == nullptr) return usage();
+
+  Trace t;
+  if (!loadTrace(path, t)) return 1;
+  if (t.scans.empty()) autoId = true;
+  const std::vector<Placement> placements = findPlacements(t, (float)gtMinKg);
+  const double spanS = t.samples.empty() ? 0.0 : (t.samples.back().ms - t.samples.front().ms) / 1000.0;
+  printf("%s: %.1f s, %zu conversions, %zu reads, %zu scans, %zu state changes, %zu placements%s\n", path, spanS,
+         t.samples.size(), t.reads.size(), t.scans.size(), t.states.size(), placements.size(),
+         autoId ? " (ID always ready)" : "");
+
+  std::vector<Result> results;
+  for (double sd : stddev) {
+    for (double sm : stableMs) {
+      for (double to : timeoutMs) {
+        for (double mk : minKg) {
+          WeighFsm::Params p = defaults;
+          p.stableStddevKg = (float)sd;
+          p.stableMinMs = (uint32_t)sm;
+          p.weighingTimeoutMs = (uint32_t)to;
+          p.minEffectiveKg = (float)mk;
+          results.push_back(run(t, placements, p, autoId));
+        }
+      }
+    }
+  }
+  std::stable_sort(results.begin(), results.end(), [&](const Result &a, const Result &b) {
+    const int ea = a.missed + a.falseTriggers, eb = b.missed + b.falseTriggers;
+    if (ea != eb) return ea < eb;
+    const bool ta = a.p95AbsErrG <= tolG, tb = b.p95AbsErrG <= tolG;
+    if (ta != tb) return ta;
+    return a.meanCommitS < b.meanCommitS;
+  });
+
+  printf("\n%-8s %7s %6s %7s %6s %9s %4s %4s %7s %7s %7s %7s %7s\n", "", "stddev", "stable", "timeout", "min_kg",
+         "uploads", "miss", "fals", "t_mean", "t_p95", "err_avg", "err_p95", "err_max");
+  printRow("current", run(t, placements, defaults, autoId), (int)placements.size());
+  for (int i = 0; i < top && i < (int)results.size(); ++i) {
+    char tag[16];
+    snprintf(tag, sizeof(tag), "#%d", i + 1);
+    printRow(tag, results[i], (int)placements.size());
+  }
+  printf("\n(%zu combinations; times in s from placement to commit, errors in g vs. settled reference)\n",
+         results.size());
+  return 0;
+}
@@ -0,0 +1,385 @@
+// Discrete-event throughput simulator for one weighing station ([env:sim]).
+//
+// Fishers arrive at random (Poisson), queue, step up, put a crate on the
+// platform, hold their card to the reader, take the crate off when the LCD
+// says so and leave. The station runs the real WeighFsm on weights averaged
+// the way ScaleManager::getWeightKg() averages conversions, with the loop
+// blocked for the ADC read and for each upload. Everything is seeded, so a
+// given command line always prints the same numbers.
+//
+// For each arrival rate it reports weigh-ins per minute, station
+// utilisation, queue length and the time spent in each phase:
+//
+//   wait     arrival -> stepping up (queueing)
+//   weigh    crate placed -> stable/timeout commit
+//   id       commit -> scan bound
+//   upload   scan bound -> upload done
+//   clear    scan bound -> FSM back to idle (crate off)
+//   cycle    crate placed -> crate placed by the next fisher (busy station)
+//
+//   pio run -e sim && .pio/build/sim/program [--rates 1,2,4,6,8] [--fishers 2000]
+//       [--settle calm|normal|lively] [--scan-delay-s 2] [--net-median-ms 450]
+//       [--net-p95-ms 1500] [--read-ms 1600] [--stable-ms 3000] [--stddev 0.007]
+//       [--timeout-ms 3000] [--no-pipeline] [--seed 1]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/weigh_fsm.h"
+
+namespace {
+
+struct Config {
+  std::vector<double> ratesPerMin = {1, 2, 3, 4, 5, 6, 8};
+  int fishers = 2000;
+  uint32_t seed = 1;
+  bool pipelined = RFID_PIPELINED;
+  double readMs = 1600.0;        // 4 x 8 conversions at 20 SPS
+  double loopOverheadMs = 15.0;  // RFID poll, LCD, FSM
+  double netMedianMs = 450.0;    // TLS connect + GET + 200 ms pause
+  double netP95Ms = 1500.0;
+  double scanDelayS = 2.0;       // mean, after the crate is down
+  double noiseG = 0.45;          // per conversion, 1 sigma
+  std::string settle = "normal";
+  WeighFsm::Params params;
+};
+
+struct SettleProfile {
+  double ampLo, ampHi;      // initial bounce, fraction of the load
+  double tauLo, tauHi;      // decay, s
+  double freqLo, freqHi;    // Hz
+  double flapProb;          // fish still moving: extra decaying jitter
+};
+
+SettleProfile profileFor(const std::string &name) {
+  if (name == "calm") return {0.02, 0.10, 0.2, 0.5, 2.0, 4.0, 0.0};
+  if (name == "lively") return {0.15, 0.45, 0.6, 1.8, 1.5, 4.0, 0.5};
+  return {0.05, 0.30, 0.3, 1.0, 2.0, 4.0, 0.15};
+}
+
+struct Fisher {
+  double arriveS = 0, stepUpS = 0, placedS = 0, scanS = 0;
+  double commitS = -1, boundS = -1, uploadDoneS = -1, removeAtS = -1, clearedS = -1;
+  double massKg = 0, amp = 0, tau = 0, freq = 0, flapAmp = 0;
+  bool cardSeen = false;
+  bool timedOut = false;
+};
+
+struct Stats {
+  int done = 0, abandoned = 0, duplicates = 0, timeouts = 0, rescans = 0;
+  double busyS = 0, spanS = 0, queueArea = 0;
+  size_t queueMax = 0;
+  std::vector<double> wait, weigh, id, upload, clear, cycle;
+};
+
+enum EventType { Arrive, Placed, Remove, Tick, Rescan };
+
+struct Event {
+  double t;
+  EventType type;
+  int fisher;
+  bool operator>(const Event &o) const { return t > o.t || (t == o.t && type > o.type); }
+};
+
+class Sim {
+ public:
+  Sim(const Config &cfg, double ratePerMin) : cfg_(cfg), rate_(ratePerMin), rng_(cfg.seed), fsm_(cfg.params) {}
+
+  Stats run() {
+    const SettleProfile sp = profileFor(cfg_.settle);
+    std::exponential_distribution<double> interArrival(rate_ / 60.0);
+    std::lognormal_distribution<double> mass(log(12.0), 0.5);
+    double t = 0;
+    for (int i = 0; i < cfg_.fishers; ++i) {
+      t += interArrival(rng_);
+      Fisher f;
+      f.arriveS = t;
+      f.massKg = std::min(45.0, std::max(0.8, mass(rng_)));
+      f.amp = uniform(sp.ampLo, sp.ampHi);
+      f.tau = uniform(sp.tauLo, sp.tauHi);
+      f.freq = uniform(sp.freqLo, sp.freqHi);
+      f.flapAmp = uniform(0, 1) < sp.flapProb ? uniform(0.005, 0.03) : 0.0;
+      fishers_.push_back(f);
+      push({t, Arrive, i});
+    }
+    push({0.0, Tick, -1});
+
+    while (!events_.empty() && stats_.done + stats_.abandoned < cfg_.fishers) {
+      const Event e = events_.top();
+      events_.pop();
+      stats_.queueArea += (double)queue_.size() * (e.t - lastT_);
+      lastT_ = e.t;
+      switch (e.type) {
+        case Arrive: arrive(e.fisher, e.t); break;
+        case Placed: placed(e.fisher, e.t); break;
+        case Remove: remove(e.fisher, e.t); break;
+        case Tick: tick(e.t); break;
+        case Rescan: rescan(e.fisher, e.t); break;
+      }
+    }
+    stats_.spanS = lastT_;
+    return stats_;
+  }
+
+ private:
+  double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng_); }
+  void push(const Event &e) { events_.push(e); }
+
+  double loadKg(double t) const {
+    if (onPlatform_ < 0) return 0.0;
+    const Fisher &f = fishers_[onPlatform_];
+    if (t < f.placedS || (f.removeAtS >= 0 && t >= f.removeAtS)) return 0.0;
+    const double dt = t - f.placedS;
+    const double bounce = f.amp * exp(-dt / f.tau) * cos(2.0 * M_PI * f.freq * dt);
+    const double flap = f.flapAmp * exp(-dt / 6.0) * sin(2.0 * M_PI * 0.7 * dt + f.freq);
+    return f.massKg * (1.0 + bounce + flap);
+  }
+
+  void arrive(int i, double t) {
+    queue_.push_back(i);
+    stats_.queueMax = std::max(stats_.queueMax, queue_.size());
+    maybeStepUp(t);
+  }
+
+  // The next fisher steps up once the previous crate is off the platform.
+  void maybeStepUp(double t) {
+    if (onPlatform_ >= 0 || queue_.empty()) return;
+    const int i = queue_.front();
+    queue_.pop_front();
+    Fisher &f = fishers_[i];
+    f.stepUpS = t;
+    stats_.wait.push_back(t - f.arriveS);
+    onPlatform_ = i;
+    f.placedS = t + uniform(1.0, 3.0);
+    f.scanS = f.placedS + 0.3 + std::exponential_distribution<double>(1.0 / cfg_.scanDelayS)(rng_);
+    if (lastPlacedS_ >= 0) stats_.cycle.push_back(f.placedS - lastPlacedS_);
+    lastPlacedS_ = f.placedS;
+    push({f.placedS, Placed, i});
+  }
+
+  void placed(int i, double t) {
+    // Give up on a stuck weigh-in after 90 s.
+    push({t + 90.0, Remove, i});
+  }
+
+  void remove(int i, double t) {
+    Fisher &f = fishers_[i];
+    if (onPlatform_ != i || (f.removeAtS >= 0 && f.removeAtS < t)) return;  // already off
+    if (f.boundS < 0) {
+      stats_.abandoned++;
+    } else {
+      stats_.done++;
+      stats_.weigh.push_back(f.commitS - f.placedS);
+      stats_.id.push_back(f.boundS - f.commitS);
+      stats_.upload.push_back(f.uploadDoneS - f.boundS);
+    }
+    f.removeAtS = t;
+    onPlatform_ = -1;
+    lastOff_ = i;
+    maybeStepUp(t);
+  }
+
+  // The fisher scans again when the LCD asks for the ID and no card was seen.
+  void rescan(int i, double t) {
+    Fisher &f = fishers_[i];
+    if (onPlatform_ != i || f.boundS >= 0 || pending_) return;
+    f.scanS = t;
+    f.cardSeen = false;
+    stats_.rescans++;
+  }
+
+  double averagedKg(double t0) {
+    const int n = 32;
+    double sum = 0;
+    for (int k = 1; k <= n; ++k) sum += loadKg(t0 + cfg_.readMs / 1000.0 * k / n);
+    std::normal_distribution<double> noise(0.0, cfg_.noiseG / 1000.0 / sqrt((double)n));
+    return fabs(sum / n + noise(rng_));
+  }
+
+  double uploadS() {
+    // Log-normal through the median and p95.
+    const double mu = log(cfg_.netMedianMs);
+    const double sigma = std::max(1e-6, (log(cfg_.netP95Ms) - mu) / 1.645);
+    return std::lognormal_distribution<double>(mu, sigma)(rng_) / 1000.0;
+  }
+
+  void tick(double t) {
+    const double readEnd = t + cfg_.readMs / 1000.0;
+    const double kg = averagedKg(t);
+
+    // pollRfid(): a card held to the reader right now.
+    if (onPlatform_ >= 0) {
+      Fisher &f = fishers_[onPlatform_];
+      const bool holding = !f.cardSeen && f.boundS < 0 && readEnd >= f.scanS && readEnd < f.scanS + 8.0;
+      if (holding && (cfg_.pipelined || fsm_.state() == WeighFsm::AskId)) {
+        f.cardSeen = true;
+        pending_ = true;
+        pendingOwner_ = onPlatform_;
+        pendingS_ = readEnd;
+      }
+    }
+    if (pending_ && readEnd - pendingS_ > RFID_BIND_WINDOW_MS / 1000.0) pending_ = false;
+
+    const bool idReady = fsm_.state() == WeighFsm::AskId && pending_;
+    const WeighFsm::State prev = fsm_.state();
+    WeighFsm::Event ev = fsm_.update((float)kg, (unsigned long)llround(readEnd * 1000.0), idReady);
+    double blockedS = 0;
+
+    while (true) {
+      switch (ev) {
+        case WeighFsm::Stable:
+        case WeighFsm::TimedOut:
+          if (onPlatform_ >= 0) {
+            Fisher &f = fishers_[onPlatform_];
+            f.commitS = readEnd;
+            f.timedOut = ev == WeighFsm::TimedOut;
+            if (!pending_) push({readEnd + 1.0, Rescan, onPlatform_});
+          }
+          break;
+        case WeighFsm::IdBound: {
+          pending_ = false;
+          blockedS = uploadS();
+          const int owner = pendingOwner_;
+          if (owner >= 0 && fishers_[owner].boundS < 0) {
+            Fisher &f = fishers_[owner];
+            f.boundS = readEnd;
+            f.uploadDoneS = readEnd + blockedS;
+            if (f.timedOut) stats_.timeouts++;
+            // "Remove The weight.." is on the LCD before the upload starts.
+            push({readEnd + uniform(0.5, 2.0), Remove, owner});
+          } else {
+            stats_.duplicates++;
+          }
+          break;
+        }
+        case WeighFsm::Removed:
+        case WeighFsm::LoadLost:
+        case WeighFsm::NoIdTimeout:
+          finishCleared(readEnd);
+          break;
+        default:
+          break;
+      }
+      // As the firmware: a scan already waiting binds with the commit.
+      if ((ev != WeighFsm::Stable && ev != WeighFsm::TimedOut) || !pending_) break;
+      ev = fsm_.update((float)kg, (unsigned long)llround(readEnd * 1000.0), true);
+    }
+    // A new crate can go down before the FSM saw zero (AwaitRemoval -> Reweigh).
+    if (ev == WeighFsm::Reweigh && prev == WeighFsm::AwaitRemoval) finishCleared(readEnd);
+
+    const double busyUntil = readEnd + cfg_.loopOverheadMs / 1000.0 + blockedS;
+    const double next = std::max(busyUntil, t + LOOP_PERIOD_MS / 1000.0);
+    if (fsm_.state() != WeighFsm::Idle || onPlatform_ >= 0) stats_.busyS += next - t;
+    push({next, Tick, -1});
+  }
+
+  void finishCleared(double t) {
+    if (lastOff_ < 0) return;
+    Fisher &f = fishers_[lastOff_];
+    lastOff_ = -1;
+    if (f.boundS < 0) return;  // abandoned
+    f.clearedS = t;
+    stats_.clear.push_back(f.clearedS - f.boundS);
+  }
+
+  const Config &cfg_;
+  double rate_;
+  std::mt19937 rng_;
+  WeighFsm fsm_;
+  std::vector<Fisher> fishers_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  std::deque<int> queue_;
+  int onPlatform_ = -1;
+  int lastOff_ = -1;
+  bool pending_ = false;
+  int pendingOwner_ = -1;
+  double pendingS_ = 0;
+  double lastPlacedS_ = -1;
+  double lastT_ = 0;
+  Stats stats_;
+};
+
+double mean(const std::vector<double> &v) {
+  if (v.empty()) return 0.0;
+  double s = 0;
+  for (double x : v) s += x;
+  return s / (double)v.size();
+}
+
+double p95(std::vector<double> v) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(0.95 * (double)(v.size() - 1))];
+}
+
+std::vector<double> parseList(const char *s) {
+  std::vector<double> v;
+  const char *p = s;
+  while (*p) {
+    v.push_back(strtod(p, const_cast<char **>(&p)));
+    if (*p == ',') p++;
+    else break;
+  }
+  return v;
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage: sim [--rates a,b,c] [--fishers N] [--settle calm|normal|lively] [--scan-delay-s S]\n"
+          "           [--net-median-ms MS] [--net-p95-ms MS] [--read-ms MS] [--stable-ms MS]\n"
+          "           [--stddev KG] [--timeout-ms MS] [--no-pipeline] [--seed N]\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Config cfg;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool v = i + 1 < argc;
+    if (a == "--rates" && v) cfg.ratesPerMin = parseList(argv[++i]);
+    else if (a == "--fishers" && v) cfg.fishers = atoi(argv[++i]);
+    else if (a == "--settle" && v) cfg.settle = argv[++i];
+    else if (a == "--scan-delay-s" && v) cfg.scanDelayS = atof(argv[++i]);
+    else if (a == "--net-median-ms" && v) cfg.netMedianMs = atof(argv[++i]);
+    else if (a == "--net-p95-ms" && v) cfg.netP95Ms = atof(argv[++i]);
+    else if (a == "--read-ms" && v) cfg.readMs = atof(argv[++i]);
+    else if (a == "--stable-ms" && v) cfg.params.stableMinMs = (uint32_t)atoi(argv[++i]);
+    else if (a == "--stddev" && v) cfg.params.stableStddevKg = (float)atof(argv[++i]);
+    else if (a == "--timeout-ms" && v) cfg.params.weighingTimeoutMs = (uint32_t)atoi(argv[++i]);
+    else if (a == "--seed" && v) cfg.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (a == "--no-pipeline") cfg.pipelined = false;
+    else return usage();
+  }
+
+  printf("station: read %.0f ms, stable %u ms @ %.3f kg, timeout %u ms, %s RFID, settle %s,\n"
+         "         scan delay %.1f s, upload median %.0f / p95 %.0f ms, %d fishers per rate, seed %u\n\n",
+         cfg.readMs, (unsigned)cfg.params.stableMinMs, cfg.params.stableStddevKg,
+         (unsigned)cfg.params.weighingTimeoutMs, cfg.pipelined ? "pipelined" : "AskId-only", cfg.settle.c_str(),
+         cfg.scanDelayS, cfg.netMedianMs, cfg.netP95Ms, cfg.fishers, (unsigned)cfg.seed);
+  printf("%7s %8s %5s %6s %5s %13s %11s %11s %11s %11s %11s %5s %4s %4s\n", "offered", "done/min", "util", "q_avg",
+         "q_max", "wait avg/p95", "weigh", "id", "upload", "clear", "cycle", "t/o%", "dup", "abnd");
+
+  for (double rate : cfg.ratesPerMin) {
+    Sim sim(cfg, rate);
+    const Stats s = sim.run();
+    const double minutes = s.spanS / 60.0;
+    printf("%7.1f %8.2f %4.0f%% %6.2f %5zu %6.1f/%-6.1f %5.1f/%-5.1f %5.1f/%-5.1f %5.1f/%-5.1f %5.1f/%-5.1f "
+           "%5.1f/%-5.1f %4.0f%% %4d %4d\n",
+           rate, s.done / minutes, 100.0 * s.busyS / s.spanS, s.queueArea / s.spanS, s.queueMax, mean(s.wait),
+           p95(s.wait), mean(s.weigh), p95(s.weigh), mean(s.id), p95(s.id), mean(s.upload), p95(s.upload),
+           mean(s.clear), p95(s.clear), mean(s.cycle), p95(s.cycle), s.done ? 100.0 * s.timeouts / s.done : 0.0,
+           s.duplicates, s.abandoned);
+  }
+  printf("\n(phase columns: mean/p95 seconds; t/o%% = weights committed by WEIGHING_TIMEOUT_MS)\n");
+  return 0;
+}
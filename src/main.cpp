@@ -1,28 +1,50 @@
-// ESP32 + NAU7802 + 20x4 I2C LCD
+// ESP32 + NAU7802 (or HX711/ADS1232, see SCALE_ADC) + 20x4 I2C LCD
 #include <Arduino.h>
 #include <Wire.h>
 #include <math.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <WiFiClientSecure.h>
 #include "config.h"
 #include "modules/lcd_display.h"
 #include "modules/scale.h"
 #include "modules/rfid2.h"
 #include "modules/wifi_manager.h"
+#include "modules/id_directory.h"
+#include "modules/alloc_guard.h"
+#include "modules/heap_monitor.h"
+#include "modules/event_log.h"
+#include "modules/metrics.h"
+#include "modules/http_api.h"
+#include "modules/weigh_fsm.h"
+#include "modules/adc_trace.h"
+#include "modules/power.h"
+#include "modules/uploader.h"
+#include "modules/vib_analysis.h"
+#include "modules/self_bench.h"
+#include "modules/weigh_log.h"
+#include "modules/station_params.h"
 
 // LCD over I2C
 LCDDisplay lcd;
 bool lcdOK = false;
 uint8_t lcdAddr = 0x00;
 
-// Load cell / NAU7802
+// Load cell (ADC driver per SCALE_ADC)
 ScaleManager scale;
 
 // RFID2 on same I2C bus
 RFID2 rfid;
 bool rfidOK = false;
 
+// Known cards (names / blocked list), synced from the server
+IdDirectory directory;
+unsigned long lastDirectorySyncMs = 0;
+
+// Every weigh-in, for per-card queries on the station ('y', GET /history)
+WeighLog history;
+
+// Heap health over the day ('h' prints the report)
+HeapMonitor heapMon;
+
 bool scaleReady = false;
 // WiFi status
 bool wifiOK = false;
@@ -31,44 +53,45 @@ bool wifiOK = false;
 WiFiManager wifiMgr;
 bool wifiConfigMode = false;
 
+// Diagnostics HTTP server in STA mode (/metrics)
+HttpApi httpApi;
+
 // Wi-Fi timeouts
 static const uint32_t WIFI_CONNECT_TIMEOUT_MS = 8000;
-static const uint32_t WIFI_RECONNECT_TIMEOUT_MS = 2500;
 
-// Server endpoint (GET)
-static const char *UPLOAD_BASE_URL = "https://fishcore.ph/uploadWeightIns";
-static const int UPLOAD_ID = 1;
-static const int UPLOAD_SCALE_ID = 1;
+// Weigh-in uploads (endpoint and retry policy in config.h)
+Uploader uploader;
+
+// Stability filter + weigh-in state machine
+WeighFsm fsm;
 
-// Stability buffer
-static const int kBufN = 10;
-float wBuf[kBufN] = {0};
-int wIdx = 0, wCnt = 0;
+// Tunable weighing parameters ('u', /params); copied into fsm, scale and the
+// loop pacing when their generation moves
+StationParams params;
+uint32_t appliedParams = 0;
+uint32_t loopPeriodMs = LOOP_PERIOD_MS;
 
-enum AppState { Idle, Weighing, AskId, Sending, AwaitRemoval };
-AppState state = Idle;
-unsigned long stableStartMs = 0;
-unsigned long zeroStartMs = 0;
-float stableWeightKg = 0.0f;
-unsigned long weighingStartMs = 0;
+// Pipelined ID capture: the reader runs for the whole cycle and the latest
+// scan waits here until it is bound to a stable weight or expires.
+char pendingId[RFID2::kIdLen] = {};
+char pendingName[IdDirectory::kNameLen] = {};
+unsigned long pendingIdMs = 0;
+unsigned long idNoticeUntilMs = 0;
+
+// Consecutive above-threshold conversions while dozing
+uint8_t dozeLoadCount = 0;
+
+// Temperature compensation: last sensor read, last NVS save of the model
+unsigned long lastTempMs = 0;
+unsigned long lastTempSaveMs = 0;
 
 static float effectiveWeight(float kg) {
   float a = fabsf(kg);
-  if (a <= MIN_EFFECTIVE_WEIGHT_KG || a < DISPLAY_ZERO_CLAMP_KG) return 0.0f;
+  if (a <= fsm.params().minEffectiveKg || a < DISPLAY_ZERO_CLAMP_KG) return 0.0f;
   return kg;
 }
 
-static void showCentered(uint8_t row, const String &text) {
-  String t = text;
-  if (t.length() < LCD_COLS) {
-    int pad = (LCD_COLS - t.length()) / 2;
-    String spaces = String(' ', pad);
-    t = spaces + t;
-  }
-  lcd.printLine(row, t);
-}
-
-static void lcdStatus(const String &l0, const String &l1 = "", const String &l2 = "", const String &l3 = "") {
+static void lcdStatus(const char *l0, const char *l1 = "", const char *l2 = "", const char *l3 = "") {
   if (!lcdOK) return;
   lcd.printLine(0, l0);
   if (LCD_ROWS > 1) lcd.printLine(1, l1);
@@ -81,36 +104,139 @@ bool initScale() {
     lcdStatus("LOAD CELL NOT FOUND", "Check wiring & power");
     return false;
   }
+  VibFilter::Config vib;
+  if (VibFilter::load(vib)) scale.setVibFilter(vib);
+  TempComp::Model model;
+  if (TempComp::load(model)) scale.setTempModel(model);
+  lastTempMs = lastTempSaveMs = millis();
   return true;
 }
 
-static float bufferStdDev() {
-  if (wCnt <= 1) return 1e9f;
-  float sum = 0.0f, sum2 = 0.0f;
-  for (int i = 0; i < wCnt; ++i) { sum += wBuf[i]; sum2 += wBuf[i] * wBuf[i]; }
-  float mean = sum / wCnt;
-  float var = (sum2 / wCnt) - (mean * mean);
-  return sqrtf(fmaxf(var, 0.0f));
+// Copies the current parameters to where the weighing path reads them.
+static void applyParams() {
+  const StationParams::Values &v = params.values();
+  WeighFsm::Params p = fsm.params();
+  p.stableStddevKg = v.stableStddevKg;
+  p.minEffectiveKg = v.minEffectiveKg;
+  p.stableMinMs = v.stableMinMs;
+  p.weighingTimeoutMs = v.weighingTimeoutMs;
+  p.noIdZeroTimeoutMs = v.noIdZeroTimeoutMs;
+  fsm.setParams(p);
+  scale.setActiveSps((uint16_t)v.adcSps);
+  loopPeriodMs = v.loopPeriodMs;
+  appliedParams = params.generation();
 }
 
-static float bufferMean() {
-  if (wCnt == 0) return 0.0f;
-  float sum = 0.0f;
-  for (int i = 0; i < wCnt; ++i) sum += wBuf[i];
-  return sum / wCnt;
+// Blanks rows [from, LCD_ROWS).
+static void clearRows(uint8_t from) {
+  for (uint8_t r = from; r < LCD_ROWS; ++r) lcd.printLine(r, "");
 }
 
-static void pushWeight(float kg) {
-  wBuf[wIdx] = kg;
-  wIdx = (wIdx + 1) % kBufN;
-  if (wCnt < kBufN) wCnt++;
+static bool pendingIdValid() {
+  if (pendingId[0] == '\0') return false;
+  if (millis() - pendingIdMs > RFID_BIND_WINDOW_MS) {
+    pendingId[0] = '\0';
+    return false;
+  }
+  return true;
 }
 
-static void clearBuf() { wIdx = 0; wCnt = 0; }
+// Row 1 shows the fisher's name (or the raw ID) while it waits for the weight.
+static void showPendingId() {
+  if (LCD_ROWS <= 1) return;
+  if ((long)(millis() - idNoticeUntilMs) < 0) return;  // keep reject notice up
+  if (!pendingIdValid()) {
+    lcd.printLine(1, "");
+  } else if (pendingName[0] != '\0') {
+    lcd.printLine(1, pendingName);
+  } else {
+    // A 10-byte UID is 20 hex digits, a whole row: no label then.
+    char line[3 + RFID2::kIdLen];
+    snprintf(line, sizeof(line), "%s%s", strlen(pendingId) + 3 <= LCD_COLS ? "ID " : "", pendingId);
+    lcd.printLine(1, line);
+  }
+}
 
-void setup() {
+static void pollRfid() {
+  if (!rfidOK) return;
+#if !RFID_PIPELINED
+  if (fsm.state() != WeighFsm::AskId) return;
+#endif
+  char id[RFID2::kIdLen];
+  if (rfid.poll(id) && id[0] != '\0') {
+    // The weigh-in on the platform is already bound: a re-tap now would
+    // wait for, and bind to, the next fisher's load.
+    if (fsm.state() == WeighFsm::AwaitRemoval) return;
+    // Blocked/unknown cards are rejected here instead of after a server round trip.
+    IdDirectory::Entry entry;
+    const IdDirectory::Status st = directory.lookup(id, &entry);
+    const bool reject = (st == IdDirectory::Status::Blocked) ||
+                        (ID_DIRECTORY_REJECT_UNKNOWN && st == IdDirectory::Status::Unknown &&
+                         directory.size() > 0);
+    if (reject) {
+      if (LCD_ROWS > 1) lcd.printLine(1, st == IdDirectory::Status::Blocked ? "Card blocked" : "Unknown card");
+      idNoticeUntilMs = millis() + ID_NOTICE_MS;
+      return;
+    }
+    if (AdcTrace::active()) {
+      IdDirectory::Key key;
+      if (IdDirectory::parseUidHex(id, key)) AdcTrace::rfid(key.uid, key.len);
+    }
+    memcpy(pendingId, id, sizeof(pendingId));
+    if (st == IdDirectory::Status::Known) {
+      memcpy(pendingName, entry.name, sizeof(pendingName));
+      pendingName[sizeof(pendingName) - 1] = '\0';
+    } else {
+      pendingName[0] = '\0';
+    }
+    pendingIdMs = millis();
+    idNoticeUntilMs = millis();
+    if (fsm.state() == WeighFsm::Idle || fsm.state() == WeighFsm::Weighing) showPendingId();
+  }
+}
+
+// Weigh-ins waiting in the upload queue and a network to send them on. Not
+// while the portal lingers: an upload that times out would hold the loop
+// past LOOP_BUDGET_MS with a phone on the status page (doSendData() queues
+// fresh weigh-ins then for the same reason).
+static bool queueDue() { return uploader.queued() > 0 && !wifiConfigMode && wifiMgr.isConnected(); }
+
+static bool directorySyncDue() {
+  if (!directory.ready()) return false;
+  return lastDirectorySyncMs == 0 || millis() - lastDirectorySyncMs >= ID_DIRECTORY_SYNC_PERIOD_MS;
+}
+
+// Pull card changes while nothing is on the scale (the sync blocks on HTTP).
+static void maybeSyncDirectory() {
+  if (fsm.state() != WeighFsm::Idle || pendingIdValid() || !directorySyncDue()) return;
+  lastDirectorySyncMs = millis();
+  if (!wifiMgr.isConnected()) return;
+  AllocGuard::Allow allow;  // HTTP/TLS internals allocate
+  directory.sync();
+}
+
+// Takes the pending scan; call after pendingIdValid() returned true.
+static void takePendingId(char *id, char *name) {
+  memcpy(id, pendingId, sizeof(pendingId));
+  memcpy(name, pendingName, sizeof(pendingName));
+  pendingId[0] = '\0';
+  pendingName[0] = '\0';
+}
+
+// Idle row 3 while the config portal is up.
+static void showPortalNotice() {
+  char line[LCD_COLS + 1];
+  snprintf(line, sizeof(line), "Setup %s", wifiMgr.apIp().c_str());
+  lcd.printLine(3, line);
+}
+
+static void setupHardware() {
   Serial.begin(115200);
   delay(100);
+  EventLog::begin();
+  LOG_EVENT(Boot);
+  Metrics::begin(WeighFsm::stateNames(), WeighFsm::kStateCount);
+  Power::begin();
 
   Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
   Wire.setClock(100000);
@@ -121,7 +247,7 @@ void setup() {
     lcd.printLine(0, "Calibrating...");
     if (LCD_ROWS > 1) lcd.printLine(1, "RFID Ready...");
   } else {
-    Serial.println("LCD FAIL");
+    LOG_EVENT(LcdFail);
   }
 
   delay(10);
@@ -142,19 +268,33 @@ void setup() {
   if (lcdOK && LCD_ROWS > 2) {
     lcd.printLine(2, wifiOK ? "Internet Ready..." : "WiFi Setup Mode...");
   }
+  if (wifiOK) {
+    httpApi.begin();
+    configTime(0, 0, WEIGHLOG_NTP_SERVER);  // UTC, for the weigh-in history
+  }
+  uploader.begin(wifiMgr);
+
+  // Config portal: the scale runs anyway and weigh-ins wait in the upload
+  // queue. Connect your phone/PC to the shown AP SSID, then open the IP.
+  if (wifiConfigMode && lcdOK) {
+    lcd.printLine(0, "WiFi CONFIG (AP)");
+    if (LCD_ROWS > 1) lcd.printLine(1, wifiMgr.apSsid());
+    if (LCD_ROWS > 3) lcd.printLine(3, wifiMgr.apIp());
+    delay(2000);
+  }
 
-  // If we entered config portal mode, don't run the scale logic.
-  // Connect your phone/PC to the shown AP SSID, then open the shown IP.
-  if (wifiConfigMode) {
-    if (lcdOK) {
-      lcd.printLine(0, "WiFi CONFIG (AP)");
-      if (LCD_ROWS > 1) lcd.printLine(1, wifiMgr.apSsid());
-      if (LCD_ROWS > 3) lcd.printLine(3, wifiMgr.apIp());
-    }
-    return;
+  directory.begin();
+  history.begin();
+  httpApi.setHistory(&history);
+  if (wifiOK) {
+    directory.sync();
+    lastDirectorySyncMs = millis();
   }
 
   if (!initScale()) return;
+  params.begin();
+  httpApi.setParams(&params);
+  applyParams();
 
   if (lcdOK) {
     lcd.printLine(0, "");
@@ -169,74 +309,311 @@ void setup() {
   float zeroKg = scale.getWeightKg(true);
   scaleReady = (fabsf(zeroKg) <= ZERO_THRESHOLD_KG);
   if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, scaleReady ? "Ready             " : "Zero failed       ");
+  if (lcdOK && LCD_ROWS > 3 && scaleReady && wifiConfigMode) showPortalNotice();
 
-  state = Idle;
-  clearBuf();
-  zeroStartMs = 0;
-  if (!scaleReady) Serial.println("Zeroing did not reach threshold");
+  fsm.reset();
+  if (!scaleReady) LOG_EVENT(ZeroFailed);
 }
 
-static void showWeight(float kg) {
-  kg = effectiveWeight(kg);
-  char l0[21];
-  snprintf(l0, sizeof(l0), "Weight %6.2f kg", kg);
-  lcd.printLine(0, String(l0));
-}
+// Serial 'l': cost of one deferred log call vs. one Serial.printf line.
+static void reportLogCost() {
+  const int kLogCalls = 32;
+  const int kPrintCalls = 8;
+  Serial.flush();
 
-static void doSendData(const String &id, float kg) {
-  // Build URL: https://actual.fishcore.ph/uploadWeightIns/1/{IdNumber}/1/{Weight}
-  // id = 1 (fixed), scaleId = 1 (fixed), IdNumber = scanned RFID, Weight = stable weight
-  const float effectiveKg = effectiveWeight(kg);
-  String url = String(UPLOAD_BASE_URL) + "/" + String(UPLOAD_ID) + "/" + id + "/" + String(UPLOAD_SCALE_ID) + "/" + String(effectiveKg, 2);
+  uint32_t t0 = ESP.getCycleCount();
+  for (int i = 0; i < kLogCalls; ++i) EventLog::log(EventLog::LogBench, (uint32_t)i);
+  const uint32_t logCycles = (ESP.getCycleCount() - t0) / kLogCalls;
 
-  Serial.printf("Uploading GET: %s\n", url.c_str());
+  t0 = ESP.getCycleCount();
+  for (int i = 0; i < kPrintCalls; ++i) Serial.printf("log cost probe %d: ..........................\n", i);
+  const uint32_t printCycles = (ESP.getCycleCount() - t0) / kPrintCalls;
 
-  if (!wifiMgr.ensureConnected(WIFI_RECONNECT_TIMEOUT_MS)) {
-    Serial.println("WiFi not connected; upload skipped");
-    if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "No internet       ");
-    delay(200);
+  const uint32_t mhz = ESP.getCpuFreqMHz();
+  Serial.printf("log: LOG_EVENT %lu cycles (%lu us), Serial.printf %lu cycles (%lu us)\n",
+                (unsigned long)logCycles, (unsigned long)(logCycles / mhz),
+                (unsigned long)printCycles, (unsigned long)(printCycles / mhz));
+}
+
+// Serial 'r': start/stop recording raw conversions for offline replay.
+static void toggleTrace() {
+  if (AdcTrace::active()) {
+    AdcTrace::stop();
+    Serial.printf("trace: stopped, %lu bytes in %s\n", (unsigned long)AdcTrace::bytes(), ADC_TRACE_PATH);
+  } else if (AdcTrace::start(scale.zeroOffset(), scale.calFactor())) {
+    Serial.printf("trace: recording to %s (max %lu bytes)\n", ADC_TRACE_PATH, (unsigned long)ADC_TRACE_MAX_BYTES);
+  } else {
+    Serial.println("trace: cannot open file");
+  }
+}
+
+// Serial 'v': vibration spectra with the load on the platform, then the
+// notch/comb stages for them (saved; a quiet platform clears them).
+static void runVibDiagnostic() {
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Vibration test...");
+  VibAnalysis::Result r;
+  if (!VibAnalysis::measure(scale, r)) {
+    Serial.println("vib: capture failed");
+    if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Vibration failed");
     return;
   }
+  const VibFilter::Config cfg = VibAnalysis::design(r, scale.activeHz());
+  VibAnalysis::printResult(Serial, r, cfg, scale.activeHz());
+  for (uint8_t i = 0; i < r.count; ++i) {
+    LOG_EVENT(VibPeak, (uint32_t)lroundf(r.peaks[i].hz * 100.0f), (uint32_t)lroundf(r.peaks[i].amplitudeG));
+  }
+  scale.setVibFilter(cfg);
+  if (!VibFilter::save(cfg)) Serial.println("vib: NVS save failed");
+  scale.vibFilter().printText(Serial);
+  LOG_EVENT(VibFilterSet, (uint32_t)scale.vibFilter().config().count);
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, cfg.count ? "Vibration filtered" : "No vibration");
+  fsm.reset();
+}
 
-  WiFiClientSecure client;
-  client.setInsecure(); // avoids TLS cert issues; use CA cert if you want verification
+// Serial 'b': on-site timings of the ADC, LCD, RFID, I2C, Wi-Fi and network.
+static void runSelfBench() {
+  SelfBench::Targets t;
+  t.scale = &scale;
+  t.lcd = lcdOK ? &lcd : nullptr;
+  t.rfid = rfidOK ? &rfid : nullptr;
+  t.wifi = &wifiMgr;
+  t.uploader = &uploader;
+  SelfBench::run(t, Serial);
+  fsm.reset();
+}
 
-  HTTPClient http;
-  if (!http.begin(client, url)) {
-    Serial.println("HTTP begin failed");
-    if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "HTTP begin failed ");
-    delay(200);
+// Every TEMPCOMP_SAMPLE_MS with the FSM idle: a temperature read for the
+// compensation, and a zero point when kg (the read just before) shows an
+// empty platform. The model goes to NVS at most every TEMPCOMP_SAVE_MS.
+static void sampleTemperature(float kg) {
+  lastTempMs = millis();
+  if (!scale.sampleTemperature()) return;
+  if (kg < fsm.params().detectKg && !pendingIdValid()) scale.learnZero();
+  if (millis() - lastTempSaveMs >= TEMPCOMP_SAVE_MS) {
+    AllocGuard::Allow allow;  // NVS
+    TempComp::save(scale.tempComp().model());
+    lastTempSaveMs = millis();
+  }
+}
+
+static bool temperatureDue() { return millis() - lastTempMs >= TEMPCOMP_SAMPLE_MS; }
+
+// Serial 'k': temperature compensation state and drift since boot.
+static void printTempComp() {
+  scale.sampleTemperature();
+  scale.tempComp().printText(Serial, scale.temperatureC(), scale.calFactor());
+}
+
+// Serial 's': a span point with TEMPCOMP_REF_KG on the platform (saved).
+static void addSpanPoint() {
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Span point...");
+  const bool ok = scale.addSpanPoint(TEMPCOMP_REF_KG);
+  if (ok) TempComp::save(scale.tempComp().model());
+  Serial.printf("temp: span point %s\n", ok ? "added" : "rejected (reference mass?)");
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, ok ? "Span point added" : "Span point failed");
+  fsm.reset();
+}
+
+// Rest of a serial command line, up to the newline (50 ms for it to arrive).
+static void readSerialArgs(char *buf, size_t cap) {
+  size_t n = 0;
+  const unsigned long startMs = millis();
+  while (millis() - startMs < 50) {
+    if (!Serial.available()) {
+      delay(1);
+      continue;
+    }
+    const int c = Serial.read();
+    if (c == '\n' || c == '\r') break;
+    if (n + 1 < cap) buf[n++] = (char)c;
+  }
+  buf[n] = '\0';
+}
+
+// Serial 'y': totals per card for the last 24 h; "y <since>" totals since
+// then, "y <uid> [since]" one card's weigh-ins. since is Unix seconds (10
+// digits; UIDs have 8, 14 or 20) or, negative, seconds back from now.
+static void queryHistory() {
+  char args[48];
+  readSerialArgs(args, sizeof(args));
+  char *p = args;
+  while (*p == ' ') p++;
+  if (*p == '\0' || *p == '-' || strlen(p) == 10) {
+    history.printText(Serial);
+    history.printTotals(Serial, *p ? strtoll(p, nullptr, 10) : WeighLog::kDefaultSinceS);
+    return;
+  }
+  char *uid = p;
+  while (*p != '\0' && *p != ' ') p++;
+  if (*p != '\0') *p++ = '\0';
+  history.printCard(Serial, uid, *p ? strtoll(p, nullptr, 10) : WeighLog::kDefaultSinceS);
+}
+
+static void metricsCommand() {
+  char args[40];
+  readSerialArgs(args, sizeof(args));
+  char *p = args;
+  while (*p == ' ') p++;
+  if (strncmp(p, "station", 7) != 0) {
+    Metrics::printText(Serial);
+    return;
+  }
+  p += 7;
+  while (*p == ' ') p++;
+  if (!Metrics::setStation(p)) {
+    Serial.printf("metrics: bad station label (letters, digits, -_. up to %u)\n", (unsigned)Metrics::kStationLen - 1);
     return;
   }
+  Serial.printf("metrics: station %s\n", Metrics::station());
+}
+
+// Back to the normal loop: 20 SPS, Wi-Fi without power save.
+static void wakeUp() {
+  scale.setIdleRate(false);
+  Power::leaveDoze();
+  dozeLoadCount = 0;
+}
 
-  http.setTimeout(6000);
-  int httpCode = http.GET();
-  if (httpCode > 0) {
-    Serial.printf("HTTP %d\n", httpCode);
-    if (httpCode >= 200 && httpCode < 300) {
-      if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Sent OK           ");
+// One light-sleep slice while the station dozes. The LCD keeps showing the
+// empty scale; a load, a card, a due directory sync or queued weigh-ins
+// with Wi-Fi back wake the station.
+static void dozeStep() {
+  const Power::Wake wake = Power::sleep(scale.adc().periodUs());  // one idle conversion
+
+  float kg = 0.0f;
+  if (scale.pollKg(kg)) {
+    Power::noteSample();
+    if (kg > fmaxf(fsm.params().detectKg, fsm.params().minEffectiveKg)) {
+      Power::noteLoad();
+      dozeLoadCount++;
     } else {
-      if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Send failed       ");
-      String payload = http.getString();
-      if (payload.length() > 0) {
-        Serial.println(payload);
-      }
+      dozeLoadCount = 0;
     }
-  } else {
-    Serial.printf("HTTP GET failed: %s\n", http.errorToString(httpCode).c_str());
-    if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "HTTP GET failed   ");
   }
+  if (wake == Power::WakeRfid) pollRfid();
+  if (temperatureDue()) {
+    // A weighing read for the zero point, then back to the idle rate.
+    scale.setIdleRate(false);
+    sampleTemperature(scale.getWeightKg(true));
+    scale.setIdleRate(true);
+  }
+
+  if (dozeLoadCount >= POWER_WAKE_CONFIRM || pendingIdValid() || directorySyncDue() || queueDue()) wakeUp();
+}
+
+void setup() {
+  setupHardware();
+
+  // Everything after this point is the steady state: it should run from
+  // fixed buffers, so start counting heap use here.
+  heapMon.sampleNow();
+  AllocGuard::arm();
+}
 
-  http.end();
+static void showWeight(float kg) {
+  kg = effectiveWeight(kg);
+  char l0[LCD_COLS + 1];
+  snprintf(l0, sizeof(l0), "Weight %6.2f kg", kg);
+  lcd.printLine(0, l0);
+}
+
+static const char *uploadText(Uploader::Status st) {
+  switch (st) {
+    case Uploader::Status::Ok: return "Sent OK";
+    case Uploader::Status::HttpError: return "Send failed";
+    case Uploader::Status::NoWifi: return "No internet";
+    case Uploader::Status::ConnectFailed: return "Connect failed";
+    case Uploader::Status::BeginFailed: return "HTTP begin failed";
+    case Uploader::Status::GetFailed: return "HTTP GET failed";
+  }
+  return "";
+}
+
+// Returns what became of the upload, for the weigh-in counters.
+static Metrics::Outcome doSendData(const char *id, float kg) {
+  {
+    AllocGuard::Allow allow;  // LittleFS
+    history.append(id, effectiveWeight(kg));
+  }
+  // Queued while the portal is up, even once it has joined: see queueDue().
+  const Uploader::Result r = wifiConfigMode ? Uploader::Result{} : uploader.send(id, effectiveWeight(kg));
+  if (r.status == Uploader::Status::NoWifi) {
+    // Not sent at all, so it can go later without a duplicate.
+    uploader.enqueue(id, effectiveWeight(kg));
+    if (lcdOK && LCD_ROWS > 3) {
+      char line[LCD_COLS + 1];
+      snprintf(line, sizeof(line), "Saved, queued %u", (unsigned)uploader.queued());
+      lcd.printLine(3, line);
+    }
+    delay(200);
+    return Metrics::Queued;
+  }
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, uploadText(r.status));
   delay(200);
+  return r.status == Uploader::Status::Ok ? Metrics::Uploaded : Metrics::UploadFailed;
+}
+
+// Queued weigh-ins go out one per idle iteration once Wi-Fi is back.
+static void maybeFlushQueue() {
+  if (!queueDue() || fsm.state() != WeighFsm::Idle || pendingIdValid()) return;
+  if (uploader.flushOne() && lcdOK && LCD_ROWS > 3) {
+    char line[LCD_COLS + 1];
+    snprintf(line, sizeof(line), uploader.queued() ? "Sent queued, %u left" : "Queue sent",
+             (unsigned)uploader.queued());
+    lcd.printLine(3, line);
+  }
+}
+
+// The portal joined a network and closed: start what setup() left out.
+static void leavePortalMode() {
+  wifiConfigMode = false;
+  wifiOK = wifiMgr.isConnected();
+  httpApi.begin();
+  configTime(0, 0, WEIGHLOG_NTP_SERVER);
+  lastDirectorySyncMs = 0;  // sync at the next idle iteration
+  if (lcdOK && LCD_ROWS > 3) lcd.printLine(3, "Internet Ready");
 }
 
 void loop() {
   // Serial control:
   // - 't' to tare
   // - 'c' to clear saved Wi-Fi credentials and restart
+  // - 'h' to print the heap / allocation report
+  // - 'l' to measure the cost of a log call
+  // - 'm' to print latency histograms and FSM counters ("m station <name>"
+  //   sets the metrics label, "m station" goes back to the MAC)
+  // - 'r' to start/stop an ADC trace capture
+  // - 'p' to print the idle power report
+  // - 'v' to measure vibration and set the notch/comb filter
+  // - 'b' to run the self benchmark
+  // - 'k' to print the temperature compensation report
+  // - 's' to add a span point (TEMPCOMP_REF_KG on the platform)
+  // - 'y' to query the weigh-in history ("y", "y <uid> [since]")
+  // - 'u' to list or change the weighing parameters ("u", "u <name> <value>",
+  //   "u profile <name>", "u save <name>", "u reset")
   if (Serial.available()) {
     const char cmd = (char)Serial.read();
+    if (Power::dozing()) wakeUp();
+    if (cmd == 'p' || cmd == 'P') Power::printText(Serial);
+    if (cmd == 'm' || cmd == 'M') metricsCommand();
+    if (cmd == 'l' || cmd == 'L') reportLogCost();
+    if (cmd == 'r' || cmd == 'R') toggleTrace();
+    if (cmd == 'v' || cmd == 'V') runVibDiagnostic();
+    if ((cmd == 'b' || cmd == 'B') && !wifiConfigMode) runSelfBench();  // would take the station off the AP
+    if (cmd == 'k' || cmd == 'K') printTempComp();
+    if (cmd == 's' || cmd == 'S') addSpanPoint();
+    if (cmd == 'y' || cmd == 'Y') queryHistory();
+    if (cmd == 'u' || cmd == 'U') {
+      char args[64];
+      readSerialArgs(args, sizeof(args));
+      params.command(args, Serial);
+    }
+    if (cmd == 'h' || cmd == 'H') {
+      heapMon.sampleNow();
+      heapMon.printReport(Serial);
+      wifiMgr.printHeapReport(Serial);
+    }
+
     if (cmd == 'c' || cmd == 'C') {
       if (lcdOK && LCD_ROWS > 0) lcd.printLine(0, "Clearing WiFi...");
       wifiMgr.clearSavedCredentials();
@@ -246,162 +623,148 @@ void loop() {
 
     // existing tare behavior
     if (cmd == 't' || cmd == 'T') {
-      if (wifiConfigMode) {
-        if (lcdOK && LCD_ROWS > 0) lcd.printLine(0, "Exit WiFi setup");
-        return;
-      }
       if (LCD_ROWS > 3) lcd.printLine(3, "Tare...");
       scale.tare(32);
       float zeroKg2 = scale.getWeightKg(true);
       scaleReady = (fabsf(zeroKg2) <= ZERO_THRESHOLD_KG);
       if (LCD_ROWS > 3) lcd.printLine(3, scaleReady ? "Tare done" : "Tare not zero");
-      state = Idle;
+      fsm.reset();
       if (LCD_ROWS > 1) lcd.printLine(1, "");
       if (LCD_ROWS > 2) lcd.printLine(2, "");
-      clearBuf();
     }
   }
 
-  // Wi-Fi AP config portal mode: only serve the config web page.
-  if (wifiConfigMode) {
-    wifiMgr.loop();
-    delay(10);
-    return;
-  }
+  // The config portal serves from its own task; the scale runs regardless.
+  if (wifiConfigMode && !wifiMgr.isConfigPortalActive()) leavePortalMode();
 
   if (!lcdOK) { delay(400); return; }
 
+  heapMon.loop();
+  httpApi.loop();
+  uploader.loop();
+
+  // The weighing path below must not touch the heap; network calls inside
+  // it re-allow allocation explicitly.
+  AllocGuard::NoAlloc noAlloc;
+  if (params.generation() != appliedParams) applyParams();
+  if (Power::dozing()) {
+    dozeStep();
+    if (Power::dozing()) return;
+  }
+
+  const int64_t loopStartUs = esp_timer_get_time();
+  const unsigned long loopStartMs = millis();
+
   float kg = scale.getWeightKg(true);
-  float absKg = fabsf(kg);
 
-  // Anything at or below MIN_EFFECTIVE_WEIGHT_KG (300 g) behaves as zero
-  bool present = absKg > fmaxf(WEIGHT_DETECT_THRESHOLD_KG, MIN_EFFECTIVE_WEIGHT_KG);
-  bool isZero  = absKg <= fmaxf(ZERO_THRESHOLD_KG, MIN_EFFECTIVE_WEIGHT_KG);
+  // The reader runs for the whole cycle so a card held while the load
+  // settles is already captured when the weight becomes stable.
+  pollRfid();
 
-  // Update stability buffer
-  pushWeight(kg);
-  float stddev = bufferStdDev();
+  const WeighFsm::State prev = fsm.state();
+  const bool idReady = prev == WeighFsm::AskId && pendingIdValid();
+  WeighFsm::Event ev = fsm.update(kg, millis(), idReady);
 
-  switch (state) {
-    case Idle:
+  // Steady display of the state we were in
+  switch (prev) {
+    case WeighFsm::Idle:
       showWeight(kg);
-      if (present) {
-        state = Weighing;
-        stableStartMs = 0;
-        weighingStartMs = millis();
-        clearBuf();
-        lcd.printLine(0, "Weighing...");
-        if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 2) lcd.printLine(2, "");
-        if (LCD_ROWS > 3) lcd.printLine(3, "");
-      }
+      showPendingId();
+      maybeSyncDirectory();
+      maybeFlushQueue();
       break;
-
-    case Weighing:
+    case WeighFsm::Weighing:
       lcd.printLine(0, "Weighing...");
-      if (stddev < STABLE_STDDEV_KG) {
-        if (stableStartMs == 0) stableStartMs = millis();
-        if (millis() - stableStartMs >= STABLE_MIN_MS) {
-          stableWeightKg = bufferMean();
-          state = AskId;
-          showWeight(stableWeightKg);
-          if (LCD_ROWS > 2) lcd.printLine(2, "Please Scan The ID");
-          if (LCD_ROWS > 1) lcd.printLine(1, "");
-          if (LCD_ROWS > 3) lcd.printLine(3, "");
-          zeroStartMs = 0;
-        }
-      } else {
-        stableStartMs = 0;
-      }
-
-      // Fallback: use buffer mean if not stable before timeout
-      if (present && weighingStartMs != 0 &&
-          (millis() - weighingStartMs) >= WEIGHING_TIMEOUT_MS) {
-        stableWeightKg = bufferMean();
-        state = AskId;
-        showWeight(stableWeightKg);
-        if (LCD_ROWS > 2) lcd.printLine(2, "Please Scan The ID");
-        if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 3) lcd.printLine(3, "");
-        zeroStartMs = 0;
-      }
-      if (!present) {
-        state = Idle;
-        if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 2) lcd.printLine(2, "");
-        if (LCD_ROWS > 3) lcd.printLine(3, "");
-      }
       break;
+    case WeighFsm::AskId:
+    case WeighFsm::AwaitRemoval:
+      if (ev != WeighFsm::Reweigh) showWeight(fsm.stableKg());
+      break;
+    case WeighFsm::kStateCount:
+      break;
+  }
 
-    case AskId: {
-      // Restart weighing if weight changes a lot while waiting for ID
-      if (present && fabsf(kg - stableWeightKg) > WEIGHT_DETECT_THRESHOLD_KG) {
-        state = Weighing;
-        stableStartMs = 0;
-        weighingStartMs = millis();
-        clearBuf();
+  while (true) {
+    switch (ev) {
+      case WeighFsm::LoadPlaced:
+        Power::noteWeighing();
+        // fall through
+      case WeighFsm::Reweigh:
         lcd.printLine(0, "Weighing...");
+        showPendingId();
+        clearRows(2);
+#if UPLOAD_PREWARM
+        uploader.resolveHost();  // cached; a lookup only every UPLOAD_DNS_TTL_MS
+#endif
+        break;
+
+      case WeighFsm::Stable:
+      case WeighFsm::TimedOut:
+        showWeight(fsm.stableKg());
+        if (LCD_ROWS > 2) lcd.printLine(2, pendingIdValid() ? "ID received" : "Please Scan The ID");
         if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 2) lcd.printLine(2, "");
         if (LCD_ROWS > 3) lcd.printLine(3, "");
+#if UPLOAD_PREWARM
+        // Handshake while the fisher finds the card. Not earlier: the loop
+        // would miss the conversions the stability check is waiting for.
+        if (!pendingIdValid()) uploader.prewarm();
+#endif
         break;
-      }
 
-      showWeight(stableWeightKg);
-      String id;
-      bool scanned = rfidOK && rfid.poll(id) && id.length() > 0;
-      if (scanned) {
-        if (LCD_ROWS > 1) lcd.printLine(1, "Sending Data Wait....");
+      case WeighFsm::IdBound: {
+        char id[RFID2::kIdLen], name[IdDirectory::kNameLen];
+        takePendingId(id, name);
+        if (LCD_ROWS > 1) lcd.printLine(1, name[0] != '\0' ? name : "Sending Data Wait....");
         if (LCD_ROWS > 2) lcd.printLine(2, "Remove The weight..");
-        doSendData(id, stableWeightKg);
-        state = AwaitRemoval;
-      } else {
-        // If weight returns to zero and stays there, reset
-        if (isZero) {
-          if (zeroStartMs == 0) zeroStartMs = millis();
-          if (millis() - zeroStartMs >= NO_ID_ZERO_TIMEOUT_MS) {
-            state = Idle;
-            if (LCD_ROWS > 1) lcd.printLine(1, "");
-            if (LCD_ROWS > 2) lcd.printLine(2, "");
-            if (LCD_ROWS > 3) lcd.printLine(3, "");
-          }
-        } else {
-          zeroStartMs = 0;
-        }
+        Metrics::noteWeighIn(doSendData(id, fsm.stableKg()));
+        break;
       }
-      break;
-    }
 
-    case Sending:
-      // Unused (merged into AskId/AwaitRemoval)
-      break;
+      case WeighFsm::LoadLost:
+        // The load went before it was weighed: its scan goes with it.
+        pendingId[0] = pendingName[0] = '\0';
+        // fall through
+      case WeighFsm::NoIdTimeout:
+      case WeighFsm::Removed:
+        uploader.cancelPrewarm();
+        clearRows(1);
+        break;
 
-    case AwaitRemoval:
-      // New weighing cycle if weight increases while waiting
-      if (present && fabsf(kg - stableWeightKg) > WEIGHT_DETECT_THRESHOLD_KG) {
-        state = Weighing;
-        stableStartMs = 0;
-        weighingStartMs = millis();
-        clearBuf();
-        lcd.printLine(0, "Weighing...");
-        if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 2) lcd.printLine(2, "");
-        if (LCD_ROWS > 3) lcd.printLine(3, "");
+      default:
         break;
-      }
+    }
+    // A card shown while the load settled binds in the iteration that
+    // commits the weight, not after the next averaged read (~1.6 s).
+    if ((ev != WeighFsm::Stable && ev != WeighFsm::TimedOut) || !pendingIdValid()) break;
+    ev = fsm.update(kg, millis(), true);
+  }
 
-      showWeight(stableWeightKg);
-      if (isZero) {
-        state = Idle;
-        if (LCD_ROWS > 1) lcd.printLine(1, "");
-        if (LCD_ROWS > 2) lcd.printLine(2, "");
-        if (LCD_ROWS > 3) lcd.printLine(3, "");
-        clearBuf();
-      }
-      break;
+  Metrics::enterState(fsm.state());
+  AdcTrace::state(fsm.state());
+  const uint32_t loopUs = (uint32_t)(esp_timer_get_time() - loopStartUs);
+  Metrics::recordUs(Metrics::LoopBody, loopUs);
+  if (wifiConfigMode) Metrics::recordUs(Metrics::LoopPortal, loopUs);
+
+  if (prev == WeighFsm::Idle && fsm.state() == WeighFsm::Idle && temperatureDue()) sampleTemperature(kg);
+  // A new ADC rate (params) is calibrated with a tare on the empty platform.
+  if (prev == WeighFsm::Idle && fsm.state() == WeighFsm::Idle && scale.calibrationDue() &&
+      effectiveWeight(kg) == 0.0f && !pendingIdValid()) {
+    scale.tare(16);
   }
 
-  // Shorter loop delay for interaction. Overall stability
-  // is still governed by STABLE_MIN_MS and the buffer.
-  delay(100);
+  // Light sleep would stop the portal task, and a queued weigh-in is due
+  // out as soon as there is Wi-Fi.
+  const bool idle = fsm.state() == WeighFsm::Idle && effectiveWeight(kg) == 0.0f && !pendingIdValid() &&
+                    !AdcTrace::active() && !wifiConfigMode && !queueDue();
+  if (Power::idleLongEnough(idle)) {
+    scale.setIdleRate(true);
+    Power::enterDoze();
+    return;
+  }
+
+  // Pace iterations start to start. The FSM timers run on millis(), so the
+  // period only sets how often the FSM is fed; an ADC read already takes
+  // longer than LOOP_PERIOD_MS with the default averaging.
+  const unsigned long spentMs = millis() - loopStartMs;
+  if (spentMs < loopPeriodMs) delay(loopPeriodMs - spentMs);
 }
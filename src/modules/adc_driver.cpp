@@ -0,0 +1,217 @@
+#include "adc_driver.h"
+#include <freertos/FreeRTOS.h>
+
+// ---------------- NAU7802 ----------------
+bool Nau7802Adc::begin() {
+  // Start NAU7802 on its own I2C bus (GPIO16/17 from config.h)
+  wire_.begin(SCALE_SDA_PIN, SCALE_SCL_PIN);
+  if (!adc_.begin(wire_)) return false;
+
+  // Basic NAU config
+  adc_.setGain(NAU7802_GAIN_128);
+  setRate(AdcRate::Active);             // kActiveSps: faster updates, still stable
+  adc_.setChannel(NAU7802_CHANNEL_1);
+
+  // Calibrate analog front-end
+  if (!calibrate()) return false;
+
+  // Let it settle and discard early conversions (shortened)
+  delay(400);
+  for (int i = 0; i < 6; i++) {
+    (void)adc_.getReading();
+    delay(5);
+  }
+  return true;
+}
+
+namespace {
+NAU7802_SPS_Values nauRateCode(uint16_t sps) {
+  switch (sps) {
+    case 320: return NAU7802_SPS_320;
+    case 80: return NAU7802_SPS_80;
+    case 40: return NAU7802_SPS_40;
+    case 20: return NAU7802_SPS_20;
+    default: return NAU7802_SPS_10;
+  }
+}
+} // namespace
+
+void Nau7802Adc::setRate(AdcRate r) {
+  rate_ = r;
+  adc_.setSampleRate(r == AdcRate::Idle      ? NAU7802_SPS_10
+                     : r == AdcRate::Capture ? NAU7802_SPS_320
+                                             : nauRateCode(activeSps_));
+}
+
+uint16_t Nau7802Adc::setActiveSps(uint16_t sps) {
+  static const uint16_t kRates[] = {320, 80, 40, 20};
+  activeSps_ = 10;
+  for (uint16_t r : kRates) {
+    if (sps >= r) {
+      activeSps_ = r;
+      break;
+    }
+  }
+  return activeSps_;
+}
+
+// Conversions after a gain or input change still carry the old setting
+// through the digital filter: drop two each way.
+bool Nau7802Adc::readTemperatureC(float &c) {
+  const uint32_t timeoutMs = 3 * periodUs() / 1000 + 50;
+  auto next = [&](int32_t &v) {
+    const unsigned long start = millis();
+    while (!adc_.available()) {
+      if (millis() - start > timeoutMs) return false;
+      delay(1);
+    }
+    v = adc_.getReading();
+    return true;
+  };
+
+  adc_.setGain(NAU7802_GAIN_1);
+  adc_.setBit(NAU7802_I2C_CONTROL_TS, NAU7802_I2C_CONTROL);
+  int32_t v = 0;
+  long total = 0;
+  bool ok = true;
+  for (uint8_t i = 0; i < 6 && ok; ++i) {
+    ok = next(v);
+    if (i >= 2) total += v;
+  }
+  adc_.clearBit(NAU7802_I2C_CONTROL_TS, NAU7802_I2C_CONTROL);
+  adc_.setGain(NAU7802_GAIN_128);
+  for (uint8_t i = 0; i < 2 && ok; ++i) ok = next(v);
+  if (!ok) return false;
+  c = 25.0f + (total / 4 - NAU7802_TEMP_COUNTS_25C) / NAU7802_TEMP_COUNTS_PER_C;
+  return true;
+}
+
+// ---------------- HX711 / ADS1232 ----------------
+namespace {
+portMUX_TYPE g_shiftMux = portMUX_INITIALIZER_UNLOCKED;
+} // namespace
+
+bool SerialAdcBase::beginPins_() {
+  pinMode(SERIAL_ADC_DOUT_PIN, INPUT_PULLUP);
+  pinMode(SERIAL_ADC_SCK_PIN, OUTPUT);
+  digitalWrite(SERIAL_ADC_SCK_PIN, LOW);  // also leaves HX711 power-down
+#if SERIAL_ADC_RATE_PIN != 255
+  pinMode(SERIAL_ADC_RATE_PIN, OUTPUT);
+#endif
+  setRate(AdcRate::Active);
+  return connected();
+}
+
+// A part that is not there leaves DOUT pulled high.
+bool SerialAdcBase::connected() { return waitReady_(3 * periodUs() / 1000 + 50); }
+
+bool SerialAdcBase::waitReady_(uint32_t timeoutMs) {
+  const unsigned long start = millis();
+  while (!ready()) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+void SerialAdcBase::setRate(AdcRate r) {
+#if SERIAL_ADC_RATE_PIN != 255
+  sps_ = r == AdcRate::Idle ? 10 : activeSps_;
+  digitalWrite(SERIAL_ADC_RATE_PIN, sps_ == 80 ? HIGH : LOW);
+#else
+  (void)r;
+  sps_ = SERIAL_ADC_STRAPPED_SPS;
+#endif
+}
+
+uint16_t SerialAdcBase::setActiveSps(uint16_t sps) {
+#if SERIAL_ADC_RATE_PIN != 255
+  activeSps_ = sps >= 80 ? 80 : 10;
+#else
+  (void)sps;
+#endif
+  return activeSps_;
+}
+
+int32_t SerialAdcBase::shift_(uint8_t extraPulses) {
+  uint32_t value = 0;
+  portENTER_CRITICAL(&g_shiftMux);
+  for (uint8_t i = 0; i < 24; ++i) {
+    digitalWrite(SERIAL_ADC_SCK_PIN, HIGH);
+    delayMicroseconds(1);
+    value = (value << 1) | (uint32_t)(digitalRead(SERIAL_ADC_DOUT_PIN) & 1);
+    digitalWrite(SERIAL_ADC_SCK_PIN, LOW);
+    delayMicroseconds(1);
+  }
+  for (uint8_t i = 0; i < extraPulses; ++i) {
+    digitalWrite(SERIAL_ADC_SCK_PIN, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(SERIAL_ADC_SCK_PIN, LOW);
+    delayMicroseconds(1);
+  }
+  portEXIT_CRITICAL(&g_shiftMux);
+  // Sign-extend two's complement 24-bit.
+  return (int32_t)(value << 8) >> 8;
+}
+
+bool Hx711Adc::begin() {
+  if (!beginPins_()) return false;
+  // First conversion after power-up sets the gain for the next one; drop two.
+  for (int i = 0; i < 2; i++) {
+    if (!waitReady_(3 * periodUs() / 1000 + 50)) return false;
+    (void)read();
+  }
+  return true;
+}
+
+bool Ads1232Adc::begin() {
+#if ADS1232_PDWN_PIN != 255
+  pinMode(ADS1232_PDWN_PIN, OUTPUT);
+  digitalWrite(ADS1232_PDWN_PIN, HIGH);
+  delay(1);
+#endif
+  if (!beginPins_()) return false;
+  return calibrate();
+}
+
+bool Ads1232Adc::calibrate() {
+  // Read, then the 26th pulse: DOUT stays high until the offset is done.
+  if (!waitReady_(3 * periodUs() / 1000 + 50)) return false;
+  (void)shift_(2);
+  return waitReady_(11 * periodUs() / 1000 + 50);
+}
+
+// ---------------- Emulated ----------------
+bool EmulatedAdc::begin() {
+  lastUs_ = micros();
+  return true;
+}
+
+void EmulatedAdc::setRate(AdcRate r) {
+  rate_ = r;
+  lastUs_ = micros();
+}
+
+uint16_t EmulatedAdc::setActiveSps(uint16_t sps) {
+  activeSps_ = sps < 1 ? 1 : sps > 320 ? 320 : sps;
+  return activeSps_;
+}
+
+float EmulatedAdc::noise_() {
+  // Sum of four uniforms (xorshift32), scaled to unit variance.
+  float sum = 0.0f;
+  for (int i = 0; i < 4; ++i) {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    sum += (float)(rng_ & 0xFFFF) / 65535.0f;
+  }
+  return (sum - 2.0f) * 1.7320508f;
+}
+
+int32_t EmulatedAdc::read() {
+  // Conversions sit on a fixed grid, like a free-running converter.
+  const uint32_t now = micros();
+  lastUs_ = now - (now - lastUs_) % periodUs();
+  return offsetCounts_ + (int32_t)lroundf(loadGrams_ * SCALE_CAL_FACTOR_DEFAULT + noise_() * noiseCounts_);
+}
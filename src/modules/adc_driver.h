@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <SparkFun_Qwiic_Scale_NAU7802_Arduino_Library.h>
+#include "config.h"
+
+// Load cell ADC drivers: compile-time policies for ScaleManager (scale.h).
+//
+// ScaleManager is a template over one of these; SCALE_ADC in config.h picks
+// the one the firmware uses (ScaleAdc below). Calls are direct, no virtual
+// dispatch, and every driver has the same shape:
+//
+//   static constexpr const char *kName;
+//   static constexpr uint16_t kActiveSps; // Active rate after begin()
+//   bool begin();              // bus/pins, fixed gain and channel, settle
+//   bool connected();
+//   bool ready();              // a conversion is waiting (DRDY)
+//   int32_t read();            // take it: signed 24-bit counts
+//   void setRate(AdcRate r);   // Active while weighing, Idle while dozing,
+//                              // Capture: fastest rate (vibration analysis)
+//   uint16_t setActiveSps(uint16_t sps); // Active rate from the next
+//                              // setRate(Active): the fastest the part has at
+//                              // or below sps; returns it
+//   uint32_t periodUs() const; // conversion period at the current rate
+//   bool calibrate();          // internal offset calibration; true if done
+//   bool readTemperatureC(float &c); // on-chip sensor; false if there is none
+//
+// read() is only meaningful after ready(); the counts are raw (zero offset
+// and calibration factor are ScaleManager's). test/test_adc runs the
+// same conformance checks and benchmark on every driver.
+enum class AdcRate : uint8_t { Active, Idle, Capture };
+
+// NAU7802 over its own I2C bus (SparkFun library), 20 SPS (10..320 with
+// setActiveSps) / 10 SPS, and 320 SPS for captures.
+class Nau7802Adc {
+ public:
+  static constexpr const char *kName = "nau7802";
+  static constexpr uint16_t kActiveSps = 20;
+
+  bool begin();
+  bool connected() { return adc_.isConnected(); }
+  bool ready() { return adc_.available(); }
+  int32_t read() { return adc_.getReading(); }
+  void setRate(AdcRate r);
+  uint16_t setActiveSps(uint16_t sps);
+  uint32_t periodUs() const {
+    return rate_ == AdcRate::Idle ? 100000UL : rate_ == AdcRate::Capture ? 3125UL : 1000000UL / activeSps_;
+  }
+  bool calibrate() { return adc_.calibrateAFE(); }
+  // Temperature sensor through the PGA at gain 1, then back to the load
+  // cell: ~8 conversions (~400 ms at 20 SPS) that are not load readings.
+  bool readTemperatureC(float &c);
+
+  NAU7802 &device() { return adc_; }  // register access (temperature, gain)
+
+ private:
+  NAU7802 adc_;
+  TwoWire wire_{1};
+  AdcRate rate_ = AdcRate::Active;
+  uint16_t activeSps_ = kActiveSps;
+};
+
+// Shared by the two serial-interface parts: DOUT low = data ready, 24 bits
+// shifted out MSB first on SCK rising edges, then extra pulses for gain or
+// calibration. The shift runs in a critical section; SCK high for more than
+// 60 us powers an HX711 down.
+class SerialAdcBase {
+ public:
+#if SERIAL_ADC_RATE_PIN != 255
+  static constexpr uint16_t kActiveSps = 80;
+#else
+  static constexpr uint16_t kActiveSps = SERIAL_ADC_STRAPPED_SPS;
+#endif
+
+  bool connected();
+  bool ready() { return digitalRead(SERIAL_ADC_DOUT_PIN) == LOW; }
+  void setRate(AdcRate r);
+  // 10 or 80 with the RATE/SPEED pin, else the strapped rate.
+  uint16_t setActiveSps(uint16_t sps);
+  uint32_t periodUs() const { return 1000000UL / sps_; }
+
+ protected:
+  bool beginPins_();
+  int32_t shift_(uint8_t extraPulses);
+  bool waitReady_(uint32_t timeoutMs);
+
+  uint16_t sps_ = SERIAL_ADC_STRAPPED_SPS;
+  uint16_t activeSps_ = kActiveSps;
+};
+
+// HX711, channel A at gain 128 (25 pulses per read). No offset calibration
+// on chip; calibrate() only resynchronises, tare does the rest.
+class Hx711Adc : public SerialAdcBase {
+ public:
+  static constexpr const char *kName = "hx711";
+
+  bool begin();
+  int32_t read() { return shift_(1); }
+  bool calibrate() { return waitReady_(3 * periodUs() / 1000 + 50); }
+  bool readTemperatureC(float &) { return false; }
+};
+
+// ADS1232, gain set by pins (128). A 26th pulse after a read starts the
+// offset calibration (~801 ms at 10 SPS, ~101 ms at 80 SPS).
+class Ads1232Adc : public SerialAdcBase {
+ public:
+  static constexpr const char *kName = "ads1232";
+
+  bool begin();
+  int32_t read() { return shift_(1); }
+  bool calibrate();
+  bool readTemperatureC(float &) { return false; }
+};
+
+// No hardware: conversions at the configured rate from an offset, a load
+// (setLoadGrams) and pseudo-random noise. For bench tests of the firmware
+// without a load cell, and as the reference in the host conformance run.
+class EmulatedAdc {
+ public:
+  static constexpr const char *kName = "emulated";
+  static constexpr uint16_t kActiveSps = 20;
+
+  bool begin();
+  bool connected() { return true; }
+  bool ready() { return micros() - lastUs_ >= periodUs(); }
+  int32_t read();
+  void setRate(AdcRate r);
+  uint16_t setActiveSps(uint16_t sps);  // any rate, 1..320
+  uint32_t periodUs() const {
+    return rate_ == AdcRate::Idle ? 100000UL : rate_ == AdcRate::Capture ? 3125UL : 1000000UL / activeSps_;
+  }
+  bool calibrate() { return true; }
+  bool readTemperatureC(float &) { return false; }
+
+  void setLoadGrams(float g) { loadGrams_ = g; }
+  void setNoiseCounts(float sigma) { noiseCounts_ = sigma; }
+
+ private:
+  float noise_();
+
+  AdcRate rate_ = AdcRate::Active;
+  uint16_t activeSps_ = kActiveSps;
+  uint32_t lastUs_ = 0;
+  int32_t offsetCounts_ = 8000;
+  float loadGrams_ = 0.0f;
+  float noiseCounts_ = 6.0f;
+  uint32_t rng_ = 0x2545F491;
+};
+
+#if SCALE_ADC == SCALE_ADC_HX711
+using ScaleAdc = Hx711Adc;
+#elif SCALE_ADC == SCALE_ADC_ADS1232
+using ScaleAdc = Ads1232Adc;
+#elif SCALE_ADC == SCALE_ADC_EMULATED
+using ScaleAdc = EmulatedAdc;
+#else
+using ScaleAdc = Nau7802Adc;
+#endif
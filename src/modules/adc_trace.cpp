@@ -0,0 +1,116 @@
+#include "adc_trace.h"
+
+#include <LittleFS.h>
+#include "alloc_guard.h"
+#include "event_log.h"
+
+namespace AdcTrace {
+namespace {
+
+File g_file;
+bool g_active = false;
+uint32_t g_bytes = 0;       // written to the file, including the buffer
+uint32_t g_lastMs = 0;      // time of the previous record
+uint8_t g_lastState = 0xFF;
+
+// Flash writes are batched; a flush costs one LittleFS write of this size.
+uint8_t g_buf[512];
+size_t g_len = 0;
+
+void flush() {
+  if (g_len == 0) return;
+  AllocGuard::Allow allow;  // LittleFS may allocate a cache block on first write
+  g_file.write(g_buf, g_len);
+  g_len = 0;
+}
+
+void put(const void *data, size_t n) {
+  memcpy(g_buf + g_len, data, n);
+  g_len += n;
+}
+
+// Starts a record of `payload` bytes; false if the trace is full (and stops it).
+bool begin(Tag tag, size_t payload) {
+  if (!g_active) return false;
+  const uint32_t now = millis();
+  uint32_t dt = now - g_lastMs;
+  const size_t need = (dt > 0xFFFF ? 7 : 0) + 3 + payload;
+  if (g_bytes + need > ADC_TRACE_MAX_BYTES) {
+    stop();
+    return false;
+  }
+  if (g_len + need > sizeof(g_buf)) flush();
+  if (dt > 0xFFFF) {
+    const uint8_t t[3] = {TagTime, 0, 0};
+    put(t, sizeof(t));
+    put(&now, 4);
+    dt = 0;
+  }
+  const uint8_t h[3] = {tag, (uint8_t)dt, (uint8_t)(dt >> 8)};
+  put(h, sizeof(h));
+  g_lastMs = now;
+  g_bytes += need;
+  return true;
+}
+
+} // namespace
+
+bool start(long zeroOffset, float calFactor) {
+  if (g_active) stop();
+  AllocGuard::Allow allow;
+  if (!LittleFS.begin(true)) return false;
+  g_file = LittleFS.open(ADC_TRACE_PATH, "w");
+  if (!g_file) return false;
+
+  FileHeader h = {kMagic, kVersion, {0, 0, 0}, (uint32_t)millis()};
+  g_file.write(reinterpret_cast<const uint8_t *>(&h), sizeof(h));
+  g_bytes = sizeof(h);
+  g_lastMs = h.startMs;
+  g_lastState = 0xFF;
+  g_len = 0;
+  g_active = true;
+  calibration(zeroOffset, calFactor);
+  LOG_EVENT(TraceStarted);
+  return true;
+}
+
+void stop() {
+  if (!g_active) return;
+  g_active = false;
+  flush();
+  g_file.close();
+  LOG_EVENT(TraceStopped, g_bytes);
+}
+
+bool active() { return g_active; }
+uint32_t bytes() { return g_bytes; }
+
+void sample(int32_t counts) {
+  if (!begin(TagSample, 3)) return;
+  const uint8_t c[3] = {(uint8_t)counts, (uint8_t)(counts >> 8), (uint8_t)(counts >> 16)};
+  put(c, sizeof(c));
+}
+
+void weight() { begin(TagWeight, 0); }
+
+void calibration(long zeroOffset, float calFactor) {
+  if (!begin(TagCal, 8)) return;
+  const int32_t z = (int32_t)zeroOffset;
+  put(&z, 4);
+  put(&calFactor, 4);
+}
+
+void state(uint8_t s) {
+  if (!g_active || s == g_lastState) return;
+  if (!begin(TagState, 1)) return;
+  g_lastState = s;
+  put(&s, 1);
+}
+
+void rfid(const uint8_t *uid, uint8_t len) {
+  if (!begin(TagRfid, 1 + (size_t)len)) return;
+  put(&len, 1);
+  put(uid, len);
+}
+
+} // namespace AdcTrace
@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Raw ADC trace capture for offline threshold tuning.
+//
+// While recording, every ADC conversion, the end of each averaged read,
+// tare/calibration changes, FSM state changes and RFID scans are appended to
+// ADC_TRACE_PATH on LittleFS in a compact binary format (~125 B/s at
+// 20 SPS). Records go through a small RAM buffer that is flushed to flash
+// when full. Serial 'r' starts/stops a capture; GET /trace downloads it.
+// src/host/replay_main.cpp replays a trace through WeighFsm.
+//
+// File layout (little endian):
+//   FileHeader, then records: tag (u8), dt (u16, ms since previous record),
+//   payload:
+//     'S' sample     i24 raw counts
+//     'W' weight     -             (end of one ScaleManager::getWeightKg)
+//     'Z' cal        i32 zero offset, f32 calibration factor
+//     'F' state      u8 WeighFsm::State
+//     'R' rfid       u8 length, UID bytes
+//     'T' time       u32 absolute ms (dt = 0), when dt would overflow
+namespace AdcTrace {
+
+constexpr uint32_t kMagic = 0x52544346;  // "FCTR"
+constexpr uint8_t kVersion = 2;  // 2: WeighFsm without the unused Sending state
+
+enum Tag : uint8_t {
+  TagSample = 'S',
+  TagWeight = 'W',
+  TagCal = 'Z',
+  TagState = 'F',
+  TagRfid = 'R',
+  TagTime = 'T',
+};
+
+struct FileHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t reserved[3];
+  uint32_t startMs;
+};
+
+// Truncates the trace file and starts recording with the current calibration.
+bool start(long zeroOffset, float calFactor);
+// Flushes and closes; also called when ADC_TRACE_MAX_BYTES is reached.
+void stop();
+bool active();
+uint32_t bytes();
+
+void sample(int32_t counts);
+void weight();
+void calibration(long zeroOffset, float calFactor);
+void state(uint8_t s);
+void rfid(const uint8_t *uid, uint8_t len);
+
+} // namespace AdcTrace
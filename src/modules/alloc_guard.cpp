@@ -0,0 +1,72 @@
+#include "alloc_guard.h"
+
+#if FISHCORE_ALLOC_GUARD
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+}
+
+namespace {
+volatile bool g_armed = false;
+TaskHandle_t g_task = nullptr;
+volatile int g_noAllocDepth = 0;  // only touched by the guarded task
+volatile int g_allowDepth = 0;
+
+volatile uint32_t g_allocs = 0;
+volatile uint32_t g_hotAllocs = 0;
+volatile uintptr_t g_lastHotCaller = 0;
+
+inline void note(void *caller) {
+  if (!g_armed) return;
+  g_allocs++;
+  if (g_noAllocDepth > 0 && g_allowDepth == 0 && xTaskGetCurrentTaskHandle() == g_task) {
+    g_hotAllocs++;
+    g_lastHotCaller = reinterpret_cast<uintptr_t>(caller);
+#if FISHCORE_ALLOC_TRAP
+    abort();
+#endif
+  }
+}
+} // namespace
+
+extern "C" {
+void *__wrap_malloc(size_t size) {
+  note(__builtin_return_address(0));
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  note(__builtin_return_address(0));
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  note(__builtin_return_address(0));
+  return __real_realloc(ptr, size);
+}
+}
+
+namespace AllocGuard {
+
+void arm() {
+  g_task = xTaskGetCurrentTaskHandle();
+  g_allocs = 0;
+  g_hotAllocs = 0;
+  g_lastHotCaller = 0;
+  g_armed = true;
+}
+
+Stats stats() { return Stats{g_allocs, g_hotAllocs, g_lastHotCaller}; }
+
+NoAlloc::NoAlloc() { g_noAllocDepth++; }
+NoAlloc::~NoAlloc() { g_noAllocDepth--; }
+
+Allow::Allow() { g_allowDepth++; }
+Allow::~Allow() { g_allowDepth--; }
+
+} // namespace AllocGuard
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+
+// Heap allocation instrumentation for the steady-state loop.
+//
+// Built with -DFISHCORE_ALLOC_GUARD=1 and the linker wraps from
+// [env:esp32dev_allocguard], every malloc/calloc/realloc after arm() is
+// counted. Allocations made by the loop task inside a NoAlloc scope are
+// "hot-path allocations": they are counted separately and, with
+// -DFISHCORE_ALLOC_TRAP=1, abort() so the panic backtrace shows the caller.
+//
+// Without the build flag every call compiles to nothing.
+namespace AllocGuard {
+
+struct Stats {
+  uint32_t allocs;          // all allocations since arm()
+  uint32_t hotPathAllocs;   // allocations inside NoAlloc scopes
+  uintptr_t lastHotCaller;  // return address of the last hot-path allocation
+};
+
+#if FISHCORE_ALLOC_GUARD
+// Call at the end of setup(); the calling task becomes the guarded task.
+void arm();
+Stats stats();
+
+// Marks a region of the loop task that must not allocate.
+class NoAlloc {
+ public:
+  NoAlloc();
+  ~NoAlloc();
+};
+
+// Re-allows allocation inside a NoAlloc region (network/library calls whose
+// internals allocate, e.g. HTTPClient and the TLS stack).
+class Allow {
+ public:
+  Allow();
+  ~Allow();
+};
+#else
+inline void arm() {}
+inline Stats stats() { return Stats{0, 0, 0}; }
+class NoAlloc {
+ public:
+  NoAlloc() {}
+};
+class Allow {
+ public:
+  Allow() {}
+};
+#endif
+
+} // namespace AllocGuard
@@ -0,0 +1,175 @@
+#include "event_log.h"
+
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace EventLog {
+namespace {
+
+static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0, "LOG_RING_RECORDS must be a power of two");
+constexpr uint32_t kMask = LOG_RING_RECORDS - 1;
+
+// Bounded MPMC queue (per-slot sequence numbers): producers claim a slot with
+// one CAS and publish it by bumping its sequence; no locks, no blocking.
+struct Slot {
+  std::atomic<uint32_t> seq;
+  Record rec;
+};
+
+Slot g_slots[LOG_RING_RECORDS];
+std::atomic<uint32_t> g_head{0};  // next slot to write
+uint32_t g_tail = 0;              // next slot to drain (drain task only)
+std::atomic<uint32_t> g_dropped{0};
+bool g_slotsInit = false;
+TaskHandle_t g_task = nullptr;
+
+void initSlots() {
+  for (uint32_t i = 0; i < LOG_RING_RECORDS; ++i) g_slots[i].seq.store(i, std::memory_order_relaxed);
+  g_slotsInit = true;
+}
+
+bool pop(Record &out) {
+  Slot &s = g_slots[g_tail & kMask];
+  const uint32_t seq = s.seq.load(std::memory_order_acquire);
+  if ((int32_t)(seq - (g_tail + 1)) < 0) return false;
+  out = s.rec;
+  s.seq.store(g_tail + LOG_RING_RECORDS, std::memory_order_release);
+  g_tail++;
+  return true;
+}
+
+#if FISHCORE_LOG_TEXT
+constexpr const char *kNames[] = {
+#define FISHCORE_LOG_NAMES(name, level, fmt) #name,
+    FISHCORE_LOG_EVENTS(FISHCORE_LOG_NAMES)
+#undef FISHCORE_LOG_NAMES
+};
+constexpr const char *kFormats[] = {
+#define FISHCORE_LOG_FORMATS(name, level, fmt) fmt,
+    FISHCORE_LOG_EVENTS(FISHCORE_LOG_FORMATS)
+#undef FISHCORE_LOG_FORMATS
+};
+
+// Same conversions as tools/log_decode.py.
+void emit(const Record &r) {
+  char line[160];
+  size_t n = snprintf(line, sizeof(line), "[%10lu] %s: ", (unsigned long)r.ms,
+                      r.event < kEventCount ? kNames[r.event] : "?");
+  const char *f = r.event < kEventCount ? kFormats[r.event] : "";
+  uint8_t ai = 0;
+  while (*f && n + 16 < sizeof(line)) {
+    if (*f != '%') {
+      line[n++] = *f++;
+      continue;
+    }
+    char spec[8] = {'%'};
+    size_t sp = 1;
+    f++;
+    while ((*f == '0' || (*f >= '1' && *f <= '9')) && sp < 4) spec[sp++] = *f++;
+    const char conv = *f ? *f++ : '%';
+    const uint32_t v = ai < r.nargs ? r.args[ai] : 0;
+    switch (conv) {
+      case 'k':
+        n += snprintf(line + n, sizeof(line) - n, "%ld.%02ld", (long)(int32_t)v / 100, labs((long)(int32_t)v % 100));
+        ai++;
+        break;
+      case 'I':
+        n += snprintf(line + n, sizeof(line) - n, "%lu.%lu.%lu.%lu", (unsigned long)(v & 0xFF),
+                      (unsigned long)((v >> 8) & 0xFF), (unsigned long)((v >> 16) & 0xFF), (unsigned long)(v >> 24));
+        ai++;
+        break;
+      case 'd':
+        spec[sp++] = 'l';
+        spec[sp++] = 'd';
+        n += snprintf(line + n, sizeof(line) - n, spec, (long)(int32_t)v);
+        ai++;
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+        spec[sp++] = 'l';
+        spec[sp++] = conv;
+        n += snprintf(line + n, sizeof(line) - n, spec, (unsigned long)v);
+        ai++;
+        break;
+      default:
+        line[n++] = '%';
+        break;
+    }
+  }
+  line[n++] = '\n';
+  Serial.write(reinterpret_cast<const uint8_t *>(line), n);
+}
+#else
+void emit(const Record &r) {
+  uint8_t frame[2 + sizeof(Record) + 1];
+  frame[0] = 0xA5;
+  frame[1] = 0x5A;
+  memcpy(frame + 2, &r, sizeof(Record));
+  uint8_t x = 0;
+  for (size_t i = 0; i < sizeof(Record); ++i) x ^= frame[2 + i];
+  frame[sizeof(frame) - 1] = x;
+  Serial.write(frame, sizeof(frame));
+}
+#endif
+
+void drainTask(void *) {
+  uint32_t reportedDrops = 0;
+  for (;;) {
+    Record r;
+    bool any = false;
+    while (pop(r)) {
+      emit(r);
+      any = true;
+    }
+    const uint32_t d = g_dropped.load(std::memory_order_relaxed);
+    if (d != reportedDrops) {
+      Record dr = {(uint32_t)millis(), LogDropped, LOG_LEVEL_WARN, 1, {d - reportedDrops, 0, 0}};
+      emit(dr);
+      reportedDrops = d;
+    }
+    if (!any) vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+  }
+}
+
+} // namespace
+
+void begin() {
+  if (!g_slotsInit) initSlots();
+  if (g_task != nullptr) return;
+  // Core 0 next to the Wi-Fi stack; loop() runs on core 1 and is never
+  // blocked by UART writes.
+  xTaskCreatePinnedToCore(drainTask, "log", 3072, nullptr, 1, &g_task, 0);
+}
+
+void write(Event e, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2) {
+  if (!g_slotsInit) initSlots();  // records before begin() (static init, early setup)
+  uint32_t pos = g_head.load(std::memory_order_relaxed);
+  Slot *s;
+  for (;;) {
+    s = &g_slots[pos & kMask];
+    const uint32_t seq = s->seq.load(std::memory_order_acquire);
+    const int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (g_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      g_dropped.fetch_add(1, std::memory_order_relaxed);  // full
+      return;
+    } else {
+      pos = g_head.load(std::memory_order_relaxed);
+    }
+  }
+  s->rec.ms = millis();
+  s->rec.event = e;
+  s->rec.level = kLevels[e];
+  s->rec.nargs = nargs;
+  s->rec.args[0] = a0;
+  s->rec.args[1] = a1;
+  s->rec.args[2] = a2;
+  s->seq.store(pos + 1, std::memory_order_release);
+}
+
+uint32_t dropped() { return g_dropped.load(std::memory_order_relaxed); }
+
+} // namespace EventLog
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "log_events.h"
+
+// Deferred binary event log.
+//
+// LOG_EVENT(name, args...) stores a fixed-size record (timestamp, event id,
+// up to three 32-bit args) in a lock-free ring and returns; a low-priority
+// task drains the ring to Serial. Producers never block: if the ring is full
+// the record is dropped and counted.
+//
+// Events below FISHCORE_LOG_LEVEL compile to nothing (arguments are not
+// evaluated either).
+//
+// Wire format (little endian), one frame per record:
+//   0xA5 0x5A | u32 ms | u16 event | u8 level | u8 nargs | u32 args[3] | u8 xor
+// Anything between frames is plain text (e.g. command output) and is passed
+// through by tools/log_decode.py.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+namespace EventLog {
+
+enum Event : uint16_t {
+#define FISHCORE_LOG_ENUM(name, level, fmt) name,
+  FISHCORE_LOG_EVENTS(FISHCORE_LOG_ENUM)
+#undef FISHCORE_LOG_ENUM
+  kEventCount
+};
+
+constexpr uint8_t kLevels[] = {
+#define FISHCORE_LOG_LEVELS(name, level, fmt) LOG_LEVEL_##level,
+    FISHCORE_LOG_EVENTS(FISHCORE_LOG_LEVELS)
+#undef FISHCORE_LOG_LEVELS
+};
+
+constexpr bool enabled(Event e) { return kLevels[e] >= FISHCORE_LOG_LEVEL; }
+
+struct Record {
+  uint32_t ms;
+  uint16_t event;
+  uint8_t level;
+  uint8_t nargs;
+  uint32_t args[3];
+};
+
+// Starts the drain task. Records written before begin() are kept in the ring.
+void begin();
+
+void write(Event e, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2);
+
+inline void log(Event e) { write(e, 0, 0, 0, 0); }
+inline void log(Event e, uint32_t a0) { write(e, 1, a0, 0, 0); }
+inline void log(Event e, uint32_t a0, uint32_t a1) { write(e, 2, a0, a1, 0); }
+inline void log(Event e, uint32_t a0, uint32_t a1, uint32_t a2) { write(e, 3, a0, a1, a2); }
+
+uint32_t dropped();
+
+} // namespace EventLog
+
+#define LOG_EVENT(name, ...)                                                   \
+  do {                                                                         \
+    if (EventLog::enabled(EventLog::name)) EventLog::log(EventLog::name, ##__VA_ARGS__); \
+  } while (0)
@@ -0,0 +1,44 @@
+#include "heap_monitor.h"
+#include <esp_heap_caps.h>
+#include "alloc_guard.h"
+#include "tls_session.h"
+
+void HeapMonitor::loop() {
+  if (count_ != 0 && millis() - lastSampleMs_ < HEAP_SAMPLE_PERIOD_MS) return;
+  sampleNow();
+}
+
+void HeapMonitor::sampleNow() {
+  lastSampleMs_ = millis();
+  Sample &s = samples_[next_];
+  s.uptimeS = lastSampleMs_ / 1000;
+  s.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  s.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  s.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (s.largestBlock < lowestLargestBlock_) lowestLargestBlock_ = s.largestBlock;
+  next_ = (next_ + 1) % kSamples;
+  if (count_ < kSamples) count_++;
+}
+
+void HeapMonitor::printReport(Print &out) const {
+  out.printf("heap: uptime_s free min_free largest_block\n");
+  const uint8_t first = (count_ < kSamples) ? 0 : next_;
+  for (uint8_t i = 0; i < count_; ++i) {
+    const Sample &s = samples_[(first + i) % kSamples];
+    out.printf("heap: %lu %lu %lu %lu\n", (unsigned long)s.uptimeS, (unsigned long)s.freeBytes,
+               (unsigned long)s.minFreeBytes, (unsigned long)s.largestBlock);
+  }
+  if (count_ > 0) {
+    out.printf("heap: lowest largest_block %lu\n", (unsigned long)lowestLargestBlock_);
+  }
+
+  const AllocGuard::Stats a = AllocGuard::stats();
+#if FISHCORE_ALLOC_GUARD
+  out.printf("alloc: since_setup %lu hot_path %lu last_hot_caller 0x%08lx\n", (unsigned long)a.allocs,
+             (unsigned long)a.hotPathAllocs, (unsigned long)a.lastHotCaller);
+#else
+  (void)a;
+  out.printf("alloc: guard disabled (build env esp32dev_allocguard)\n");
+#endif
+  TlsSession::printReport(out);
+}
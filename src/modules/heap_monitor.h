@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Periodic heap health samples (free heap, lowest-ever free heap and the
+// largest free block) kept in a fixed ring, so fragmentation over a market
+// day can be read back over Serial ('h').
+class HeapMonitor {
+ public:
+  static constexpr uint8_t kSamples = 48;
+
+  struct Sample {
+    uint32_t uptimeS;
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;
+    uint32_t largestBlock;
+  };
+
+  // Call from loop(); takes a sample every HEAP_SAMPLE_PERIOD_MS.
+  void loop();
+  void sampleNow();
+  void printReport(Print &out) const;
+
+ private:
+  Sample samples_[kSamples] = {};
+  uint8_t next_ = 0;
+  uint8_t count_ = 0;
+  unsigned long lastSampleMs_ = 0;
+  uint32_t lowestLargestBlock_ = UINT32_MAX;
+};
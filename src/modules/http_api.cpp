@@ -0,0 +1,191 @@
+#include "http_api.h"
+
+#include <LittleFS.h>
+#include <WebServer.h>
+#include <algorithm>
+#include "adc_trace.h"
+#include "metrics.h"
+#include "power.h"
+#include "station_params.h"
+#include "weigh_log.h"
+
+namespace {
+WebServer *asServer(void *p) { return reinterpret_cast<WebServer *>(p); }
+
+// Print adapter that streams a chunked response through a fixed buffer.
+class ChunkedResponse : public Print {
+ public:
+  ChunkedResponse(WebServer &server, const char *contentType) : server_(server) {
+    server_.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server_.send(200, contentType, "");
+  }
+  ~ChunkedResponse() {
+    flush_();
+    server_.sendContent("", 0);  // terminating chunk
+  }
+
+  size_t write(uint8_t c) override {
+    if (len_ == sizeof(buf_)) flush_();
+    buf_[len_++] = (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t n) override {
+    for (size_t i = 0; i < n; ++i) write(data[i]);
+    return n;
+  }
+
+ private:
+  void flush_() {
+    if (len_ == 0) return;
+    server_.sendContent(buf_, len_);
+    len_ = 0;
+  }
+
+  WebServer &server_;
+  char buf_[512];
+  size_t len_ = 0;
+};
+
+// Print into a fixed buffer; the tail is dropped when it is full.
+class TextBuffer : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    if (len_ + 1 >= sizeof(buf_)) return 0;
+    buf_[len_++] = (char)c;
+    buf_[len_] = '\0';
+    return 1;
+  }
+  const char *c_str() const { return buf_; }
+
+ private:
+  char buf_[256] = {};
+  size_t len_ = 0;
+};
+} // namespace
+
+bool HttpApi::begin(uint16_t port) {
+  if (server_ != nullptr) return true;
+  server_ = new WebServer(port);
+  WebServer &server = *asServer(server_);
+
+  server.on("/metrics", HTTP_GET, [this]() {
+    ChunkedResponse out(*asServer(server_), "text/plain; version=0.0.4");
+    Metrics::printPrometheus(out);
+    Power::printPrometheus(out);
+  });
+
+  server.on("/trace", HTTP_GET, [this]() {
+    WebServer &srv = *asServer(server_);
+    if (AdcTrace::active()) {
+      srv.send(409, "text/plain", "Trace recording; stop it with serial 'r' first");
+      return;
+    }
+    File f = LittleFS.open(ADC_TRACE_PATH, "r");
+    if (!f) {
+      srv.send(404, "text/plain", "No trace");
+      return;
+    }
+    srv.streamFile(f, "application/octet-stream");
+    f.close();
+  });
+
+  server.on("/history", HTTP_GET, [this]() {
+    WebServer &srv = *asServer(server_);
+    if (history_ == nullptr || !history_->ready()) {
+      srv.send(503, "text/plain", "No history");
+      return;
+    }
+    IdDirectory::Key key;
+    if (srv.hasArg("uid") && !IdDirectory::parseUidHex(srv.arg("uid").c_str(), key)) {
+      srv.send(400, "text/plain", "Bad uid");
+      return;
+    }
+    const int64_t since = srv.hasArg("since") ? strtoll(srv.arg("since").c_str(), nullptr, 10)
+                                              : WeighLog::kDefaultSinceS;
+    const long limit = srv.hasArg("limit") ? strtol(srv.arg("limit").c_str(), nullptr, 10) : WEIGHLOG_QUERY_LIMIT;
+    ChunkedResponse out(srv, "text/plain");
+    if (srv.hasArg("uid")) {
+      history_->printCard(out, srv.arg("uid").c_str(), since, (uint16_t)std::min(std::max(limit, 0L), 0xFFFFL));
+    } else {
+      history_->printTotals(out, since);
+    }
+  });
+
+  server.on("/params", HTTP_GET, [this]() {
+    WebServer &srv = *asServer(server_);
+    if (params_ == nullptr) {
+      srv.send(503, "text/plain", "No parameters");
+      return;
+    }
+    ChunkedResponse out(srv, "text/plain");
+    params_->printText(out);
+  });
+
+  server.on("/params", HTTP_POST, [this]() {
+    WebServer &srv = *asServer(server_);
+    if (params_ == nullptr) {
+      srv.send(503, "text/plain", "No parameters");
+      return;
+    }
+    // Anyone on the network could retune the weighing: serial 'u' only
+    // unless a password is configured, then HTTP Basic auth.
+    if (strlen(PARAMS_HTTP_PASSWORD) == 0) {
+      srv.send(403, "text/plain", "POST /params is off (PARAMS_HTTP_PASSWORD); use serial 'u'\n");
+      return;
+    }
+    if (!srv.authenticate(PARAMS_HTTP_USER, PARAMS_HTTP_PASSWORD)) {
+      srv.requestAuthentication();
+      return;
+    }
+    // Values first, so a typo rejects the request before anything changes.
+    TextBuffer msgs;
+    for (const StationParams::Def &d : StationParams::kDefs) {
+      float x;
+      if (!srv.hasArg(d.name) || srv.arg(d.name) == "default" || StationParams::parse(d, srv.arg(d.name).c_str(), x)) {
+        continue;
+      }
+      msgs.printf("params: %s: bad value '%s' (%g..%g %s)\n", d.name, srv.arg(d.name).c_str(), d.min, d.max, d.unit);
+      srv.send(400, "text/plain", msgs.c_str());
+      return;
+    }
+    // Profile or reset, then the values, taken as one change; save last.
+    char lines[1 + StationParams::kCount][64];
+    const char *batch[1 + StationParams::kCount];
+    uint8_t n = 0;
+    if (srv.hasArg("profile")) {
+      snprintf(lines[n], sizeof(lines[n]), "profile %s", srv.arg("profile").c_str());
+      n++;
+    } else if (srv.hasArg("reset")) {
+      snprintf(lines[n], sizeof(lines[n]), "reset");
+      n++;
+    }
+    for (const StationParams::Def &d : StationParams::kDefs) {
+      if (!srv.hasArg(d.name)) continue;
+      snprintf(lines[n], sizeof(lines[n]), "%s %s", d.name, srv.arg(d.name).c_str());
+      n++;
+    }
+    for (uint8_t i = 0; i < n; ++i) batch[i] = lines[i];
+    bool ok = n == 0 || params_->commands(batch, n, msgs);
+    if (ok && srv.hasArg("save")) {
+      char line[64];
+      snprintf(line, sizeof(line), "save %s", srv.arg("save").c_str());
+      ok = params_->command(line, msgs);
+    }
+    if (!ok) {
+      srv.send(400, "text/plain", msgs.c_str());
+      return;
+    }
+    ChunkedResponse out(srv, "text/plain");
+    out.print(msgs.c_str());
+    params_->printText(out);
+  });
+
+  server.onNotFound([this]() { asServer(server_)->send(404, "text/plain", "Not found"); });
+  server.begin();
+  return true;
+}
+
+void HttpApi::loop() {
+  if (server_ == nullptr) return;
+  asServer(server_)->handleClient();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+class WeighLog;
+class StationParams;
+
+// Small HTTP server for station diagnostics while connected in STA mode.
+//
+// Routes:
+//   GET /metrics  Prometheus text exposition (see metrics.h)
+//   GET /trace    last ADC trace capture (see adc_trace.h)
+//   GET /history  weigh-in history (see weigh_log.h): ?uid=<card>&since=<s>
+//                 &limit=<n> for one card, without uid totals per card;
+//                 since is Unix seconds or, <= 0, relative to now (-86400)
+//   GET /params   weighing parameters and where each value comes from
+//   POST /params  change them (see station_params.h): profile=<name> or
+//                 reset=1, then <name>=<value|default> per parameter, then
+//                 save=<name>; 400 and nothing applied on a bad value.
+//                 Basic auth as PARAMS_HTTP_USER/PASSWORD; 403 while the
+//                 password is empty (the default)
+//
+// Handlers run from loop() via loop(), between weighing iterations. Responses
+// are streamed in small chunks rather than built as one String.
+class HttpApi {
+ public:
+  bool begin(uint16_t port = 80);
+  void loop();
+  bool active() const { return server_ != nullptr; }
+  void setHistory(WeighLog *history) { history_ = history; }
+  void setParams(StationParams *params) { params_ = params; }
+
+ private:
+  // Lazy-created in .cpp (to avoid exposing WebServer header in other files).
+  void *server_ = nullptr;
+  WeighLog *history_ = nullptr;
+  StationParams *params_ = nullptr;
+};
@@ -0,0 +1,333 @@
+#include "id_directory.h"
+
+#include <LittleFS.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <algorithm>
+#include "event_log.h"
+#include "tls_session.h"
+
+namespace {
+constexpr uint32_t kMagic = 0x44494346;  // "FCID"
+constexpr const char *kTmpPath = ID_DIRECTORY_PATH ".tmp";
+constexpr const char *kStagePath = ID_DIRECTORY_PATH ".new";  // sync in progress
+constexpr uint32_t kLineTimeoutMs = 5000;
+
+// One block of records, shared by lookups (the loop is single-threaded).
+IdDirectory::Entry g_block[IdDirectory::kBlockRecords];
+
+int compareKeys(const IdDirectory::Key &a, const IdDirectory::Key &b) {
+  if (a.len != b.len) return a.len < b.len ? -1 : 1;
+  return memcmp(a.uid, b.uid, a.len);
+}
+
+int hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Reads one '\n'-terminated line (without CR/LF). Returns false on timeout or
+// EOF before the '\n': the body was cut off. Overlong lines are truncated.
+bool readLine(Stream &in, char *buf, size_t cap) {
+  size_t n = 0;
+  uint32_t startMs = millis();
+  while (true) {
+    if (!in.available()) {
+      if ((millis() - startMs) > kLineTimeoutMs) break;
+      delay(1);
+      continue;
+    }
+    const int c = in.read();
+    if (c < 0) break;
+    startMs = millis();
+    if (c == '\n') {
+      buf[n] = '\0';
+      return true;
+    }
+    if (c != '\r' && n + 1 < cap) buf[n++] = (char)c;
+  }
+  buf[n] = '\0';
+  return false;
+}
+} // namespace
+
+bool IdDirectory::parseUidHex(const char *hex, Key &out) {
+  memset(&out, 0, sizeof(out));
+  size_t len = 0;
+  while (hex[len] != '\0' && hex[len] != ' ') len++;
+  if (len == 0 || (len % 2) != 0 || len / 2 > kMaxUidLen) return false;
+  for (size_t i = 0; i < len / 2; ++i) {
+    const int hi = hexNibble(hex[2 * i]);
+    const int lo = hexNibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out.uid[i] = (uint8_t)((hi << 4) | lo);
+  }
+  out.len = (uint8_t)(len / 2);
+  return true;
+}
+
+bool IdDirectory::begin() {
+  if (!LittleFS.begin(true)) {
+    ready_ = false;
+    return false;
+  }
+  // Left by a sync that did not complete; the table is the last complete one.
+  if (LittleFS.exists(kStagePath)) LittleFS.remove(kStagePath);
+  ready_ = loadIndex_();
+  return ready_;
+}
+
+bool IdDirectory::loadIndex_() {
+  count_ = 0;
+  version_ = 0;
+  fenceCount_ = 0;
+  delete[] fences_;
+  fences_ = nullptr;
+  table_.close();
+
+  // A missing file is an empty directory, not an error.
+  if (!LittleFS.exists(ID_DIRECTORY_PATH)) return true;
+
+  File f = LittleFS.open(ID_DIRECTORY_PATH, "r");
+  if (!f) return false;
+
+  Header h;
+  if (f.read(reinterpret_cast<uint8_t *>(&h), sizeof(h)) != sizeof(h) ||
+      h.magic != kMagic || h.recordSize != sizeof(Entry) ||
+      f.size() < sizeof(h) + (size_t)h.count * sizeof(Entry)) {
+    f.close();
+    return false;
+  }
+
+  const uint32_t blocks = (h.count + kBlockRecords - 1) / kBlockRecords;
+  if (blocks > 0) {
+    fences_ = new Key[blocks];
+    for (uint32_t b = 0; b < blocks; ++b) {
+      f.seek(sizeof(Header) + (size_t)b * kBlockRecords * sizeof(Entry));
+      if (f.read(reinterpret_cast<uint8_t *>(&fences_[b]), sizeof(Key)) != sizeof(Key)) {
+        f.close();
+        delete[] fences_;
+        fences_ = nullptr;
+        return false;
+      }
+    }
+  }
+  // Opening a file allocates its stream buffer; lookups reuse this one.
+  table_ = f;
+
+  fenceCount_ = blocks;
+  count_ = h.count;
+  version_ = h.version;
+  return true;
+}
+
+IdDirectory::Status IdDirectory::lookup(const char *uidHex, Entry *out) {
+  if (!ready_) return Status::Unavailable;
+  Key key;
+  if (!parseUidHex(uidHex, key)) return Status::Unknown;
+  if (fenceCount_ == 0) return Status::Unknown;
+
+  // Last block whose first key is <= key.
+  uint32_t lo = 0, hi = fenceCount_;
+  while (lo < hi) {
+    const uint32_t mid = (lo + hi) / 2;
+    if (compareKeys(fences_[mid], key) <= 0) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == 0) return Status::Unknown;
+  const uint32_t block = lo - 1;
+
+  const uint32_t first = block * kBlockRecords;
+  const uint32_t n = std::min<uint32_t>(kBlockRecords, count_ - first);
+
+  if (!table_ || !table_.seek(sizeof(Header) + (size_t)first * sizeof(Entry))) return Status::Unavailable;
+  const size_t want = (size_t)n * sizeof(Entry);
+  if (table_.read(reinterpret_cast<uint8_t *>(g_block), want) != want) return Status::Unavailable;
+
+  uint32_t l = 0, h = n;
+  while (l < h) {
+    const uint32_t mid = (l + h) / 2;
+    const int c = compareKeys(g_block[mid].key, key);
+    if (c == 0) {
+      if (out) *out = g_block[mid];
+      return (g_block[mid].flags & kBlocked) ? Status::Blocked : Status::Known;
+    }
+    if (c < 0) l = mid + 1;
+    else h = mid;
+  }
+  return Status::Unknown;
+}
+
+bool IdDirectory::mergeChanges_(Change *changes, size_t n, const char *from, uint32_t &count, uint32_t version) {
+  // Sort the chunk; for repeated UIDs the last change in the stream wins.
+  std::stable_sort(changes, changes + n, [](const Change &a, const Change &b) {
+    return compareKeys(a.entry.key, b.entry.key) < 0;
+  });
+
+  File in;
+  uint32_t inCount = 0;
+  if (from != nullptr && count > 0) {
+    in = LittleFS.open(from, "r");
+    if (!in) return false;
+    in.seek(sizeof(Header));
+    inCount = count;
+  }
+
+  File out = LittleFS.open(kTmpPath, "w");
+  if (!out) {
+    if (in) in.close();
+    return false;
+  }
+
+  Header h = {kMagic, (uint16_t)sizeof(Entry), 0, 0, version};
+  out.write(reinterpret_cast<const uint8_t *>(&h), sizeof(h));
+
+  Entry cur;
+  bool haveCur = false;
+  uint32_t readCount = 0;
+  size_t ci = 0;
+  bool ok = true;
+
+  auto nextOld = [&]() {
+    haveCur = false;
+    if (readCount >= inCount) return;
+    if (in.read(reinterpret_cast<uint8_t *>(&cur), sizeof(cur)) != sizeof(cur)) {
+      ok = false;
+      return;
+    }
+    readCount++;
+    haveCur = true;
+  };
+  auto emit = [&](const Entry &e) {
+    if (out.write(reinterpret_cast<const uint8_t *>(&e), sizeof(e)) != sizeof(e)) ok = false;
+    h.count++;
+  };
+
+  nextOld();
+  while (ok && (haveCur || ci < n)) {
+    if (ci < n) {
+      // Collapse repeated UIDs in the chunk to the last one.
+      while (ci + 1 < n && compareKeys(changes[ci].entry.key, changes[ci + 1].entry.key) == 0) ci++;
+    }
+    const int c = !haveCur ? 1 : (ci >= n ? -1 : compareKeys(cur.key, changes[ci].entry.key));
+    if (c < 0) {
+      emit(cur);
+      nextOld();
+    } else {
+      if (!changes[ci].remove) emit(changes[ci].entry);
+      if (c == 0) nextOld();
+      ci++;
+    }
+  }
+
+  if (in) in.close();
+  if (ok) {
+    out.seek(0);
+    ok = out.write(reinterpret_cast<const uint8_t *>(&h), sizeof(h)) == sizeof(h);
+  }
+  out.close();
+
+  if (!ok) {
+    LittleFS.remove(kTmpPath);
+    return false;
+  }
+  // LittleFS replaces the staged file atomically.
+  if (!LittleFS.rename(kTmpPath, kStagePath)) return false;
+  count = h.count;
+  return true;
+}
+
+bool IdDirectory::sync() {
+  // A held upload connection (Uploader::prewarm()) is for the upload host.
+  if (!ready_ || TlsSession::open()) return false;
+
+  char url[160];
+  snprintf(url, sizeof(url), "%s?since=%lu", ID_DIRECTORY_SYNC_URL, (unsigned long)version_);
+
+  TlsSession::Lease tls;
+  HTTPClient http;
+  http.useHTTP10(true);  // plain body, no chunked encoding to undo
+  if (!http.begin(tls.client(), url)) return false;
+  http.setTimeout(6000);
+
+  const int httpCode = http.GET();
+  tls.sampleConnected();
+  if (httpCode != 200) {
+    LOG_EVENT(DirSyncHttp, (uint32_t)httpCode);
+    http.end();
+    return false;
+  }
+
+  Stream &body = *http.getStreamPtr();
+  char line[64];
+
+  // Header: "v <version>" or "v <version> full" (full snapshot replaces the table).
+  if (!readLine(body, line, sizeof(line)) || line[0] != 'v') {
+    http.end();
+    return false;
+  }
+  const uint32_t newVersion = strtoul(line + 1, nullptr, 10);
+  const bool replaceAll = strstr(line, "full") != nullptr;
+  if (newVersion == version_ && !replaceAll) {
+    http.end();
+    return true;
+  }
+
+  // Chunks are merged into kStagePath, starting from the live table (or from
+  // nothing for a snapshot). The live table and version_ only change once
+  // the end line has arrived with the right count, so a cut-off sync leaves
+  // them as they were and the same delta is fetched again next time.
+  Change *changes = new Change[kMergeChunk];
+  const char *from = replaceAll ? nullptr : ID_DIRECTORY_PATH;
+  uint32_t staged = replaceAll ? 0 : count_;
+  uint32_t received = 0;
+  size_t n = 0;
+  bool ok = true;
+  bool complete = false;
+
+  // Body lines: "+<UID> <flags> <name>" or "-<UID>", then ". <count>".
+  while (ok && readLine(body, line, sizeof(line))) {
+    if (line[0] == '.') {
+      complete = strtoul(line + 1, nullptr, 10) == received;
+      break;
+    }
+    if (line[0] != '+' && line[0] != '-') continue;
+    received++;
+    Change &ch = changes[n];
+    memset(&ch, 0, sizeof(ch));
+    if (!parseUidHex(line + 1, ch.entry.key)) continue;
+    ch.remove = (line[0] == '-');
+    if (!ch.remove) {
+      const char *p = strchr(line + 1, ' ');
+      if (p) {
+        char *end = nullptr;
+        ch.entry.flags = (uint8_t)strtoul(p + 1, &end, 16);
+        if (end && *end == ' ') strncpy(ch.entry.name, end + 1, kNameLen - 1);
+      }
+    }
+    if (++n == kMergeChunk) {
+      ok = mergeChanges_(changes, n, from, staged, version_);
+      from = kStagePath;
+      n = 0;
+    }
+  }
+  http.end();
+  ok = ok && complete && mergeChanges_(changes, n, from, staged, newVersion);
+  delete[] changes;
+  if (ok) {
+    table_.close();  // not renamed over while open
+    ok = LittleFS.rename(kStagePath, ID_DIRECTORY_PATH);
+    // The new table, or the old one again if the rename failed.
+    ready_ = loadIndex_();
+    ok = ok && ready_;
+  }
+  if (!ok) {
+    if (LittleFS.exists(kStagePath)) LittleFS.remove(kStagePath);
+    if (!complete) LOG_EVENT(DirSyncCut, received);
+  }
+
+  LOG_EVENT(DirSync, ok ? 1u : 0u, count_, version_);
+  return ok;
+}
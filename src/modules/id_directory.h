@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+
+// Local directory of known RFID cards (UID -> display name + flags).
+//
+// Stored on LittleFS as one file of fixed-size records sorted by UID. A sparse
+// in-RAM fence index (first key of every block of kBlockRecords records) turns
+// a lookup into a binary search in RAM plus a single block read from flash:
+//   RAM   : 12 bytes per block, ~6 KB for 32k cards (+ one 2 KB block buffer)
+//   Flash : 32 bytes per card, ~1 MB for 32k cards
+//
+// The server sends deltas since the version we hold; they are merged into a
+// staged copy in bounded chunks, so sync RAM does not grow with the delta
+// size, and replace the table only when the whole delta has arrived.
+class IdDirectory {
+ public:
+  static constexpr uint8_t kMaxUidLen = 10;
+  static constexpr uint8_t kNameLen = 20;  // including terminating NUL
+  static constexpr uint16_t kBlockRecords = 64;
+  static constexpr uint16_t kMergeChunk = 256;
+
+  enum Flags : uint8_t { kBlocked = 0x01 };
+
+  enum class Status : uint8_t { Unavailable, Unknown, Known, Blocked };
+
+  struct Key {
+    uint8_t len;
+    uint8_t uid[kMaxUidLen];
+  };
+
+  struct Entry {
+    Key key;
+    uint8_t flags;
+    char name[kNameLen];
+  };
+
+  bool begin();
+
+  // uidHex is the hex string produced by RFID2 (two upper-case digits per byte).
+  // Reads through the table file held open since begin()/sync(): no heap
+  // use, so the weighing loop can call it.
+  Status lookup(const char *uidHex, Entry *out = nullptr);
+
+  // Fetches and applies the delta since version() from ID_DIRECTORY_SYNC_URL.
+  // Call only when Wi-Fi is up and the scale is idle (it blocks on HTTP).
+  bool sync();
+
+  bool ready() const { return ready_; }
+  uint32_t size() const { return count_; }
+  uint32_t version() const { return version_; }
+
+  static bool parseUidHex(const char *hex, Key &out);
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t reserved;
+    uint32_t count;
+    uint32_t version;
+  };
+
+  struct Change {
+    Entry entry;
+    bool remove;
+  };
+
+  bool loadIndex_();
+  // Merges a chunk into the count records of from (none if null) and stages
+  // the result, with version in its header, as the next from.
+  bool mergeChanges_(Change *changes, size_t n, const char *from, uint32_t &count, uint32_t version);
+
+  bool ready_ = false;
+  uint32_t count_ = 0;
+  uint32_t version_ = 0;
+
+  Key *fences_ = nullptr;
+  uint32_t fenceCount_ = 0;
+  File table_;  // ID_DIRECTORY_PATH, open while it has records
+};
@@ -1,6 +1,7 @@
 #include "lcd_display.h"
 #include <Wire.h>
 #include "config.h"
+#include "metrics.h"
 
 static bool probeI2CAddress(TwoWire &wire, uint8_t address) {
   wire.beginTransmission(address);
@@ -47,24 +48,31 @@ bool LCDDisplay::begin(TwoWire &wire, uint8_t &detectedAddress) {
   return initialized_;
 }
 
-void LCDDisplay::clearRow(uint8_t row) {
+void LCDDisplay::printLine(uint8_t row, const char *text) {
   if (!initialized_) return;
   if (row >= LCD_ROWS) return;
-  lcd_->setCursor(0, row);
-  for (int i = 0; i < LCD_COLS; i++) lcd_->print(" ");
-}
+  if (text == nullptr) text = "";
+  Metrics::ScopedTimer timer(Metrics::LcdWrite);
+
+  // Pad to the full row width so one write both sets and clears the row.
+  char t[LCD_COLS + 1];
+  size_t n = strnlen(text, LCD_COLS);
+  memcpy(t, text, n);
+  memset(t + n, ' ', LCD_COLS - n);
+  t[LCD_COLS] = '\0';
 
-void LCDDisplay::printLine(uint8_t row, const String &text) {
-  if (!initialized_) return;
-  if (row >= LCD_ROWS) return;
-  String t = text;
-  if ((int)t.length() > LCD_COLS) {
-    t = t.substring(0, LCD_COLS);
-  }
   // Skip I2C update if content for this row is unchanged.
-  if (t == lastLines_[row]) return;
-  lastLines_[row] = t;
-  clearRow(row);
+  if (memcmp(t, lastLines_[row], LCD_COLS) == 0) return;
+  memcpy(lastLines_[row], t, sizeof(t));
   lcd_->setCursor(0, row);
   lcd_->print(t);
 }
+
+void LCDDisplay::printAt(uint8_t col, uint8_t row, char c) {
+  if (!initialized_ || row >= LCD_ROWS || col >= LCD_COLS) return;
+  Metrics::ScopedTimer timer(Metrics::LcdWrite);
+  if (lastLines_[row][col] == c) return;
+  lastLines_[row][col] = c;
+  lcd_->setCursor(col, row);
+  lcd_->write((uint8_t)c);
+}
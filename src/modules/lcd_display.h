@@ -8,7 +8,13 @@ class LCDDisplay {
  public:
   LCDDisplay();
   bool begin(TwoWire &wire, uint8_t &detectedAddress);
-  void printLine(uint8_t row, const String &text);
+  // Writes text (truncated/padded to LCD_COLS) to a row. Allocation-free.
+  void printLine(uint8_t row, const char *text);
+  void printLine(uint8_t row, const String &text) { printLine(row, text.c_str()); }
+  // One character cell (self benchmark); keeps the row cache in step.
+  void printAt(uint8_t col, uint8_t row, char c);
+  // What the row shows now, padded to LCD_COLS.
+  const char *line(uint8_t row) const { return row < LCD_ROWS ? lastLines_[row] : ""; }
   bool ok() const { return initialized_; }
   uint8_t address() const { return address_; }
 
@@ -18,7 +24,5 @@ class LCDDisplay {
   LiquidCrystal_PCF8574 *lcd_ = nullptr;
 
   // Simple per-row cache to avoid re-writing identical content over I2C.
-  String lastLines_[LCD_ROWS];
-
-  void clearRow(uint8_t row);
+  char lastLines_[LCD_ROWS][LCD_COLS + 1] = {};
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+// Log event catalogue: X(name, level, format).
+//
+// Records carry only the event id and up to three 32-bit arguments; the format
+// strings stay here and are applied by tools/log_decode.py (or by the drain
+// task when FISHCORE_LOG_TEXT is set). Append new events at the end so ids of
+// existing ones stay stable for older decoders.
+//
+// Format conversions: %d %u %x %X (optionally zero-padded width, e.g. %08X),
+// %k = centi-kilograms as kg with 2 decimals, %I = IPv4 address, %% = '%'.
+#define FISHCORE_LOG_EVENTS(X)                                                     \
+  X(Boot,              INFO,  "boot")                                              \
+  X(LcdFail,           ERROR, "LCD FAIL")                                          \
+  X(ZeroFailed,        WARN,  "Zeroing did not reach threshold")                   \
+  X(UploadStart,       INFO,  "Uploading uid=%08X%08X kg=%k")                      \
+  X(UploadNoWifi,      WARN,  "WiFi not connected; upload skipped")                \
+  X(UploadBeginFailed, ERROR, "HTTP begin failed")                                 \
+  X(UploadHttpStatus,  INFO,  "HTTP %d (%u ms)")                                   \
+  X(UploadGetFailed,   ERROR, "HTTP GET failed: %d")                               \
+  X(UploadBody,        DEBUG, "HTTP error body %u bytes")                          \
+  X(WifiNoSaved,       INFO,  "No saved WiFi credentials in NVS")                  \
+  X(WifiConnecting,    INFO,  "Connecting WiFi (%u: 0=saved 1=fallback 2=reconnect 3=portal)") \
+  X(WifiConnected,     INFO,  "WiFi connected. IP: %I (%u ms)")                    \
+  X(WifiFailed,        WARN,  "WiFi connect failed; starting AP config portal")    \
+  X(PortalStarted,     INFO,  "WiFi config portal started, AP IP: %I")             \
+  X(DirSync,           INFO,  "Directory sync ok=%u cards=%u version=%u")          \
+  X(DirSyncHttp,       WARN,  "Directory sync HTTP %d")                            \
+  X(LogDropped,        WARN,  "log ring overflow, %u records dropped")          \
+  X(LogBench,          DEBUG, "log cost probe %u")                              \
+  X(UploadConnectFailed, ERROR, "TLS connect to upload host failed")              \
+  X(TraceStarted,      INFO,  "ADC trace started")                                 \
+  X(TraceStopped,      INFO,  "ADC trace stopped, %u bytes")                      \
+  X(DozeEnter,         DEBUG, "idle: dozing")                                      \
+  X(DozeExit,          DEBUG, "idle: awake after %u ms, %u sleeps")                \
+  X(UploadRetry,       WARN,  "upload retry %u in %u ms")                         \
+  X(UploadDnsResolved, DEBUG, "upload host %I resolved in %u ms")                   \
+  X(UploadDnsFailed,   WARN,  "upload host lookup failed")                         \
+  X(UploadPrewarm,     DEBUG, "upload connection pre-warmed in %u ms")             \
+  X(UploadPrewarmExpired, DEBUG, "pre-warmed connection unused for %u ms, closed") \
+  X(UploadPrewarmStale, WARN, "pre-warmed connection stale; reconnecting")         \
+  X(VibPeak,           INFO,  "vibration at %u cHz, %u g")                         \
+  X(VibFilterSet,      INFO,  "vibration filter: %u stages")                       \
+  X(SelfBench,         INFO,  "self benchmark ran for %u ms")                      \
+  X(TempZero,          INFO,  "zero point at %d cC: raw %d dg, compensated %d dg") \
+  X(TempSpan,          INFO,  "span point at %d cC: gain %d ppm")                  \
+  X(PortalClosed,      INFO,  "WiFi config portal closed, station IP: %I")         \
+  X(PortalJoinFailed,  WARN,  "portal WiFi join failed after %u ms")               \
+  X(UploadQueued,      INFO,  "weigh-in queued offline (%u waiting)")              \
+  X(UploadQueueSent,   INFO,  "queued weigh-in sent after %u ms (%u waiting)")     \
+  X(UploadQueueDropped, WARN, "queued weigh-in dropped (%u: 0=full 1=rejected 2=maybe sent)") \
+  X(HistoryOpened,     INFO,  "weigh-in history: %u records, %u cards")            \
+  X(HistoryRepaired,   WARN,  "weigh-in history: torn record %u replaced")         \
+  X(HistoryDropped,    INFO,  "weigh-in history: oldest segment dropped, %u kept") \
+  X(HistoryAppendFailed, ERROR, "weigh-in history append failed (%u: 0=fs 1=cards full)") \
+  X(ParamsChanged,     INFO,  "weighing parameters: generation %u, %u station overrides") \
+  X(DirSyncCut,        WARN,  "directory sync cut off after %u changes, table kept") \
+  X(PowerNoLightSleep, WARN,  "automatic light sleep unavailable (esp_pm_configure %d), modem sleep only") \
+  X(UploadUid,         INFO,  "upload uid is %u bytes, bytes 9-10 %04X")
@@ -0,0 +1,201 @@
+#include "metrics.h"
+#include <Preferences.h>
+#include "config.h"
+
+namespace Metrics {
+namespace {
+
+constexpr const char *kTimerNames[kTimerCount] = {
+    "adc_read",     "lcd_write", "rfid_poll",      "wifi_reconnect", "tls_connect", "http_request",
+    "upload",       "loop_body", "wake_to_sample", "doze_exit",  "loop_portal",
+};
+
+constexpr const char *kOutcomeNames[kOutcomeCount] = {"uploaded", "queued", "failed"};
+
+constexpr const char *kNamespace = "metrics";
+constexpr const char *kStationKey = "station";
+
+Histogram g_hist[kTimerCount];
+char g_station[kStationLen] = "";
+
+const char *const *g_stateNames = nullptr;
+uint8_t g_stateCount = 0;
+uint8_t g_state = 0;
+unsigned long g_stateSinceMs = 0;
+uint64_t g_stateMs[kMaxStates] = {};
+uint32_t g_stateEntries[kMaxStates] = {};
+
+// Weigh-ins per minute for the last hour (ring indexed by minute of uptime).
+uint16_t g_perMinute[60] = {};
+uint32_t g_lastMinute = 0;
+uint32_t g_weighIns = 0;
+uint32_t g_outcomes[kOutcomeCount] = {};
+
+// Smallest b with us <= 2^b, so the bucket's le is its true upper bound.
+uint8_t bucketFor(uint32_t us) {
+  if (us <= 1) return 0;
+  const uint8_t b = 32 - __builtin_clz(us - 1);
+  return b < kBuckets - 1 ? b : kBuckets - 1;
+}
+
+bool validStation(const char *label) {
+  const size_t n = strlen(label);
+  if (n >= kStationLen) return false;
+  for (size_t i = 0; i < n; ++i) {
+    const char c = label[i];
+    if (!isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.') return false;
+  }
+  return true;
+}
+
+// NVS label, else the factory MAC (readable before Wi-Fi starts).
+void loadStation() {
+  Preferences prefs;
+  size_t n = 0;
+  if (prefs.begin(kNamespace, true)) {
+    n = prefs.isKey(kStationKey) ? prefs.getString(kStationKey, g_station, sizeof(g_station)) : 0;
+    prefs.end();
+  }
+  if (n > 0 && validStation(g_station)) return;
+  const uint64_t mac = ESP.getEfuseMac();
+  snprintf(g_station, sizeof(g_station), "%02x%02x%02x%02x%02x%02x", (unsigned)(mac & 0xFF),
+           (unsigned)((mac >> 8) & 0xFF), (unsigned)((mac >> 16) & 0xFF), (unsigned)((mac >> 24) & 0xFF),
+           (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+}
+
+void rollMinutes() {
+  const uint32_t minute = millis() / 60000UL;
+  if (minute - g_lastMinute >= 60) {
+    memset(g_perMinute, 0, sizeof(g_perMinute));
+  } else {
+    for (uint32_t m = g_lastMinute + 1; m <= minute; ++m) g_perMinute[m % 60] = 0;
+  }
+  g_lastMinute = minute;
+}
+
+uint32_t weighInsLastHour() {
+  rollMinutes();
+  uint32_t n = 0;
+  for (uint16_t c : g_perMinute) n += c;
+  return n;
+}
+
+uint64_t stateMs(uint8_t s) {
+  uint64_t ms = g_stateMs[s];
+  if (s == g_state) ms += millis() - g_stateSinceMs;
+  return ms;
+}
+
+} // namespace
+
+void begin(const char *const *stateNames, uint8_t stateCount) {
+  loadStation();
+  g_stateNames = stateNames;
+  g_stateCount = stateCount < kMaxStates ? stateCount : kMaxStates;
+  g_stateSinceMs = millis();
+  g_lastMinute = millis() / 60000UL;
+}
+
+const char *station() { return g_station; }
+
+bool setStation(const char *label) {
+  if (!validStation(label)) return false;
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) return false;
+  const bool ok = label[0] == '\0' ? (!prefs.isKey(kStationKey) || prefs.remove(kStationKey))
+                                   : prefs.putString(kStationKey, label) == strlen(label);
+  prefs.end();
+  if (ok) loadStation();
+  return ok;
+}
+
+void recordUs(Timer t, uint32_t us) {
+  Histogram &h = g_hist[t];
+  h.buckets[bucketFor(us)]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+void enterState(uint8_t state) {
+  if (state == g_state || state >= kMaxStates) return;
+  const unsigned long now = millis();
+  g_stateMs[g_state] += now - g_stateSinceMs;
+  g_stateSinceMs = now;
+  g_state = state;
+  g_stateEntries[state]++;
+}
+
+void noteWeighIn(Outcome o) {
+  rollMinutes();
+  g_perMinute[g_lastMinute % 60]++;
+  g_weighIns++;
+  if (o < kOutcomeCount) g_outcomes[o]++;
+}
+
+const Histogram &histogram(Timer t) { return g_hist[t]; }
+uint32_t weighIns(Outcome o) { return o < kOutcomeCount ? g_outcomes[o] : 0; }
+
+void printText(Print &out) {
+  out.printf("metrics: op count mean_us max_us\n");
+  for (uint8_t t = 0; t < kTimerCount; ++t) {
+    const Histogram &h = g_hist[t];
+    out.printf("metrics: %-14s %8lu %8lu %8lu\n", kTimerNames[t], (unsigned long)h.count,
+               (unsigned long)(h.count ? h.sumUs / h.count : 0), (unsigned long)h.maxUs);
+  }
+  const Histogram &portal = g_hist[LoopPortal];
+  if (portal.count > 0) {
+    out.printf("metrics: loop during config portal max %lu ms, budget %lu ms: %s\n",
+               (unsigned long)(portal.maxUs / 1000), (unsigned long)LOOP_BUDGET_MS,
+               portal.maxUs <= LOOP_BUDGET_MS * 1000UL ? "ok" : "OVER");
+  }
+  for (uint8_t s = 0; s < g_stateCount; ++s) {
+    out.printf("metrics: state %-12s %8lu entries %10lu ms\n", g_stateNames[s], (unsigned long)g_stateEntries[s],
+               (unsigned long)stateMs(s));
+  }
+  out.printf("metrics: weigh_ins %lu (uploaded %lu, queued %lu, failed %lu), last hour %lu\n",
+             (unsigned long)g_weighIns, (unsigned long)g_outcomes[Uploaded], (unsigned long)g_outcomes[Queued],
+             (unsigned long)g_outcomes[UploadFailed], (unsigned long)weighInsLastHour());
+}
+
+void printPrometheus(Print &out) {
+  out.printf("# TYPE fishcore_op_duration_seconds histogram\n");
+  for (uint8_t t = 0; t < kTimerCount; ++t) {
+    const Histogram &h = g_hist[t];
+    uint32_t cumulative = 0;
+    for (uint8_t b = 0; b < kBuckets - 1; ++b) {
+      cumulative += h.buckets[b];
+      out.printf("fishcore_op_duration_seconds_bucket{station=\"%s\",op=\"%s\",le=\"%.6f\"} %lu\n", g_station,
+                 kTimerNames[t], (double)(1UL << b) / 1e6, (unsigned long)cumulative);
+    }
+    out.printf("fishcore_op_duration_seconds_bucket{station=\"%s\",op=\"%s\",le=\"+Inf\"} %lu\n", g_station,
+               kTimerNames[t], (unsigned long)h.count);
+    out.printf("fishcore_op_duration_seconds_sum{station=\"%s\",op=\"%s\"} %.6f\n", g_station, kTimerNames[t],
+               (double)h.sumUs / 1e6);
+    out.printf("fishcore_op_duration_seconds_count{station=\"%s\",op=\"%s\"} %lu\n", g_station, kTimerNames[t],
+               (unsigned long)h.count);
+  }
+
+  out.printf("# TYPE fishcore_state_seconds_total counter\n");
+  for (uint8_t s = 0; s < g_stateCount; ++s) {
+    out.printf("fishcore_state_seconds_total{station=\"%s\",state=\"%s\"} %.3f\n", g_station, g_stateNames[s],
+               (double)stateMs(s) / 1000.0);
+  }
+  out.printf("# TYPE fishcore_state_entries_total counter\n");
+  for (uint8_t s = 0; s < g_stateCount; ++s) {
+    out.printf("fishcore_state_entries_total{station=\"%s\",state=\"%s\"} %lu\n", g_station, g_stateNames[s],
+               (unsigned long)g_stateEntries[s]);
+  }
+
+  out.printf("# TYPE fishcore_weigh_ins_total counter\n");
+  for (uint8_t o = 0; o < kOutcomeCount; ++o) {
+    out.printf("fishcore_weigh_ins_total{station=\"%s\",upload=\"%s\"} %lu\n", g_station, kOutcomeNames[o],
+               (unsigned long)g_outcomes[o]);
+  }
+  out.printf("# TYPE fishcore_weigh_ins_last_hour gauge\n");
+  out.printf("fishcore_weigh_ins_last_hour{station=\"%s\"} %lu\n", g_station, (unsigned long)weighInsLastHour());
+  out.printf("# TYPE fishcore_uptime_seconds gauge\n");
+  out.printf("fishcore_uptime_seconds{station=\"%s\"} %lu\n", g_station, (unsigned long)(millis() / 1000));
+}
+
+} // namespace Metrics
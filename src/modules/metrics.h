@@ -0,0 +1,78 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Hot-path latency histograms and weigh-in counters.
+//
+// Timers read the 64-bit esp_timer at each end (the 32-bit cycle counter
+// wraps after 17.9 s at 240 MHz, shorter than a slow upload) and feed fixed
+// log2 histograms: bucket 0 holds durations up to 1 us, bucket i > 0 those in
+// (2^(i-1), 2^i] us, the last bucket everything above. No allocation, no
+// locks: everything is recorded and read from the loop task.
+//
+// Exposed as text on serial 'm' and as Prometheus text on GET /metrics,
+// labelled with the station name from NVS ("m station <name>") or, when
+// none is set, the factory MAC.
+namespace Metrics {
+
+enum Timer : uint8_t {
+  AdcRead,        // ScaleManager::getWeightKg
+  LcdWrite,       // LCDDisplay::printLine
+  RfidPoll,       // RFID2::poll
+  WifiReconnect,  // WiFiManager::ensureConnected
+  TlsConnect,     // TCP + TLS handshake to the upload host
+  HttpRequest,    // GET and response status
+  Upload,         // doSendData end to end
+  LoopBody,       // one loop() iteration without the pacing delay
+  WakeToSample,   // light-sleep wake to the conversion read (power.h)
+  DozeExit,       // first load conversion while dozing to Weighing
+  LoopPortal,     // LoopBody while the config portal is up (LOOP_BUDGET_MS)
+  kTimerCount
+};
+
+constexpr uint8_t kBuckets = 25;  // <= 1 us .. 8.4 s, then overflow
+constexpr uint8_t kMaxStates = 8;
+
+// What became of a committed weigh-in's upload.
+enum Outcome : uint8_t { Uploaded, Queued, UploadFailed, kOutcomeCount };
+constexpr size_t kStationLen = 24;
+
+struct Histogram {
+  uint32_t buckets[kBuckets];
+  uint32_t count;
+  uint64_t sumUs;
+  uint32_t maxUs;
+};
+
+void begin(const char *const *stateNames, uint8_t stateCount);
+
+// Label on every series, also used by Power.
+const char *station();
+// Saves the label to NVS and uses it from now on; "" goes back to the MAC.
+// Letters, digits, '-', '_' and '.', up to kStationLen - 1 characters.
+bool setStation(const char *label);
+
+void recordUs(Timer t, uint32_t us);
+
+// Called on every FSM transition; accumulates time spent in the old state.
+void enterState(uint8_t state);
+// Called once per committed (ID bound) weigh-in, after its upload.
+void noteWeighIn(Outcome o);
+
+const Histogram &histogram(Timer t);
+uint32_t weighIns(Outcome o);
+
+void printText(Print &out);
+void printPrometheus(Print &out);
+
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Timer t) : t_(t), start_(esp_timer_get_time()) {}
+  ~ScopedTimer() { recordUs(t_, (uint32_t)(esp_timer_get_time() - start_)); }
+
+ private:
+  Timer t_;
+  int64_t start_;
+};
+
+} // namespace Metrics
@@ -0,0 +1,225 @@
+#include "power.h"
+#include <WiFi.h>
+#include <driver/uart.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include "event_log.h"
+#include "metrics.h"
+
+namespace Power {
+namespace {
+
+constexpr const char *kModeNames[kModeCount] = {"active", "doze", "sleep"};
+constexpr const char *kWakeNames[kWakeCount] = {"adc", "rfid", "uart", "timer"};
+constexpr float kModeMa[kModeCount] = {POWER_MA_ACTIVE, POWER_MA_DOZE, POWER_MA_SLEEP};
+constexpr int kCpuMhz = 240;
+constexpr int kCpuIdleMhz = 40;  // XTAL: lowest clock Wi-Fi keeps working on
+
+bool g_dozing = false;
+bool g_autoSleep = false;  // esp_pm_configure accepted light_sleep_enable
+bool g_pmWarned = false;
+bool g_idle = false;
+unsigned long g_idleSinceMs = 0;
+unsigned long g_dozeSinceMs = 0;
+uint32_t g_dozeSleeps = 0;
+unsigned long g_nextRfidMs = 0;
+
+uint64_t g_modeUs[kModeCount] = {};
+unsigned long g_markUs = 0;
+uint32_t g_wakes[kWakeCount] = {};
+uint32_t g_dozes = 0;
+
+bool g_sampleDue = false;
+unsigned long g_wakeUs = 0;
+bool g_loadSeen = false;
+unsigned long g_loadUs = 0;
+
+// Charges the time since the previous call to mode m. Called at least once
+// per loop(), so the 32-bit micros() difference never wraps.
+void account(Mode m) {
+  const unsigned long now = micros();
+  g_modeUs[m] += now - g_markUs;
+  g_markUs = now;
+}
+
+// Automatic light sleep: the idle task stops the CPU whenever every task is
+// blocked and wakes it for the next tick deadline, keeping the Wi-Fi
+// association (the radio still wakes for DTIM beacons). Needs a core built
+// with CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE; without them
+// the station dozes on modem sleep alone.
+bool autoLightSleep(bool on) {
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = kCpuMhz;
+  pm.min_freq_mhz = on ? kCpuIdleMhz : kCpuMhz;
+  pm.light_sleep_enable = on;
+  const esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK && on && !g_pmWarned) {
+    g_pmWarned = true;
+    LOG_EVENT(PowerNoLightSleep, (uint32_t)err);
+  }
+  return err == ESP_OK && on;
+}
+
+} // namespace
+
+void begin() {
+  g_markUs = micros();
+  // Full power while weighing; applied when the STA interface starts.
+  WiFi.setSleep(WIFI_PS_NONE);
+#if POWER_IDLE_SLEEP
+#if SCALE_DRDY_ACTIVE_HIGH
+  pinMode(SCALE_DRDY_PIN, INPUT_PULLDOWN);
+#else
+  pinMode(SCALE_DRDY_PIN, INPUT_PULLUP);  // HX711/ADS1232 DOUT: low = ready
+#endif
+#if RFID_IRQ_PIN != 255
+  pinMode(RFID_IRQ_PIN, INPUT_PULLUP);
+#endif
+  // Light sleep stops the UART clock; RX edges wake the chip instead.
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+#endif
+}
+
+bool idleLongEnough(bool idle) {
+  account(Active);
+  if (!idle) {
+    g_idle = false;
+    return false;
+  }
+  if (!g_idle) {
+    g_idle = true;
+    g_idleSinceMs = millis();
+  }
+#if POWER_IDLE_SLEEP
+  return millis() - g_idleSinceMs >= POWER_IDLE_AFTER_MS;
+#else
+  return false;
+#endif
+}
+
+bool dozing() { return g_dozing; }
+
+void enterDoze() {
+  account(Active);
+  g_dozing = true;
+  g_idle = false;
+  g_dozes++;
+  g_dozeSinceMs = millis();
+  g_dozeSleeps = 0;
+  g_nextRfidMs = millis();
+  g_loadSeen = false;
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);  // wake for each DTIM beacon, stay associated
+  g_autoSleep = autoLightSleep(true);
+  LOG_EVENT(DozeEnter);
+}
+
+void leaveDoze() {
+  account(Doze);
+  g_dozing = false;
+  g_sampleDue = false;
+  if (g_autoSleep) autoLightSleep(false);
+  g_autoSleep = false;
+  WiFi.setSleep(WIFI_PS_NONE);
+  LOG_EVENT(DozeExit, (uint32_t)(millis() - g_dozeSinceMs), g_dozeSleeps);
+}
+
+Wake sleep(uint32_t conversionUs) {
+  account(Doze);
+  const long untilRfidMs = (long)(g_nextRfidMs - millis());
+  if (untilRfidMs <= 0) {
+    g_nextRfidMs = millis() + POWER_RFID_POLL_MS;
+    g_wakes[WakeRfid]++;
+    return WakeRfid;
+  }
+
+  // UART TX stops in light sleep; let pending output go first.
+  Serial.flush();
+  uint32_t waitUs = (uint32_t)untilRfidMs * 1000UL;
+  if (conversionUs < waitUs) waitUs = conversionUs;
+  // Blocked here, the chip light-sleeps until the tick deadline. DRDY is not
+  // a wake source: a level wake would keep firing until the conversion is
+  // read, and the wait is one conversion period anyway.
+  delay((waitUs + 999) / 1000);
+  account(g_autoSleep ? Sleep : Doze);
+  g_dozeSleeps++;
+  g_wakeUs = micros();
+
+  Wake w = WakeTimer;
+  if (digitalRead(SCALE_DRDY_PIN) == (SCALE_DRDY_ACTIVE_HIGH ? HIGH : LOW)) {
+    w = WakeAdc;
+#if RFID_IRQ_PIN != 255
+  } else if (digitalRead(RFID_IRQ_PIN) == LOW) {
+    w = WakeRfid;
+#endif
+  } else if (Serial.available() > 0) {
+    w = WakeUart;
+  }
+  if (w == WakeTimer && (long)(millis() - g_nextRfidMs) >= 0) w = WakeRfid;
+  if (w == WakeRfid) g_nextRfidMs = millis() + POWER_RFID_POLL_MS;
+  g_sampleDue = (w == WakeAdc);
+  g_wakes[w]++;
+  return w;
+}
+
+void noteSample() {
+  if (!g_sampleDue) return;
+  g_sampleDue = false;
+  Metrics::recordUs(Metrics::WakeToSample, micros() - g_wakeUs);
+}
+
+void noteLoad() {
+  if (g_loadSeen) return;
+  g_loadSeen = true;
+  g_loadUs = micros();
+}
+
+void noteWeighing() {
+  if (!g_loadSeen) return;
+  g_loadSeen = false;
+  Metrics::recordUs(Metrics::DozeExit, micros() - g_loadUs);
+}
+
+float averageMilliamps() {
+  uint64_t totalUs = 0;
+  double charge = 0.0;
+  for (uint8_t m = 0; m < kModeCount; ++m) {
+    totalUs += g_modeUs[m];
+    charge += (double)g_modeUs[m] * kModeMa[m];
+  }
+  return totalUs ? (float)(charge / (double)totalUs) : kModeMa[Active];
+}
+
+void printText(Print &out) {
+  uint64_t totalUs = 0;
+  for (uint64_t us : g_modeUs) totalUs += us;
+  out.printf("power: light sleep %s; currents are POWER_MA_* estimates, not measured\n",
+             g_autoSleep || !g_pmWarned ? "automatic" : "unavailable (modem sleep only)");
+  out.printf("power: mode        seconds  share  est_mA\n");
+  for (uint8_t m = 0; m < kModeCount; ++m) {
+    out.printf("power: %-8s %10.1f %5.1f%% %7.1f\n", kModeNames[m], (double)g_modeUs[m] / 1e6,
+               totalUs ? 100.0 * (double)g_modeUs[m] / (double)totalUs : 0.0, (double)kModeMa[m]);
+  }
+  out.printf("power: average %.1f mA (always active %.1f mA), dozes %lu\n", (double)averageMilliamps(),
+             (double)kModeMa[Active], (unsigned long)g_dozes);
+  out.printf("power: wakes");
+  for (uint8_t w = 0; w < kWakeCount; ++w) out.printf(" %s %lu", kWakeNames[w], (unsigned long)g_wakes[w]);
+  out.printf("\n");
+}
+
+void printPrometheus(Print &out) {
+  out.printf("# TYPE fishcore_power_mode_seconds_total counter\n");
+  for (uint8_t m = 0; m < kModeCount; ++m) {
+    out.printf("fishcore_power_mode_seconds_total{station=\"%s\",mode=\"%s\"} %.3f\n", Metrics::station(), kModeNames[m],
+               (double)g_modeUs[m] / 1e6);
+  }
+  out.printf("# TYPE fishcore_power_estimated_milliamps gauge\n");
+  out.printf("fishcore_power_estimated_milliamps{station=\"%s\"} %.1f\n", Metrics::station(), (double)averageMilliamps());
+  out.printf("# TYPE fishcore_power_wakes_total counter\n");
+  for (uint8_t w = 0; w < kWakeCount; ++w) {
+    out.printf("fishcore_power_wakes_total{station=\"%s\",cause=\"%s\"} %lu\n", Metrics::station(), kWakeNames[w],
+               (unsigned long)g_wakes[w]);
+  }
+}
+
+} // namespace Power
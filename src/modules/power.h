@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Idle power mode for battery/solar stations.
+//
+// While the scale is empty and nothing is pending, loop() waits out each ADC
+// conversion blocked in delay() with automatic light sleep on
+// (esp_pm_configure light_sleep_enable): the idle task stops the CPU and
+// the Wi-Fi association survives, the radio waking for DTIM beacons (modem
+// sleep, WIFI_PS_MIN_MODEM). Each wait ends at the next conversion or reader
+// poll; DRDY, the RFID IRQ line if wired, and UART0 (the byte that wakes
+// the chip is lost, so type a serial command twice) are checked on return.
+// Wi-Fi runs without power save otherwise, so uploads do not wait for a
+// beacon.
+//
+// Time is split into three modes for the report: active (normal loop),
+// doze (CPU awake between waits) and sleep (blocked with light sleep on;
+// an upper bound, the chip also wakes for beacons). The current per mode is
+// the POWER_MA_* estimate in config.h, not a measurement.
+namespace Power {
+
+enum Mode : uint8_t { Active, Doze, Sleep, kModeCount };
+enum Wake : uint8_t { WakeAdc, WakeRfid, WakeUart, WakeTimer, kWakeCount };
+
+void begin();
+
+// Call once per active loop(); true once the station has been idle
+// (empty, no pending scan) for POWER_IDLE_AFTER_MS.
+bool idleLongEnough(bool idle);
+
+bool dozing();
+void enterDoze();
+void leaveDoze();
+
+// Blocks until the next conversion or reader poll, light-sleeping if the
+// core supports it, and reports what is waiting. conversionUs: ADC sample
+// period.
+Wake sleep(uint32_t conversionUs);
+
+// First conversion read after a WakeAdc wake.
+void noteSample();
+// A conversion above the detect threshold while dozing; the doze_exit
+// histogram runs from the first one to noteWeighing().
+void noteLoad();
+void noteWeighing();
+
+float averageMilliamps();
+void printText(Print &out);
+void printPrometheus(Print &out);
+
+} // namespace Power
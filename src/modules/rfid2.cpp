@@ -1,5 +1,6 @@
 #include "rfid2.h"
 #include <MFRC522_I2C.h>
+#include "metrics.h"
 
 // Single instance for the MFRC522 reader
 static MFRC522_I2C* mfrc522_ = nullptr;
@@ -33,52 +34,58 @@ bool RFID2::begin(TwoWire &wire, uint8_t addr) {
 bool RFID2::isConnected() const { return connected_; }
 
 // Poll for a tag. Returns true when a new/non-empty ID is read.
-bool RFID2::poll(String &id) {
+// readUid_() halts the card after reading it, and a halted card does not
+// answer the REQA, so a card left on the reader is read once. Lifted and
+// tapped again it is read again: within dupWindowMs_ of the last read that
+// is taken as the same presentation and dropped, after it the card counts
+// again.
+bool RFID2::poll(char *id) {
   if (!connected_ || wire_ == nullptr) return false;
-  String newId;
+  Metrics::ScopedTimer timer(Metrics::RfidPoll);
+  char newId[kIdLen];
   if (!readUid_(newId)) return false;
-  if (newId.length() == 0) return false;
-  if (newId != lastId_) {
-    lastId_ = newId;
-    id = lastId_;
+  if (newId[0] == '\0') return false;
+  const unsigned long now = millis();
+  const bool duplicate = (strcmp(newId, lastId_) == 0) && (now - lastReadMs_) < dupWindowMs_;
+  lastReadMs_ = now;
+  if (!duplicate) {
+    memcpy(lastId_, newId, kIdLen);
+    memcpy(id, lastId_, kIdLen);
     return true;
   }
-  id = lastId_;
+  memcpy(id, lastId_, kIdLen);
   return false;
 }
 
-const String &RFID2::lastId() const { return lastId_; }
+const char *RFID2::lastId() const { return lastId_; }
 
 bool RFID2::probe_(uint8_t a) {
   wire_->beginTransmission(a);
   return (wire_->endTransmission() == 0);
 }
 
-bool RFID2::readUid_(String &out) {
+bool RFID2::readUid_(char *out) {
+  out[0] = '\0';
   if (!connected_ || wire_ == nullptr || mfrc522_ == nullptr) {
-    out = "";
     return false;
   }
 
   // Use MFRC522_I2C API to detect and read a new card UID
   if (!mfrc522_->PICC_IsNewCardPresent()) {
-    out = "";
     return false;
   }
   if (!mfrc522_->PICC_ReadCardSerial()) {
-    out = "";
     return false;
   }
 
   // Build hex UID string
-  String hexStr;
-  hexStr.reserve(mfrc522_->uid.size * 2);
-  for (uint8_t k = 0; k < mfrc522_->uid.size; ++k) {
-    char buf[3];
-    snprintf(buf, sizeof(buf), "%02X", mfrc522_->uid.uidByte[k]);
-    hexStr += buf;
+  static const char kHex[] = "0123456789ABCDEF";
+  const uint8_t n = mfrc522_->uid.size < 10 ? mfrc522_->uid.size : 10;
+  for (uint8_t k = 0; k < n; ++k) {
+    out[2 * k] = kHex[mfrc522_->uid.uidByte[k] >> 4];
+    out[2 * k + 1] = kHex[mfrc522_->uid.uidByte[k] & 0x0F];
   }
-  out = hexStr;
+  out[2 * n] = '\0';
 
   // Halt the card and stop crypto to be ready for the next read
   mfrc522_->PICC_HaltA();
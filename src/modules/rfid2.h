@@ -8,12 +8,19 @@
 
 class RFID2 {
  public:
+  // Hex UID buffer size: up to 10 UID bytes, two digits each, plus NUL.
+  static constexpr size_t kIdLen = 21;
+
   RFID2();
 
   bool begin(TwoWire &wire, uint8_t addr = RFID2_ADDR_DEFAULT);
   bool isConnected() const;
-  bool poll(String &id);
-  const String &lastId() const;
+  // Returns true once per card presentation. The same UID is suppressed while
+  // it keeps being read within dupWindowMs of the previous read.
+  // id must hold kIdLen chars. Allocation-free.
+  bool poll(char *id);
+  const char *lastId() const;
+  void setDupWindowMs(uint32_t ms) { dupWindowMs_ = ms; }
 
   // New lightweight accessors
   inline bool ready() const { return connected_; }
@@ -23,8 +30,10 @@ class RFID2 {
   TwoWire *wire_ = nullptr;
   uint8_t addr_ = 0x00;
   bool connected_ = false;
-  String lastId_;
+  char lastId_[kIdLen] = {};
+  unsigned long lastReadMs_ = 0;
+  uint32_t dupWindowMs_ = RFID_DUP_WINDOW_MS;
 
   bool probe_(uint8_t a);
-  bool readUid_(String &out);
+  bool readUid_(char *out);
 };
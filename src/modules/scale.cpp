@@ -1,42 +1,21 @@
 #include "scale.h"
-#include <Wire.h>
 #include <math.h>
-#include <SparkFun_Qwiic_Scale_NAU7802_Arduino_Library.h>
 #include "config.h"
-
-static NAU7802 g_scale;
-static TwoWire g_scaleWire(1);
-
-bool ScaleManager::begin() {
-  // Start NAU7802 on its own I2C bus (GPIO16/17 from config.h)
-  g_scaleWire.begin(SCALE_SDA_PIN, SCALE_SCL_PIN);
-
-  if (!g_scale.begin(g_scaleWire)) {
-    initialized_ = false;
-    return false;
-  }
-
-  // Basic NAU config
-  g_scale.setGain(NAU7802_GAIN_128);
-  g_scale.setSampleRate(NAU7802_SPS_20);   // faster updates, still stable
-  g_scale.setChannel(NAU7802_CHANNEL_1);
-
-  // Calibrate analog front-end
-  if (!g_scale.calibrateAFE()) {
-    initialized_ = false;
-    return false;
-  }
-
-  // Let it settle and discard early conversions (shortened)
-  delay(400);
-  for (int i = 0; i < 6; i++) {
-    (void)g_scale.getReading();
-    delay(5);
-  }
+#include "metrics.h"
+#include "adc_trace.h"
+#include "event_log.h"
+#include "vib_analysis.h"
+
+template <typename Adc>
+bool BasicScale<Adc>::begin() {
+  initialized_ = false;
+  if (!adc_.begin()) return false;
+  activeHz_ = 1e6f / adc_.periodUs();
+  filter_.configure(VibAnalysis::retune(vibCfg_, activeHz_), activeHz_);
+  recal_ = false;  // calibrated at this rate
 
   // Set a calibration factor (grams scaling). We'll flip sign if needed.
   calFactor_ = SCALE_CAL_FACTOR_DEFAULT;
-  g_scale.setCalibrationFactor(calFactor_);
 
   // Shorter tare at boot
   tare(24);
@@ -51,70 +30,72 @@ bool ScaleManager::begin() {
   return true;
 }
 
-void ScaleManager::tare(uint16_t samples) {
-  if (!g_scale.isConnected()) return;
-
-  // At 10SPS, 128 samples ~12.8s. Give it enough time.
-  const uint32_t timeoutMs = (uint32_t)samples * 120 + 500; // ~100ms/sample + margin
-
-  g_scale.calculateZeroOffset(samples, timeoutMs);
-  zeroOffset_ = g_scale.getZeroOffset();
-  g_scale.setZeroOffset(zeroOffset_);
-}
-
-
-void ScaleManager::autoFixDirection() {
-  // We detect direction by checking raw delta from the ADC (independent of calibration).
-  // Ask user to do nothing; we just observe noise & sign. If it’s inverted due to wiring,
-  // the library-weight might go negative when load increases. We'll fix by flipping calFactor.
-
-  // Grab a baseline raw average
-  long base = 0;
-  const int n = 16;
-  for (int i = 0; i < n; i++) {
-    base += g_scale.getReading();
-    delay(10);
+// The platform is empty: the time to redo the ADC's offset calibration if
+// the rate changed since the last one (the NAU7802 datasheet asks for it
+// after a rate change). The conversion made across it is dropped.
+template <typename Adc>
+void BasicScale<Adc>::tare(uint16_t samples) {
+  if (!adc_.connected()) return;
+  if (recal_ && adc_.calibrate()) {
+    recal_ = false;
+    int32_t dropped = 0;
+    readAverage_(1, timeoutMs_(1), dropped, false);
+    filter_.reset();
   }
-  base /= n;
 
-  // Wait a moment and read again. If signal drifts the other way, that's OK—this is just a sanity check.
-  long later = 0;
-  for (int i = 0; i < n; i++) {
-    later += g_scale.getReading();
-    delay(10);
-  }
-  later /= n;
+  int32_t avg = 0;
+  if (samples > 255) samples = 255;
+  const bool haveTemp = sampleTemperature();
+  if (!readAverage_((uint8_t)samples, timeoutMs_(samples) + 400, avg, false)) return;
+  zeroOffset_ = avg;
+  if (haveTemp) comp_.setTare(tempC_);
+  AdcTrace::calibration(effectiveZero(), effectiveCal());
+}
 
+template <typename Adc>
+void BasicScale<Adc>::autoFixDirection() {
   // If your system is wired such that adding weight results in negative grams,
   // the simplest robust fix is: flip calibration sign.
   //
   // Since we can’t force you to add a known load at boot, we instead do a practical check:
   // If current computed weight is negative (beyond a small noise band), flip sign.
-  float gramsNow = g_scale.getWeight(true); // uses current zeroOffset + calFactor
-  if (gramsNow < -5.0f) {                   // more than -5g = likely inverted
+  int32_t avg = 0;
+  if (!readAverage_(8, timeoutMs_(8), avg, false)) return;
+  const float gramsNow = (avg - zeroOffset_) / calFactor_;
+  if (gramsNow < -5.0f) {  // more than -5g = likely inverted
     calFactor_ = -fabsf(calFactor_);
-    g_scale.setCalibrationFactor(calFactor_);
   }
-
-  // (Optional) If you want to log raw drift:
-  (void)base;
-  (void)later;
 }
 
-float ScaleManager::getWeightKg(bool averaged) {
-  if (!initialized_) return 0.0f;
-
-  // Fewer samples and no extra delay: rely on the NAU7802's own
-  // filtering plus the higher-level stability buffer in main.cpp.
-  const uint8_t samples = averaged ? 4 : 1;
-  float sumGrams = 0.0f;
-
-  for (uint8_t i = 0; i < samples; i++) {
-    sumGrams += g_scale.getWeight(true); // grams
+// Waits for each conversion on the driver's data-ready; every one is visible
+// to the trace recorder when traced.
+template <typename Adc>
+bool BasicScale<Adc>::readAverage_(uint8_t samples, uint32_t timeoutMs, int32_t &avg, bool traced) {
+  long total = 0;
+  uint8_t acquired = 0;
+  const unsigned long start = millis();
+  while (acquired < samples) {
+    if (adc_.ready()) {
+      const int32_t counts = adc_.read();
+      if (traced) {
+        AdcTrace::sample(counts);
+        total += lroundf(filter_.step((float)counts, micros()));
+      } else {
+        total += counts;
+      }
+      acquired++;
+      continue;
+    }
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
   }
+  avg = (int32_t)(total / samples);
+  return true;
+}
 
-  float grams = sumGrams / samples;
-  float kg = grams / 1000.0f;
+template <typename Adc>
+float BasicScale<Adc>::countsToKg(int32_t avgCounts, long zeroOffset, float calFactor) {
+  float kg = ((avgCounts - zeroOffset) / calFactor) / 1000.0f;
 
   // deadband near zero
   if (fabsf(kg) < 0.002f) kg = 0.0f;
@@ -124,3 +105,149 @@ float ScaleManager::getWeightKg(bool averaged) {
 
   return kg;
 }
+
+template <typename Adc>
+float BasicScale<Adc>::getWeightKg(bool averaged) {
+  if (!initialized_) return 0.0f;
+  Metrics::ScopedTimer timer(Metrics::AdcRead);
+
+  // Fewer samples and no extra delay: rely on the ADC's own
+  // filtering plus the stability buffer in WeighFsm.
+  // 4 x 8 conversions, as four getWeight() calls used to do.
+  const uint8_t samples = averaged ? 32 : 8;
+  int32_t avg = 0;
+  const bool ok = readAverage_(samples, timeoutMs_(samples), avg, true);
+  AdcTrace::weight();
+  if (!ok) return 0.0f;  // ADC stopped converting
+  lastAvg_ = avg;
+
+  return countsToKg(avg, effectiveZero(), effectiveCal());
+}
+
+template <typename Adc>
+long BasicScale<Adc>::effectiveZero() const {
+  if (isnan(tempC_)) return zeroOffset_;
+  return zeroOffset_ + lroundf(comp_.zeroShift(tempC_));
+}
+
+template <typename Adc>
+float BasicScale<Adc>::effectiveCal() const {
+  if (isnan(tempC_)) return calFactor_;
+  return comp_.countsPerGram(tempC_, calFactor_);
+}
+
+// The sensor read takes the ADC off the load cell for a few conversions;
+// the vibration stages restart on the gap, and a trace gets the zero and
+// factor the following weights use.
+template <typename Adc>
+bool BasicScale<Adc>::sampleTemperature() {
+  float c = 0.0f;
+  if (!adc_.readTemperatureC(c)) return false;
+  tempC_ = c;
+  filter_.reset();
+  AdcTrace::calibration(effectiveZero(), effectiveCal());
+  return true;
+}
+
+template <typename Adc>
+void BasicScale<Adc>::learnZero() {
+  if (!initialized_ || isnan(tempC_)) return;
+  const float residual = (float)(lastAvg_ - zeroOffset_);
+  comp_.addZeroPoint(tempC_, residual, calFactor_);
+  // Decigrams: a day's log shows the drift the compensation took out.
+  const int32_t rawDg = lroundf(residual * 10.0f / calFactor_);
+  const int32_t compDg = lroundf((lastAvg_ - effectiveZero()) * 10.0f / effectiveCal());
+  LOG_EVENT(TempZero, (uint32_t)lroundf(tempC_ * 100.0f), (uint32_t)rawDg, (uint32_t)compDg);
+}
+
+template <typename Adc>
+bool BasicScale<Adc>::addSpanPoint(float refKg) {
+  if (!initialized_ || refKg <= 0.0f || !sampleTemperature()) return false;
+  int32_t avg = 0;
+  if (!readAverage_(32, timeoutMs_(32), avg, false)) return false;
+  const float refG = refKg * 1000.0f;
+  if (!comp_.addSpanPoint(tempC_, (float)(avg - zeroOffset_), refG, calFactor_)) return false;
+  AdcTrace::calibration(effectiveZero(), effectiveCal());
+  const float gain = (avg - effectiveZero()) / refG / calFactor_;
+  LOG_EVENT(TempSpan, (uint32_t)lroundf(tempC_ * 100.0f), (uint32_t)lroundf((gain - 1.0f) * 1e6f));
+  return true;
+}
+
+template <typename Adc>
+void BasicScale<Adc>::setIdleRate(bool idle) {
+  if (!initialized_) return;
+  idle_ = idle;
+  adc_.setRate(idle ? AdcRate::Idle : AdcRate::Active);
+  if (idle) return;
+  const unsigned long start = millis();
+  while (!adc_.ready() && millis() - start < 3 * adc_.periodUs() / 1000) delay(1);
+  (void)adc_.read();
+}
+
+template <typename Adc>
+uint16_t BasicScale<Adc>::setActiveSps(uint16_t sps) {
+  const uint16_t got = adc_.setActiveSps(sps);
+  if ((float)got == activeHz_) return got;
+  activeHz_ = got;
+  filter_.configure(VibAnalysis::retune(vibCfg_, activeHz_), activeHz_);
+  recal_ = initialized_;  // begin() calibrates at whatever rate it finds
+  // Dozing: the new rate comes with the wake-up.
+  if (initialized_ && !idle_) setIdleRate(false);
+  return got;
+}
+
+template <typename Adc>
+void BasicScale<Adc>::setVibFilter(const VibFilter::Config &c) {
+  vibCfg_ = c;
+  filter_.configure(VibAnalysis::retune(c, activeHz_), activeHz_);
+}
+
+template <typename Adc>
+bool BasicScale<Adc>::captureRaw(int32_t *out, uint16_t n, float &hz, uint16_t &missed) {
+  if (!initialized_ || n < 2) return false;
+  constexpr uint16_t kSettle = 4;  // conversions dropped after the rate change
+  adc_.setRate(AdcRate::Capture);
+  const uint32_t periodUs = adc_.periodUs();
+  const uint32_t timeoutUs = 4 * periodUs + 2000;
+  missed = 0;
+  bool ok = true;
+  uint32_t firstUs = 0, lastUs = 0, waitUs = micros();
+  for (uint16_t i = 0; i < n + kSettle && ok;) {
+    if (!adc_.ready()) {
+      ok = micros() - waitUs < timeoutUs;
+      delayMicroseconds(100);
+      continue;
+    }
+    const int32_t counts = adc_.read();
+    const uint32_t now = micros();
+    if (i >= kSettle) {
+      if (i == kSettle) {
+        firstUs = now;
+      } else {
+        const uint32_t periods = (now - lastUs + periodUs / 2) / periodUs;
+        if (periods > 1) missed += periods - 1;
+      }
+      out[i - kSettle] = counts;
+    }
+    lastUs = waitUs = now;
+    i++;
+  }
+  // The conversion clock is only nominal; time the block.
+  hz = ok && lastUs != firstUs ? 1e6f * (n - 1 + missed) / (lastUs - firstUs) : 1e6f / periodUs;
+  setIdleRate(false);
+  filter_.reset();
+  return ok && missed <= n / 50;
+}
+
+template <typename Adc>
+bool BasicScale<Adc>::pollKg(float &kg) {
+  if (!initialized_ || !adc_.ready()) return false;
+  kg = countsToKg(adc_.read(), effectiveZero(), effectiveCal());
+  return true;
+}
+
+// Unused drivers cost nothing on the device: the linker drops their sections.
+template class BasicScale<Nau7802Adc>;
+template class BasicScale<Hx711Adc>;
+template class BasicScale<Ads1232Adc>;
+template class BasicScale<EmulatedAdc>;
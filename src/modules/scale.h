@@ -1,20 +1,95 @@
 #pragma once
 #include <Arduino.h>
+#include "adc_driver.h"
+#include "temp_comp.h"
+#include "vib_filter.h"
 
-class ScaleManager {
+// Weighing layer over one ADC driver (adc_driver.h): zero offset,
+// calibration factor, averaging, idle rate, temperature compensation.
+// Specialised per driver at compile time; the firmware uses ScaleManager
+// (the SCALE_ADC driver).
+template <typename Adc>
+class BasicScale {
  public:
   bool begin();
   void tare(uint16_t samples = 64);
   float getWeightKg(bool averaged = true);
 
+  // Idle power mode (see power.h): 10 SPS. On the way back the conversion
+  // started at the old rate is dropped.
+  void setIdleRate(bool idle);
+  // Weighing conversion rate (the nearest the ADC has at or below sps, see
+  // adc_driver.h). The vibration stages are re-derived for it; the ADC's
+  // offset calibration is redone with the next tare(), which needs an empty
+  // platform (calibrationDue() until then). Returns the rate set.
+  uint16_t setActiveSps(uint16_t sps);
+  bool calibrationDue() const { return recal_; }
+  // One conversion as kg if the ADC has one ready; does not wait.
+  bool pollKg(float &kg);
+
+  // Vibration stages on weighing conversions (vib_filter.h); an empty config
+  // turns them off. Kept as given and retuned to each weighing rate.
+  void setVibFilter(const VibFilter::Config &c);
+  const VibFilter &vibFilter() const { return filter_; }
+  float activeHz() const { return activeHz_; }
+  // n raw conversions back to back at the capture rate (vibration analysis).
+  // hz is the measured conversion rate, missed the conversions lost on the
+  // way; false when the ADC stalled or lost more than 2%. Back at the
+  // active rate afterwards.
+  bool captureRaw(int32_t *out, uint16_t n, float &hz, uint16_t &missed);
+
+  // Temperature compensation (temp_comp.h). sampleTemperature() reads the
+  // ADC's sensor between conversions (false without one); from then on
+  // weights use the zero and calibration factor at that temperature.
+  // learnZero() turns the last averaged read into a zero point: call it
+  // only when the platform is empty. addSpanPoint() averages a read with
+  // refKg on the platform.
+  bool sampleTemperature();
+  float temperatureC() const { return tempC_; }  // NAN before the first read
+  int32_t lastAverage() const { return lastAvg_; }  // of the last getWeightKg()
+  void learnZero();
+  bool addSpanPoint(float refKg);
+  void setTempModel(const TempComp::Model &m) { comp_.setModel(m); }
+  const TempComp &tempComp() const { return comp_; }
+
   long zeroOffset() const { return zeroOffset_; }
   float calFactor() const { return calFactor_; }
+  // At the last sampled temperature (zeroOffset()/calFactor() without one).
+  long effectiveZero() const;
+  float effectiveCal() const;
+  Adc &adc() { return adc_; }
+
+  // Averaged raw counts to the kg value getWeightKg() reports (deadband,
+  // never negative). Shared with the host trace replay.
+  static float countsToKg(int32_t avgCounts, long zeroOffset, float calFactor);
 
  private:
+  Adc adc_;
   long zeroOffset_ = 0;
   float calFactor_ = 0.0f;
   bool initialized_ = false;
+  VibFilter filter_;
+  VibFilter::Config vibCfg_;  // as designed; filter_ runs it at activeHz_
+  float activeHz_ = 0.0f;
+  bool idle_ = false;
+  bool recal_ = false;  // rate changed since the last offset calibration
+  TempComp comp_;
+  float tempC_ = NAN;
+  int32_t lastAvg_ = 0;
 
   // Checks which direction is positive and flips calibration sign if needed.
   void autoFixDirection();
+  // traced: conversions go to the ADC trace (weighing reads only) and
+  // through the vibration filter.
+  bool readAverage_(uint8_t samples, uint32_t timeoutMs, int32_t &avg, bool traced);
+  // Generous wait for n conversions at the current rate.
+  uint32_t timeoutMs_(uint16_t n) const { return (uint32_t)((uint64_t)n * adc_.periodUs() * 5 / 2000) + 100; }
 };
+
+// Instantiated in scale.cpp for every driver.
+extern template class BasicScale<Nau7802Adc>;
+extern template class BasicScale<Hx711Adc>;
+extern template class BasicScale<Ads1232Adc>;
+extern template class BasicScale<EmulatedAdc>;
+
+using ScaleManager = BasicScale<ScaleAdc>;
@@ -0,0 +1,227 @@
+#include "self_bench.h"
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <Wire.h>
+#include "config.h"
+#include "event_log.h"
+#include "lcd_display.h"
+#include "rfid2.h"
+#include "tls_session.h"
+#include "uploader.h"
+#include "wifi_manager.h"
+
+namespace {
+
+struct Stat {
+  uint32_t n = 0;
+  uint64_t sumUs = 0;
+  uint32_t maxUs = 0;
+
+  void add(uint32_t us) {
+    n++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+  unsigned long meanUs() const { return n ? (unsigned long)(sumUs / n) : 0; }
+};
+
+void benchAdc(ScaleManager &scale, Print &out) {
+  ScaleAdc &adc = scale.adc();
+  Stat read;
+  // Start on a fresh conversion so the count covers whole periods.
+  const unsigned long syncStart = millis();
+  while (!adc.ready() && millis() - syncStart < 3 * adc.periodUs() / 1000) delay(1);
+  (void)adc.read();
+
+  const uint32_t start = micros();
+  uint32_t first = 0, last = 0;
+  while (micros() - start < BENCH_ADC_MS * 1000UL) {
+    if (!adc.ready()) {
+      delay(1);
+      continue;
+    }
+    const uint32_t t0 = micros();
+    (void)adc.read();
+    last = micros();
+    read.add(last - t0);
+    if (read.n == 1) first = t0;
+  }
+  // Conversion to conversion, so the window edges do not count.
+  const float sps = read.n > 1 && last != first ? (read.n - 1) * 1e6f / (last - first) : 0.0f;
+  out.printf("bench: adc %s %.1f SPS (nominal %.1f), read %lu us mean %lu max\n", ScaleAdc::kName, sps,
+             1e6f / adc.periodUs(), read.meanUs(), (unsigned long)read.maxUs);
+}
+
+void benchLcd(LCDDisplay &lcd, Print &out) {
+  char saved[LCD_ROWS][LCD_COLS + 1];
+  for (uint8_t r = 0; r < LCD_ROWS; ++r) snprintf(saved[r], sizeof(saved[r]), "%s", lcd.line(r));
+
+  // Alternating frames, so the row cache never skips a write.
+  Stat frame;
+  char text[LCD_COLS + 1];
+  for (uint8_t f = 0; f < 4; ++f) {
+    const uint32_t t0 = micros();
+    for (uint8_t r = 0; r < LCD_ROWS; ++r) {
+      snprintf(text, sizeof(text), "%sBENCH %u/%u", f % 2 ? " " : "", (unsigned)r, (unsigned)f);
+      lcd.printLine(r, text);
+    }
+    frame.add(micros() - t0);
+  }
+  Stat cell;
+  for (uint8_t i = 0; i < BENCH_REPEAT; ++i) {
+    const uint32_t t0 = micros();
+    lcd.printAt(i % LCD_COLS, LCD_ROWS - 1, (char)('0' + i % 10));
+    cell.add(micros() - t0);
+  }
+  for (uint8_t r = 0; r < LCD_ROWS; ++r) lcd.printLine(r, saved[r]);
+  out.printf("bench: lcd frame (%u rows) %lu us mean %lu max, cell %lu us mean %lu max\n", (unsigned)LCD_ROWS,
+             frame.meanUs(), (unsigned long)frame.maxUs, cell.meanUs(), (unsigned long)cell.maxUs);
+}
+
+void benchRfid(RFID2 &rfid, Print &out) {
+  Stat poll;
+  char id[RFID2::kIdLen];
+  bool card = false;
+  for (uint8_t i = 0; i < BENCH_REPEAT; ++i) {
+    const uint32_t t0 = micros();
+    card |= rfid.poll(id);
+    poll.add(micros() - t0);
+  }
+  out.printf("bench: rfid poll %lu us mean %lu max%s\n", poll.meanUs(), (unsigned long)poll.maxUs,
+             card ? " (a card was read and dropped)" : "");
+}
+
+uint8_t probe(TwoWire &wire, uint8_t addr) {
+  wire.beginTransmission(addr);
+  return wire.endTransmission();
+}
+
+void benchI2c(const SelfBench::Targets &t, Print &out) {
+  const bool lcd = t.lcd != nullptr && t.lcd->ok();
+  const bool rfid = t.rfid != nullptr && t.rfid->ready();
+  uint32_t tries0 = 0, errors0 = 0, errorsAdc = 0;
+  for (uint8_t i = 0; i < BENCH_REPEAT; ++i) {
+    if (lcd) {
+      tries0++;
+      errors0 += probe(Wire, t.lcd->address()) != 0;
+    }
+    if (rfid) {
+      tries0++;
+      errors0 += probe(Wire, t.rfid->address()) != 0;
+    }
+    errorsAdc += !t.scale->adc().connected();
+  }
+  out.printf("bench: i2c bus0 %lu/%lu probes failed (lcd %s, rfid %s), adc %lu/%u\n", (unsigned long)errors0,
+             (unsigned long)tries0, lcd ? "on" : "off", rfid ? "on" : "off", (unsigned long)errorsAdc,
+             (unsigned)BENCH_REPEAT);
+}
+
+void benchWifi(WiFiManager &wifi, Print &out) {
+  const int rssi = WiFi.RSSI();
+  WiFi.disconnect();
+  delay(100);
+  // The driver keeps the network it joined (saved or fallback credentials).
+  const unsigned long t0 = millis();
+  WiFi.reconnect();
+  while (WiFi.status() != WL_CONNECTED && millis() - t0 < BENCH_WIFI_TIMEOUT_MS) delay(10);
+  bool ok = WiFi.status() == WL_CONNECTED;
+  if (!ok) ok = wifi.ensureConnected(BENCH_WIFI_TIMEOUT_MS);
+  out.printf("bench: wifi rssi %d dBm, reconnect %s in %lu ms\n", rssi, ok ? "ok" : "FAILED",
+             (unsigned long)(millis() - t0));
+}
+
+// "scheme://host[:port]/path" -> host, port.
+bool parseUrl(const char *url, char *host, size_t hostLen, uint16_t &port, bool &tls) {
+  tls = strncmp(url, "https://", 8) == 0;
+  if (!tls && strncmp(url, "http://", 7) != 0) return false;
+  const char *h = url + (tls ? 8 : 7);
+  const size_t n = strcspn(h, ":/");
+  if (n == 0 || n >= hostLen) return false;
+  memcpy(host, h, n);
+  host[n] = '\0';
+  port = h[n] == ':' ? (uint16_t)atoi(h + n + 1) : (tls ? 443 : 80);
+  return port != 0;
+}
+
+bool connectTo(WiFiClientSecure &client, const IPAddress &ip, uint16_t port, const char *host) {
+  return client.connect(ip, port, host, nullptr, nullptr, nullptr);  // host for SNI
+}
+bool connectTo(WiFiClient &client, const IPAddress &ip, uint16_t port, const char *) {
+  return client.connect(ip, port);
+}
+
+// Handshake, then the GET on the same connection (HTTPClient reuses it).
+template <typename Client>
+void exchange(Client &client, const IPAddress &ip, const char *host, uint16_t port, bool tls, Print &out) {
+  uint32_t t0 = millis();
+  const bool connected = connectTo(client, ip, port, host);
+  const uint32_t connectMs = millis() - t0;
+  if (!connected) {
+    out.printf("bench: %s connect to %s:%u FAILED after %lu ms\n", tls ? "tls" : "tcp", host, (unsigned)port,
+               (unsigned long)connectMs);
+    return;
+  }
+  HTTPClient http;
+  int code = -1;
+  t0 = millis();
+  if (http.begin(client, BENCH_URL)) {
+    http.setTimeout(UPLOAD_HTTP_TIMEOUT_MS);
+    code = http.GET();
+    http.end();
+  }
+  out.printf("bench: %s %lu ms, GET %d in %lu ms\n", tls ? "tls handshake" : "tcp connect", (unsigned long)connectMs,
+             code, (unsigned long)(millis() - t0));
+}
+
+void benchNet(Print &out) {
+  char host[64];
+  uint16_t port = 0;
+  bool tls = false;
+  if (!parseUrl(BENCH_URL, host, sizeof(host), port, tls)) {
+    out.printf("bench: net skipped, cannot parse %s\n", BENCH_URL);
+    return;
+  }
+  IPAddress ip;
+  const uint32_t t0 = millis();
+  const bool resolved = WiFi.hostByName(host, ip) == 1;
+  const uint32_t dnsMs = millis() - t0;
+  out.printf("bench: dns %s %s in %lu ms\n", host, resolved ? ip.toString().c_str() : "FAILED",
+             (unsigned long)dnsMs);
+  if (!resolved) return;
+  if (tls) {
+    TlsSession::Lease lease;
+    exchange(lease.client(), ip, host, port, true, out);
+  } else {
+    WiFiClient client;
+    exchange(client, ip, host, port, false, out);
+    client.stop();
+  }
+}
+
+} // namespace
+
+namespace SelfBench {
+
+void run(const Targets &t, Print &out) {
+  const unsigned long start = millis();
+  out.printf("bench: start (%s)\n", BENCH_URL);
+  if (t.scale != nullptr) benchAdc(*t.scale, out);
+  if (t.lcd != nullptr && t.lcd->ok()) benchLcd(*t.lcd, out);
+  if (t.rfid != nullptr && t.rfid->ready()) benchRfid(*t.rfid, out);
+  if (t.scale != nullptr) benchI2c(t, out);
+
+  if (t.wifi == nullptr || t.wifi->isConfigPortalActive()) {
+    out.println("bench: wifi skipped (config portal)");
+  } else {
+    // The held connection would only be closed by the disconnect.
+    if (t.uploader != nullptr) t.uploader->cancelPrewarm();
+    benchWifi(*t.wifi, out);
+    if (t.wifi->isConnected()) benchNet(out);
+  }
+  const unsigned long ms = millis() - start;
+  out.printf("bench: done in %lu ms\n", ms);
+  LOG_EVENT(SelfBench, (uint32_t)ms);
+}
+
+} // namespace SelfBench
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "scale.h"
+
+class LCDDisplay;
+class RFID2;
+class WiFiManager;
+class Uploader;
+
+// On-site performance check (serial 'b'): a scripted run over the station's
+// peripherals and network path, printed as a short report.
+//
+//   adc   conversions per second against the nominal rate, read() latency
+//   lcd   full frame (every row) and single-cell update time
+//   rfid  poll() time
+//   i2c   failed address probes: LCD and reader on bus 0, the ADC on its own
+//   wifi  RSSI, and the time to reconnect after a deliberate disconnect
+//   net   DNS, TCP+TLS handshake and one GET to BENCH_URL
+//
+// The ADC is read raw: zero offset, calibration factor, vibration stages and
+// NVS are left alone. The LCD rows are put back afterwards. A card read by
+// the RFID polls is dropped. The loop is blocked for ~3 s plus the
+// Wi-Fi rejoin and the network exchange.
+namespace SelfBench {
+
+struct Targets {
+  ScaleManager *scale = nullptr;
+  LCDDisplay *lcd = nullptr;       // skipped when null or not found
+  RFID2 *rfid = nullptr;
+  WiFiManager *wifi = nullptr;     // wifi and net skipped in the config portal
+  Uploader *uploader = nullptr;    // a pre-warmed connection is dropped first
+};
+
+void run(const Targets &t, Print &out);
+
+} // namespace SelfBench
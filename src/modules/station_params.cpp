@@ -0,0 +1,374 @@
+#include "station_params.h"
+#include <Preferences.h>
+#include <ctype.h>
+#include <math.h>
+#include "event_log.h"
+
+namespace {
+constexpr const char *kNamespace = "params";
+constexpr const char *kStationKey = "station";
+constexpr const char *kProfilesKey = "profiles";
+constexpr uint32_t kStationMagic = 0x50524d31;   // "PRM1"
+constexpr uint32_t kProfilesMagic = 0x50524631;  // "PRF1"
+
+using Values = StationParams::Values;
+static_assert(sizeof(Values) == StationParams::kCount * 4, "Values: 4-byte fields, one per Def");
+
+struct StationBlob {
+  uint32_t magic;
+  char profile[StationParams::kNameLen];
+  uint32_t mask;
+  Values overrides;
+};
+
+struct SavedProfile {
+  char name[StationParams::kNameLen];
+  Values values;
+};
+
+struct ProfilesBlob {
+  uint32_t magic;
+  uint32_t count;
+  SavedProfile saved[PARAMS_MAX_SAVED_PROFILES];
+};
+
+// Starting points for common loads; tune on the station and "save" the
+// result under the station's own name.
+struct BuiltIn {
+  const char *name;
+  void (*apply)(Values &v);
+};
+const BuiltIn kBuiltIns[] = {
+    {"default", [](Values &) {}},
+    // Bags of a few hundred grams: a lower floor and a tighter band.
+    {"small-fish",
+     [](Values &v) {
+       v.stableStddevKg = 0.004f;
+       v.minEffectiveKg = 0.10f;
+     }},
+    // 10-50 kg crates swing more and are set down harder: a wider band,
+    // a shorter settle, faster conversions to see it.
+    {"crates",
+     [](Values &v) {
+       v.stableStddevKg = 0.020f;
+       v.stableMinMs = 1500;
+       v.weighingTimeoutMs = 2500;
+       v.minEffectiveKg = 1.0f;
+       v.adcSps = 40;
+     }},
+};
+
+bool loadProfiles(ProfilesBlob &b) {
+  b = ProfilesBlob{};
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, true)) return false;
+  const bool ok = prefs.getBytes(kProfilesKey, &b, sizeof(b)) == sizeof(b) && b.magic == kProfilesMagic &&
+                  b.count <= PARAMS_MAX_SAVED_PROFILES;
+  prefs.end();
+  if (!ok) b = ProfilesBlob{};
+  return ok;
+}
+
+bool validName(const char *name) {
+  const size_t n = strlen(name);
+  if (n == 0 || n >= StationParams::kNameLen) return false;
+  for (size_t i = 0; i < n; ++i) {
+    if (!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_') return false;
+  }
+  return true;
+}
+
+uint32_t *field(Values &v, const StationParams::Def &d) {
+  return reinterpret_cast<uint32_t *>(reinterpret_cast<uint8_t *>(&v) + d.offset);
+}
+} // namespace
+
+const StationParams::Def StationParams::kDefs[kCount] = {
+    {"stable_stddev_kg", Type::Float, offsetof(Values, stableStddevKg), 0.001f, 0.5f, "kg"},
+    {"stable_min_ms", Type::UInt, offsetof(Values, stableMinMs), 200, 30000, "ms"},
+    {"weighing_timeout_ms", Type::UInt, offsetof(Values, weighingTimeoutMs), 500, 60000, "ms"},
+    {"no_id_zero_timeout_ms", Type::UInt, offsetof(Values, noIdZeroTimeoutMs), 1000, 600000, "ms"},
+    {"min_effective_kg", Type::Float, offsetof(Values, minEffectiveKg), 0.0f, 50.0f, "kg"},
+    {"adc_sps", Type::UInt, offsetof(Values, adcSps), 10, 320, "SPS"},
+    {"loop_period_ms", Type::UInt, offsetof(Values, loopPeriodMs), 0, 2000, "ms"},
+};
+
+const StationParams::Def *StationParams::find(const char *name) {
+  for (const Def &d : kDefs) {
+    if (strcmp(d.name, name) == 0) return &d;
+  }
+  return nullptr;
+}
+
+float StationParams::get(const Values &v, const Def &d) {
+  const uint32_t *p = field(const_cast<Values &>(v), d);
+  if (d.type == Type::UInt) return (float)*p;
+  float f;
+  memcpy(&f, p, sizeof(f));
+  return f;
+}
+
+bool StationParams::parse(const Def &d, const char *text, float &x) {
+  char *end = nullptr;
+  x = strtof(text, &end);
+  if (end == text) return false;
+  while (*end == ' ') end++;
+  return *end == '\0' && x >= d.min && x <= d.max && (d.type == Type::Float || x == floorf(x));
+}
+
+void StationParams::begin() {
+  mask_ = 0;
+  overrides_ = Values();
+  strncpy(profile_, PARAMS_PROFILE, sizeof(profile_) - 1);
+  Preferences prefs;
+  if (prefs.begin(kNamespace, true)) {
+    StationBlob b;
+    if (prefs.getBytes(kStationKey, &b, sizeof(b)) == sizeof(b) && b.magic == kStationMagic) {
+      b.profile[kNameLen - 1] = '\0';
+      memcpy(profile_, b.profile, sizeof(profile_));
+      mask_ = b.mask & ((1UL << kCount) - 1);
+      overrides_ = b.overrides;
+    }
+    prefs.end();
+  }
+  resolve_();
+}
+
+bool StationParams::profileValues_(const char *name, Values &out) const {
+  out = Values();
+  for (const BuiltIn &b : kBuiltIns) {
+    if (strcmp(b.name, name) == 0) {
+      b.apply(out);
+      return true;
+    }
+  }
+  ProfilesBlob blob;
+  loadProfiles(blob);
+  for (uint32_t i = 0; i < blob.count; ++i) {
+    if (strncmp(blob.saved[i].name, name, kNameLen) == 0) {
+      out = blob.saved[i].values;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StationParams::resolveInto_(Values &v) const {
+  const bool found = profileValues_(profile_, v);
+  for (uint8_t i = 0; i < kCount; ++i) {
+    if (mask_ & (1UL << i)) *field(v, kDefs[i]) = *field(const_cast<Values &>(overrides_), kDefs[i]);
+  }
+  return found;
+}
+
+void StationParams::resolve_() {
+  Values v;
+  if (!resolveInto_(v)) {
+    // Saved profile gone (or renamed in a newer build): config.h defaults.
+    strncpy(profile_, "default", sizeof(profile_) - 1);
+  }
+  uint8_t overridden = 0;
+  for (uint8_t i = 0; i < kCount; ++i) overridden += (mask_ >> i) & 1;
+  values_ = v;
+  generation_++;
+  LOG_EVENT(ParamsChanged, generation_, (uint32_t)overridden);
+}
+
+bool StationParams::saveStation_() const {
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) return false;
+  StationBlob b{};
+  b.magic = kStationMagic;
+  memcpy(b.profile, profile_, sizeof(b.profile));
+  b.mask = mask_;
+  b.overrides = overrides_;
+  const bool ok = prefs.putBytes(kStationKey, &b, sizeof(b)) == sizeof(b);
+  prefs.end();
+  return ok;
+}
+
+StationParams::State StationParams::state_() const {
+  State s;
+  memcpy(s.profile, profile_, sizeof(s.profile));
+  s.mask = mask_;
+  s.overrides = overrides_;
+  return s;
+}
+
+void StationParams::restore_(const State &s) {
+  memcpy(profile_, s.profile, sizeof(profile_));
+  mask_ = s.mask;
+  overrides_ = s.overrides;
+}
+
+// The FSM gives up on a settle at weighing_timeout_ms: below stable_min_ms
+// no weight would ever be stable long enough.
+bool StationParams::consistent_(const Values &v, Print &out) {
+  if (v.weighingTimeoutMs >= v.stableMinMs) return true;
+  out.printf("params: weighing_timeout_ms %lu is below stable_min_ms %lu\n", (unsigned long)v.weighingTimeoutMs,
+             (unsigned long)v.stableMinMs);
+  return false;
+}
+
+bool StationParams::settle_(const State &before, Print &out) {
+  if (batch_) return true;
+  Values v;
+  resolveInto_(v);
+  if (!consistent_(v, out)) {
+    restore_(before);
+    return false;
+  }
+  resolve_();
+  saveStation_();
+  return true;
+}
+
+bool StationParams::set_(const Def &d, const char *text, Print &out) {
+  const uint8_t bit = (uint8_t)(&d - kDefs);
+  const State before = state_();
+  if (strcmp(text, "default") == 0) {
+    mask_ &= ~(1UL << bit);
+    if (!settle_(before, out)) return false;
+    out.printf("params: %s back to the profile\n", d.name);
+    return true;
+  }
+  float x;
+  if (!parse(d, text, x)) {
+    out.printf("params: %s takes %s %g..%g %s\n", d.name, d.type == Type::UInt ? "a whole number in" : "a number in",
+               d.min, d.max, d.unit);
+    return false;
+  }
+  if (d.type == Type::UInt) *field(overrides_, d) = (uint32_t)x;
+  else memcpy(field(overrides_, d), &x, sizeof(x));
+  mask_ |= 1UL << bit;
+  if (!settle_(before, out)) return false;
+  out.printf("params: %s = %g %s (station)\n", d.name, get(overrides_, d), d.unit);
+  return true;
+}
+
+bool StationParams::selectProfile_(const char *name, Print &out) {
+  Values v;
+  if (!profileValues_(name, v)) {
+    out.printf("params: no profile '%s'\n", name);
+    return false;
+  }
+  const State before = state_();
+  strncpy(profile_, name, sizeof(profile_) - 1);
+  profile_[kNameLen - 1] = '\0';
+  mask_ = 0;
+  return settle_(before, out);
+}
+
+bool StationParams::saveProfile_(const char *name) {
+  for (const BuiltIn &b : kBuiltIns) {
+    if (strcmp(b.name, name) == 0) return false;
+  }
+  ProfilesBlob blob;
+  loadProfiles(blob);
+  uint32_t i = 0;
+  while (i < blob.count && strncmp(blob.saved[i].name, name, kNameLen) != 0) i++;
+  if (i == PARAMS_MAX_SAVED_PROFILES) return false;
+  if (i == blob.count) blob.count++;
+  blob.saved[i] = SavedProfile{};
+  strncpy(blob.saved[i].name, name, kNameLen - 1);
+  blob.saved[i].values = values_;
+  blob.magic = kProfilesMagic;
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) return false;
+  const bool ok = prefs.putBytes(kProfilesKey, &blob, sizeof(blob)) == sizeof(blob);
+  prefs.end();
+  // The station now runs that profile as it is.
+  if (ok) {
+    strncpy(profile_, name, sizeof(profile_) - 1);
+    mask_ = 0;
+    resolve_();
+    saveStation_();
+  }
+  return ok;
+}
+
+bool StationParams::command(const char *line, Print &out) {
+  char buf[64];
+  strncpy(buf, line, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  char *word = buf;
+  while (*word == ' ') word++;
+  char *arg = word;
+  while (*arg != '\0' && *arg != ' ') arg++;
+  if (*arg != '\0') *arg++ = '\0';
+  while (*arg == ' ') arg++;
+  for (char *e = arg + strlen(arg); e > arg && e[-1] == ' ';) *--e = '\0';
+
+  if (*word == '\0') {
+    printText(out);
+    return true;
+  }
+  if (strcmp(word, "reset") == 0) {
+    const State before = state_();
+    strncpy(profile_, "default", sizeof(profile_) - 1);
+    mask_ = 0;
+    if (!settle_(before, out)) return false;
+    out.printf("params: default profile, no overrides\n");
+    return true;
+  }
+  if (strcmp(word, "profile") == 0) {
+    if (!selectProfile_(arg, out)) return false;
+    out.printf("params: profile %s\n", profile_);
+    return true;
+  }
+  if (strcmp(word, "save") == 0) {
+    if (batch_) {
+      out.printf("params: save after the other changes\n");
+      return false;
+    }
+    if (!validName(arg) || !saveProfile_(arg)) {
+      out.printf("params: cannot save '%s' (letters, digits, - and _; not a built-in name; %u slots)\n", arg,
+                 (unsigned)PARAMS_MAX_SAVED_PROFILES);
+      return false;
+    }
+    out.printf("params: saved as profile %s\n", profile_);
+    return true;
+  }
+  const Def *d = find(word);
+  if (d == nullptr || *arg == '\0') {
+    out.printf("params: unknown '%s'; 'u' lists the names\n", word);
+    return false;
+  }
+  return set_(*d, arg, out);
+}
+
+bool StationParams::commands(const char *const *lines, uint8_t n, Print &out) {
+  const State before = state_();
+  batch_ = true;
+  bool ok = true;
+  for (uint8_t i = 0; i < n && ok; ++i) ok = command(lines[i], out);
+  batch_ = false;
+  if (!ok) {
+    restore_(before);
+    return false;
+  }
+  return settle_(before, out);
+}
+
+void StationParams::printText(Print &out) const {
+  uint8_t overridden = 0;
+  for (uint8_t i = 0; i < kCount; ++i) overridden += (mask_ >> i) & 1;
+  out.printf("params: profile %s, %u station override%s, generation %lu\n", profile_, (unsigned)overridden,
+             overridden == 1 ? "" : "s", (unsigned long)generation_);
+  Values profileV;
+  profileValues_(profile_, profileV);
+  const Values defaults;
+  for (uint8_t i = 0; i < kCount; ++i) {
+    const Def &d = kDefs[i];
+    const char *source = (mask_ & (1UL << i))                  ? "station"
+                         : get(profileV, d) != get(defaults, d) ? "profile"
+                                                               : "default";
+    out.printf("  %-22s %10g %-4s %-8s (%g..%g)\n", d.name, get(values_, d), d.unit, source, d.min, d.max);
+  }
+  out.printf("params: profiles");
+  for (const BuiltIn &b : kBuiltIns) out.printf(" %s", b.name);
+  ProfilesBlob blob;
+  loadProfiles(blob);
+  for (uint32_t i = 0; i < blob.count; ++i) out.printf(" %s", blob.saved[i].name);
+  out.printf("\n");
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <Arduino.h>
+#include <stddef.h>
+#include "adc_driver.h"
+#include "config.h"
+
+// Weighing parameters that can be tuned per station while it runs.
+//
+// Each value is the station override if there is one, else the active
+// profile's, else the config.h default. Profiles are built in ("default",
+// "small-fish", "crates") or saved from the current values; the profile
+// name and the overrides live in NVS and survive reboots.
+//
+// Changes arrive as text commands (serial 'u', POST /params) between loop
+// iterations and bump generation(). The loop compares it once per iteration
+// and copies values() into the FSM, the ADC rate and its own pacing, so the
+// weighing path reads plain fields and never looks a name up.
+class StationParams {
+ public:
+  struct Values {
+    float stableStddevKg = STABLE_STDDEV_KG;
+    uint32_t stableMinMs = STABLE_MIN_MS;
+    uint32_t weighingTimeoutMs = WEIGHING_TIMEOUT_MS;
+    uint32_t noIdZeroTimeoutMs = NO_ID_ZERO_TIMEOUT_MS;
+    float minEffectiveKg = MIN_EFFECTIVE_WEIGHT_KG;
+    uint32_t adcSps = ScaleAdc::kActiveSps;
+    uint32_t loopPeriodMs = LOOP_PERIOD_MS;
+  };
+
+  enum class Type : uint8_t { Float, UInt };
+
+  // One entry per field of Values; the registry's names are the commands'.
+  struct Def {
+    const char *name;
+    Type type;
+    uint8_t offset;  // in Values
+    float min;
+    float max;
+    const char *unit;
+  };
+
+  static constexpr uint8_t kCount = 7;
+  static constexpr uint8_t kNameLen = 16;  // profile names, with the NUL
+  static const Def kDefs[kCount];
+
+  // Profile and overrides from NVS; the default profile without them.
+  void begin();
+
+  const Values &values() const { return values_; }
+  uint32_t generation() const { return generation_; }
+  const char *profile() const { return profile_; }
+
+  // Text commands, as typed after serial 'u':
+  //   ""                 list the values and where each comes from
+  //   "<name> <value>"   station override
+  //   "<name> default"   drop the override (back to the profile)
+  //   "profile <name>"   switch profile, dropping the overrides
+  //   "save <name>"      save the current values as a profile
+  //   "reset"            default profile, no overrides
+  // Prints the outcome; false when rejected (nothing changes then). Values
+  // are also checked against each other: weighing_timeout_ms may not be
+  // below stable_min_ms.
+  bool command(const char *line, Print &out);
+  // Several commands (not "save") taken as one change: the values are
+  // checked together once all are in, so a pair can move past each other;
+  // on any rejection the station keeps what it had.
+  bool commands(const char *const *lines, uint8_t n, Print &out);
+  void printText(Print &out) const;
+
+  static const Def *find(const char *name);
+  static float get(const Values &v, const Def &d);
+  // A value as typed, within d's range (whole for UInt); false otherwise.
+  static bool parse(const Def &d, const char *text, float &x);
+
+ private:
+  bool set_(const Def &d, const char *text, Print &out);
+  bool selectProfile_(const char *name, Print &out);
+  bool saveProfile_(const char *name);
+  bool profileValues_(const char *name, Values &out) const;
+  // Profile values under the overrides; false when the profile is gone.
+  bool resolveInto_(Values &v) const;
+  void resolve_();
+  bool saveStation_() const;
+
+  struct State {
+    char profile[kNameLen];
+    uint32_t mask;
+    Values overrides;
+  };
+  State state_() const;
+  void restore_(const State &s);
+  static bool consistent_(const Values &v, Print &out);
+  // After a change to the profile or overrides: resolve and save it, or
+  // restore `before` if the values do not fit together. Deferred in a batch.
+  bool settle_(const State &before, Print &out);
+
+  Values values_;
+  Values overrides_;
+  uint32_t mask_ = 0;  // bit i: kDefs[i] overridden on this station
+  char profile_[kNameLen] = PARAMS_PROFILE;
+  uint32_t generation_ = 0;
+  bool batch_ = false;
+};
@@ -0,0 +1,163 @@
+#include "temp_comp.h"
+#include <Preferences.h>
+#include <math.h>
+
+namespace {
+constexpr const char *kNamespace = "tempcomp";
+constexpr const char *kKey = "model";
+constexpr uint32_t kMagic = 0x544d5032;  // "TMP2": C from the datasheet conversion
+
+struct Blob {
+  uint32_t magic;
+  TempComp::Model model;
+};
+
+constexpr float kMaxGainError = 0.05f;  // span point against calFactor
+} // namespace
+
+void TempComp::setModel(const Model &m) {
+  m_ = m;
+  if (m_.spanCount > kMaxSpanPoints) m_.spanCount = kMaxSpanPoints;
+  if (m_.spanNext >= kMaxSpanPoints) m_.spanNext = 0;
+  fitZero_();
+  fitSpan_();
+}
+
+void TempComp::addZeroPoint(float tempC, float residualCounts, float calFactor) {
+  if (calFactor == 0.0f) return;
+  countsPerGram_ = fabsf(calFactor);
+  const double x = tempC - tareC_;
+  const double y = residualCounts;
+  const double keep = 1.0 - 1.0 / TEMPCOMP_MEMORY_POINTS;
+  m_.sw = m_.sw * keep + 1.0;
+  m_.sx = m_.sx * keep + x;
+  m_.sy = m_.sy * keep + y;
+  m_.sxx = m_.sxx * keep + x * x;
+  m_.sxy = m_.sxy * keep + x * y;
+  fitZero_();
+  fitSpan_();  // span points are net of the zero slope
+
+  const float rawG = residualCounts / calFactor;
+  const float compG = (residualCounts - zeroShift(tempC)) / calFactor;
+  Drift &d = drift_;
+  if (d.points++ == 0) {
+    d.minC = d.maxC = tempC;
+    d.rawMinG = d.rawMaxG = rawG;
+    d.compMinG = d.compMaxG = compG;
+    return;
+  }
+  d.minC = fminf(d.minC, tempC);
+  d.maxC = fmaxf(d.maxC, tempC);
+  d.rawMinG = fminf(d.rawMinG, rawG);
+  d.rawMaxG = fmaxf(d.rawMaxG, rawG);
+  d.compMinG = fminf(d.compMinG, compG);
+  d.compMaxG = fmaxf(d.compMaxG, compG);
+}
+
+// Least squares on the weighted sums; the slope is only used once the
+// points cover enough temperature to pin it down.
+void TempComp::fitZero_() {
+  zeroSlope_ = 0.0f;
+  if (m_.sw < TEMPCOMP_MIN_POINTS) return;
+  const double mx = m_.sx / m_.sw;
+  const double varX = m_.sxx / m_.sw - mx * mx;
+  if (varX < (double)TEMPCOMP_MIN_SPREAD_C * TEMPCOMP_MIN_SPREAD_C) return;
+  const double slope = (m_.sxy / m_.sw - mx * (m_.sy / m_.sw)) / varX;
+  if (fabs(slope) > (double)TEMPCOMP_MAX_ZERO_G_PER_C * countsPerGram_) return;
+  zeroSlope_ = (float)slope;
+}
+
+bool TempComp::addSpanPoint(float tempC, float netCounts, float refGrams, float calFactor) {
+  if (refGrams <= 0.0f || calFactor == 0.0f) return false;
+  const float gain = (netCounts - zeroShift(tempC)) / refGrams / calFactor;
+  if (!(fabsf(gain - 1.0f) <= kMaxGainError)) return false;
+  const uint8_t i = m_.spanNext;
+  m_.spanC[i] = tempC;
+  m_.spanTareC[i] = tareC_;
+  m_.spanNet[i] = netCounts;
+  m_.spanRefG[i] = refGrams;
+  m_.spanNext = (uint8_t)((i + 1) % kMaxSpanPoints);
+  if (m_.spanCount < kMaxSpanPoints) m_.spanCount++;
+  fitSpan_();
+  return true;
+}
+
+// Counts per gram of each point net of the zero drift since its tare, then
+// a line over temperature.
+void TempComp::fitSpan_() {
+  spanCpg_ = 0.0f;
+  spanSlope_ = 0.0f;
+  const uint8_t n = m_.spanCount;
+  if (n < 2) return;
+  float cpg[kMaxSpanPoints];
+  float minC = m_.spanC[0], maxC = m_.spanC[0], sumC = 0.0f, sumG = 0.0f;
+  for (uint8_t i = 0; i < n; ++i) {
+    cpg[i] = (m_.spanNet[i] - zeroSlope_ * (m_.spanC[i] - m_.spanTareC[i])) / m_.spanRefG[i];
+    minC = fminf(minC, m_.spanC[i]);
+    maxC = fmaxf(maxC, m_.spanC[i]);
+    sumC += m_.spanC[i];
+    sumG += cpg[i];
+  }
+  if (maxC - minC < TEMPCOMP_SPAN_MIN_DELTA_C) return;
+  const float mc = sumC / n, mg = sumG / n;
+  float sxx = 0.0f, sxy = 0.0f;
+  for (uint8_t i = 0; i < n; ++i) {
+    sxx += (m_.spanC[i] - mc) * (m_.spanC[i] - mc);
+    sxy += (m_.spanC[i] - mc) * (cpg[i] - mg);
+  }
+  const float slope = sxy / sxx / mg;  // relative to the span at mc
+  if (fabsf(slope) > TEMPCOMP_MAX_SPAN_PPM_PER_C * 1e-6f) return;
+  spanCpg_ = mg;
+  spanSlope_ = slope;
+  spanRefC_ = mc;
+}
+
+void TempComp::printText(Print &out, float tempC, float calFactor) const {
+  if (isnan(tempC)) {
+    out.printf("temp: no sensor reading\n");
+    return;
+  }
+  out.printf("temp: %.2f C, tared at %.2f C\n", tempC, tareC_);
+  if (zeroFitted()) {
+    out.printf("temp: zero %+.2f g/C from %.0f points, now %+.1f g\n", zeroSlope_ / calFactor, m_.sw,
+               zeroShift(tempC) / calFactor);
+  } else {
+    out.printf("temp: zero not learned yet (%.0f points)\n", m_.sw);
+  }
+  if (spanFitted()) {
+    out.printf("temp: span %+.0f ppm/C about %.1f C, now %+.0f ppm against the calibration\n",
+               spanSlope_ * 1e6f, spanRefC_, (countsPerGram(tempC, calFactor) / calFactor - 1.0f) * 1e6f);
+  } else {
+    out.printf("temp: span not learned (%u points; 's' with %.1f kg on the platform)\n", (unsigned)m_.spanCount,
+               TEMPCOMP_REF_KG);
+  }
+  const Drift &d = drift_;
+  if (d.points > 0) {
+    out.printf("temp: %lu zero points since boot, %.1f..%.1f C\n", (unsigned long)d.points, d.minC, d.maxC);
+    out.printf("temp: zero drift raw %+.1f..%+.1f g, compensated %+.1f..%+.1f g\n", d.rawMinG, d.rawMaxG,
+               d.compMinG, d.compMaxG);
+  }
+}
+
+bool TempComp::load(Model &m) {
+  m = Model();
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, true)) return false;
+  Blob blob;
+  const bool ok = prefs.getBytes(kKey, &blob, sizeof(blob)) == sizeof(blob) && blob.magic == kMagic &&
+                  blob.model.spanCount <= kMaxSpanPoints;
+  prefs.end();
+  if (ok) m = blob.model;
+  return ok;
+}
+
+bool TempComp::save(const Model &m) {
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) return false;
+  Blob blob;
+  blob.magic = kMagic;
+  blob.model = m;
+  const bool ok = prefs.putBytes(kKey, &blob, sizeof(blob)) == sizeof(blob);
+  prefs.end();
+  return ok;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Temperature compensation of the zero and span (ScaleManager).
+//
+// The bridge and the ADC drift with temperature: an empty tray tared at dawn
+// reads tens of grams by noon, and a load reads a little more or less. The
+// ADC's temperature sensor is read every TEMPCOMP_SAMPLE_MS between weighing
+// reads; while the FSM is idle the same read is a zero point, the empty
+// reading against the temperature, both relative to the last tare. A
+// regression over the zero points (exponential forgetting over
+// TEMPCOMP_MEMORY_POINTS) gives the zero slope; once it is trustworthy the
+// zero follows the temperature:
+//
+//   zero(T) = tare zero + zeroSlope * (T - tare temperature)
+//
+// The span cannot be learned from an empty tray: serial 's' with
+// TEMPCOMP_REF_KG on the platform records a span point (net counts, the
+// temperature and the tare it was taken against). Points at least
+// TEMPCOMP_SPAN_MIN_DELTA_C apart are refitted against the current zero
+// slope and replace the calibration factor with a line:
+//
+//   counts per gram(T) = spanCpg * (1 + spanSlope * (T - spanRefC))
+//
+// The model is per station and kept in NVS ("tempcomp"); the drift figures
+// (raw and compensated zero points in grams) are since boot.
+class TempComp {
+ public:
+  static constexpr uint8_t kMaxSpanPoints = 4;
+
+  struct Model {
+    // Weighted sums of the zero points, x = T - tare C, y = counts - tare zero.
+    double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint8_t spanCount = 0;
+    uint8_t spanNext = 0;  // oldest point, replaced when full
+    float spanC[kMaxSpanPoints] = {};
+    float spanTareC[kMaxSpanPoints] = {};
+    float spanNet[kMaxSpanPoints] = {};  // counts - tare zero
+    float spanRefG[kMaxSpanPoints] = {};
+  };
+
+  struct Drift {
+    uint32_t points = 0;
+    float minC = 0.0f, maxC = 0.0f;
+    float rawMinG = 0.0f, rawMaxG = 0.0f;    // empty reading since the tare
+    float compMinG = 0.0f, compMaxG = 0.0f;  // and with the zero slope applied
+  };
+
+  void setModel(const Model &m);
+  const Model &model() const { return m_; }
+
+  void setTare(float tempC) { tareC_ = tempC; }
+  float tareC() const { return tareC_; }
+
+  // Counts the empty reading has moved since the tare, at tempC.
+  float zeroShift(float tempC) const { return zeroSlope_ * (tempC - tareC_); }
+  // Counts per gram at tempC: the fitted span, calFactor until there is one.
+  float countsPerGram(float tempC, float calFactor) const {
+    return spanFitted() ? spanCpg_ * (1.0f + spanSlope_ * (tempC - spanRefC_)) : calFactor;
+  }
+
+  // An empty reading at tempC, residual = averaged counts - tare zero.
+  // calFactor turns it into grams for the drift figures.
+  void addZeroPoint(float tempC, float residualCounts, float calFactor);
+  // refGrams on the platform at tempC, netCounts = averaged counts - tare
+  // zero. False when it is not within 5% of calFactor (wrong mass, nothing
+  // on the platform): that is a calibration problem, not temperature.
+  bool addSpanPoint(float tempC, float netCounts, float refGrams, float calFactor);
+
+  bool zeroFitted() const { return zeroSlope_ != 0.0f; }
+  bool spanFitted() const { return spanCpg_ != 0.0f; }
+  float zeroSlope() const { return zeroSlope_; }  // counts per C
+  float spanSlope() const { return spanSlope_; }  // per C
+  const Drift &drift() const { return drift_; }
+
+  void printText(Print &out, float tempC, float calFactor) const;
+
+  // NVS ("tempcomp"); load() leaves m empty when nothing valid is stored.
+  static bool load(Model &m);
+  static bool save(const Model &m);
+
+ private:
+  void fitZero_();
+  void fitSpan_();
+
+  Model m_;
+  float countsPerGram_ = fabsf(SCALE_CAL_FACTOR_DEFAULT);  // for the slope limit
+  float tareC_ = 25.0f;
+  float zeroSlope_ = 0.0f;
+  float spanCpg_ = 0.0f;  // 0: no span fit
+  float spanSlope_ = 0.0f;
+  float spanRefC_ = 25.0f;
+  Drift drift_;
+};
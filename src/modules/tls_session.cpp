@@ -0,0 +1,79 @@
+#include "tls_session.h"
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+
+namespace {
+TlsSession::Stats g_stats = {0, 0, 0, 0, 0, UINT32_MAX};
+bool g_open = false;
+uint32_t g_freeBefore = 0;
+uint32_t g_freeConnected = 0;
+
+uint32_t freeHeap() { return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+
+WiFiClientSecure &client() {
+  static WiFiClientSecure c;
+  static bool configured = false;
+  if (!configured) {
+    c.setInsecure();  // avoids TLS cert issues; use CA cert if you want verification
+    configured = true;
+  }
+  return c;
+}
+} // namespace
+
+namespace TlsSession {
+
+WiFiClientSecure &acquire() {
+  WiFiClientSecure &c = client();  // built before the baseline: it stays
+  if (!g_open) {
+    g_open = true;
+    g_freeBefore = freeHeap();
+    g_freeConnected = 0;
+  }
+  return c;
+}
+
+bool open() { return g_open; }
+
+void sampleConnected() {
+  const uint32_t f = freeHeap();
+  if (g_freeConnected == 0 || f < g_freeConnected) g_freeConnected = f;
+}
+
+void release() {
+  if (!g_open) return;
+  client().stop();
+  g_open = false;
+
+  const uint32_t after = freeHeap();
+  g_stats.sessions++;
+  if (g_freeConnected != 0 && g_freeConnected < g_freeBefore) {
+    g_stats.lastInUse = g_freeBefore - g_freeConnected;
+    if (g_stats.lastInUse > g_stats.maxInUse) g_stats.maxInUse = g_stats.lastInUse;
+  }
+  g_stats.idleFree = after;
+  g_stats.lastRetained = (int32_t)(g_freeBefore - after);
+  const uint32_t stack = (uint32_t)uxTaskGetStackHighWaterMark(nullptr);
+  if (stack < g_stats.minLoopStack) g_stats.minLoopStack = stack;
+}
+
+Stats stats() { return g_stats; }
+
+void printReport(Print &out) {
+  if (g_stats.sessions == 0) {
+    out.printf("tls: no session yet\n");
+    return;
+  }
+  // Headroom: what is free with the stack released, and what would be left
+  // if the largest session seen so far were up right now.
+  const uint32_t idle = freeHeap();
+  const uint32_t during = idle > g_stats.maxInUse ? idle - g_stats.maxInUse : 0;
+  out.printf("tls: sessions %lu in_use last %lu max %lu retained %ld\n", (unsigned long)g_stats.sessions,
+             (unsigned long)g_stats.lastInUse, (unsigned long)g_stats.maxInUse, (long)g_stats.lastRetained);
+  out.printf("tls: free released %lu, during worst session %lu, loop stack min %lu\n", (unsigned long)idle,
+             (unsigned long)during, (unsigned long)g_stats.minLoopStack);
+}
+
+} // namespace TlsSession
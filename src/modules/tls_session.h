@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+
+class WiFiClientSecure;
+
+// The one TLS client for uploads and directory syncs.
+//
+// The client is built on the first exchange and kept: its own state is
+// small next to the mbedTLS record buffers, which connect() allocates and
+// stop() frees whether the object lives on or not. A Lease's destructor
+// stops the connection, so nothing of the TLS stack is held between
+// exchanges. Each session also measures what it cost (TLS plus the
+// exchange's HTTPClient), so the 'h' report shows the free-heap headroom the
+// device has while no exchange is running against the worst session seen.
+//
+// A session may be opened ahead of the exchange (the upload pre-warm, see
+// Uploader::prewarm()) with acquire(); a Lease taken while it is open uses
+// that client, connection included, and ends the session.
+namespace TlsSession {
+
+struct Stats {
+  uint32_t sessions;       // leases since boot
+  uint32_t lastInUse;      // heap held by the last session while connected
+  uint32_t maxInUse;       // largest of those
+  uint32_t idleFree;       // free heap after the last session was released
+  int32_t lastRetained;    // free heap lost across the last lease (leak check)
+  uint32_t minLoopStack;   // lowest loop-task stack headroom seen at release
+};
+
+// Opens a session if there is none and returns the client.
+WiFiClientSecure &acquire();
+bool open();
+// Call while the connection is up (after the handshake or the request);
+// the free heap then gives the session's cost.
+void sampleConnected();
+// Stops the connection (freeing the TLS buffers) and ends the session;
+// no-op without one.
+void release();
+
+class Lease {
+ public:
+  Lease() : client_(&acquire()) {}
+  ~Lease() { release(); }
+  Lease(const Lease &) = delete;
+  Lease &operator=(const Lease &) = delete;
+
+  WiFiClientSecure &client() { return *client_; }
+  void sampleConnected() { TlsSession::sampleConnected(); }
+
+ private:
+  WiFiClientSecure *client_;
+};
+
+Stats stats();
+void printReport(Print &out);
+
+} // namespace TlsSession
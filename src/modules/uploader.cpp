@@ -0,0 +1,263 @@
+#include "uploader.h"
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include "alloc_guard.h"
+#include "event_log.h"
+#include "id_directory.h"
+#include "metrics.h"
+#include "tls_session.h"
+#include "wifi_manager.h"
+
+void Uploader::begin(WiFiManager &wifi, int scaleId) {
+  wifi_ = &wifi;
+  scaleId_ = scaleId;
+}
+
+int Uploader::formatUrl(char *out, size_t n, int scaleId, const char *id, float kg) {
+  return snprintf(out, n, "%s/%d/%s/%d/%.2f", UPLOAD_BASE_URL, UPLOAD_ID, id, scaleId, kg);
+}
+
+bool Uploader::unsent(const Result &r) {
+  switch (r.status) {
+    case Status::NoWifi:
+    case Status::ConnectFailed:
+    case Status::BeginFailed:
+      return true;
+    case Status::GetFailed:
+      return r.httpCode == HTTPC_ERROR_CONNECTION_REFUSED || r.httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+             r.httpCode == HTTPC_ERROR_NOT_CONNECTED;
+    default:
+      return false;
+  }
+}
+
+bool Uploader::retryable(const Result &r) {
+  switch (r.status) {
+    case Status::ConnectFailed:
+    case Status::GetFailed:
+      return unsent(r);
+    case Status::HttpError:
+      return r.httpCode >= 500 || r.httpCode == 429;
+    default:
+      return false;
+  }
+}
+
+namespace {
+// A held socket the server closed while idle: the header write fails or
+// the socket is already gone. A connection lost after the GET went out is
+// not one; the server may have recorded it (as in flushOne()).
+bool staleHeld(const Uploader::Result &r) {
+  return r.status == Uploader::Status::GetFailed && Uploader::unsent(r);
+}
+} // namespace
+
+Uploader::Result Uploader::send(const char *id, float kg) {
+  char url[128];
+  formatUrl(url, sizeof(url), scaleId_, id, kg);
+
+  IdDirectory::Key key;
+  IdDirectory::parseUidHex(id, key);
+  LOG_EVENT(UploadStart, (uint32_t)key.uid[0] << 24 | key.uid[1] << 16 | key.uid[2] << 8 | key.uid[3],
+            (uint32_t)key.uid[4] << 24 | key.uid[5] << 16 | key.uid[6] << 8 | key.uid[7],
+            (uint32_t)lroundf(kg * 100.0f));
+  // The record above holds the first 8 bytes; RFID2 reads up to 10.
+  LOG_EVENT(UploadUid, (uint32_t)key.len, (uint32_t)key.uid[8] << 8 | key.uid[9]);
+
+  // HTTPClient keeps the URL in Strings and the TLS stack allocates its
+  // buffers per connection; those library allocations are expected here.
+  AllocGuard::Allow allow;
+  Metrics::ScopedTimer uploadTimer(Metrics::Upload);
+
+  Result r;
+  const uint8_t attempts = policy_.attempts > 0 ? policy_.attempts : 1;
+  for (uint8_t i = 0; i < attempts; ++i) {
+    if (i > 0) {
+      uint32_t waitMs = policy_.backoffMs << (i - 1);
+      waitMs += (uint32_t)random((long)(waitMs / 2 + 1));
+      LOG_EVENT(UploadRetry, (uint32_t)i, waitMs);
+      delay(waitMs);
+    }
+    if (wifi_ == nullptr || !wifi_->ensureConnected(WIFI_RECONNECT_TIMEOUT_MS)) {
+      LOG_EVENT(UploadNoWifi);
+      cancelPrewarm();
+      r.status = Status::NoWifi;
+      return r;
+    }
+    const uint8_t tried = r.attempts;
+    const bool wasWarm = warm();
+    r = attempt_(url);
+    if (wasWarm && staleHeld(r)) {
+      // The held connection had gone stale; that is not a failed attempt.
+      LOG_EVENT(UploadPrewarmStale);
+      r = attempt_(url);
+    }
+    r.attempts = tried + 1;
+    if (!retryable(r)) break;
+  }
+  return r;
+}
+
+bool Uploader::resolve_(IPAddress &ip) {
+  // The resolver does not hand out the record TTL, so answers are kept for
+  // UPLOAD_DNS_TTL_MS at most, and dropped when a connect to them fails.
+  if (resolved_ && millis() - resolvedMs_ < UPLOAD_DNS_TTL_MS) {
+    ip = hostIp_;
+    return true;
+  }
+  const unsigned long start = millis();
+  resolved_ = WiFi.hostByName(UPLOAD_HOST, hostIp_) == 1;
+  if (!resolved_) {
+    LOG_EVENT(UploadDnsFailed);
+    return false;
+  }
+  resolvedMs_ = millis();
+  LOG_EVENT(UploadDnsResolved, (uint32_t)hostIp_, (uint32_t)(resolvedMs_ - start));
+  ip = hostIp_;
+  return true;
+}
+
+bool Uploader::resolveHost() {
+  if (wifi_ == nullptr || !wifi_->isConnected()) return false;
+  IPAddress ip;
+  return resolve_(ip);
+}
+
+bool Uploader::connect_(WiFiClientSecure &client) {
+  IPAddress ip;
+  if (!resolve_(ip)) return false;
+  Metrics::ScopedTimer timer(Metrics::TlsConnect);
+  // By address, with the host name for SNI.
+  if (client.connect(ip, UPLOAD_PORT, UPLOAD_HOST, nullptr, nullptr, nullptr)) return true;
+  resolved_ = false;
+  return false;
+}
+
+bool Uploader::prewarm() {
+  if (warm()) return true;
+  if (wifi_ == nullptr || !wifi_->isConnected() || TlsSession::open()) return false;
+  AllocGuard::Allow allow;  // TLS buffers
+  const unsigned long start = millis();
+  WiFiClientSecure &client = TlsSession::acquire();
+  if (!connect_(client)) {
+    TlsSession::release();
+    LOG_EVENT(UploadConnectFailed);
+    return false;
+  }
+  TlsSession::sampleConnected();
+  warmSinceMs_ = millis();
+  if (warmSinceMs_ == 0) warmSinceMs_ = 1;
+  LOG_EVENT(UploadPrewarm, (uint32_t)(warmSinceMs_ - start));
+  return true;
+}
+
+void Uploader::cancelPrewarm() {
+  if (!warm()) return;
+  warmSinceMs_ = 0;
+  TlsSession::release();
+}
+
+void Uploader::loop() {
+  if (warm() && millis() - warmSinceMs_ >= UPLOAD_PREWARM_HOLD_MS) {
+    LOG_EVENT(UploadPrewarmExpired, (uint32_t)UPLOAD_PREWARM_HOLD_MS);
+    cancelPrewarm();
+  }
+}
+
+void Uploader::enqueue(const char *id, float kg) {
+  if (queueCount_ == UPLOAD_QUEUE_LEN) {
+    LOG_EVENT(UploadQueueDropped, 0u);
+    popQueued_();
+  }
+  Queued &q = queue_[(queueHead_ + queueCount_) % UPLOAD_QUEUE_LEN];
+  strncpy(q.id, id, sizeof(q.id) - 1);
+  q.id[sizeof(q.id) - 1] = '\0';
+  q.kg = kg;
+  q.ms = millis();
+  queueCount_++;
+  LOG_EVENT(UploadQueued, (uint32_t)queueCount_);
+}
+
+void Uploader::popQueued_() {
+  queueHead_ = (uint8_t)((queueHead_ + 1) % UPLOAD_QUEUE_LEN);
+  queueCount_--;
+}
+
+bool Uploader::flushOne() {
+  if (queueCount_ == 0) return false;
+  if (queueRetryMs_ != 0 && millis() - queueRetryMs_ < UPLOAD_QUEUE_RETRY_MS) return false;
+  const Queued &q = queue_[queueHead_];
+  const unsigned long weighedMs = q.ms;
+  const Result r = send(q.id, q.kg);
+  if (r.status == Status::Ok) {
+    popQueued_();
+    queueRetryMs_ = 0;
+    LOG_EVENT(UploadQueueSent, (uint32_t)(millis() - weighedMs), (uint32_t)queueCount_);
+    return true;
+  }
+  if (r.status == Status::HttpError && !retryable(r)) {
+    // The server will not take it later either.
+    popQueued_();
+    LOG_EVENT(UploadQueueDropped, 1u);
+    return true;
+  }
+  if (r.status != Status::HttpError && !unsent(r)) {
+    // A read timeout or a dropped connection after the GET went out: the
+    // server may have recorded it, so sending it again could duplicate it.
+    popQueued_();
+    queueRetryMs_ = 0;
+    LOG_EVENT(UploadQueueDropped, 2u);
+    return true;
+  }
+  queueRetryMs_ = millis();
+  if (queueRetryMs_ == 0) queueRetryMs_ = 1;
+  return false;
+}
+
+Uploader::Result Uploader::attempt_(const char *url) {
+  Result r;
+  warmSinceMs_ = 0;
+  TlsSession::Lease tls;  // takes over a pre-warmed connection
+  WiFiClientSecure &client = tls.client();
+
+  // Connect explicitly so the handshake is timed on its own; HTTPClient
+  // reuses an already connected client.
+  if (!client.connected()) {
+    if (!connect_(client)) {
+      LOG_EVENT(UploadConnectFailed);
+      r.status = Status::ConnectFailed;
+      return r;
+    }
+    tls.sampleConnected();
+  }
+
+  HTTPClient http;
+  if (!http.begin(client, url)) {
+    LOG_EVENT(UploadBeginFailed);
+    r.status = Status::BeginFailed;
+    return r;
+  }
+
+  http.setTimeout(UPLOAD_HTTP_TIMEOUT_MS);
+  const unsigned long getStartMs = millis();
+  {
+    Metrics::ScopedTimer timer(Metrics::HttpRequest);
+    r.httpCode = http.GET();
+  }
+  if (r.httpCode > 0) {
+    LOG_EVENT(UploadHttpStatus, (uint32_t)r.httpCode, (uint32_t)(millis() - getStartMs));
+    if (r.httpCode >= 200 && r.httpCode < 300) {
+      r.status = Status::Ok;
+    } else {
+      r.status = Status::HttpError;
+      LOG_EVENT(UploadBody, (uint32_t)http.getSize());
+    }
+  } else {
+    LOG_EVENT(UploadGetFailed, (uint32_t)r.httpCode);
+    r.status = Status::GetFailed;
+  }
+
+  http.end();
+  return r;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+#include "config.h"
+#include "rfid2.h"
+
+class WiFiManager;
+class WiFiClientSecure;
+
+// Weigh-in upload: GET <UPLOAD_BASE_URL>/<UPLOAD_ID>/<card>/<scale>/<kg>.
+//
+// send() blocks the caller: Wi-Fi check (one reconnect attempt), TLS connect,
+// GET. The GET records a weigh-in and is not idempotent, so only failures
+// where the request never reached the server (no connection, header not
+// written; see unsent()) and HTTP 5xx/429 are tried again, up to
+// Policy::attempts times, with a doubling backoff plus jitter. A read
+// timeout is final: the server may have recorded the weigh-in already. The fleet
+// load generator (src/host/fleet_main.cpp) runs this code for every
+// simulated scale.
+//
+// Pre-warm: resolveHost() looks UPLOAD_HOST up ahead of time (the answer is
+// kept for UPLOAD_DNS_TTL_MS) and prewarm() opens the TLS connection while
+// the station waits for the card, so the upload after the scan is only the
+// GET. The connection is held until send()
+// uses it, cancelPrewarm() drops it, or loop() finds it idle for
+// UPLOAD_PREWARM_HOLD_MS. When the held socket turns out to be closed (the
+// server dropped it while idle: not connected, header write failed, or
+// closed before any response byte) the request is sent once more on a fresh
+// connection; any other failure on it counts like one on a fresh one.
+//
+// Offline queue: a weigh-in that got NoWifi (it never left the station, so
+// there is no duplicate risk) can be enqueue()d into a RAM ring of
+// UPLOAD_QUEUE_LEN; flushOne() sends the oldest once Wi-Fi is back. The
+// queue does not survive a reboot.
+class Uploader {
+ public:
+  enum class Status : uint8_t { Ok, HttpError, NoWifi, ConnectFailed, BeginFailed, GetFailed };
+
+  struct Result {
+    Status status = Status::NoWifi;
+    int httpCode = 0;      // last HTTP status, or HTTPC_ERROR_* (< 0)
+    uint8_t attempts = 0;  // connects tried
+  };
+
+  struct Policy {
+    uint8_t attempts = UPLOAD_ATTEMPTS;
+    uint32_t backoffMs = UPLOAD_RETRY_BACKOFF_MS;
+  };
+
+  void begin(WiFiManager &wifi, int scaleId = UPLOAD_SCALE_ID);
+  const Policy &policy() const { return policy_; }
+  void setPolicy(const Policy &p) { policy_ = p; }
+
+  Result send(const char *id, float kg);
+
+  // Looks UPLOAD_HOST up unless the cached answer is still fresh.
+  bool resolveHost();
+  // Blocks for the DNS lookup (on a cache miss) and the TLS handshake;
+  // does nothing without Wi-Fi or when already warm. Returns true when a
+  // connection is up.
+  bool prewarm();
+  void cancelPrewarm();
+  bool warm() const { return warmSinceMs_ != 0; }
+  // Call from loop(): enforces the hold deadline.
+  void loop();
+
+  // Queues a weigh-in for later; drops the oldest when full.
+  void enqueue(const char *id, float kg);
+  uint8_t queued() const { return queueCount_; }
+  // Sends the oldest queued weigh-in unless the last try failed less than
+  // UPLOAD_QUEUE_RETRY_MS ago. It stays queued only when the request did not
+  // reach the server (unsent()) or got a 5xx/429. True when one left the
+  // queue (sent, rejected by the server, or dropped because it may have
+  // been recorded).
+  bool flushOne();
+
+  // URL for one weigh-in; returns the snprintf() length.
+  static int formatUrl(char *out, size_t n, int scaleId, const char *id, float kg);
+  static bool retryable(const Result &r);
+  // The request did not reach the server, so sending it again cannot
+  // record the weigh-in twice.
+  static bool unsent(const Result &r);
+
+ private:
+  struct Queued {
+    char id[RFID2::kIdLen];
+    float kg;
+    unsigned long ms;  // when it was weighed
+  };
+
+  Result attempt_(const char *url);
+  void popQueued_();
+  // Connects the session's client to UPLOAD_HOST via the DNS cache.
+  bool connect_(WiFiClientSecure &client);
+  bool resolve_(IPAddress &ip);
+
+  WiFiManager *wifi_ = nullptr;
+  int scaleId_ = UPLOAD_SCALE_ID;
+  Policy policy_;
+  unsigned long warmSinceMs_ = 0;  // 0: no pre-warmed connection
+  IPAddress hostIp_;
+  unsigned long resolvedMs_ = 0;
+  bool resolved_ = false;
+  Queued queue_[UPLOAD_QUEUE_LEN];
+  uint8_t queueHead_ = 0;  // oldest
+  uint8_t queueCount_ = 0;
+  unsigned long queueRetryMs_ = 0;  // last failed flush, 0: none
+};
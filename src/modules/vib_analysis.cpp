@@ -0,0 +1,267 @@
+#include "vib_analysis.h"
+#include <math.h>
+#include <algorithm>
+
+namespace {
+
+inline int16_t sat16(int32_t v) { return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v); }
+
+// Q15 multiply with rounding.
+inline int32_t mulQ15(int32_t a, int32_t b) { return (a * b + (1 << 14)) >> 15; }
+
+bool harmonicOf(float hz, float fundamentalHz) {
+  const float m = hz / fundamentalHz;
+  return m >= 1.5f && fabsf(m - roundf(m)) < 0.03f * roundf(m);
+}
+
+// Conversions per period of a vibration at hz when it is close enough to a
+// whole number for a comb; 0 otherwise.
+uint8_t combLen(float hz, float weighHz) {
+  const float a = VibAnalysis::aliasHz(hz, weighHz);
+  if (a < VIB_MIN_NOTCH_HZ) return 0;
+  const float period = weighHz / a;
+  const float len = roundf(period);
+  if (len < 2 || len > VibFilter::kMaxCombLen || fabsf(period - len) >= 0.03f * len) return 0;
+  return (uint8_t)len;
+}
+
+void addComb(VibFilter::Config &c, uint8_t len, float weighHz, float sourceHz) {
+  VibFilter::Stage &s = c.stages[c.count++];
+  s = VibFilter::Stage{};
+  s.kind = VibFilter::Kind::Comb;
+  s.combLen = len;
+  s.hz = weighHz / len;
+  s.sourceHz = sourceHz;
+}
+
+// A notch where sourceHz aliases to at weighHz, unless that is too close to
+// DC or Nyquist or already notched. False when no stage was added.
+bool addNotch(VibFilter::Config &c, float weighHz, float sourceHz) {
+  if (c.count >= VibFilter::kMaxStages) return false;
+  const float a = VibAnalysis::aliasHz(sourceHz, weighHz);
+  // Near DC a notch would take seconds to settle; at Nyquist it has no room.
+  if (a < VIB_MIN_NOTCH_HZ || a > weighHz / 2 - 0.1f) return false;
+  for (uint8_t j = 0; j < c.count; ++j) {
+    if (c.stages[j].kind == VibFilter::Kind::Notch && fabsf(c.stages[j].hz - a) < VIB_NOTCH_BW_HZ / 2) return false;
+  }
+  VibFilter::Stage &s = c.stages[c.count++];
+  s = VibFilter::Stage{};
+  s.kind = VibFilter::Kind::Notch;
+  s.hz = a;
+  s.q = fminf(fmaxf(a / VIB_NOTCH_BW_HZ, 0.7f), 8.0f);
+  s.sourceHz = sourceHz;
+  return true;
+}
+
+} // namespace
+
+namespace VibAnalysis {
+
+void makeCosTable(int16_t *cosTab, uint16_t n) {
+  for (uint16_t k = 0; k <= n / 2; ++k) {
+    cosTab[k] = sat16((int32_t)lroundf(32767.0f * cosf(2.0f * (float)M_PI * k / n)));
+  }
+}
+
+void fftQ15(int16_t *re, int16_t *im, uint8_t log2n, const int16_t *cosTab) {
+  const uint16_t n = (uint16_t)(1u << log2n);
+
+  // Bit-reversed order.
+  for (uint16_t i = 1, j = 0; i < n; ++i) {
+    uint16_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j |= bit;
+    if (i < j) {
+      std::swap(re[i], re[j]);
+      std::swap(im[i], im[j]);
+    }
+  }
+
+  // Butterflies; halving every stage keeps |x| < 1 without a guard bit.
+  for (uint16_t len = 2; len <= n; len <<= 1) {
+    const uint16_t half = len >> 1;
+    const uint16_t step = n / len;
+    for (uint16_t i = 0; i < n; i += len) {
+      for (uint16_t j = 0; j < half; ++j) {
+        const uint16_t k = j * step;
+        const int32_t wr = cosTab[k];
+        const int32_t wi = -cosTab[k > n / 4 ? k - n / 4 : n / 4 - k];  // -sin
+        const uint16_t a = i + j, b = a + half;
+        const int32_t tr = mulQ15(re[b], wr) - mulQ15(im[b], wi);
+        const int32_t ti = mulQ15(re[b], wi) + mulQ15(im[b], wr);
+        const int32_t ur = re[a], ui = im[a];
+        re[a] = sat16((ur + tr) >> 1);
+        im[a] = sat16((ui + ti) >> 1);
+        re[b] = sat16((ur - tr) >> 1);
+        im[b] = sat16((ui - ti) >> 1);
+      }
+    }
+  }
+}
+
+Spectrum::Spectrum(uint8_t log2n) : log2n_(log2n), n_((uint16_t)(1u << log2n)) {
+  re_ = new int16_t[n_];
+  im_ = new int16_t[n_];
+  cos_ = new int16_t[n_ / 2 + 1];
+  power_ = new float[n_ / 2];
+  makeCosTable(cos_, n_);
+  for (uint16_t k = 0; k < n_ / 2; ++k) power_[k] = 0.0f;
+}
+
+Spectrum::~Spectrum() {
+  delete[] re_;
+  delete[] im_;
+  delete[] cos_;
+  delete[] power_;
+}
+
+void Spectrum::addBlock(const int32_t *counts) {
+  int64_t sum = 0;
+  for (uint16_t i = 0; i < n_; ++i) sum += counts[i];
+  const int32_t mean = (int32_t)(sum / n_);
+
+  // Hann window on the deviations, then a block exponent so the largest
+  // value uses 14 bits.
+  auto windowed = [&](uint16_t i) -> int64_t {
+    const uint16_t c = i <= n_ / 2 ? i : n_ - i;
+    const int32_t w = (32767 - cos_[c]) >> 1;
+    return ((int64_t)(counts[i] - mean) * w) >> 15;
+  };
+  int64_t peak = 0;
+  for (uint16_t i = 0; i < n_; ++i) peak = std::max(peak, (int64_t)llabs(windowed(i)));
+  uint8_t shift = 0;
+  while ((peak >> shift) >= (1 << 14)) shift++;
+  for (uint16_t i = 0; i < n_; ++i) {
+    re_[i] = (int16_t)(windowed(i) >> shift);
+    im_[i] = 0;
+  }
+
+  fftQ15(re_, im_, log2n_, cos_);
+
+  const float scale = (float)(1ull << (2 * shift));
+  for (uint16_t k = 0; k < n_ / 2; ++k) {
+    power_[k] += ((float)re_[k] * re_[k] + (float)im_[k] * im_[k]) * scale;
+  }
+  blocks_++;
+}
+
+Result Spectrum::peaks(float sampleHz, float countsPerGram) const {
+  Result r;
+  r.sampleHz = sampleHz;
+  r.blocks = blocks_;
+  if (blocks_ == 0 || countsPerGram <= 0.0f) return r;
+
+  const uint16_t bins = n_ / 2;
+  const float binHz = sampleHz / n_;
+  float *sorted = new float[bins];
+  for (uint16_t k = 0; k < bins; ++k) sorted[k] = power_[k] / blocks_;
+  std::nth_element(sorted + 1, sorted + bins / 2, sorted + bins);
+  const float median = fmaxf(sorted[bins / 2], 1e-6f);
+  delete[] sorted;
+
+  // An on-bin sine of amplitude A gives |X/n| = A/4 with the Hann window;
+  // summed over the main lobe the energy is 3/32 A^2 whatever the offset.
+  r.floorG = 4.0f * sqrtf(median) / countsPerGram;
+  auto p = [&](int k) { return power_[k] / blocks_; };
+
+  const int kMin = std::max(2, (int)ceilf(VIB_MIN_HZ / binHz));
+  for (int k = kMin; k < bins - 2; ++k) {
+    // A local maximum over the Hann main lobe (+-2 bins), so leakage next
+    // to a stronger peak is not a peak of its own.
+    if (!(p(k) > p(k - 1) && p(k) > p(k - 2) && p(k) >= p(k + 1) && p(k) >= p(k + 2))) continue;
+    if (p(k) < median * VIB_PEAK_RATIO) continue;
+    float lobe = 0.0f;
+    for (int j = k - 2; j <= k + 2; ++j) lobe += p(j);
+    Peak pk;
+    pk.amplitudeG = sqrtf(lobe * 32.0f / 3.0f) / countsPerGram;
+    if (pk.amplitudeG < VIB_MIN_AMPLITUDE_G) continue;
+    const float la = logf(p(k - 1) + 1e-6f), lb = logf(p(k) + 1e-6f), lc = logf(p(k + 1) + 1e-6f);
+    const float den = la - 2.0f * lb + lc;
+    const float delta = den != 0.0f ? 0.5f * (la - lc) / den : 0.0f;
+    pk.hz = (k + delta) * binHz;
+    pk.snrDb = 10.0f * log10f(p(k) / median);
+
+    // Keep the strongest kMaxPeaks, in descending amplitude.
+    uint8_t at = r.count;
+    while (at > 0 && r.peaks[at - 1].amplitudeG < pk.amplitudeG) at--;
+    if (at >= kMaxPeaks) continue;
+    const uint8_t last = r.count < kMaxPeaks ? r.count : kMaxPeaks - 1;
+    for (uint8_t i = last; i > at; --i) r.peaks[i] = r.peaks[i - 1];
+    r.peaks[at] = pk;
+    if (r.count < kMaxPeaks) r.count++;
+  }
+  return r;
+}
+
+float aliasHz(float hz, float sampleHz) {
+  const float f = fmodf(hz, sampleHz);
+  return f > sampleHz / 2 ? sampleHz - f : f;
+}
+
+VibFilter::Config design(const Result &r, float weighHz) {
+  VibFilter::Config c;
+  if (r.count == 0 || weighHz <= 0.0f) return c;
+  bool covered[kMaxPeaks] = {};
+
+  // A fundamental whose period is a whole number of conversions, with a
+  // harmonic present: one comb cancels them all.
+  const Peak &p0 = r.peaks[0];
+  const uint8_t len = combLen(p0.hz, weighHz);
+  bool harmonic = false;
+  for (uint8_t i = 1; i < r.count; ++i) harmonic |= harmonicOf(r.peaks[i].hz, p0.hz);
+  if (harmonic && len != 0) {
+    addComb(c, len, weighHz, p0.hz);
+    const float combHz = c.stages[0].hz;
+    for (uint8_t i = 0; i < r.count; ++i) {
+      // The comb nulls every multiple of weighHz / len.
+      const float a = aliasHz(r.peaks[i].hz, weighHz) / combHz;
+      covered[i] = fabsf(a - roundf(a)) * combHz < VIB_NOTCH_BW_HZ / 2 && roundf(a) >= 1;
+    }
+  }
+
+  for (uint8_t i = 0; i < r.count && c.count < VibFilter::kMaxStages; ++i) {
+    if (!covered[i]) addNotch(c, weighHz, r.peaks[i].hz);
+  }
+  return c;
+}
+
+VibFilter::Config retune(const VibFilter::Config &c, float weighHz) {
+  VibFilter::Config out;
+  if (weighHz <= 0.0f) return out;
+  for (uint8_t i = 0; i < c.count && i < VibFilter::kMaxStages; ++i) {
+    const VibFilter::Stage &s = c.stages[i];
+    if (s.kind == VibFilter::Kind::Comb) {
+      const uint8_t len = combLen(s.sourceHz, weighHz);
+      if (len != 0) {
+        addComb(out, len, weighHz, s.sourceHz);
+        continue;
+      }
+    }
+    addNotch(out, weighHz, s.sourceHz);
+  }
+  return out;
+}
+
+void printResult(Print &out, const Result &r, const VibFilter::Config &c, float weighHz) {
+  out.printf("vib: %u blocks at %.0f SPS, %u conversions missed, floor %.2f g\n", (unsigned)r.blocks, r.sampleHz,
+             (unsigned)r.missed, r.floorG);
+  if (r.count == 0) out.printf("vib: no vibration above %.1f g\n", (double)VIB_MIN_AMPLITUDE_G);
+  for (uint8_t i = 0; i < r.count; ++i) {
+    const Peak &p = r.peaks[i];
+    const float a = aliasHz(p.hz, weighHz);
+    const char *action = "not filtered (too close to DC or Nyquist)";
+    for (uint8_t j = 0; j < c.count; ++j) {
+      const VibFilter::Stage &s = c.stages[j];
+      if (s.kind == VibFilter::Kind::Comb) {
+        const float m = a / s.hz;
+        if (roundf(m) >= 1 && fabsf(m - roundf(m)) * s.hz < VIB_NOTCH_BW_HZ / 2) action = "comb";
+      } else if (fabsf(s.hz - a) < VIB_NOTCH_BW_HZ / 2) {
+        action = "notch";
+      }
+    }
+    out.printf("vib: %6.2f Hz  %6.1f g  %4.0f dB  -> %5.2f Hz at %.0f SPS: %s\n", p.hz, p.amplitudeG, p.snrDb, a,
+               weighHz, action);
+  }
+}
+
+} // namespace VibAnalysis
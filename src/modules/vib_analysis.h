@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "vib_filter.h"
+
+// Vibration diagnostic (serial 'v'): spectra of high-rate conversion blocks
+// and the VibFilter stages that cancel what they show.
+//
+// measure() takes VIB_BLOCKS blocks of 2^VIB_FFT_LOG2N conversions at the
+// ADC's fastest rate with a load on the platform, runs a Hann-windowed
+// fixed-point FFT (Q15, scaled by 1/2 per stage, block exponent per block)
+// on each and averages the power spectra. Peaks well above the median bin
+// and above VIB_MIN_AMPLITUDE_G are the vibration; design() turns them into
+// notch or comb stages at the weighing rate. Working buffers (~6 KB) live
+// only for the measurement.
+namespace VibAnalysis {
+
+constexpr uint8_t kMaxPeaks = 4;
+
+struct Peak {
+  float hz;
+  float amplitudeG;  // sine amplitude
+  float snrDb;       // over the median bin
+};
+
+struct Result {
+  float sampleHz = 0.0f;
+  uint16_t blocks = 0;
+  uint16_t missed = 0;  // conversions lost during capture
+  float floorG = 0.0f;  // median bin as a sine amplitude
+  uint8_t count = 0;
+  Peak peaks[kMaxPeaks] = {};
+};
+
+// In place, re/im Q15, n = 2^log2n; the result is the DFT divided by n.
+// cosTab holds n/2 + 1 entries of cos(2*pi*k/n) in Q15 (makeCosTable()).
+void fftQ15(int16_t *re, int16_t *im, uint8_t log2n, const int16_t *cosTab);
+void makeCosTable(int16_t *cosTab, uint16_t n);
+
+// Averaged power spectrum of conversion blocks.
+class Spectrum {
+ public:
+  explicit Spectrum(uint8_t log2n = VIB_FFT_LOG2N);
+  ~Spectrum();
+  Spectrum(const Spectrum &) = delete;
+  Spectrum &operator=(const Spectrum &) = delete;
+
+  bool ok() const { return power_ != nullptr; }
+  uint16_t size() const { return n_; }
+  void addBlock(const int32_t *counts);
+  // Peaks of the blocks added so far, strongest first.
+  Result peaks(float sampleHz, float countsPerGram) const;
+
+ private:
+  uint8_t log2n_;
+  uint16_t n_;
+  uint16_t blocks_ = 0;
+  int16_t *re_ = nullptr;
+  int16_t *im_ = nullptr;
+  int16_t *cos_ = nullptr;
+  float *power_ = nullptr;  // n/2 bins, in counts^2 (block exponent undone)
+};
+
+// Where a vibration at hz shows up when sampled at sampleHz (0 .. sampleHz/2).
+float aliasHz(float hz, float sampleHz);
+// Stages for the weighing rate (weighHz) against r's peaks.
+VibFilter::Config design(const Result &r, float weighHz);
+// c's stages re-derived for another weighing rate from the vibration each
+// was made for (Stage::sourceHz): notches move to the new alias, a comb
+// gets the new conversions per period. A comb that no longer fits becomes
+// a notch on its fundamental (its harmonics need a new 'v' run); a stage
+// whose alias lands too close to DC or Nyquist is dropped.
+VibFilter::Config retune(const VibFilter::Config &c, float weighHz);
+void printResult(Print &out, const Result &r, const VibFilter::Config &c, float weighHz);
+
+// Captures and analyses blocks through a ScaleManager (BasicScale<Adc>).
+// False when the buffers could not be allocated or a capture failed.
+template <typename Scale>
+bool measure(Scale &scale, Result &out, uint8_t blocks = VIB_BLOCKS) {
+  Spectrum spectrum;
+  int32_t *block = spectrum.ok() ? new int32_t[spectrum.size()] : nullptr;
+  if (block == nullptr) return false;
+  float hz = 0.0f;
+  uint16_t missed = 0;
+  bool ok = true;
+  for (uint8_t b = 0; b < blocks && ok; ++b) {
+    uint16_t m = 0;
+    ok = scale.captureRaw(block, spectrum.size(), hz, m);
+    missed += m;
+    if (ok) spectrum.addBlock(block);
+  }
+  delete[] block;
+  if (!ok) return false;
+  out = spectrum.peaks(hz, fabsf(scale.calFactor()));
+  out.missed = missed;
+  return true;
+}
+
+} // namespace VibAnalysis
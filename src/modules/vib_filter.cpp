@@ -0,0 +1,121 @@
+#include "vib_filter.h"
+#include <Preferences.h>
+#include <math.h>
+
+namespace {
+constexpr const char *kNamespace = "vibfilter";
+constexpr const char *kKey = "cfg";
+constexpr uint32_t kMagic = 0x56494231;  // "VIB1"
+
+struct Blob {
+  uint32_t magic;
+  VibFilter::Config cfg;
+};
+} // namespace
+
+void VibFilter::configure(const Config &c, float sampleHz) {
+  cfg_ = Config();
+  sampleHz_ = sampleHz;
+  periodUs_ = sampleHz > 0.0f ? (uint32_t)lroundf(1e6f / sampleHz) : 0;
+  bool haveComb = false;
+  for (uint8_t i = 0; i < c.count && i < kMaxStages; ++i) {
+    const Stage &s = c.stages[i];
+    if (s.kind == Kind::Comb) {
+      // One comb buffer; a second comb would only repeat the first's nulls.
+      if (haveComb || s.combLen < 2 || s.combLen > kMaxCombLen) continue;
+      haveComb = true;
+    } else if (s.kind == Kind::Notch) {
+      if (s.hz <= 0.0f || s.hz >= sampleHz / 2 || s.q <= 0.0f) continue;
+      // RBJ notch, normalised by a0.
+      const float w0 = 2.0f * (float)M_PI * s.hz / sampleHz;
+      const float alpha = sinf(w0) / (2.0f * s.q);
+      const float a0 = 1.0f + alpha;
+      Biquad &b = biquads_[cfg_.count];
+      b.b0 = 1.0f / a0;
+      b.b1 = -2.0f * cosf(w0) / a0;
+      b.b2 = 1.0f / a0;
+      b.a1 = b.b1;
+      b.a2 = (1.0f - alpha) / a0;
+    } else {
+      continue;
+    }
+    cfg_.stages[cfg_.count++] = s;
+  }
+  primed_ = false;
+}
+
+void VibFilter::prime_(float x, uint32_t nowUs) {
+  // Steady state for a constant input: every stage passes DC unchanged.
+  ref_ = x;
+  for (Biquad &b : biquads_) b.x1 = b.x2 = b.y1 = b.y2 = 0.0f;
+  for (float &v : comb_) v = 0.0f;
+  combSum_ = 0.0f;
+  combIdx_ = 0;
+  lastUs_ = nowUs;
+  primed_ = true;
+}
+
+float VibFilter::step(float x, uint32_t nowUs) {
+  if (cfg_.count == 0) return x;
+  if (!primed_ || nowUs - lastUs_ > periodUs_ + periodUs_ / 2) prime_(x, nowUs);
+  lastUs_ = nowUs;
+
+  float v = x - ref_;
+  for (uint8_t i = 0; i < cfg_.count; ++i) {
+    const Stage &s = cfg_.stages[i];
+    if (s.kind == Kind::Comb) {
+      combSum_ += v - comb_[combIdx_];
+      comb_[combIdx_] = v;
+      combIdx_ = (uint8_t)((combIdx_ + 1) % s.combLen);
+      v = combSum_ / s.combLen;
+    } else {
+      Biquad &b = biquads_[i];
+      const float y = b.b0 * v + b.b1 * b.x1 + b.b2 * b.x2 - b.a1 * b.y1 - b.a2 * b.y2;
+      b.x2 = b.x1;
+      b.x1 = v;
+      b.y2 = b.y1;
+      b.y1 = y;
+      v = y;
+    }
+  }
+  return v + ref_;
+}
+
+void VibFilter::printText(Print &out) const {
+  if (cfg_.count == 0) {
+    out.printf("vib: filter off\n");
+    return;
+  }
+  for (uint8_t i = 0; i < cfg_.count; ++i) {
+    const Stage &s = cfg_.stages[i];
+    if (s.kind == Kind::Comb) {
+      out.printf("vib: stage %u comb %u conversions (%.2f Hz and harmonics) for %.2f Hz\n", (unsigned)i,
+                 (unsigned)s.combLen, sampleHz_ / s.combLen, s.sourceHz);
+    } else {
+      out.printf("vib: stage %u notch %.2f Hz Q %.1f for %.2f Hz\n", (unsigned)i, s.hz, s.q, s.sourceHz);
+    }
+  }
+}
+
+bool VibFilter::load(Config &c) {
+  c = Config();
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, true)) return false;
+  Blob blob;
+  const bool ok = prefs.getBytes(kKey, &blob, sizeof(blob)) == sizeof(blob) && blob.magic == kMagic &&
+                  blob.cfg.count <= kMaxStages;
+  prefs.end();
+  if (ok) c = blob.cfg;
+  return ok;
+}
+
+bool VibFilter::save(const Config &c) {
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) return false;
+  Blob blob;
+  blob.magic = kMagic;
+  blob.cfg = c;
+  const bool ok = prefs.putBytes(kKey, &blob, sizeof(blob)) == sizeof(blob);
+  prefs.end();
+  return ok;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Vibration stages in front of the weighing average (ScaleManager).
+//
+// Each weighing conversion goes through up to kMaxStages stages before it is
+// averaged: notches (biquad, unity gain at DC) at a vibration frequency, or a
+// comb (moving average over one vibration period, which also cancels its
+// harmonics). The stages run at the conversion rate, so a vibration faster
+// than half that rate is notched where it aliases to. The 'v' diagnostic
+// (vib_analysis.h) picks the stages and stores them in NVS; they are loaded
+// at boot. Without stages step() returns its input.
+class VibFilter {
+ public:
+  static constexpr uint8_t kMaxStages = 3;
+  static constexpr uint8_t kMaxCombLen = 32;
+
+  enum class Kind : uint8_t { Notch = 1, Comb = 2 };
+
+  struct Stage {
+    Kind kind;
+    uint8_t combLen;  // Comb: conversions per period
+    float hz;         // Notch: centre at the conversion rate (alias)
+    float q;          // Notch: centre / -3 dB width
+    float sourceHz;   // the vibration it was made for (report only)
+  };
+
+  struct Config {
+    uint8_t count = 0;
+    Stage stages[kMaxStages] = {};
+  };
+
+  // sampleHz: rate step() is called at while weighing.
+  void configure(const Config &c, float sampleHz);
+  const Config &config() const { return cfg_; }
+  bool active() const { return cfg_.count > 0; }
+
+  // One conversion in, filtered conversion out. A gap of more than one and
+  // a half conversion periods since the last call (other work, a rate
+  // change) restarts the stages from this sample.
+  float step(float x, uint32_t nowUs);
+  void reset() { primed_ = false; }
+
+  void printText(Print &out) const;
+
+  // NVS ("vibfilter"); load() leaves c empty when nothing valid is stored.
+  static bool load(Config &c);
+  static bool save(const Config &c);
+
+ private:
+  struct Biquad {
+    float b0, b1, b2, a1, a2;
+    float x1, x2, y1, y2;
+  };
+
+  void prime_(float x, uint32_t nowUs);
+
+  Config cfg_;
+  float sampleHz_ = 0.0f;
+  uint32_t periodUs_ = 0;
+  Biquad biquads_[kMaxStages] = {};
+  float comb_[kMaxCombLen] = {};
+  float combSum_ = 0.0f;
+  uint8_t combIdx_ = 0;
+  float ref_ = 0.0f;  // stages run on x - ref_ to keep float precision
+  uint32_t lastUs_ = 0;
+  bool primed_ = false;
+};
@@ -0,0 +1,142 @@
+#include "weigh_fsm.h"
+#include <math.h>
+
+namespace {
+
+using F = WeighFsm;
+
+// Rows for one state are tried in order; the first guard that holds fires.
+constexpr F::Transition kTable[] = {
+    {F::Idle,         F::IsPresent,  F::Weighing,     F::LoadPlaced,  F::ClearBuffer | F::StartWeighing},
+
+    // Losing the load wins over a commit in the same iteration.
+    {F::Weighing,     F::IsAbsent,   F::Idle,         F::LoadLost,    0},
+    {F::Weighing,     F::IsSettled,  F::AskId,        F::Stable,      F::Commit},
+    // Fallback: use buffer mean if not stable before timeout
+    {F::Weighing,     F::IsTimedOut, F::AskId,        F::TimedOut,    F::Commit},
+
+    // Restart weighing if weight changes a lot while waiting for ID
+    {F::AskId,        F::IsChanged,  F::Weighing,     F::Reweigh,     F::ClearBuffer | F::StartWeighing},
+    {F::AskId,        F::IsIdReady,  F::AwaitRemoval, F::IdBound,     0},
+    // Weight returned to zero and stayed there without a scan
+    {F::AskId,        F::IsZeroHeld, F::Idle,         F::NoIdTimeout, 0},
+
+    // New weighing cycle if weight changes while waiting for removal
+    {F::AwaitRemoval, F::IsChanged,  F::Weighing,     F::Reweigh,     F::ClearBuffer | F::StartWeighing},
+    {F::AwaitRemoval, F::IsZero,     F::Idle,         F::Removed,     F::ClearBuffer},
+};
+
+constexpr const char *kStateNames[F::kStateCount] = {"idle", "weighing", "ask_id", "await_removal"};
+constexpr const char *kEventNames[F::kEventCount] = {
+    "none", "load_placed", "stable", "timed_out", "load_lost", "reweigh", "id_bound", "no_id_timeout", "removed",
+};
+
+} // namespace
+
+const char *WeighFsm::stateName(State s) { return s < kStateCount ? kStateNames[s] : "?"; }
+const char *const *WeighFsm::stateNames() { return kStateNames; }
+const char *WeighFsm::eventName(Event e) { return e < kEventCount ? kEventNames[e] : "?"; }
+
+void WeighFsm::reset() {
+  state_ = Idle;
+  clear_();
+  for (bool &on : timerOn_) on = false;
+}
+
+float WeighFsm::stddev() const {
+  if (cnt_ <= 1) return 1e9f;
+  // Two passes: sum2/n - mean^2 in float loses the few grams that matter
+  // under a 20 kg load.
+  const float m = mean();
+  float var = 0.0f;
+  for (int i = 0; i < cnt_; ++i) var += (buf_[i] - m) * (buf_[i] - m);
+  return sqrtf(var / cnt_);
+}
+
+float WeighFsm::mean() const {
+  if (cnt_ == 0) return 0.0f;
+  float sum = 0.0f;
+  for (int i = 0; i < cnt_; ++i) sum += buf_[i];
+  return sum / cnt_;
+}
+
+void WeighFsm::push_(float kg) {
+  buf_[idx_] = kg;
+  idx_ = (idx_ + 1) % kBufN;
+  if (cnt_ < kBufN) cnt_++;
+}
+
+void WeighFsm::startTimer_(Timer t, unsigned long nowMs) {
+  timerStartMs_[t] = nowMs;
+  timerOn_[t] = true;
+}
+
+bool WeighFsm::expired_(Timer t, unsigned long nowMs, uint32_t ms) const {
+  return timerOn_[t] && nowMs - timerStartMs_[t] >= ms;
+}
+
+// Timers that run while in a state, before its guards are evaluated.
+void WeighFsm::runTimers_(const Inputs &in) {
+  if (state_ == Weighing) {
+    if (stddev() >= params_.stableStddevKg) {
+      stopTimer_(StableTimer);
+    } else if (!timerOn_[StableTimer]) {
+      startTimer_(StableTimer, in.nowMs);
+    }
+  } else if (state_ == AskId) {
+    if (!in.zero) {
+      stopTimer_(ZeroTimer);
+    } else if (!timerOn_[ZeroTimer]) {
+      startTimer_(ZeroTimer, in.nowMs);
+    }
+  }
+}
+
+bool WeighFsm::guard_(Guard g, const Inputs &in) const {
+  switch (g) {
+    case IsPresent: return in.present;
+    case IsAbsent: return !in.present;
+    case IsChanged: return in.present && fabsf(in.kg - stableKg_) > params_.detectKg;
+    case IsSettled: return expired_(StableTimer, in.nowMs, params_.stableMinMs);
+    case IsTimedOut: return in.present && expired_(WeighingTimer, in.nowMs, params_.weighingTimeoutMs);
+    case IsIdReady: return in.idReady;
+    case IsZeroHeld: return expired_(ZeroTimer, in.nowMs, params_.noIdZeroTimeoutMs);
+    case IsZero: return in.zero;
+  }
+  return false;
+}
+
+void WeighFsm::apply_(const Transition &t, unsigned long nowMs) {
+  if (t.effects & ClearBuffer) clear_();
+  if (t.effects & StartWeighing) {
+    startTimer_(WeighingTimer, nowMs);
+    stopTimer_(StableTimer);
+  }
+  if (t.effects & Commit) {
+    stableKg_ = mean();
+    stopTimer_(ZeroTimer);
+  }
+  state_ = t.to;
+}
+
+WeighFsm::Event WeighFsm::update(float kg, unsigned long nowMs, bool idReady) {
+  const float absKg = fabsf(kg);
+
+  // Anything at or below minEffectiveKg (tray) behaves as zero
+  Inputs in;
+  in.kg = kg;
+  in.nowMs = nowMs;
+  in.present = absKg > fmaxf(params_.detectKg, params_.minEffectiveKg);
+  in.zero = absKg <= fmaxf(params_.zeroKg, params_.minEffectiveKg);
+  in.idReady = idReady;
+
+  push_(kg);
+  runTimers_(in);
+
+  for (const Transition &t : kTable) {
+    if (t.from != state_ || !guard_(t.guard, in)) continue;
+    apply_(t, nowMs);
+    return t.event;
+  }
+  return None;
+}
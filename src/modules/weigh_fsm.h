@@ -0,0 +1,126 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Stability filter and weigh-in state machine, without display or network.
+//
+// loop() feeds one weight per iteration and acts on the returned event
+// (LCD text, upload). The host tools (src/host/replay_main.cpp,
+// src/host/sim_main.cpp) run the same class over recorded traces and
+// synthetic scenarios.
+//
+// Transitions are rows of a table: (state, guard) -> (next state, event,
+// effects). For the current state the rows are tried in order and the first
+// guard that holds fires; at most one transition per update(). Timers
+// (stable, weighing, zero) are kept here against the caller's clock, so the
+// FSM does not depend on the loop period.
+class WeighFsm {
+ public:
+  enum State : uint8_t { Idle, Weighing, AskId, AwaitRemoval, kStateCount };
+
+  // Output of update(): what happened, for the caller's side effects.
+  enum Event : uint8_t {
+    None,
+    LoadPlaced,   // Idle -> Weighing
+    Stable,       // Weighing -> AskId, stddev below threshold for stableMinMs
+    TimedOut,     // Weighing -> AskId, buffer mean after weighingTimeoutMs
+    LoadLost,     // Weighing -> Idle
+    Reweigh,      // AskId/AwaitRemoval -> Weighing, load changed
+    IdBound,      // AskId -> AwaitRemoval, caller uploads stableKg()
+    NoIdTimeout,  // AskId -> Idle, load removed without a scan
+    Removed,      // AwaitRemoval -> Idle
+    kEventCount
+  };
+
+  // Transition guards, evaluated on the current weight.
+  enum Guard : uint8_t {
+    IsPresent,     // above max(detectKg, minEffectiveKg)
+    IsAbsent,
+    IsChanged,     // present and off the committed weight by > detectKg
+    IsSettled,     // stable timer ran stableMinMs
+    IsTimedOut,    // weighing timer ran weighingTimeoutMs while present
+    IsIdReady,     // caller has a scan to bind
+    IsZeroHeld,    // zero timer ran noIdZeroTimeoutMs
+    IsZero,        // at or below max(zeroKg, minEffectiveKg)
+  };
+
+  enum Timer : uint8_t { StableTimer, WeighingTimer, ZeroTimer, kTimerCount };
+
+  // Transition effects (bit mask).
+  enum Effect : uint8_t {
+    ClearBuffer = 0x01,    // drop buffered weights
+    StartWeighing = 0x02,  // weighing timer from now, stable timer off
+    Commit = 0x04,         // stableKg() = buffer mean, zero timer off
+  };
+
+  struct Transition {
+    State from;
+    Guard guard;
+    State to;
+    Event event;
+    uint8_t effects;
+  };
+
+  struct Params {
+    float detectKg = WEIGHT_DETECT_THRESHOLD_KG;
+    float zeroKg = ZERO_THRESHOLD_KG;
+    float stableStddevKg = STABLE_STDDEV_KG;
+    float minEffectiveKg = MIN_EFFECTIVE_WEIGHT_KG;
+    uint32_t stableMinMs = STABLE_MIN_MS;
+    uint32_t weighingTimeoutMs = WEIGHING_TIMEOUT_MS;
+    uint32_t noIdZeroTimeoutMs = NO_ID_ZERO_TIMEOUT_MS;
+  };
+
+  static constexpr int kBufN = 10;
+
+  WeighFsm() = default;
+  explicit WeighFsm(const Params &p) : params_(p) {}
+
+  // One loop iteration. idReady: a scan is waiting to be bound (AskId only).
+  // After Stable/TimedOut, a second call with the same reading and idReady
+  // binds a scan that was already waiting in the same iteration.
+  Event update(float kg, unsigned long nowMs, bool idReady);
+
+  // Back to Idle with an empty buffer (after a tare).
+  void reset();
+
+  State state() const { return state_; }
+  float stableKg() const { return stableKg_; }
+  float stddev() const;
+  float mean() const;
+  const Params &params() const { return params_; }
+  void setParams(const Params &p) { params_ = p; }
+
+  static const char *stateName(State s);
+  static const char *const *stateNames();  // kStateCount entries
+  static const char *eventName(Event e);
+
+ private:
+  struct Inputs {
+    float kg;
+    unsigned long nowMs;
+    bool present;
+    bool zero;
+    bool idReady;
+  };
+
+  bool guard_(Guard g, const Inputs &in) const;
+  void runTimers_(const Inputs &in);
+  void apply_(const Transition &t, unsigned long nowMs);
+
+  void startTimer_(Timer t, unsigned long nowMs);
+  void stopTimer_(Timer t) { timerOn_[t] = false; }
+  bool expired_(Timer t, unsigned long nowMs, uint32_t ms) const;
+
+  void push_(float kg);
+  void clear_() { idx_ = cnt_ = 0; }
+
+  Params params_;
+  State state_ = Idle;
+  float buf_[kBufN] = {};
+  int idx_ = 0;
+  int cnt_ = 0;
+  unsigned long timerStartMs_[kTimerCount] = {};
+  bool timerOn_[kTimerCount] = {};
+  float stableKg_ = 0.0f;
+};
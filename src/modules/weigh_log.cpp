@@ -0,0 +1,573 @@
+#include "weigh_log.h"
+
+#include <LittleFS.h>
+#include <stddef.h>
+#include <time.h>
+#include <algorithm>
+#include "event_log.h"
+
+namespace {
+constexpr uint32_t kMagic = 0x4c574346;  // "FCWL"
+constexpr const char *kMetaPath = WEIGHLOG_DIR "/meta.bin";
+constexpr const char *kCardsPath = WEIGHLOG_DIR "/cards.bin";
+constexpr uint32_t kMinValidS = 1600000000UL;  // SNTP not answered yet below this
+constexpr uint16_t kCardReadChunk = 16;
+
+struct Meta {
+  uint32_t magic;
+  uint16_t recordSize;
+  uint16_t segmentRecords;
+  uint32_t firstSegment;
+};
+
+static_assert(sizeof(WeighLog::Record) == 12, "record layout");
+static_assert(sizeof(WeighLog::CardEntry) == 16, "card entry layout");
+static_assert(WEIGHLOG_SEGMENT_RECORDS % WeighLog::kBlockRecords == 0, "segments hold whole blocks");
+static_assert(WEIGHLOG_MAX_CARDS <= 32 * WeighLog::kTotalsWindow, "totals window mask");
+static_assert(WEIGHLOG_MAX_CARDS < 0x7FFF, "card numbers are 15 bits");
+
+// Shared by appends and queries (the loop and the HTTP handlers run on one
+// task): one block of records, and the per-card sums of one totals pass.
+WeighLog::Record g_block[WeighLog::kBlockRecords];
+struct CardSum {
+  uint32_t count;
+  uint32_t kg100;
+} g_window[WeighLog::kTotalsWindow];
+
+void segmentPath(char *out, size_t n, uint32_t seg) {
+  snprintf(out, n, WEIGHLOG_DIR "/%08lx.dat", (unsigned long)seg);
+}
+
+uint16_t keyHash(const IdDirectory::Key &key) {
+  uint32_t h = 2166136261UL;  // FNV-1a
+  h = (h ^ key.len) * 16777619UL;
+  for (uint8_t i = 0; i < key.len; ++i) h = (h ^ key.uid[i]) * 16777619UL;
+  const uint16_t h16 = (uint16_t)(h ^ (h >> 16));
+  return h16 != WeighLog::kFreeSlot ? h16 : 1;
+}
+
+void keyHex(const IdDirectory::Key &key, char *out) {
+  static const char kDigits[] = "0123456789ABCDEF";
+  for (uint8_t i = 0; i < key.len; ++i) {
+    out[2 * i] = kDigits[key.uid[i] >> 4];
+    out[2 * i + 1] = kDigits[key.uid[i] & 0x0F];
+  }
+  out[2 * key.len] = '\0';
+}
+
+// "2026-10-19 08:30:00", '~' in front when the time was estimated.
+void formatTime(uint32_t s, bool estimated, char *out, size_t n) {
+  const time_t t = (time_t)s;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char date[24];
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(out, n, "%s%s", estimated ? "~" : "", date);
+}
+
+bool wallClock(uint32_t &s) {
+  struct tm tm;
+  if (!getLocalTime(&tm, 0)) return false;
+  const time_t t = mktime(&tm);
+  if (t < (time_t)kMinValidS) return false;
+  s = (uint32_t)t;
+  return true;
+}
+
+bool writeAt(File &f, size_t pos, const void *data, size_t n) {
+  return f.seek(pos) && f.write(reinterpret_cast<const uint8_t *>(data), n) == n;
+}
+} // namespace
+
+size_t WeighLog::ramBytes() {
+  return sizeof(WeighLog) + sizeof(g_block) + sizeof(g_window);
+}
+
+bool WeighLog::clockSet() const {
+  uint32_t s;
+  return wallClock(s);
+}
+
+uint32_t WeighLog::nowS() const {
+  uint32_t s;
+  if (!wallClock(s)) s = bootBaseS_ + millis() / 1000;
+  return std::max(s, lastTimeS_);
+}
+
+bool WeighLog::writeMeta_() {
+  const Meta m = {kMagic, (uint16_t)sizeof(Record), (uint16_t)WEIGHLOG_SEGMENT_RECORDS, firstSeg_};
+  File f = LittleFS.open(kMetaPath, "w");
+  if (!f) return false;
+  const bool ok = f.write(reinterpret_cast<const uint8_t *>(&m), sizeof(m)) == sizeof(m);
+  f.close();
+  return ok;
+}
+
+bool WeighLog::begin() {
+  ready_ = false;
+  torn_ = false;
+  if (!LittleFS.begin(true)) return false;
+  if (!LittleFS.exists(WEIGHLOG_DIR)) LittleFS.mkdir(WEIGHLOG_DIR);
+
+  Meta m = {};
+  File f = LittleFS.open(kMetaPath, "r");
+  const bool haveMeta = f && f.read(reinterpret_cast<uint8_t *>(&m), sizeof(m)) == sizeof(m) &&
+                        m.magic == kMagic;
+  if (f) f.close();
+  const bool layoutOk =
+      haveMeta && m.recordSize == sizeof(Record) && m.segmentRecords == WEIGHLOG_SEGMENT_RECORDS;
+  char path[32];
+  if (haveMeta && !layoutOk) {
+    // Another layout: start over rather than misread it.
+    for (uint32_t seg = m.firstSegment;; ++seg) {
+      segmentPath(path, sizeof(path), seg);
+      if (!LittleFS.exists(path)) break;
+      LittleFS.remove(path);
+    }
+    LittleFS.remove(kCardsPath);
+  }
+  firstSeg_ = layoutOk ? m.firstSegment : 0;
+  if (!layoutOk && !writeMeta_()) return false;
+  first_ = firstSeg_ * WEIGHLOG_SEGMENT_RECORDS;
+
+  // A drop cut off between the meta write and the remove leaves the old file.
+  if (firstSeg_ > 0) {
+    segmentPath(path, sizeof(path), firstSeg_ - 1);
+    if (LittleFS.exists(path)) LittleFS.remove(path);
+  }
+
+  next_ = first_;
+  segmentPath(path, sizeof(path), firstSeg_);
+  if (LittleFS.exists(path)) {
+    uint32_t last = firstSeg_;
+    while (true) {
+      segmentPath(path, sizeof(path), last + 1);
+      if (!LittleFS.exists(path)) break;
+      last++;
+    }
+    segmentPath(path, sizeof(path), last);
+    File tail = LittleFS.open(path, "r");
+    if (!tail) return false;
+    next_ = last * WEIGHLOG_SEGMENT_RECORDS + (uint32_t)(tail.size() / sizeof(Record));
+    tail.close();
+  }
+  while (size() > kMaxRecords) dropOldest_();  // WEIGHLOG_MAX_SEGMENTS went down
+
+  if (!loadFences_() || !loadCards_() || !repairTail_()) return false;
+  bootBaseS_ = lastTimeS_;
+  ready_ = true;
+  LOG_EVENT(HistoryOpened, size(), (uint32_t)cards());
+  return true;
+}
+
+bool WeighLog::readRecords_(File &f, uint32_t &seg, uint32_t n, Record *out, uint32_t count) const {
+  const uint32_t s = n / WEIGHLOG_SEGMENT_RECORDS;
+  if (!f || seg != s) {
+    if (f) f.close();
+    char path[32];
+    segmentPath(path, sizeof(path), s);
+    f = LittleFS.open(path, "r");
+    seg = s;
+    if (!f) return false;
+  }
+  const size_t want = (size_t)count * sizeof(Record);
+  return f.seek((n % WEIGHLOG_SEGMENT_RECORDS) * sizeof(Record)) &&
+         f.read(reinterpret_cast<uint8_t *>(out), want) == want;
+}
+
+bool WeighLog::loadFences_() {
+  File f;
+  uint32_t seg = kNone;
+  for (uint32_t n = first_; n < next_; n += kBlockRecords) {
+    if (!readRecords_(f, seg, n, g_block, 1)) return false;
+    fences_[(n - first_) / kBlockRecords] = g_block[0].timeS;
+  }
+  lastTimeS_ = 0;
+  if (next_ > first_) {
+    if (!readRecords_(f, seg, next_ - 1, g_block, 1)) return false;
+    lastTimeS_ = g_block[0].timeS;
+  }
+  return true;
+}
+
+bool WeighLog::loadCards_() {
+  cardCount_ = 0;
+  freeCards_ = 0;
+  File f = LittleFS.open(kCardsPath, "r");
+  if (!f) {
+    f = LittleFS.open(kCardsPath, "w");
+    if (!f) return false;
+    f.close();
+    return true;
+  }
+  // A torn entry at the end is overwritten by the next new card.
+  const uint32_t n = std::min<uint32_t>((uint32_t)(f.size() / sizeof(CardEntry)), WEIGHLOG_MAX_CARDS);
+  CardEntry chunk[kCardReadChunk];
+  while (cardCount_ < n) {
+    const uint32_t k = std::min<uint32_t>(kCardReadChunk, n - cardCount_);
+    if (f.read(reinterpret_cast<uint8_t *>(chunk), k * sizeof(CardEntry)) != k * sizeof(CardEntry)) break;
+    for (uint32_t i = 0; i < k; ++i) {
+      const bool dropped = chunk[i].head < first_;
+      cardHash_[cardCount_++] = dropped ? kFreeSlot : keyHash(chunk[i].key);
+      freeCards_ += dropped;
+    }
+  }
+  f.close();
+  return true;
+}
+
+// The last append may have been cut off: a partial record becomes a hole,
+// and a record whose card head was not updated gets it now.
+bool WeighLog::repairTail_() {
+  char path[32];
+  segmentPath(path, sizeof(path), next_ / WEIGHLOG_SEGMENT_RECORDS);
+  const size_t whole = (size_t)(next_ % WEIGHLOG_SEGMENT_RECORDS) * sizeof(Record);
+  File f;
+  if (LittleFS.exists(path)) f = LittleFS.open(path, "r+");
+  if (f && f.size() > whole) {
+    const Record hole = {lastTimeS_, kNone, kHole, 0};
+    const bool ok = writeAt(f, whole, &hole, sizeof(hole));
+    f.close();
+    if (!ok) return false;
+    LOG_EVENT(HistoryRepaired, next_);
+    if ((next_ - first_) % kBlockRecords == 0) fences_[(next_ - first_) / kBlockRecords] = lastTimeS_;
+    next_++;
+    return true;
+  }
+  if (f) f.close();
+  if (next_ == first_) return true;
+
+  File seg;
+  uint32_t segNo = kNone;
+  Record last;
+  const bool ok = readRecords_(seg, segNo, next_ - 1, &last, 1);
+  seg.close();
+  if (!ok) return false;
+  const uint16_t card = last.card & kCardMask;
+  if (last.card == kHole || card >= cardCount_) return true;
+  File cards = LittleFS.open(kCardsPath, "r+");
+  if (!cards) return false;
+  CardEntry e;
+  bool fixed = cards.seek((size_t)card * sizeof(CardEntry)) &&
+               cards.read(reinterpret_cast<uint8_t *>(&e), sizeof(e)) == sizeof(e);
+  if (fixed && e.head != next_ - 1) {
+    e.head = next_ - 1;
+    fixed = writeAt(cards, (size_t)card * sizeof(CardEntry) + offsetof(CardEntry, head), &e.head, sizeof(e.head));
+  }
+  cards.close();
+  return fixed;
+}
+
+void WeighLog::dropOldest_(File *cards) {
+  char path[32];
+  segmentPath(path, sizeof(path), firstSeg_);
+  firstSeg_++;
+  writeMeta_();  // first: a cut-off drop leaves a stray file, not a hole
+  LittleFS.remove(path);
+  first_ += WEIGHLOG_SEGMENT_RECORDS;
+  if (next_ < first_) next_ = first_;
+  const uint32_t shift = WEIGHLOG_SEGMENT_RECORDS / kBlockRecords;
+  const uint32_t kept = (next_ - first_ + kBlockRecords - 1) / kBlockRecords;
+  memmove(fences_, fences_ + shift, kept * sizeof(fences_[0]));
+  releaseCards_(cards);
+  LOG_EVENT(HistoryDropped, size());
+}
+
+// Cards whose newest record was just dropped have nothing left on flash:
+// their slots go to the next new cards, so cards.bin stops growing.
+void WeighLog::releaseCards_(File *cards) {
+  if (cardCount_ == 0) return;
+  File own;
+  if (cards == nullptr) {
+    own = LittleFS.open(kCardsPath, "r");
+    cards = &own;
+  }
+  if (!*cards || !cards->seek(0)) return;
+  CardEntry chunk[kCardReadChunk];
+  for (uint32_t i = 0; i < cardCount_; i += kCardReadChunk) {
+    const uint32_t k = std::min<uint32_t>(kCardReadChunk, cardCount_ - i);
+    if (cards->read(reinterpret_cast<uint8_t *>(chunk), k * sizeof(CardEntry)) != k * sizeof(CardEntry)) break;
+    for (uint32_t j = 0; j < k; ++j) {
+      if (cardHash_[i + j] == kFreeSlot || chunk[j].head >= first_) continue;
+      cardHash_[i + j] = kFreeSlot;
+      freeCards_++;
+    }
+  }
+}
+
+// Starting a segment: drop the oldest ones while it would not leave
+// WEIGHLOG_RESERVE_BYTES free for the trace and the directory.
+void WeighLog::makeRoom_(File &cards) {
+  const size_t need = WEIGHLOG_RESERVE_BYTES + (size_t)WEIGHLOG_SEGMENT_RECORDS * sizeof(Record);
+  while (firstSeg_ < next_ / WEIGHLOG_SEGMENT_RECORDS) {
+    const size_t used = LittleFS.usedBytes(), total = LittleFS.totalBytes();
+    if (used < total && total - used >= need) break;
+    dropOldest_(&cards);
+  }
+}
+
+bool WeighLog::writeRecord_(const Record &r) {
+  char path[32];
+  segmentPath(path, sizeof(path), next_ / WEIGHLOG_SEGMENT_RECORDS);
+  File seg = LittleFS.open(path, "a");
+  const bool ok = seg && seg.write(reinterpret_cast<const uint8_t *>(&r), sizeof(r)) == sizeof(r);
+  if (seg) seg.close();
+  return ok;
+}
+
+int32_t WeighLog::findCard_(File &cards, const IdDirectory::Key &key, CardEntry &entry) const {
+  const uint16_t h = keyHash(key);  // never kFreeSlot
+  for (uint16_t i = 0; i < cardCount_; ++i) {
+    if (cardHash_[i] != h) continue;
+    if (!cards.seek((size_t)i * sizeof(CardEntry)) ||
+        cards.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry)) != sizeof(entry)) {
+      return -1;
+    }
+    if (entry.key.len == key.len && memcmp(entry.key.uid, key.uid, key.len) == 0) return i;
+  }
+  return -1;
+}
+
+bool WeighLog::append(const char *uidHex, float kg) {
+  if (!ready_) return false;
+  IdDirectory::Key key;
+  if (!IdDirectory::parseUidHex(uidHex, key)) return false;
+
+  // The last append did not get its record down: turn what it left into a
+  // hole before anything follows it.
+  if (torn_ && !repairTail_()) {
+    LOG_EVENT(HistoryAppendFailed, 0u);
+    return false;
+  }
+  torn_ = false;
+  File cards = LittleFS.open(kCardsPath, "r+");
+  if (!cards) {
+    LOG_EVENT(HistoryAppendFailed, 0u);
+    return false;
+  }
+  if (next_ % WEIGHLOG_SEGMENT_RECORDS == 0) {
+    if (size() == kMaxRecords) dropOldest_(&cards);
+    makeRoom_(cards);
+  }
+
+  CardEntry entry;
+  int32_t card = findCard_(cards, key, entry);
+  if (card < 0) {
+    uint16_t slot = cardCount_;
+    if (freeCards_ > 0) {
+      slot = (uint16_t)(std::find(cardHash_, cardHash_ + cardCount_, kFreeSlot) - cardHash_);
+    } else if (cardCount_ == WEIGHLOG_MAX_CARDS) {
+      cards.close();
+      LOG_EVENT(HistoryAppendFailed, 1u);
+      return false;
+    }
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    entry.head = kNone;
+    if (!writeAt(cards, (size_t)slot * sizeof(CardEntry), &entry, sizeof(entry))) {
+      cards.close();
+      LOG_EVENT(HistoryAppendFailed, 0u);
+      return false;
+    }
+    card = slot;
+    if (slot == cardCount_) cardCount_++;
+    else freeCards_--;
+    cardHash_[slot] = keyHash(key);
+  }
+
+  uint32_t t;
+  const bool estimated = !wallClock(t);
+  if (estimated) t = bootBaseS_ + millis() / 1000;
+  t = std::max(t, lastTimeS_);
+  const long kg100 = lroundf(kg * 100.0f);
+  const Record r = {t, entry.head, (uint16_t)(card | (estimated ? kEstimated : 0)),
+                    (uint16_t)std::min<long>(std::max<long>(kg100, 0), 0xFFFF)};
+
+  bool written = writeRecord_(r);
+  if (!written && firstSeg_ < next_ / WEIGHLOG_SEGMENT_RECORDS) {
+    // Most likely out of space (something else grew into the reserve):
+    // give up the oldest segment, make a partial record a hole and retry.
+    // repairTail_() opens cards.bin itself.
+    dropOldest_(&cards);
+    cards.close();
+    written = repairTail_() && writeRecord_(r);
+    if (written) cards = LittleFS.open(kCardsPath, "r+");  // no head: begin() redoes it
+  }
+  if (!written) {
+    // A partial record would shift every later one: the next append, or
+    // begin(), repairs it first.
+    if (cards) cards.close();
+    torn_ = true;
+    LOG_EVENT(HistoryAppendFailed, 0u);
+    return false;
+  }
+  if ((next_ - first_) % kBlockRecords == 0) fences_[(next_ - first_) / kBlockRecords] = t;
+  if (cards) {
+    writeAt(cards, (size_t)card * sizeof(CardEntry) + offsetof(CardEntry, head), &next_, sizeof(next_));
+    cards.close();
+  }
+  if (cardHash_[card] == kFreeSlot) {
+    // Its older records were dropped on the way; the slot is in use again.
+    cardHash_[card] = keyHash(key);
+    freeCards_--;
+  }
+  next_++;
+  lastTimeS_ = t;
+  return true;
+}
+
+uint32_t WeighLog::resolveSince_(int64_t sinceS) const {
+  if (sinceS > 0) return (uint32_t)std::min<int64_t>(sinceS, 0xFFFFFFFFLL);
+  const int64_t t = (int64_t)nowS() + sinceS;
+  return t > 0 ? (uint32_t)t : 0;
+}
+
+// First record at or after t: the fences narrow it to one block.
+uint32_t WeighLog::firstSince_(uint32_t t) {
+  const uint32_t blocks = (next_ - first_ + kBlockRecords - 1) / kBlockRecords;
+  const uint32_t b = (uint32_t)(std::lower_bound(fences_, fences_ + blocks, t) - fences_);
+  if (b == 0) return first_;
+  const uint32_t start = first_ + (b - 1) * kBlockRecords;
+  const uint32_t n = std::min<uint32_t>(kBlockRecords, next_ - start);
+  File f;
+  uint32_t seg = kNone;
+  if (!readRecords_(f, seg, start, g_block, n)) return next_;
+  for (uint32_t i = 0; i < n; ++i) {
+    if (g_block[i].timeS >= t) return start + i;
+  }
+  return start + n;
+}
+
+WeighLog::Result WeighLog::printCard(Print &out, const char *uidHex, int64_t sinceS, uint16_t limit) {
+  Result res;
+  const unsigned long startMs = millis();
+  IdDirectory::Key key;
+  if (!ready_ || !IdDirectory::parseUidHex(uidHex, key)) {
+    out.printf("history: %s\n", ready_ ? "bad card id" : "not available");
+    return res;
+  }
+  char uid[2 * IdDirectory::kMaxUidLen + 1];
+  keyHex(key, uid);
+  const uint32_t since = resolveSince_(sinceS);
+  char when[28];
+  formatTime(since, !clockSet(), when, sizeof(when));
+  out.printf("history: card %s since %lu (%s UTC)\n", uid, (unsigned long)since, when);
+
+  File cards = LittleFS.open(kCardsPath, "r");
+  CardEntry entry;
+  const int32_t card = cards ? findCard_(cards, key, entry) : -1;
+  if (cards) cards.close();
+  uint32_t n = card >= 0 ? entry.head : kNone;
+  File f;
+  uint32_t seg = kNone;
+  Record r;
+  while (n != kNone && n < next_) {
+    if (n < first_) {
+      res.truncated = true;
+      break;
+    }
+    if (!readRecords_(f, seg, n, &r, 1)) break;
+    res.recordsRead++;
+    if (r.timeS < since || (r.card & kCardMask) != (uint16_t)card) break;
+    if (res.count < limit) {
+      formatTime(r.timeS, (r.card & kEstimated) != 0, when, sizeof(when));
+      out.printf("  %10lu  %-20s %8.2f kg\n", (unsigned long)r.timeS, when, r.kg100 / 100.0f);
+    }
+    res.count++;
+    res.kg100 += r.kg100;
+    n = r.prev;
+  }
+  if (res.count > limit) out.printf("  ... %lu older\n", (unsigned long)(res.count - limit));
+  res.ms = millis() - startMs;
+  out.printf("history: %lu weigh-ins, %.2f kg; %lu records read in %lu ms%s\n", (unsigned long)res.count,
+             res.kg100 / 100.0, (unsigned long)res.recordsRead, (unsigned long)res.ms,
+             res.truncated ? "; older weigh-ins dropped from flash" : "");
+  return res;
+}
+
+WeighLog::Result WeighLog::printTotals(Print &out, int64_t sinceS) {
+  Result res;
+  const unsigned long startMs = millis();
+  if (!ready_) {
+    out.printf("history: not available\n");
+    return res;
+  }
+  const uint32_t since = resolveSince_(sinceS);
+  char when[28];
+  formatTime(since, !clockSet(), when, sizeof(when));
+  out.printf("history: totals since %lu (%s UTC)\n", (unsigned long)since, when);
+
+  const uint32_t start = firstSince_(since);
+  res.truncated = first_ > 0 && size() > 0 && fences_[0] > since;
+  File f, cards;
+  uint32_t seg = kNone;
+  uint32_t windows = 1;  // card windows seen; the first pass finds them all
+  uint16_t cardsWeighed = 0;
+  uint32_t passes = 0;
+  for (uint32_t w = 0; w * kTotalsWindow < cardCount_; ++w) {
+    if (!(windows & (1UL << w))) continue;
+    passes++;
+    memset(g_window, 0, sizeof(g_window));
+    const uint32_t lo = w * kTotalsWindow;
+    for (uint32_t n = start; n < next_;) {
+      const uint32_t k = std::min<uint32_t>(
+          std::min<uint32_t>(kBlockRecords, WEIGHLOG_SEGMENT_RECORDS - n % WEIGHLOG_SEGMENT_RECORDS), next_ - n);
+      if (!readRecords_(f, seg, n, g_block, k)) break;
+      res.recordsRead += k;
+      for (uint32_t i = 0; i < k; ++i) {
+        const Record &r = g_block[i];
+        if (r.card == kHole) continue;
+        const uint32_t c = r.card & kCardMask;
+        windows |= 1UL << (c / kTotalsWindow);
+        if (c - lo >= kTotalsWindow) continue;
+        g_window[c - lo].count++;
+        g_window[c - lo].kg100 += r.kg100;
+      }
+      n += k;
+    }
+    if (!cards) cards = LittleFS.open(kCardsPath, "r");
+    for (uint32_t i = 0; i < kTotalsWindow && lo + i < cardCount_; ++i) {
+      if (g_window[i].count == 0) continue;
+      CardEntry e;
+      char uid[2 * IdDirectory::kMaxUidLen + 1] = "?";
+      if (cards && cards.seek((lo + i) * sizeof(CardEntry)) &&
+          cards.read(reinterpret_cast<uint8_t *>(&e), sizeof(e)) == sizeof(e)) {
+        keyHex(e.key, uid);
+      }
+      out.printf("  %-20s %6lu %10.2f kg\n", uid, (unsigned long)g_window[i].count, g_window[i].kg100 / 100.0f);
+      res.count += g_window[i].count;
+      res.kg100 += g_window[i].kg100;
+      cardsWeighed++;
+    }
+  }
+  if (cards) cards.close();
+  res.ms = millis() - startMs;
+  out.printf("history: %lu weigh-ins by %u cards, %.2f kg; %lu records read in %lu pass%s, %lu ms%s\n",
+             (unsigned long)res.count, (unsigned)cardsWeighed, res.kg100 / 100.0, (unsigned long)res.recordsRead,
+             (unsigned long)passes, passes == 1 ? "" : "es", (unsigned long)res.ms,
+             res.truncated ? "; older weigh-ins dropped from flash" : "");
+  return res;
+}
+
+void WeighLog::printText(Print &out) const {
+  if (!ready_) {
+    out.printf("history: not available\n");
+    return;
+  }
+  char when[28] = "none";
+  if (size() > 0) formatTime(fences_[0], false, when, sizeof(when));
+  out.printf("history: %lu weigh-ins in %lu segments since %s, %u cards\n", (unsigned long)size(),
+             (unsigned long)((next_ - first_ + WEIGHLOG_SEGMENT_RECORDS - 1) / WEIGHLOG_SEGMENT_RECORDS), when,
+             (unsigned)cards());
+  out.printf("history: flash %lu KB (max %lu KB; LittleFS %lu of %lu KB used), RAM %lu bytes\n",
+             (unsigned long)((size() * sizeof(Record) + cardCount_ * sizeof(CardEntry)) / 1024),
+             (unsigned long)((kMaxRecords * sizeof(Record) + WEIGHLOG_MAX_CARDS * sizeof(CardEntry)) / 1024),
+             (unsigned long)(LittleFS.usedBytes() / 1024), (unsigned long)(LittleFS.totalBytes() / 1024),
+             (unsigned long)ramBytes());
+  if (clockSet()) {
+    formatTime(nowS(), false, when, sizeof(when));
+    out.printf("history: clock %s UTC\n", when);
+  } else {
+    out.printf("history: clock not set; times estimated from the last record + uptime (~)\n");
+  }
+}
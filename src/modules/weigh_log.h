@@ -0,0 +1,117 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+#include "id_directory.h"
+
+// On-device weigh-in history: an append-only log on LittleFS with two small
+// indexes, for "weigh-ins and total for card X since T" and "totals per card
+// since T" without a server.
+//
+// Layout under WEIGHLOG_DIR:
+//   meta.bin         format and the oldest segment kept (written on a drop)
+//   cards.bin        one 16-byte entry per card: UID + newest record; the
+//                    slot of a card whose records were all dropped is reused
+//   <segment>.dat    WEIGHLOG_SEGMENT_RECORDS records of 12 bytes
+// Records are numbered from the first weigh-in ever, so record n lives in
+// segment n / WEIGHLOG_SEGMENT_RECORDS. Each record holds the number of the
+// same card's previous record:
+//   by card : cards.bin gives the newest record, the chain goes back in time;
+//             a query reads exactly the card's records since T
+//   by time : RAM fences hold the time of every kBlockRecords-th record, so
+//             the first record since T costs one block read
+//   RAM     : 4 bytes per block + 2 bytes per card (a UID hash, confirmed in
+//             cards.bin), ~5 KB by default, + 5 KB of shared query buffers
+//   Flash   : 12 bytes per weigh-in, 16 per card
+// An append writes the record, then the card's head: two small writes. After
+// a power cut or a failed write a torn record is replaced by a hole and a
+// lost head update is redone from the last record. The log gives way to the
+// rest of LittleFS: it keeps WEIGHLOG_RESERVE_BYTES free when it starts a
+// segment and drops its oldest one when a write runs out of space.
+//
+// Times are Unix seconds (UTC) from SNTP. Without a clock they are estimated
+// from the last record's time plus uptime and flagged; they never go back.
+class WeighLog {
+ public:
+  static constexpr uint16_t kBlockRecords = 256;
+  static constexpr uint16_t kTotalsWindow = 256;  // cards counted per totals pass
+  static constexpr uint32_t kMaxRecords = (uint32_t)WEIGHLOG_SEGMENT_RECORDS * WEIGHLOG_MAX_SEGMENTS;
+  static constexpr int32_t kDefaultSinceS = -86400;  // queries: the last 24 h
+  static constexpr uint16_t kFreeSlot = 0;  // cardHash_ of a card with nothing kept
+
+  struct Result {
+    uint32_t count = 0;        // weigh-ins since T
+    uint64_t kg100 = 0;        // their total, 10 g units
+    uint32_t recordsRead = 0;  // flash records read to answer
+    uint32_t ms = 0;
+    bool truncated = false;    // older matching weigh-ins were dropped from flash
+  };
+
+  // On flash, in segment files and cards.bin.
+  struct Record {
+    uint32_t timeS;
+    uint32_t prev;   // same card's previous record, kNone if none
+    uint16_t card;   // index in cards.bin | kEstimated, or kHole
+    uint16_t kg100;
+  };
+
+  struct CardEntry {
+    IdDirectory::Key key;
+    uint8_t reserved;
+    uint32_t head;   // newest record
+  };
+
+  bool begin();
+
+  // uidHex as produced by RFID2. Call with allocation allowed (LittleFS).
+  bool append(const char *uidHex, float kg);
+
+  // sinceS > 0 is Unix seconds, <= 0 is relative to now. Lists up to limit
+  // weigh-ins, newest first; the totals cover all of them.
+  Result printCard(Print &out, const char *uidHex, int64_t sinceS,
+                   uint16_t limit = WEIGHLOG_QUERY_LIMIT);
+  // One line per card weighed since sinceS, then the station total.
+  Result printTotals(Print &out, int64_t sinceS);
+  void printText(Print &out) const;
+
+  bool ready() const { return ready_; }
+  uint32_t size() const { return next_ - first_; }
+  uint16_t cards() const { return cardCount_ - freeCards_; }  // with weigh-ins kept
+  bool clockSet() const;
+  uint32_t nowS() const;  // time the next record would get
+  static size_t ramBytes();
+
+ private:
+  static constexpr uint32_t kNone = 0xFFFFFFFFUL;
+  static constexpr uint16_t kEstimated = 0x8000;
+  static constexpr uint16_t kCardMask = 0x7FFF;
+  static constexpr uint16_t kHole = 0x7FFF;
+
+  // Reads count records from n on, within one segment; f stays open on
+  // segment seg between calls.
+  bool readRecords_(File &f, uint32_t &seg, uint32_t n, Record *out, uint32_t count) const;
+  int32_t findCard_(File &cards, const IdDirectory::Key &key, CardEntry &entry) const;
+  bool repairTail_();
+  bool loadFences_();
+  bool loadCards_();
+  void dropOldest_(File *cards = nullptr);
+  void releaseCards_(File *cards);
+  void makeRoom_(File &cards);
+  bool writeRecord_(const Record &r);
+  bool writeMeta_();
+  uint32_t resolveSince_(int64_t sinceS) const;
+  uint32_t firstSince_(uint32_t t);
+
+  bool ready_ = false;
+  bool torn_ = false;        // the last record write failed part way
+  uint32_t firstSeg_ = 0;
+  uint32_t first_ = 0;       // oldest record kept
+  uint32_t next_ = 0;        // number of the next record
+  uint32_t lastTimeS_ = 0;
+  uint32_t bootBaseS_ = 0;   // estimated time at millis() 0
+  uint16_t cardCount_ = 0;   // slots in cards.bin
+  uint16_t freeCards_ = 0;   // slots whose records were all dropped
+
+  uint32_t fences_[kMaxRecords / kBlockRecords];
+  uint16_t cardHash_[WEIGHLOG_MAX_CARDS];
+};
@@ -3,6 +3,11 @@
 #include <WiFi.h>
 #include <WebServer.h>
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "event_log.h"
+#include "metrics.h"
 
 namespace {
 constexpr const char *kPrefsNamespace = "wifi";
@@ -73,17 +78,20 @@ bool WiFiManager::connectSta_(const Credentials &creds, uint32_t timeoutMs) {
     delay(150);
   }
 
-  return WiFi.status() == WL_CONNECTED;
+  if (WiFi.status() != WL_CONNECTED) return false;
+  LOG_EVENT(WifiConnected, (uint32_t)WiFi.localIP(), (uint32_t)(millis() - startMs));
+  return true;
 }
 
 bool WiFiManager::ensureConnected(uint32_t timeoutMs) {
   if (WiFi.status() == WL_CONNECTED) return true;
   if (configPortalActive_) return false;
+  Metrics::ScopedTimer timer(Metrics::WifiReconnect);
 
   Credentials saved = loadSavedCredentials();
   if (!saved.valid()) return false;
 
-  Serial.printf("Reconnecting WiFi SSID: %s\n", saved.ssid.c_str());
+  LOG_EVENT(WifiConnecting, 2u);
   return connectSta_(saved, timeoutMs);
 }
 
@@ -113,16 +121,19 @@ String WiFiManager::htmlEscape_(const String &in) {
 }
 
 void WiFiManager::startConfigPortal_() {
+  portalFreeBefore_ = portalFreeMin_ = ESP.getFreeHeap();
+  portalFreeAfter_ = 0;
   configPortalActive_ = true;
+  join_ = Join::None;
+  joinEndMs_ = millis();  // first background retry after WIFI_PORTAL_RETRY_MS
 
+  // AP+STA: the setup network and the station's own join side by side.
   apSsid_ = makeApSsid_();
-  WiFi.mode(WIFI_AP);
+  WiFi.mode(WIFI_AP_STA);
   WiFi.softAP(apSsid_.c_str());
   apIp_ = WiFi.softAPIP().toString();
 
-  if (server_ == nullptr) {
-    server_ = new WebServer(80);
-  }
+  server_ = new WebServer(80);
   WebServer &server = *asServer(server_);
 
   server.on("/", HTTP_GET, [this]() {
@@ -135,14 +146,16 @@ void WiFiManager::startConfigPortal_() {
     html += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
     html += "<title>FishCore WiFi Setup</title></head><body>";
     html += "<h2>Configure WiFi</h2>";
+    html += "<p>The scale keeps weighing; weigh-ins are uploaded once it is online.</p>";
     html += "<form method='POST' action='/save'>";
     html += "<label>SSID</label><br>";
     html += "<input name='ssid' maxlength='32' value='" + savedSsid + "' style='width: 100%; max-width: 320px;' required><br><br>";
     html += "<label>Password</label><br>";
     html += "<input name='pass' type='password' maxlength='64' style='width: 100%; max-width: 320px;'><br><br>";
-    html += "<button type='submit'>Save & Restart</button>";
+    html += "<button type='submit'>Save & Connect</button>";
     html += "</form>";
-    html += "<p style='margin-top:16px;'><a href='/clear'>Clear saved WiFi credentials</a></p>";
+    html += "<p style='margin-top:16px;'><a href='/status'>Connection status</a></p>";
+    html += "<p><a href='/clear'>Clear saved WiFi credentials</a></p>";
     html += "</body></html>";
 
     asServer(server_)->send(200, "text/html", html);
@@ -161,25 +174,89 @@ void WiFiManager::startConfigPortal_() {
       return;
     }
 
-    asServer(server_)->send(200, "text/plain", "Saved. Rebooting...");
-    delay(500);
-    ESP.restart();
+    // Applied live; the scale is not interrupted.
+    startJoin_(normalizeCreds(creds));
+    asServer(server_)->send(200, "text/html",
+                            "<!doctype html><html><head><meta http-equiv='refresh' content='2;url=/status'></head>"
+                            "<body>Saved. Connecting... <a href='/status'>status</a></body></html>");
+  });
+
+  server.on("/status", HTTP_GET, [this]() {
+    const String ssid = htmlEscape_(joinSsid_);
+    const uint32_t sinceMs = millis() - joinEndMs_;
+    String html;
+    html.reserve(600);
+    html += "<!doctype html><html><head><meta charset='utf-8'>";
+    if (join_ == Join::Connecting) html += "<meta http-equiv='refresh' content='2'>";
+    html += "<title>FishCore WiFi Status</title></head><body>";
+    switch (join_) {
+      case Join::Connecting:
+        html += "<p>Connecting to " + ssid + "...</p>";
+        break;
+      case Join::Connected: {
+        const uint32_t leftMs = sinceMs < WIFI_PORTAL_LINGER_MS ? WIFI_PORTAL_LINGER_MS - sinceMs : 0;
+        html += "<p>Connected to " + ssid + ", address " + WiFi.localIP().toString() + ".</p>";
+        html += "<p>This setup network closes in " + String((unsigned)(leftMs / 1000)) + " s.</p>";
+        break;
+      }
+      case Join::Failed:
+        html += "<p>Could not connect to " + ssid + ". Check the name and password and save again.</p>";
+        break;
+      case Join::None:
+        html += "<p>Not connected.</p>";
+        break;
+    }
+    html += "<p><a href='/'>Back</a></p></body></html>";
+    asServer(server_)->send(200, "text/html", html);
   });
 
   server.on("/clear", HTTP_GET, [this]() {
     clearSavedCredentials();
-    asServer(server_)->send(200, "text/plain", "Cleared saved WiFi credentials. Rebooting...");
-    delay(500);
-    ESP.restart();
+    asServer(server_)->send(200, "text/plain", "Cleared saved WiFi credentials.");
   });
 
   server.onNotFound([this]() { asServer(server_)->send(404, "text/plain", "Not found"); });
 
   server.begin();
 
-  Serial.println("WiFi config portal started");
-  Serial.printf("AP SSID: %s\n", apSsid_.c_str());
-  Serial.printf("AP IP:   %s\n", apIp_.c_str());
+  LOG_EVENT(PortalStarted, (uint32_t)WiFi.softAPIP());
+
+  // Core 0 with the Wi-Fi stack, below its tasks; loop() runs on core 1 at
+  // the same priority, so the two never compete for a core.
+  TaskHandle_t task = nullptr;
+  xTaskCreatePinnedToCore(portalTask_, "portal", WIFI_PORTAL_TASK_STACK, this, WIFI_PORTAL_TASK_PRIO, &task, 0);
+  task_ = task;
+}
+
+void WiFiManager::portalTask_(void *arg) {
+  WiFiManager *self = static_cast<WiFiManager *>(arg);
+  while (self->configPortalActive_) {
+    self->loop();
+    vTaskDelay(pdMS_TO_TICKS(WIFI_PORTAL_POLL_MS));
+  }
+  self->task_ = nullptr;
+  vTaskDelete(nullptr);
+}
+
+void WiFiManager::stopConfigPortal_() {
+  asServer(server_)->close();
+  delete asServer(server_);  // with its handlers; only the portal task uses it
+  server_ = nullptr;
+  WiFi.softAPdisconnect(false);
+  WiFi.mode(WIFI_STA);  // keeps the station's connection
+  LOG_EVENT(PortalClosed, (uint32_t)WiFi.localIP());
+  configPortalActive_ = false;
+  portalFreeAfter_ = ESP.getFreeHeap();  // the task's stack goes when it exits
+}
+
+void WiFiManager::startJoin_(const Credentials &creds) {
+  LOG_EVENT(WifiConnecting, 3u);
+  if (join_ == Join::Connecting) WiFi.disconnect();  // station side only
+  joinSsid_ = creds.ssid;
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(creds.ssid.c_str(), creds.password.c_str());
+  joinStartMs_ = millis();
+  join_ = Join::Connecting;
 }
 
 bool WiFiManager::begin(uint32_t connectTimeoutMs) {
@@ -188,31 +265,30 @@ bool WiFiManager::begin(uint32_t connectTimeoutMs) {
 
 bool WiFiManager::begin(uint32_t connectTimeoutMs, const Credentials &fallbackIn) {
   configPortalActive_ = false;
+  connectTimeoutMs_ = connectTimeoutMs;
+  fallback_ = normalizeCreds(fallbackIn);
 
   // 1) Try saved credentials
   Credentials saved = loadSavedCredentials();
   if (saved.valid()) {
-    Serial.printf("Connecting WiFi (saved) SSID: %s\n", saved.ssid.c_str());
+    LOG_EVENT(WifiConnecting, 0u);
     if (connectSta_(saved, connectTimeoutMs)) {
-      Serial.printf("WiFi connected. IP: %s\n", WiFi.localIP().toString().c_str());
       return true;
     }
   } else {
-    Serial.println("No saved WiFi credentials in NVS");
+    LOG_EVENT(WifiNoSaved);
   }
 
   // 2) Optional fallback credentials (e.g., compile-time defaults)
-  Credentials fallback = normalizeCreds(fallbackIn);
-  if (fallback.valid()) {
-    Serial.printf("Connecting WiFi (fallback) SSID: %s\n", fallback.ssid.c_str());
-    if (connectSta_(fallback, connectTimeoutMs)) {
-      Serial.printf("WiFi connected. IP: %s\n", WiFi.localIP().toString().c_str());
+  if (fallback_.valid()) {
+    LOG_EVENT(WifiConnecting, 1u);
+    if (connectSta_(fallback_, connectTimeoutMs)) {
       return true;
     }
   }
 
   // 3) Failed -> enter AP config mode
-  Serial.println("WiFi connect failed; starting AP config portal");
+  LOG_EVENT(WifiFailed);
   startConfigPortal_();
   return false;
 }
@@ -220,4 +296,60 @@ bool WiFiManager::begin(uint32_t connectTimeoutMs, const Credentials &fallbackIn
 void WiFiManager::loop() {
   if (!configPortalActive_ || server_ == nullptr) return;
   asServer(server_)->handleClient();
+  const uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < portalFreeMin_) portalFreeMin_ = freeHeap;
+
+  // The join runs in the background; nothing here waits for it.
+  const uint32_t now = millis();
+  switch (join_) {
+    case Join::Connecting:
+      if (WiFi.status() == WL_CONNECTED) {
+        join_ = Join::Connected;
+        joinEndMs_ = now;
+        LOG_EVENT(WifiConnected, (uint32_t)WiFi.localIP(), now - joinStartMs_);
+      } else if (now - joinStartMs_ >= connectTimeoutMs_) {
+        WiFi.disconnect();  // stop retrying; the AP stays up
+        join_ = Join::Failed;
+        joinEndMs_ = now;
+        LOG_EVENT(PortalJoinFailed, now - joinStartMs_);
+      }
+      break;
+    case Join::Connected:
+      if (WiFi.status() != WL_CONNECTED) {
+        join_ = Join::Failed;  // lost again before the portal closed
+        joinEndMs_ = now;
+      } else if (now - joinEndMs_ >= WIFI_PORTAL_LINGER_MS) {
+        stopConfigPortal_();
+      }
+      break;
+    case Join::None:
+    case Join::Failed:
+      // The router may have come up after the station did. Not while a
+      // phone is on the setup network: a join in AP+STA moves the AP to the
+      // router's channel and drops the phone mid-page.
+      if (now - joinEndMs_ >= WIFI_PORTAL_RETRY_MS && WiFi.softAPgetStationNum() == 0) {
+        Credentials creds = loadSavedCredentials();
+        if (!creds.valid()) creds = fallback_;
+        if (creds.valid()) {
+          startJoin_(creds);
+        } else {
+          joinEndMs_ = now;
+        }
+      }
+      break;
+  }
+}
+
+void WiFiManager::printHeapReport(Print &out) const {
+  if (portalFreeBefore_ == 0) {
+    out.printf("portal: not started since boot\n");
+    return;
+  }
+  out.printf("portal: free before %lu, lowest while up %lu (held %lu)", (unsigned long)portalFreeBefore_,
+             (unsigned long)portalFreeMin_, (unsigned long)(portalFreeBefore_ - portalFreeMin_));
+  if (configPortalActive_) {
+    out.printf(", still up\n");
+  } else {
+    out.printf(", after close %lu\n", (unsigned long)portalFreeAfter_);
+  }
 }
@@ -8,6 +8,16 @@
 // - Falling back to AP mode with a small config web page
 // - Clearing credentials on request
 //
+// The config portal runs AP+STA from its own task (WIFI_PORTAL_TASK_PRIO, on
+// the other core from the loop), so the scale keeps weighing while someone
+// configures the station. /save stores the credentials and joins the network
+// live; the saved and fallback networks are also retried every
+// WIFI_PORTAL_RETRY_MS in case the router comes up after the station, but
+// only while no phone is on the setup network (the join changes channel). Once joined the portal stays
+// up for WIFI_PORTAL_LINGER_MS (its status page reports the address), then
+// closes and isConfigPortalActive() turns false. No restart either way.
+// The AP, web server and portal task exist only while the portal is up.
+//
 // This module is intentionally independent of the scale / LCD / RFID logic.
 class WiFiManager {
  public:
@@ -25,7 +35,9 @@ class WiFiManager {
   // the provided fallback credentials before starting AP config mode.
   bool begin(uint32_t connectTimeoutMs, const Credentials &fallback);
 
-  // Call from loop() to process HTTP requests while in AP mode.
+  // One step of the portal: HTTP requests and the join in progress. The
+  // portal task calls it every WIFI_PORTAL_POLL_MS; host programs, which
+  // have no scheduler, call it themselves.
   void loop();
 
   // Returns true when STA is connected.
@@ -53,16 +65,37 @@ class WiFiManager {
   // Save credentials to NVS.
   bool saveCredentials(const Credentials &creds);
 
+  // Free heap around the last portal: before it started, lowest while it was
+  // up and after it closed ('h').
+  void printHeapReport(Print &out) const;
+
  private:
+  // Portal join progress (the status page, loop()).
+  enum class Join : uint8_t { None, Connecting, Connected, Failed };
+
   bool connectSta_(const Credentials &creds, uint32_t timeoutMs);
   void startConfigPortal_();
+  void stopConfigPortal_();
+  // Starts a join without leaving AP+STA; loop() follows it up.
+  void startJoin_(const Credentials &creds);
+  static void portalTask_(void *arg);
 
   static String makeApSsid_();
   static String htmlEscape_(const String &in);
 
-  bool configPortalActive_ = false;
+  volatile bool configPortalActive_ = false;  // written by the portal task
+  volatile Join join_ = Join::None;
+  uint32_t joinStartMs_ = 0;
+  uint32_t joinEndMs_ = 0;  // connected or failed
+  uint32_t connectTimeoutMs_ = 0;
+  Credentials fallback_;
+  String joinSsid_;
+  void *task_ = nullptr;
   String apSsid_;
   String apIp_;
+  uint32_t portalFreeBefore_ = 0;
+  uint32_t portalFreeMin_ = 0;
+  uint32_t portalFreeAfter_ = 0;
 
   // Lazy-created in .cpp (to avoid exposing WebServer header in other files).
   void *server_ = nullptr;
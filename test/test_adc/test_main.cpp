@@ -0,0 +1,228 @@
+// ADC driver conformance and benchmark, one test per driver.
+//
+// Every driver in src/modules/adc_driver.h goes through the same checks
+// against the shim's load cell model (NAU7802 over I2C, HX711 and ADS1232
+// bit-banged on GPIOs, the emulated ADC on its own model):
+//
+//   begin/connected, conversion cadence at the active and idle rates, one
+//   read per conversion, counts that track the load (slope and sign), offset
+//   calibration, and BasicScale<driver> weighing a known load.
+//
+// Then per driver: conversions per second, host ns per read(), noise of a
+// single conversion and of a getWeightKg() average, and how long that
+// average takes. The shim's noise is the same per conversion for every
+// part, so the noise columns show what the rate buys, not the datasheets;
+// record an ADC trace on the real board for its own noise.
+//
+//   pio test -e native -f test_adc
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "config.h"
+#include "modules/adc_driver.h"
+#include "modules/scale.h"
+#include "shim.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Drivers on the shim: wire the model the driver talks to.
+void attach(Nau7802Adc *) { shim::setSerialAdc(shim::SerialAdc::None, -1, -1, -1); }
+void attach(Hx711Adc *) {
+  shim::setSerialAdc(shim::SerialAdc::Hx711, SERIAL_ADC_DOUT_PIN, SERIAL_ADC_SCK_PIN, SERIAL_ADC_RATE_PIN);
+}
+void attach(Ads1232Adc *) {
+  shim::setSerialAdc(shim::SerialAdc::Ads1232, SERIAL_ADC_DOUT_PIN, SERIAL_ADC_SCK_PIN, SERIAL_ADC_RATE_PIN);
+}
+void attach(EmulatedAdc *) { shim::setSerialAdc(shim::SerialAdc::None, -1, -1, -1); }
+
+template <typename Adc>
+void setLoad(Adc &, float grams) {
+  shim::loadCell().loadGrams = [grams](uint64_t) { return grams; };
+}
+void setLoad(EmulatedAdc &adc, float grams) { adc.setLoadGrams(grams); }
+
+// Conversions delivered in ms of (virtual) time, reading as fast as ready() allows.
+template <typename Adc>
+uint32_t countConversions(Adc &adc, uint32_t ms, bool *doubleRead) {
+  uint32_t n = 0;
+  const unsigned long start = millis();
+  while (millis() - start < ms) {
+    if (adc.ready()) {
+      adc.read();
+      n++;
+      if (adc.ready() && doubleRead != nullptr) *doubleRead = true;
+    } else {
+      delay(1);
+    }
+  }
+  return n;
+}
+
+template <typename Adc>
+double averageCounts(Adc &adc, int n) {
+  double sum = 0.0;
+  for (int i = 0; i < n;) {
+    if (!adc.ready()) {
+      delay(1);
+      continue;
+    }
+    sum += adc.read();
+    i++;
+  }
+  return sum / n;
+}
+
+bool near(double v, double expected, double tol) { return fabs(v - expected) <= tol; }
+
+struct Bench {
+  const char *name;
+  double sps;
+  double nsPerRead;
+  double noiseG;        // one conversion, 1 sigma
+  double weightNoiseG;  // getWeightKg(true), 1 sigma
+  double weightMs;      // one getWeightKg(true)
+};
+
+std::vector<Bench> g_benches;
+
+template <typename Adc>
+void run() {
+  shim::resetTime(0);
+  shim::loadCell() = shim::LoadCellModel();
+  attach(static_cast<Adc *>(nullptr));
+  const float countsPerGram = shim::loadCell().countsPerGram;
+
+  // ---- conformance ----
+  Adc adc;
+  TEST_ASSERT_TRUE_MESSAGE(adc.begin(), "begin()");
+  TEST_ASSERT_TRUE_MESSAGE(adc.connected(), "connected()");
+
+  char what[64];
+  bool doubleRead = false;
+  const uint32_t active = countConversions(adc, 2000, &doubleRead);
+  const double expectActive = 2e6 / adc.periodUs();
+  snprintf(what, sizeof(what), "active rate: %u conversions in 2 s", (unsigned)active);
+  TEST_ASSERT_TRUE_MESSAGE(near(active, expectActive, 1 + expectActive * 0.02), what);
+  TEST_ASSERT_TRUE_MESSAGE(!doubleRead, "one read() per conversion");
+
+  adc.setRate(AdcRate::Idle);
+  const uint32_t idle = countConversions(adc, 2000, nullptr);
+  const double expectIdle = 2e6 / adc.periodUs();
+  snprintf(what, sizeof(what), "idle rate: %u conversions in 2 s", (unsigned)idle);
+  TEST_ASSERT_TRUE_MESSAGE(idle < active && near(idle, expectIdle, 1 + expectIdle * 0.02), what);
+  adc.setRate(AdcRate::Active);
+
+  setLoad(adc, 0.0f);
+  const double zero = averageCounts(adc, 16);
+  setLoad(adc, 10000.0f);
+  const double loaded = averageCounts(adc, 16);
+  const double slope = (loaded - zero) / 10000.0;
+  snprintf(what, sizeof(what), "counts track load: %.3f counts/g", slope);
+  TEST_ASSERT_TRUE_MESSAGE(near(slope, countsPerGram, fabs(countsPerGram) * 0.01), what);
+  TEST_ASSERT_TRUE_MESSAGE(loaded < 0, "negative counts sign-extended");
+  setLoad(adc, 0.0f);
+
+  const unsigned long calStart = millis();
+  const bool calibrated = adc.calibrate();
+  const unsigned long calMs = millis() - calStart;
+  bool resumed = false;
+  for (unsigned long t = millis(); millis() - t < 1000 && !resumed;) {
+    resumed = adc.ready();
+    if (!resumed) delay(1);
+  }
+  snprintf(what, sizeof(what), "calibrate() in %lu ms, conversions resume", calMs);
+  TEST_ASSERT_TRUE_MESSAGE(calibrated && resumed, what);
+
+  BasicScale<Adc> scale;
+  TEST_ASSERT_TRUE_MESSAGE(scale.begin(), "BasicScale::begin()");
+  setLoad(scale.adc(), 12500.0f);
+  const float kg = scale.getWeightKg(true);
+  snprintf(what, sizeof(what), "BasicScale weighs 12.5 kg: %.3f", kg);
+  TEST_ASSERT_TRUE_MESSAGE(near(kg, 12.5, 12.5 * 0.005), what);
+  float polled = 0.0f;
+  bool gotPoll = false;
+  for (unsigned long t = millis(); millis() - t < 500 && !gotPoll;) {
+    gotPoll = scale.pollKg(polled);
+    if (!gotPoll) delay(1);
+  }
+  TEST_ASSERT_TRUE_MESSAGE(gotPoll && near(polled, 12.5, 0.2), "pollKg() returns the next conversion");
+
+  // ---- benchmark ----
+  Bench b{Adc::kName, active / 2.0, 0, 0, 0, 0};
+
+  setLoad(adc, 0.0f);
+  const uint32_t kReads = 2000;
+  uint32_t done = 0;
+  double hostNs = 0.0;
+  std::vector<double> g;
+  while (done < kReads) {
+    if (!adc.ready()) {
+      delay(1);
+      continue;
+    }
+    const Clock::time_point t0 = Clock::now();
+    const int32_t c = adc.read();
+    hostNs += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+    g.push_back(c / fabs(countsPerGram));
+    done++;
+  }
+  b.nsPerRead = hostNs / kReads;
+  double mean = 0.0, var = 0.0;
+  for (double x : g) mean += x;
+  mean /= g.size();
+  for (double x : g) var += (x - mean) * (x - mean);
+  b.noiseG = sqrt(var / (g.size() - 1));
+
+  // Weight noise around a load (the deadband would hide it at zero).
+  setLoad(scale.adc(), 5000.0f);
+  std::vector<double> w;
+  const unsigned long t0 = millis();
+  for (int i = 0; i < 40; ++i) w.push_back(scale.getWeightKg(true) * 1000.0);
+  b.weightMs = (millis() - t0) / 40.0;
+  mean = var = 0.0;
+  for (double x : w) mean += x;
+  mean /= w.size();
+  for (double x : w) var += (x - mean) * (x - mean);
+  b.weightNoiseG = sqrt(var / (w.size() - 1));
+  g_benches.push_back(b);
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_nau7802() { run<Nau7802Adc>(); }
+void test_hx711() { run<Hx711Adc>(); }
+void test_ads1232() { run<Ads1232Adc>(); }
+void test_emulated() { run<EmulatedAdc>(); }
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_adc").string();
+  std::error_code ec;
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_nau7802);
+  RUN_TEST(test_hx711);
+  RUN_TEST(test_ads1232);
+  RUN_TEST(test_emulated);
+
+  printf("%-10s %8s %12s %12s %14s %12s\n", "driver", "SPS", "ns/read", "noise g", "weight g", "weight ms");
+  for (const Bench &b : g_benches) {
+    printf("%-10s %8.1f %12.1f %12.2f %14.3f %12.0f\n", b.name, b.sps, b.nsPerRead, b.noiseG, b.weightNoiseG,
+           b.weightMs);
+  }
+  printf("(SPS and ms in virtual time at the active rate; ns/read is host CPU; noise from the shim model)\n");
+  shim::loadCell() = shim::LoadCellModel();
+  return UNITY_END();
+}
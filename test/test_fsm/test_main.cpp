@@ -0,0 +1,192 @@
+// WeighFsm transitions, guards and timers, fed readings directly (no loop,
+// no shims): one test per row group of the table in weigh_fsm.cpp.
+//
+//   pio test -e native -f test_fsm
+#include <unity.h>
+
+#include <cstring>
+
+#include "modules/weigh_fsm.h"
+
+namespace {
+
+constexpr unsigned long kStepMs = 200;
+
+WeighFsm::Params params() {
+  WeighFsm::Params p;
+  p.detectKg = 0.10f;
+  p.zeroKg = 0.05f;
+  p.stableStddevKg = 0.01f;
+  p.minEffectiveKg = 0.0f;
+  p.stableMinMs = 1000;
+  p.weighingTimeoutMs = 4000;
+  p.noIdZeroTimeoutMs = 2000;
+  return p;
+}
+
+WeighFsm g_fsm;
+unsigned long g_ms = 0;
+
+WeighFsm::Event step(float kg, bool idReady = false) {
+  g_ms += kStepMs;
+  return g_fsm.update(kg, g_ms, idReady);
+}
+
+// Feeds kg until an event other than None, at most maxSteps readings.
+WeighFsm::Event until(float kg, int maxSteps, bool idReady = false) {
+  for (int i = 0; i < maxSteps; ++i) {
+    const WeighFsm::Event ev = step(kg, idReady);
+    if (ev != WeighFsm::None) return ev;
+  }
+  return WeighFsm::None;
+}
+
+// Idle -> Weighing -> AskId on a steady kg.
+void weighSteady(float kg) {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(kg));
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(kg, 20));
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, g_fsm.state());
+}
+
+} // namespace
+
+void setUp() {
+  g_fsm = WeighFsm(params());
+  g_ms = 0;
+}
+void tearDown() {}
+
+void test_idle_until_detect_threshold() {
+  TEST_ASSERT_EQUAL(WeighFsm::None, until(0.08f, 20));
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, g_fsm.state());
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(0.5f));
+  TEST_ASSERT_EQUAL(WeighFsm::Weighing, g_fsm.state());
+}
+
+void test_stable_after_min_time() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(12.0f));
+  const unsigned long placedMs = g_ms;
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(12.0f, 20));
+  TEST_ASSERT_TRUE(g_ms - placedMs >= params().stableMinMs);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 12.0f, g_fsm.stableKg());
+}
+
+void test_bounce_restarts_stable_timer() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(5.0f));
+  for (int i = 0; i < 4; ++i) TEST_ASSERT_EQUAL(WeighFsm::None, step(i % 2 ? 5.3f : 4.7f));
+  const unsigned long bouncedMs = g_ms;
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(5.0f, 40));
+  // The buffer has to flush the bounce before the stable timer even starts.
+  TEST_ASSERT_TRUE(g_ms - bouncedMs >= params().stableMinMs + (WeighFsm::kBufN - 1) * kStepMs);
+}
+
+void test_timeout_commits_buffer_mean() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(8.0f));
+  WeighFsm::Event ev = WeighFsm::None;
+  for (int i = 0; i < 40 && ev == WeighFsm::None; ++i) ev = step(i % 2 ? 8.2f : 7.8f);
+  TEST_ASSERT_EQUAL(WeighFsm::TimedOut, ev);
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, g_fsm.state());
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 8.0f, g_fsm.stableKg());
+}
+
+void test_load_lost_while_weighing() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(3.0f));
+  TEST_ASSERT_EQUAL(WeighFsm::LoadLost, step(0.0f));
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, g_fsm.state());
+}
+
+void test_scan_binds_then_removal() {
+  weighSteady(10.0f);
+  TEST_ASSERT_EQUAL(WeighFsm::None, step(10.0f, false));
+  TEST_ASSERT_EQUAL(WeighFsm::IdBound, step(10.0f, true));
+  TEST_ASSERT_EQUAL(WeighFsm::AwaitRemoval, g_fsm.state());
+  TEST_ASSERT_EQUAL(WeighFsm::Removed, until(0.0f, 5));
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, g_fsm.state());
+}
+
+// The loop's pattern: a scan already waiting binds with a second update on
+// the reading that committed the weight.
+void test_waiting_scan_binds_on_commit_reading() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(10.0f));
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(10.0f, 20));
+  TEST_ASSERT_EQUAL(WeighFsm::IdBound, g_fsm.update(10.0f, g_ms, true));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f, g_fsm.stableKg());
+}
+
+void test_scan_ignored_outside_ask_id() {
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(6.0f, true));
+  TEST_ASSERT_EQUAL(WeighFsm::Weighing, g_fsm.state());
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(6.0f, 20, true));
+}
+
+void test_change_while_asking_reweighs() {
+  weighSteady(10.0f);
+  TEST_ASSERT_EQUAL(WeighFsm::Reweigh, step(10.5f));
+  TEST_ASSERT_EQUAL(WeighFsm::Weighing, g_fsm.state());
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(10.5f, 20));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.5f, g_fsm.stableKg());
+}
+
+void test_no_id_timeout_after_zero_held() {
+  weighSteady(4.0f);
+  TEST_ASSERT_EQUAL(WeighFsm::None, step(0.0f));
+  const unsigned long zeroMs = g_ms;
+  TEST_ASSERT_EQUAL(WeighFsm::NoIdTimeout, until(0.0f, 20));
+  TEST_ASSERT_TRUE(g_ms - zeroMs >= params().noIdZeroTimeoutMs);
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, g_fsm.state());
+}
+
+void test_zero_interrupted_restarts_timer() {
+  weighSteady(4.0f);
+  for (int i = 0; i < 5; ++i) step(0.0f);
+  step(0.08f);  // above zero, below detect: not a change, stops the zero timer
+  const unsigned long resumedMs = g_ms;
+  TEST_ASSERT_EQUAL(WeighFsm::NoIdTimeout, until(0.0f, 20));
+  TEST_ASSERT_TRUE(g_ms - resumedMs >= params().noIdZeroTimeoutMs);
+}
+
+void test_new_load_while_awaiting_removal() {
+  weighSteady(9.0f);
+  TEST_ASSERT_EQUAL(WeighFsm::IdBound, step(9.0f, true));
+  TEST_ASSERT_EQUAL(WeighFsm::Reweigh, step(18.0f));
+  TEST_ASSERT_EQUAL(WeighFsm::Weighing, g_fsm.state());
+}
+
+void test_tray_below_min_effective_is_zero() {
+  WeighFsm::Params p = params();
+  p.minEffectiveKg = 0.5f;
+  g_fsm = WeighFsm(p);
+  TEST_ASSERT_EQUAL(WeighFsm::None, until(0.4f, 10));
+  TEST_ASSERT_EQUAL(WeighFsm::LoadPlaced, step(3.0f));
+  TEST_ASSERT_EQUAL(WeighFsm::Stable, until(3.0f, 20));
+  TEST_ASSERT_EQUAL(WeighFsm::IdBound, step(3.0f, true));
+  TEST_ASSERT_EQUAL(WeighFsm::Removed, step(0.4f));
+}
+
+void test_reset_and_names() {
+  weighSteady(2.0f);
+  g_fsm.reset();
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, g_fsm.state());
+  TEST_ASSERT_EQUAL_STRING("ask_id", WeighFsm::stateName(WeighFsm::AskId));
+  TEST_ASSERT_EQUAL_STRING("no_id_timeout", WeighFsm::eventName(WeighFsm::NoIdTimeout));
+  TEST_ASSERT_EQUAL_STRING("?", WeighFsm::stateName(WeighFsm::kStateCount));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_until_detect_threshold);
+  RUN_TEST(test_stable_after_min_time);
+  RUN_TEST(test_bounce_restarts_stable_timer);
+  RUN_TEST(test_timeout_commits_buffer_mean);
+  RUN_TEST(test_load_lost_while_weighing);
+  RUN_TEST(test_scan_binds_then_removal);
+  RUN_TEST(test_waiting_scan_binds_on_commit_reading);
+  RUN_TEST(test_scan_ignored_outside_ask_id);
+  RUN_TEST(test_change_while_asking_reweighs);
+  RUN_TEST(test_no_id_timeout_after_zero_held);
+  RUN_TEST(test_zero_interrupted_restarts_timer);
+  RUN_TEST(test_new_load_while_awaiting_removal);
+  RUN_TEST(test_tray_below_min_effective_is_zero);
+  RUN_TEST(test_reset_and_names);
+  return UNITY_END();
+}
@@ -0,0 +1,491 @@
+// Weigh-in history at scale.
+//
+// 400 one-off visitors, then 280k weigh-ins by 300 cards over ~190 days
+// (busy cards weigh in far more often than occasional ones) go into
+// WeighLog on the LittleFS size of partitions_history.csv with the
+// [env:esp32dev_history] segment count, so the oldest segments are dropped
+// on the way. Per-card and all-card queries over a day, a week, a month and
+// everything kept are checked against a brute-force pass over the same
+// weigh-ins, with the records read and the host time per query. Then:
+//   - the visitors' card slots, their weigh-ins dropped, go to new cards;
+//   - a reboot (a fresh instance from flash) answers the same;
+//   - GET /history serves a card and the totals;
+//   - a torn record and a lost card head update are repaired at boot;
+//   - a directory grown past its allowance makes the log give up segments
+//     to keep WEIGHLOG_RESERVE_BYTES free; with LittleFS full, appends go
+//     on by dropping the oldest segment;
+//   - without a clock, times are estimated from the last record + uptime,
+//     flagged and never go back.
+// One test per stage, in order, on the same log. Flash use, wear (over the
+// free blocks measured) and RAM are reported at the end. [env:native]
+// builds with the esp32dev_history segment count.
+//
+//   pio test -e native -f test_history
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <LittleFS.h>
+
+#include "config.h"
+#include "modules/http_api.h"
+#include "modules/weigh_log.h"
+#include "shim.h"
+
+namespace {
+
+constexpr uint32_t kAppends = 280000;
+constexpr uint32_t kCards = 300;
+constexpr uint32_t kVisitors = 400;
+constexpr uint32_t kNewcomers = 50;
+constexpr size_t kFsBytes = 0x270000;  // partitions_history.csv "spiffs"
+constexpr size_t kBlock = 4096;
+constexpr uint32_t kStartS = 1767225600UL;  // 2026-01-01 00:00 UTC
+constexpr uint32_t kDayS = 86400;
+constexpr uint32_t kQueriedCards = 30;
+
+std::string g_fsRoot;
+
+class Capture : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
+
+// What went in, by record number (holes have card -1).
+struct Ref {
+  uint32_t timeS;
+  int32_t card;
+  uint16_t kg100;
+};
+std::vector<Ref> g_ref;
+std::vector<std::string> g_uids;      // by card number in the log
+std::vector<int32_t> g_cardOfFisher;  // fisher -> card number, -1 until seen
+std::vector<int32_t> g_queried;       // cards queried against brute force
+int32_t g_busy = -1;                  // the busiest card
+size_t g_fullUsed = 0;                // LittleFS used with the log full
+WeighLog *g_log = nullptr;
+
+std::string fisherUid(uint32_t i) {
+  char buf[24];
+  if (i % 10 == 0) snprintf(buf, sizeof(buf), "04%06X52%04X", (unsigned)(0x3A0000 + i * 7919), (unsigned)i);
+  else snprintf(buf, sizeof(buf), "%08X", (unsigned)(0x8E000000u + i * 2654435761u % 0xFFFFFF));
+  return buf;
+}
+
+void append(WeighLog &log, uint32_t fisher, uint16_t kg100) {
+  if (g_cardOfFisher[fisher] < 0) {
+    g_cardOfFisher[fisher] = (int32_t)g_uids.size();
+    g_uids.push_back(fisherUid(fisher));
+  }
+  const uint32_t t = log.nowS();
+  if (log.append(g_uids[g_cardOfFisher[fisher]].c_str(), kg100 / 100.0f)) {
+    g_ref.push_back({t, g_cardOfFisher[fisher], kg100});
+  }
+}
+
+struct Expected {
+  uint32_t count = 0;
+  uint64_t kg100 = 0;
+  bool truncated = false;
+};
+
+// Brute force over the records still on flash (the last `kept`). A card
+// with none kept is forgotten, so nothing is reported dropped for it.
+Expected expectCard(int32_t card, uint32_t since, uint32_t kept) {
+  Expected e;
+  const size_t first = g_ref.size() - kept;
+  bool dropped = false, older = false, any = false;
+  for (size_t n = 0; n < g_ref.size(); ++n) {
+    if (g_ref[n].card != card) continue;
+    if (n < first) {
+      dropped = true;
+      continue;
+    }
+    any = true;
+    if (g_ref[n].timeS < since) older = true;
+    else {
+      e.count++;
+      e.kg100 += g_ref[n].kg100;
+    }
+  }
+  e.truncated = dropped && any && !older;
+  return e;
+}
+
+Expected expectTotals(uint32_t since, uint32_t kept) {
+  Expected e;
+  for (size_t n = g_ref.size() - kept; n < g_ref.size(); ++n) {
+    if (g_ref[n].card < 0 || g_ref[n].timeS < since) continue;
+    e.count++;
+    e.kg100 += g_ref[n].kg100;
+  }
+  return e;
+}
+
+struct Stats {
+  uint32_t queries = 0;
+  uint64_t records = 0;
+  uint32_t maxRecords = 0;
+  double sumUs = 0.0;
+  double maxUs = 0.0;
+  bool match = true;
+
+  void add(const WeighLog::Result &r, double us) {
+    queries++;
+    records += r.recordsRead;
+    maxRecords = std::max(maxRecords, r.recordsRead);
+    sumUs += us;
+    maxUs = std::max(maxUs, us);
+  }
+  void print(const char *what) const {
+    printf("  %-26s %4u queries, records read mean %8.0f max %7u, host %7.0f us mean %7.0f max\n", what,
+           (unsigned)queries, queries ? (double)records / queries : 0.0, (unsigned)maxRecords,
+           queries ? sumUs / queries : 0.0, maxUs);
+  }
+};
+
+template <typename F>
+WeighLog::Result timed(Stats &s, F query) {
+  const auto t0 = std::chrono::steady_clock::now();
+  const WeighLog::Result r = query();
+  s.add(r, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+  return r;
+}
+
+bool same(const WeighLog::Result &r, const Expected &e, bool checkTruncated = true) {
+  return r.count == e.count && r.kg100 == e.kg100 && (!checkTruncated || r.truncated == e.truncated);
+}
+
+// Per-card and totals queries over the periods, against brute force.
+bool queryAll(WeighLog &log, const std::vector<int32_t> &cards, bool report) {
+  const uint32_t now = log.nowS();
+  const uint32_t oldest = g_ref[g_ref.size() - log.size()].timeS;
+  const struct {
+    const char *name;
+    uint32_t since;
+  } periods[] = {{"day", now - kDayS}, {"week", now - 7 * kDayS}, {"month", now - 30 * kDayS},
+                 {"everything kept", oldest - 1}};
+  bool ok = true;
+  Capture out;
+  for (const auto &p : periods) {
+    Stats card, totals;
+    for (int32_t c : cards) {
+      const WeighLog::Result r =
+          timed(card, [&] { return log.printCard(out, g_uids[c].c_str(), p.since, 20); });
+      card.match = card.match && same(r, expectCard(c, p.since, log.size()));
+    }
+    const WeighLog::Result r = timed(totals, [&] { return log.printTotals(out, p.since); });
+    totals.match = same(r, expectTotals(p.since, log.size()), false);
+    ok = ok && card.match && totals.match;
+    if (report) {
+      char what[64];
+      snprintf(what, sizeof(what), "card, %s", p.name);
+      card.print(what);
+      snprintf(what, sizeof(what), "all cards, %s", p.name);
+      totals.print(what);
+    }
+    out.text.clear();
+  }
+  return ok;
+}
+
+std::string hostPath(const char *path) { return g_fsRoot + path; }
+
+size_t freeBytes() { return LittleFS.totalBytes() - LittleFS.usedBytes(); }
+
+// Another LittleFS user's file, written through the shim so it takes blocks
+// the log could use; stops short when LittleFS is full.
+size_t writeFile(const char *path, size_t bytes) {
+  static const uint8_t zero[kBlock] = {};
+  File f = LittleFS.open(path, "w");
+  size_t n = 0;
+  while (f && n < bytes) {
+    const size_t w = f.write(zero, std::min(kBlock, bytes - n));
+    n += w;
+    if (w == 0) break;
+  }
+  if (f) f.close();
+  return n;
+}
+
+// Appends through a full or nearly full LittleFS, where a record may be
+// cut off and turned into a hole before the next one: the record numbers
+// tell (segments are dropped whole).
+bool appendTracked(WeighLog &log, uint32_t fisher, uint16_t kg100) {
+  const uint32_t before = log.size();
+  const size_t refs = g_ref.size();
+  append(log, fisher, kg100);
+  if (g_ref.size() == refs) return false;
+  const uint32_t grew = (log.size() + WeighLog::kMaxRecords - before) % WEIGHLOG_SEGMENT_RECORDS;
+  if (grew == 2) g_ref.insert(g_ref.end() - 1, {g_ref[refs - 1].timeS, -1, 0});
+  return grew == 1 || grew == 2;
+}
+
+// A reboot: a fresh instance from flash.
+bool reopen() {
+  delete g_log;
+  g_log = new WeighLog;
+  return g_log->begin();
+}
+
+std::string segmentFile(uint32_t seg) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), WEIGHLOG_DIR "/%08lx.dat", (unsigned long)seg);
+  return hostPath(buf);
+}
+
+// Flash use, RAM and wear with the log as the tests left it.
+void report() {
+  Capture out;
+  g_log->printText(out);
+  printf("%s", out.text.c_str());
+  const uint32_t kept = g_log->size();
+  printf("  RAM: %u bytes in this build (%u-segment fences), the default build %u\n", (unsigned)WeighLog::ramBytes(),
+         (unsigned)WEIGHLOG_MAX_SEGMENTS,
+         (unsigned)(WeighLog::ramBytes() - sizeof(uint32_t) * (WeighLog::kMaxRecords / WeighLog::kBlockRecords) +
+                    sizeof(uint32_t) * (12UL * WEIGHLOG_SEGMENT_RECORDS / WeighLog::kBlockRecords)));
+  if (kept == 0) return;
+  printf("  flash: %u weigh-ins in %u KB, %u bytes per weigh-in with the card table\n", (unsigned)kept,
+         (unsigned)((kept * sizeof(WeighLog::Record) + g_log->cards() * sizeof(WeighLog::CardEntry)) / 1024),
+         (unsigned)((kept * sizeof(WeighLog::Record) + g_log->cards() * sizeof(WeighLog::CardEntry) + kept / 2) / kept));
+  // Each append programs the record and the 4-byte card head. LittleFS
+  // copies on write, so at worst each is one 4 KB block erase, spread by
+  // its wear levelling over the free blocks: the ones left with the log
+  // full (measured after the first run) and a full ADC trace on flash.
+  const size_t worstUsed = g_fullUsed + ADC_TRACE_MAX_BYTES;
+  const double perDay = 1000.0, freeBlocks = (double)((kFsBytes - worstUsed) / kBlock), cycles = 100000.0;
+  printf("  LittleFS: %u of %u KB used with the log full, %u KB with a full trace too\n", (unsigned)(g_fullUsed / 1024),
+         (unsigned)(kFsBytes / 1024), (unsigned)(worstUsed / 1024));
+  printf("  wear: 2 writes per weigh-in (12 + 4 bytes), at worst 2 block erases; %.0f weigh-ins a day over\n"
+         "        %.0f free 4 KB blocks is %.1f erases per block a day, %.0f years to %.0fk cycles\n",
+         perDay, freeBlocks, 2 * perDay / freeBlocks, cycles / (2 * perDay / freeBlocks) / 365.0, cycles / 1000);
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_fill_drops_oldest_segments() {
+  char what[128];
+  g_log = new WeighLog;
+  TEST_ASSERT_TRUE_MESSAGE(g_log->begin() && g_log->size() == 0, "empty history opened");
+
+  printf("%u visitors, then %u weigh-ins by %u cards\n", (unsigned)kVisitors, (unsigned)kAppends, (unsigned)kCards);
+  g_cardOfFisher.assign(kCards + kVisitors + kNewcomers, -1);
+  for (uint32_t i = 0; i < kVisitors; ++i) {
+    shim::advanceUs(60ULL * 1000000ULL);
+    append(*g_log, kCards + i, 2500);
+  }
+  std::mt19937 rng(7);
+  std::vector<double> weights(kCards);
+  for (uint32_t i = 0; i < kCards; ++i) weights[i] = 1.0 / (1.0 + i * 0.05);  // a few busy boats
+  std::discrete_distribution<uint32_t> pickFisher(weights.begin(), weights.end());
+  std::uniform_int_distribution<uint32_t> gapS(20, 100);
+  std::uniform_int_distribution<uint32_t> kg100(150, 6000);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kAppends; ++i) {
+    shim::advanceUs((uint64_t)gapS(rng) * 1000000ULL);
+    append(*g_log, pickFisher(rng), (uint16_t)kg100(rng));
+  }
+  const double appendUs =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / kAppends;
+  printf("  %.1f days, %.1f us per append on the host\n", (g_log->nowS() - kStartS) / (double)kDayS, appendUs);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(kVisitors + kAppends, g_ref.size(), "all appended");
+  snprintf(what, sizeof(what), "oldest segments dropped, %u kept of %u, %u cards", (unsigned)g_log->size(),
+           (unsigned)g_ref.size(), (unsigned)g_log->cards());
+  TEST_ASSERT_TRUE_MESSAGE(g_log->size() <= WeighLog::kMaxRecords &&
+                               g_log->size() > WeighLog::kMaxRecords - WEIGHLOG_SEGMENT_RECORDS &&
+                               g_log->cards() == kCards,
+                           what);
+  snprintf(what, sizeof(what), "%u KB free of %u KB, WEIGHLOG_RESERVE_BYTES %u KB", (unsigned)(freeBytes() / 1024),
+           (unsigned)(kFsBytes / 1024), (unsigned)(WEIGHLOG_RESERVE_BYTES / 1024));
+  TEST_ASSERT_TRUE_MESSAGE(freeBytes() >= WEIGHLOG_RESERVE_BYTES, what);
+  g_fullUsed = LittleFS.usedBytes();
+}
+
+void test_queries_match_brute_force() {
+  for (uint32_t i = 0; i < kQueriedCards; ++i) g_queried.push_back(g_cardOfFisher[i * kCards / kQueriedCards]);
+  g_queried.push_back(g_cardOfFisher[kCards]);  // a visitor
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, true), "per-card and all-card totals match");
+  Capture out;
+  g_busy = g_cardOfFisher[0];
+  WeighLog::Result r = g_log->printCard(out, g_uids[g_busy].c_str(), WeighLog::kDefaultSinceS, 5);
+  TEST_ASSERT_TRUE_MESSAGE(r.count > 5 && out.text.find("... ") != std::string::npos,
+                           "listing stops at the limit, totals cover all");
+  out.text.clear();
+  r = g_log->printCard(out, g_uids[g_busy].c_str(), 1, 5);
+  TEST_ASSERT_TRUE_MESSAGE(r.truncated && out.text.find("dropped from flash") != std::string::npos,
+                           "dropped weigh-ins are reported");
+  out.text.clear();
+  r = g_log->printCard(out, "0BADCAFE", WeighLog::kDefaultSinceS);
+  TEST_ASSERT_TRUE_MESSAGE(r.count == 0 && r.recordsRead == 0, "unknown card: nothing read");
+}
+
+void test_new_cards_reuse_slots() {
+  std::error_code ec;
+  const size_t cardsBin = std::filesystem::file_size(hostPath(WEIGHLOG_DIR "/cards.bin"), ec);
+  for (uint32_t i = 0; i < kNewcomers; ++i) {
+    shim::advanceUs(60ULL * 1000000ULL);
+    append(*g_log, kCards + kVisitors + i, 3000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(kCards + kNewcomers, g_log->cards());
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(cardsBin, std::filesystem::file_size(hostPath(WEIGHLOG_DIR "/cards.bin"), ec),
+                                   "new cards take dropped visitors' slots, cards.bin does not grow");
+  g_queried.push_back(g_cardOfFisher[kCards + kVisitors]);
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "answers match, visitors' weigh-ins forgotten");
+}
+
+void test_reboot_same_answers() {
+  const uint32_t keptBefore = g_log->size();
+  TEST_ASSERT_TRUE_MESSAGE(reopen(), "reopened from flash");
+  TEST_ASSERT_EQUAL_UINT32(keptBefore, g_log->size());
+  TEST_ASSERT_EQUAL_UINT32(kCards + kNewcomers, g_log->cards());
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "same answers after the reboot");
+}
+
+void test_http_history() {
+  HttpApi api;
+  api.setHistory(g_log);
+  api.begin();
+  std::string body;
+  int code = shim::webRequest("GET", "/history", {{"uid", g_uids[g_busy]}, {"since", "-604800"}}, &body);
+  const Expected week = expectCard(g_busy, g_log->nowS() - 7 * kDayS, g_log->size());
+  TEST_ASSERT_EQUAL(200, code);
+  TEST_ASSERT_TRUE_MESSAGE(body.find("history: " + std::to_string(week.count) + " weigh-ins") != std::string::npos,
+                           "card week");
+  code = shim::webRequest("GET", "/history", {}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 200 && body.find("by ") != std::string::npos, "totals for the last 24 h");
+  TEST_ASSERT_EQUAL_MESSAGE(400, shim::webRequest("GET", "/history", {{"uid", "xyz"}}, &body), "bad uid is a 400");
+}
+
+void test_power_cut_repaired() {
+  {
+    std::ofstream torn(segmentFile((uint32_t)g_ref.size() / WEIGHLOG_SEGMENT_RECORDS), std::ios::app | std::ios::binary);
+    torn.write("\x12\x34\x56\x78\x9a", 5);
+  }
+  const uint32_t before = g_log->size();
+  TEST_ASSERT_TRUE(reopen());
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(before + 1, g_log->size(), "torn record replaced by a hole");
+  g_ref.push_back({g_ref.back().timeS, -1, 0});
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "answers unchanged");
+  shim::advanceUs(60ULL * 1000000ULL);
+  append(*g_log, 0, 1234);
+  {
+    // Roll the card head back to before the append, as if the write was lost.
+    uint32_t older = 0xFFFFFFFFUL;
+    for (size_t n = g_ref.size() - 1; n-- > 0;) {
+      if (g_ref[n].card == g_busy) {
+        older = (uint32_t)n;
+        break;
+      }
+    }
+    std::fstream cardsFile(hostPath(WEIGHLOG_DIR "/cards.bin"), std::ios::in | std::ios::out | std::ios::binary);
+    cardsFile.seekp((std::streamoff)g_busy * sizeof(WeighLog::CardEntry) + offsetof(WeighLog::CardEntry, head));
+    cardsFile.write(reinterpret_cast<const char *>(&older), sizeof(older));
+  }
+  TEST_ASSERT_TRUE(reopen());
+  Capture out;
+  const WeighLog::Result r = g_log->printCard(out, g_uids[g_busy].c_str(), WeighLog::kDefaultSinceS);
+  TEST_ASSERT_TRUE_MESSAGE(same(r, expectCard(g_busy, g_log->nowS() - kDayS, g_log->size())),
+                           "lost card head update redone");
+}
+
+void test_littlefs_filling_up() {
+  char what[128];
+  const uint32_t keptFull = g_log->size();
+  writeFile(ADC_TRACE_PATH, ADC_TRACE_MAX_BYTES);
+  writeFile(ID_DIRECTORY_PATH, freeBytes() - 256 * 1024);  // far past the directory's allowance
+  // g_ref[n] is record n: append up to the first record of the next segment.
+  bool appended = true;
+  do {
+    shim::advanceUs(60ULL * 1000000ULL);
+    appended = appendTracked(*g_log, 0, 1500) && appended;
+  } while (g_ref.size() % WEIGHLOG_SEGMENT_RECORDS != 1);
+  snprintf(what, sizeof(what), "new segment: %u of %u weigh-ins kept, %u KB free", (unsigned)g_log->size(),
+           (unsigned)keptFull, (unsigned)(freeBytes() / 1024));
+  TEST_ASSERT_TRUE_MESSAGE(appended && g_log->size() < keptFull - WEIGHLOG_SEGMENT_RECORDS &&
+                               freeBytes() >= WEIGHLOG_RESERVE_BYTES,
+                           what);
+  const uint32_t keptReserved = g_log->size();
+  writeFile(ID_DIRECTORY_PATH ".tmp", freeBytes());  // a staged copy takes the rest
+  const uint32_t holes = (uint32_t)std::count_if(g_ref.begin(), g_ref.end(), [](const Ref &x) { return x.card < 0; });
+  for (uint32_t i = 0; g_ref.size() % WEIGHLOG_SEGMENT_RECORDS != 0; ++i) {  // to the end of the segment
+    shim::advanceUs(60ULL * 1000000ULL);
+    appended = appendTracked(*g_log, i % kCards, 1500 + i % 1000) && appended;
+  }
+  const uint32_t newHoles =
+      (uint32_t)std::count_if(g_ref.begin(), g_ref.end(), [](const Ref &x) { return x.card < 0; }) - holes;
+  snprintf(what, sizeof(what), "LittleFS full: every append made it, %u kept, %u cut off and made holes",
+           (unsigned)g_log->size(), (unsigned)newHoles);
+  TEST_ASSERT_TRUE_MESSAGE(appended && newHoles > 0 && g_log->ready() && g_log->size() < keptReserved, what);
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "answers match");
+  LittleFS.remove(ID_DIRECTORY_PATH ".tmp");
+  LittleFS.remove(ID_DIRECTORY_PATH);
+  const uint32_t keptNow = g_log->size();
+  TEST_ASSERT_TRUE(reopen());
+  TEST_ASSERT_EQUAL_UINT32(keptNow, g_log->size());
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "reopened, same answers");
+}
+
+void test_reboot_without_clock() {
+  char what[128];
+  const uint32_t lastS = g_ref.back().timeS;
+  delete g_log;
+  g_log = nullptr;
+  shim::setWallClock(0);
+  shim::resetTime(0);
+  TEST_ASSERT_TRUE_MESSAGE(reopen() && !g_log->clockSet(), "opened, clock not set");
+  for (uint32_t i = 0; i < 3; ++i) {
+    shim::advanceUs(90ULL * 1000000ULL);
+    append(*g_log, 1, 2000 + i);
+  }
+  bool monotonic = g_ref.back().timeS >= lastS;
+  for (size_t n = g_ref.size() - 3; n < g_ref.size(); ++n) monotonic = monotonic && g_ref[n].timeS >= g_ref[n - 1].timeS;
+  snprintf(what, sizeof(what), "estimated times follow the last record (+%u s)", (unsigned)(g_ref.back().timeS - lastS));
+  TEST_ASSERT_TRUE_MESSAGE(monotonic && g_ref.back().timeS <= lastS + 300, what);
+  Capture out;
+  const WeighLog::Result r = g_log->printCard(out, g_uids[g_cardOfFisher[1]].c_str(), lastS);
+  TEST_ASSERT_TRUE_MESSAGE(r.count == 3 && out.text.find("~") != std::string::npos, "listed and flagged as estimated");
+  shim::setWallClock(lastS + 3600);
+  append(*g_log, 1, 2100);
+  TEST_ASSERT_TRUE_MESSAGE(g_log->clockSet() && g_ref.back().timeS == lastS + 3600, "clock back: real time again");
+  TEST_ASSERT_TRUE_MESSAGE(queryAll(*g_log, g_queried, false), "answers match");
+}
+
+int main(int, char **) {
+  g_fsRoot = (std::filesystem::temp_directory_path() / "fishcore_history").string();
+  std::error_code ec;
+  std::filesystem::remove_all(g_fsRoot, ec);
+  std::filesystem::create_directories(g_fsRoot, ec);
+  shim::setFsRoot(g_fsRoot);
+  shim::setFsCapacity(kFsBytes);
+  shim::resetTime(0);
+  shim::setWallClock(kStartS);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_drops_oldest_segments);
+  RUN_TEST(test_queries_match_brute_force);
+  RUN_TEST(test_new_cards_reuse_slots);
+  RUN_TEST(test_reboot_same_answers);
+  RUN_TEST(test_http_history);
+  RUN_TEST(test_power_cut_repaired);
+  RUN_TEST(test_littlefs_filling_up);
+  RUN_TEST(test_reboot_without_clock);
+  if (g_log != nullptr) report();
+  delete g_log;
+  return UNITY_END();
+}
@@ -0,0 +1,278 @@
+// Runtime weighing parameters without a restart.
+//
+// The station boots on the config.h defaults and weighs a round of crates
+// dropped on the platform (overshoot, bounce, creep). "u profile crates" on
+// serial switches it to the crates profile between two loop iterations; a
+// POST /params then overrides the settle time and the ADC rate on top. Each
+// round is weighed again: the same weights within 1%, sooner after the drop.
+// A bad value is a 400 that changes nothing, a fresh StationParams reads the
+// same values back from NVS, and save/reset/profile round-trip. POST needs
+// the Basic auth password [env:native] builds in (PARAMS_HTTP_PASSWORD).
+// One test per stage, in order, on the one station setup() booted.
+//
+//   pio test -e native -f test_params
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/scale.h"
+#include "modules/station_params.h"
+#include "modules/weigh_fsm.h"
+#include "shim.h"
+
+void setup();
+void loop();
+extern ScaleManager scale;
+extern WeighFsm fsm;
+extern StationParams params;
+extern uint32_t loopPeriodMs;
+
+static_assert(sizeof(PARAMS_HTTP_PASSWORD) > 1, "build with -DPARAMS_HTTP_PASSWORD=\"...\" ([env:native])");
+
+namespace {
+
+constexpr uint64_t kSecondUs = 1000000ULL;
+constexpr uint64_t kHoldUs = 14 * kSecondUs;
+constexpr uint64_t kGapUs = 25 * kSecondUs;
+constexpr uint32_t kRound = 4;
+
+struct Crate {
+  uint64_t placeUs;
+  float grams;
+  std::string uid;
+  uint64_t uploadUs = 0;
+  std::string url;
+};
+
+std::vector<Crate> g_crates;
+
+std::string uidHex(uint32_t i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "04%06X", (unsigned)(i & 0xFFFFFF));
+  return buf;
+}
+
+// A crate dropped on the platform: overshoot and a damped bounce around the
+// final load, then a slow creep.
+float crateGrams(float grams, double t) {
+  const double bounce = 0.35 * exp(-t / 0.6) * cos(2.0 * M_PI * 3.0 * t);
+  const double creep = 0.002 * (1.0 - exp(-t / 4.0));
+  return (float)(grams * (1.0 + bounce + creep));
+}
+
+void runUntil(uint64_t us) {
+  while (shim::nowUs() < us) loop();
+}
+
+struct RoundResult {
+  bool weightsOk = true;
+  double meanS = 0.0;  // drop to upload
+};
+
+RoundResult g_onDefaults, g_onCrates;  // rounds on the defaults and the crates profile
+StationParams::Values g_tuned;         // after the POST overrides
+
+// kRound crates, kGapUs apart, card shown a second after the drop.
+RoundResult weighRound(uint32_t firstCard) {
+  const size_t first = g_crates.size();
+  const uint64_t startUs = shim::nowUs() + 2 * kSecondUs;
+  for (uint32_t i = 0; i < kRound; ++i) {
+    const uint32_t card = firstCard + i;
+    Crate c;
+    c.placeUs = startUs + i * kGapUs;
+    c.grams = 12000.0f + 4500.0f * i;
+    c.uid = uidHex(card);
+    g_crates.push_back(c);
+    const uint64_t scanUs = c.placeUs + kSecondUs;
+    shim::presentCard({0x04, (uint8_t)(card >> 16), (uint8_t)(card >> 8), (uint8_t)card}, scanUs,
+                      scanUs + 3 * kSecondUs);
+  }
+  runUntil(startUs + kRound * kGapUs);
+  RoundResult r;
+  for (size_t i = first; i < g_crates.size(); ++i) {
+    const Crate &c = g_crates[i];
+    const std::string expected = "/" + c.uid + "/1/";
+    const size_t at = c.url.find(expected);
+    const float kg = at == std::string::npos ? 0.0f : strtof(c.url.c_str() + at + expected.size(), nullptr);
+    r.weightsOk = r.weightsOk && c.uploadUs != 0 && fabsf(kg * 1000.0f - c.grams) <= c.grams * 0.01f;
+    r.meanS += (c.uploadUs - c.placeUs) / 1e6 / kRound;
+  }
+  return r;
+}
+
+// Serial command line, taken by the next loop() iteration.
+std::string serial(const std::string &line) {
+  shim::clearSerialOutput();
+  shim::serialInput(line + "\n");
+  loop();
+  return shim::serialOutput();
+}
+
+bool sameValues(const StationParams::Values &a, const StationParams::Values &b) {
+  for (const StationParams::Def &d : StationParams::kDefs) {
+    if (StationParams::get(a, d) != StationParams::get(b, d)) return false;
+  }
+  return true;
+}
+
+// The FSM, the ADC and the loop pacing run on v.
+bool applied(const StationParams::Values &v) {
+  const WeighFsm::Params &p = fsm.params();
+  return p.stableStddevKg == v.stableStddevKg && p.minEffectiveKg == v.minEffectiveKg &&
+         p.stableMinMs == v.stableMinMs && p.weighingTimeoutMs == v.weighingTimeoutMs &&
+         p.noIdZeroTimeoutMs == v.noIdZeroTimeoutMs && scale.activeHz() == (float)v.adcSps &&
+         loopPeriodMs == v.loopPeriodMs;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_boot_on_defaults() {
+  const StationParams::Values defaults;
+  TEST_ASSERT_EQUAL_STRING("default", params.profile());
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(params.values(), defaults) && applied(defaults), "config.h values applied");
+  g_onDefaults = weighRound(100);
+  char what[96];
+  snprintf(what, sizeof(what), "%u crates uploaded within 1%% (%.1f s from drop)", (unsigned)kRound,
+           g_onDefaults.meanS);
+  TEST_ASSERT_TRUE_MESSAGE(g_onDefaults.weightsOk, what);
+}
+
+void test_serial_profile_switch() {
+  const uint32_t gen = params.generation();
+  const std::string out = serial("u profile crates");
+  TEST_ASSERT_TRUE_MESSAGE(out.find("params: profile crates") != std::string::npos && params.generation() != gen,
+                           "profile switched");
+  TEST_ASSERT_TRUE_MESSAGE(applied(params.values()) && scale.activeHz() == 40.0f,
+                           "applied on the next iteration (ADC at 40 SPS)");
+  g_onCrates = weighRound(200);
+  char what[96];
+  snprintf(what, sizeof(what), "%u crates within 1%% (%.1f s from drop, %.1f s on defaults)", (unsigned)kRound,
+           g_onCrates.meanS, g_onDefaults.meanS);
+  TEST_ASSERT_TRUE_MESSAGE(g_onCrates.weightsOk && g_onCrates.meanS < g_onDefaults.meanS, what);
+}
+
+void test_post_overrides() {
+  std::string body;
+  const uint32_t genNoAuth = params.generation();
+  int code = shim::webRequest("POST", "/params", {{"stable_min_ms", "900"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 401 && params.generation() == genNoAuth,
+                           "without credentials: 401, nothing applied");
+  shim::setWebCredentials(PARAMS_HTTP_USER, PARAMS_HTTP_PASSWORD);
+  code = shim::webRequest("POST", "/params", {{"stable_min_ms", "900"}, {"adc_sps", "80"}}, &body);
+  loop();
+  TEST_ASSERT_EQUAL(200, code);
+  TEST_ASSERT_TRUE_MESSAGE(body.find("stable_min_ms") != std::string::npos && body.find("station") != std::string::npos,
+                           "listing marks the station overrides");
+  TEST_ASSERT_TRUE_MESSAGE(applied(params.values()) && params.values().stableMinMs == 900 && scale.activeHz() == 80.0f,
+                           "applied (900 ms settle, 80 SPS)");
+  const RoundResult tuned = weighRound(300);
+  char what[96];
+  snprintf(what, sizeof(what), "%u crates within 1%% (%.1f s from drop, %.1f s on crates)", (unsigned)kRound,
+           tuned.meanS, g_onCrates.meanS);
+  TEST_ASSERT_TRUE_MESSAGE(tuned.weightsOk && tuned.meanS < g_onCrates.meanS, what);
+  g_tuned = params.values();
+}
+
+void test_rejected_changes() {
+  std::string body;
+  const uint32_t genBefore = params.generation();
+  int code = shim::webRequest("POST", "/params", {{"weighing_timeout_ms", "4000"}, {"stable_min_ms", "5"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 400 && params.generation() == genBefore && sameValues(params.values(), g_tuned),
+                           "out of range: 400, nothing applied");
+  code = shim::webRequest("POST", "/params", {{"weighing_timeout_ms", "800"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 400 && body.find("below stable_min_ms") != std::string::npos &&
+                               params.generation() == genBefore && sameValues(params.values(), g_tuned),
+                           "timeout below the settle time: 400, nothing applied");
+  code = shim::webRequest("POST", "/params", {{"stable_min_ms", "5000"}, {"weighing_timeout_ms", "800"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 400 && params.generation() == genBefore && sameValues(params.values(), g_tuned),
+                           "valid field before a conflicting one: 400, neither applied");
+  std::string out = serial("u weighing_timeout_ms 500");
+  TEST_ASSERT_TRUE_MESSAGE(out.find("below stable_min_ms") != std::string::npos && params.generation() == genBefore,
+                           "serial: timeout below the settle time rejected");
+  code = shim::webRequest("POST", "/params", {{"adc_sps", "40.5"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 400 && params.generation() == genBefore, "fraction for a whole number: 400");
+  code = shim::webRequest("POST", "/params", {{"profile", "eels"}}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 400 && params.generation() == genBefore, "unknown profile: 400");
+  out = serial("u loop_period_ms fast");
+  TEST_ASSERT_TRUE_MESSAGE(out.find("takes") != std::string::npos && params.generation() == genBefore,
+                           "serial: bad value rejected");
+  out = serial("u save crates");
+  TEST_ASSERT_TRUE_MESSAGE(out.find("cannot save") != std::string::npos && params.generation() == genBefore,
+                           "serial: built-in profile not overwritten");
+}
+
+void test_saved_profile_reload() {
+  std::string body;
+  int code = shim::webRequest("POST", "/params", {{"save", "dock-3"}}, &body);
+  loop();
+  TEST_ASSERT_EQUAL(200, code);
+  TEST_ASSERT_EQUAL_STRING("dock-3", params.profile());
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(params.values(), g_tuned), "saved as dock-3, station runs it");
+  StationParams reloaded;
+  reloaded.begin();
+  TEST_ASSERT_EQUAL_STRING("dock-3", reloaded.profile());
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(reloaded.values(), g_tuned), "a fresh instance reads the same values back");
+  const StationParams::Values defaults;
+  serial("u reset");
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(params.values(), defaults) && applied(defaults), "u reset: defaults applied");
+  serial("u profile dock-3");
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(params.values(), g_tuned) && applied(g_tuned),
+                           "u profile dock-3: saved values applied");
+  serial("u stable_min_ms 1200");
+  serial("u stable_min_ms default");
+  TEST_ASSERT_TRUE_MESSAGE(sameValues(params.values(), g_tuned), "override dropped back to the profile");
+  code = shim::webRequest("GET", "/params", {}, &body);
+  TEST_ASSERT_TRUE_MESSAGE(code == 200 && body.find("profile dock-3") != std::string::npos &&
+                               body.find("small-fish") != std::string::npos,
+                           "GET /params lists values and profiles");
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, shim::restarts(), "no restart");
+}
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_params").string();
+  std::error_code ec;
+  std::filesystem::remove_all(fsRoot, ec);
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+  shim::resetTime(0);
+  shim::setWifiAvailable(true, 300);
+  shim::setDrdyPin(SCALE_DRDY_PIN);
+  shim::setHttpHandler([](const std::string &url) {
+    if (url.rfind(ID_DIRECTORY_SYNC_URL, 0) == 0) return shim::HttpResponse{200, "v 1 full\n. 0\n", 120};
+    for (Crate &c : g_crates) {
+      if (c.uploadUs == 0 && url.find("/" + c.uid + "/") != std::string::npos) {
+        c.uploadUs = shim::nowUs();
+        c.url = url;
+        break;
+      }
+    }
+    return shim::HttpResponse{200, "OK", 90};
+  });
+  shim::loadCell().loadGrams = [](uint64_t now) -> float {
+    for (const Crate &c : g_crates) {
+      if (now >= c.placeUs && now < c.placeUs + kHoldUs) return crateGrams(c.grams, (now - c.placeUs) / 1e6);
+    }
+    return 0.0f;
+  };
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_on_defaults);
+  RUN_TEST(test_serial_profile_switch);
+  RUN_TEST(test_post_overrides);
+  RUN_TEST(test_rejected_changes);
+  RUN_TEST(test_saved_profile_reload);
+  const int failures = UNITY_END();
+  shim::loadCell().loadGrams = [](uint64_t) { return 0.0f; };
+  shim::setHttpHandler([](const std::string &) { return shim::HttpResponse{}; });
+  return failures;
+}
@@ -0,0 +1,250 @@
+// Config portal with the scale running.
+//
+// The station boots with no reachable network, so WiFiManager starts the
+// AP+STA config portal and setup() carries on with the scale. Three crates
+// are weighed while a phone browses the portal; the weigh-ins are queued,
+// not sent, and the background join waits for the phone to leave. A /save
+// with the router still down fails to join and leaves the portal up; with
+// the router up, a second /save joins live, a crate weighed while the
+// portal lingers is queued too, the portal closes after
+// WIFI_PORTAL_LINGER_MS and the queue goes out with the right IDs and
+// weights, the first one after a read timeout (sent once, not again). A
+// fifth crate is then uploaded directly. One test per stage, in order, on
+// the one station setup() booted.
+//
+// The portal task is not scheduled on the host (shim tasks never run), so
+// this suite steps it with wifiMgr.loop() between loop() iterations, the
+// way the task interleaves with the loop on the device.
+//
+//   pio test -e native -f test_portal
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/metrics.h"
+#include "modules/uploader.h"
+#include "modules/wifi_manager.h"
+#include "shim.h"
+
+void setup();
+void loop();
+extern WiFiManager wifiMgr;
+extern Uploader uploader;
+extern bool wifiConfigMode;
+
+namespace {
+
+constexpr uint64_t kSecondUs = 1000000ULL;
+constexpr uint64_t kHoldUs = 12 * kSecondUs;
+
+struct Crate {
+  uint64_t placeUs;
+  float grams;
+  std::string uid;
+};
+
+std::vector<Crate> g_crates;
+std::vector<std::string> g_uploads;  // upload URLs, directory syncs left out
+uint32_t g_portalPages = 0;          // portal requests answered 200
+bool g_sawQueued = false;            // "Saved, queued 3" on row 3
+bool g_slowNext = false;             // next upload answered after UPLOAD_HTTP_TIMEOUT_MS
+uint64_t g_bootUs = 0;
+
+std::string uidHex(uint32_t i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "04%06X", (unsigned)(i & 0xFFFFFF));
+  return buf;
+}
+
+void addCrate(uint64_t placeUs, float grams, uint32_t card) {
+  g_crates.push_back({placeUs, grams, uidHex(card)});
+  const uint64_t scanUs = placeUs + kSecondUs;
+  shim::presentCard({0x04, (uint8_t)(card >> 16), (uint8_t)(card >> 8), (uint8_t)card}, scanUs,
+                    scanUs + 3 * kSecondUs);
+}
+
+std::string portal(const char *method, const char *uri,
+                   const std::vector<std::pair<std::string, std::string>> &args = {}) {
+  std::string body;
+  if (shim::webRequest(method, uri, args, &body) == 200) g_portalPages++;
+  return body;
+}
+
+// One loop() iteration, the portal task's step, and a phone reloading the
+// status page every few seconds while the portal is up.
+void step() {
+  loop();
+  wifiMgr.loop();
+  static uint64_t nextPageUs = 0;
+  if (wifiMgr.isConfigPortalActive() && shim::nowUs() >= nextPageUs) {
+    portal("GET", (g_portalPages % 2) ? "/status" : "/");
+    nextPageUs = shim::nowUs() + 3 * kSecondUs;
+  }
+  if (shim::lcdRow(3).find("Saved, queued 3") != std::string::npos) g_sawQueued = true;
+}
+
+void runUntil(uint64_t us) {
+  while (shim::nowUs() < us) step();
+}
+
+template <typename Pred>
+bool runUntil(uint64_t us, Pred done) {
+  while (shim::nowUs() < us) {
+    if (done()) return true;
+    step();
+  }
+  return done();
+}
+
+// Upload URL i carries crate c's card and weight (1% for creep and noise).
+bool uploadMatches(size_t i, const Crate &c) {
+  if (i >= g_uploads.size()) return false;
+  const std::string expected = "/" + c.uid + "/1/";
+  const size_t at = g_uploads[i].find(expected);
+  if (at == std::string::npos) return false;
+  const float kg = strtof(g_uploads[i].c_str() + at + expected.size(), nullptr);
+  return fabsf(kg * 1000.0f - c.grams) <= c.grams * 0.01f;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_boot_opens_portal() {
+  char what[96];
+  snprintf(what, sizeof(what), "config portal up, scale running (%.1f s boot)", g_bootUs / 1e6);
+  TEST_ASSERT_TRUE_MESSAGE(wifiConfigMode && wifiMgr.isConfigPortalActive() && shim::lcdRow(3).find("Setup") == 0,
+                           what);
+}
+
+void test_crates_queued_while_browsing() {
+  const uint32_t begins = shim::wifiBegins();
+  for (uint32_t i = 0; i < 3; ++i) addCrate(g_bootUs + (10 + 25 * i) * kSecondUs, 6000.0f + 1500.0f * i, 200 + i);
+  runUntil(g_bootUs + 85 * kSecondUs);
+  TEST_ASSERT_EQUAL_UINT32(3, uploader.queued());
+  TEST_ASSERT_EQUAL_UINT32(0, g_uploads.size());
+  TEST_ASSERT_TRUE_MESSAGE(g_sawQueued, "LCD showed \"Saved, queued 3\"");
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(begins, shim::wifiBegins(), "no background join with the phone on the AP");
+}
+
+void test_save_with_router_down() {
+  portal("POST", "/save", {{"ssid", "harbour"}, {"pass", "secret"}});
+  runUntil(shim::nowUs() + 12 * kSecondUs);
+  const std::string status = portal("GET", "/status");
+  TEST_ASSERT_TRUE_MESSAGE(status.find("Could not connect") != std::string::npos, "join fails");
+  TEST_ASSERT_TRUE_MESSAGE(wifiMgr.isConfigPortalActive(), "portal stays up");
+}
+
+void test_retry_once_phone_left() {
+  const uint32_t begins = shim::wifiBegins();
+  runUntil(shim::nowUs() + (WIFI_PORTAL_RETRY_MS + 5000) * 1000ULL);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(begins, shim::wifiBegins(), "held while the phone is on the AP");
+  shim::setApStations(0);
+  const bool retried = runUntil(shim::nowUs() + 5 * kSecondUs, [&] { return shim::wifiBegins() > begins; });
+  TEST_ASSERT_TRUE_MESSAGE(retried, "retried as soon as the phone left");
+  runUntil(shim::nowUs() + 10 * kSecondUs);  // router still down: the join fails
+  shim::setApStations(1);
+}
+
+void test_save_joins_live() {
+  shim::setWifiAvailable(true, 2000);
+  g_slowNext = true;  // the first queued weigh-in, once online
+  std::string status = portal("POST", "/save", {{"ssid", "harbour"}, {"pass", "secret"}});
+  TEST_ASSERT_TRUE_MESSAGE(status.find("Connecting") != std::string::npos, "save answered without a restart");
+  const bool joined = runUntil(shim::nowUs() + 15 * kSecondUs, [] { return wifiMgr.isConnected(); });
+  status = portal("GET", "/status");
+  TEST_ASSERT_TRUE_MESSAGE(joined && status.find("Connected to harbour") != std::string::npos,
+                           "joined live, status page reports it");
+  const uint64_t joinedUs = shim::nowUs();
+  addCrate(joinedUs + kSecondUs, 8000.0f, 250);  // weighed while the portal lingers
+  const bool closed = runUntil(joinedUs + 20 * kSecondUs, [] { return !wifiConfigMode; });
+  char what[96];
+  snprintf(what, sizeof(what), "portal closed after %.1f s, station left portal mode", (shim::nowUs() - joinedUs) / 1e6);
+  TEST_ASSERT_TRUE_MESSAGE(closed && !wifiMgr.isConfigPortalActive(), what);
+  std::string metrics;
+  TEST_ASSERT_EQUAL_MESSAGE(200, shim::webRequest("GET", "/metrics", {}, &metrics),
+                            "/metrics served (HttpApi started)");
+  TEST_ASSERT_TRUE_MESSAGE(wifiMgr.loadSavedCredentials().ssid == "harbour", "credentials saved");
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(4, uploader.queued(), "the lingering portal's weigh-in queued");
+  TEST_ASSERT_EQUAL_UINT32(4, Metrics::weighIns(Metrics::Queued));
+  TEST_ASSERT_EQUAL_UINT32(0, g_uploads.size());
+}
+
+void test_queue_flushed_online() {
+  runUntil(shim::nowUs() + 30 * kSecondUs, [] { return uploader.queued() == 0; });
+  TEST_ASSERT_EQUAL_UINT32(0, uploader.queued());
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(4, g_uploads.size(), "the timed-out one not sent again");
+  for (size_t i = 0; i < 4; ++i) TEST_ASSERT_TRUE_MESSAGE(uploadMatches(i, g_crates[i]), "queued weigh-in in order");
+}
+
+void test_crate_online_uploaded_directly() {
+  addCrate(shim::nowUs() + 5 * kSecondUs, 9000.0f, 300);
+  runUntil(shim::nowUs() + 30 * kSecondUs);
+  TEST_ASSERT_EQUAL_UINT32(5, g_uploads.size());
+  TEST_ASSERT_TRUE(uploadMatches(4, g_crates[4]));
+  TEST_ASSERT_EQUAL_UINT32(1, Metrics::weighIns(Metrics::Uploaded));
+  TEST_ASSERT_EQUAL_UINT32(0, Metrics::weighIns(Metrics::UploadFailed));
+  TEST_ASSERT_EQUAL_UINT32(0, shim::restarts());
+}
+
+void test_loop_within_budget_while_portal_up() {
+  const Metrics::Histogram &portalLoop = Metrics::histogram(Metrics::LoopPortal);
+  const Metrics::Histogram &body = Metrics::histogram(Metrics::LoopBody);
+  printf("  %u portal pages served\n", (unsigned)g_portalPages);
+  printf("  loop while the portal was up: %u iterations, mean %.0f ms, max %.0f ms (budget %u ms)\n",
+         (unsigned)portalLoop.count, portalLoop.count ? portalLoop.sumUs / 1e3 / portalLoop.count : 0.0,
+         portalLoop.maxUs / 1e3, (unsigned)LOOP_BUDGET_MS);
+  printf("  loop over the whole run:      %u iterations, mean %.0f ms, max %.0f ms\n", (unsigned)body.count,
+         body.count ? body.sumUs / 1e3 / body.count : 0.0, body.maxUs / 1e3);
+  TEST_ASSERT_TRUE(portalLoop.count > 0);
+  TEST_ASSERT_TRUE_MESSAGE(portalLoop.maxUs <= LOOP_BUDGET_MS * 1000UL, "loop within LOOP_BUDGET_MS");
+}
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_portal").string();
+  std::error_code ec;
+  std::filesystem::remove_all(fsRoot, ec);
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+  shim::resetTime(0);
+  shim::setWifiAvailable(false);
+  shim::setApStations(1);  // a phone on the setup network
+  shim::setHttpHandler([](const std::string &url) {
+    if (url.rfind(ID_DIRECTORY_SYNC_URL, 0) == 0) return shim::HttpResponse{200, "v 1 full\n. 0\n", 120};
+    g_uploads.push_back(url);
+    if (g_slowNext) {
+      g_slowNext = false;
+      return shim::HttpResponse{200, "OK", UPLOAD_HTTP_TIMEOUT_MS + 1000};  // recorded, answer lost
+    }
+    return shim::HttpResponse{200, "OK", 90};
+  });
+  shim::loadCell().loadGrams = [](uint64_t now) -> float {
+    for (const Crate &c : g_crates) {
+      if (now >= c.placeUs && now < c.placeUs + kHoldUs) return c.grams;
+    }
+    return 0.0f;
+  };
+  setup();  // no network: portal, then the scale
+  g_bootUs = shim::nowUs();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_opens_portal);
+  RUN_TEST(test_crates_queued_while_browsing);
+  RUN_TEST(test_save_with_router_down);
+  RUN_TEST(test_retry_once_phone_left);
+  RUN_TEST(test_save_joins_live);
+  RUN_TEST(test_queue_flushed_online);
+  RUN_TEST(test_crate_online_uploaded_directly);
+  RUN_TEST(test_loop_within_budget_while_portal_up);
+  const int failures = UNITY_END();
+  shim::loadCell().loadGrams = [](uint64_t) { return 0.0f; };
+  shim::setHttpHandler([](const std::string &) { return shim::HttpResponse{}; });
+  return failures;
+}
@@ -0,0 +1,207 @@
+// Temperature compensation over two simulated days.
+//
+// The shim's load cell drifts with a daily temperature swing (cold dawn,
+// hot early afternoon): the zero by kZeroCountsPerC, the span by
+// kSpanPerC. The station boots at 05:00 and runs until 17:00 each day the
+// way the firmware does: an empty read and a temperature read
+// (ScaleManager::sampleTemperature) every TEMPCOMP_SAMPLE_MS, a zero point
+// from each (learnZero). Day 1 also takes two span points with
+// TEMPCOMP_REF_KG (serial 's'), morning and noon.
+//
+// Day 2 starts from a reboot with the model from NVS, re-tares at 14:00 at
+// the hot end, and reports the empty-scale drift and TEMPCOMP_REF_KG
+// weigh-ins with and without the compensation. The tests run in order:
+// day 2 needs the model day 1 saved.
+//
+//   pio test -e native -f test_tempcomp
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+#include "config.h"
+#include "modules/scale.h"
+#include "modules/temp_comp.h"
+#include "shim.h"
+
+namespace {
+
+constexpr float kZeroCountsPerC = 40.0f;  // ~3 g/C at 13.48 counts/g
+constexpr float kSpanPerC = -250e-6f;
+constexpr uint64_t kMinuteUs = 60ULL * 1000000ULL;
+constexpr uint64_t kHourUs = 60 * kMinuteUs;
+constexpr uint64_t kDayUs = 24 * kHourUs;
+constexpr int kStartHour = 5;
+constexpr int kEndHour = 17;
+
+// Ambient (and bridge) temperature: 18 C at 02:00, 34 C at 14:00.
+float dayTempC(uint64_t us) {
+  const double hour = fmod(us / 3.6e9 + kStartHour, 24.0);
+  return (float)(26.0 - 8.0 * cos(2.0 * M_PI * (hour - 2.0) / 24.0));
+}
+
+void setLoad(float grams) {
+  shim::loadCell().loadGrams = [grams](uint64_t) { return grams; };
+}
+
+// The firmware's periodic step with an empty platform: a weighing read,
+// then the temperature and a zero point.
+void emptyMinute(ScaleManager &scale) {
+  scale.getWeightKg(true);
+  if (scale.sampleTemperature()) scale.learnZero();
+}
+
+struct DayStats {
+  uint32_t minutes = 0;
+  uint32_t rawOut = 0, compOut = 0;  // outside the zero band
+  float rawMaxG = 0.0f, compMaxG = 0.0f;
+  float rawSpanMaxG = 0.0f, compSpanMaxG = 0.0f;  // TEMPCOMP_REF_KG error
+};
+
+DayStats g_day;
+
+float rawGrams(const ScaleManager &scale) { return (scale.lastAverage() - scale.zeroOffset()) / scale.calFactor(); }
+float compGrams(const ScaleManager &scale) {
+  return (scale.lastAverage() - scale.effectiveZero()) / scale.effectiveCal();
+}
+
+void minuteWithStats(ScaleManager &scale) {
+  scale.getWeightKg(true);
+  const float raw = rawGrams(scale), comp = compGrams(scale);
+  const float band = ZERO_THRESHOLD_KG * 1000.0f;
+  g_day.minutes++;
+  if (fabsf(raw) > band) g_day.rawOut++;
+  if (fabsf(comp) > band) g_day.compOut++;
+  g_day.rawMaxG = fmaxf(g_day.rawMaxG, fabsf(raw));
+  g_day.compMaxG = fmaxf(g_day.compMaxG, fabsf(comp));
+  if (scale.sampleTemperature()) scale.learnZero();
+}
+
+// A TEMPCOMP_REF_KG weigh-in; returns raw and compensated errors in grams.
+void weighIn(ScaleManager &scale, float &rawErr, float &compErr) {
+  const float refG = TEMPCOMP_REF_KG * 1000.0f;
+  setLoad(refG);
+  scale.getWeightKg(true);
+  const float kg = scale.getWeightKg(true);
+  rawErr = rawGrams(scale) - refG;
+  compErr = kg * 1000.0f - refG;
+  setLoad(0.0f);
+  scale.getWeightKg(true);
+}
+
+void runUntil(ScaleManager &scale, uint64_t untilUs, uint64_t dayStartUs, bool report) {
+  uint64_t next = shim::nowUs();
+  while (next < untilUs) {
+    if (report) {
+      minuteWithStats(scale);
+      const uint64_t sinceStart = shim::nowUs() - dayStartUs;
+      if (sinceStart % kHourUs < kMinuteUs) {
+        float rawErr = 0.0f, compErr = 0.0f;
+        const float raw = rawGrams(scale), comp = compGrams(scale);
+        weighIn(scale, rawErr, compErr);
+        g_day.rawSpanMaxG = fmaxf(g_day.rawSpanMaxG, fabsf(rawErr));
+        g_day.compSpanMaxG = fmaxf(g_day.compSpanMaxG, fabsf(compErr));
+        printf("  %02d:00 %5.1f C   %+6.1f g %+6.1f g   %+6.1f g %+6.1f g\n",
+               (int)(kStartHour + sinceStart / kHourUs), scale.temperatureC(), raw, comp, rawErr, compErr);
+      }
+    } else {
+      emptyMinute(scale);
+    }
+    next += kMinuteUs;
+    if (shim::nowUs() < next) shim::advanceUs(next - shim::nowUs());
+  }
+}
+
+bool bootScale(ScaleManager &scale) {
+  if (!scale.begin()) return false;
+  TempComp::Model m;
+  if (TempComp::load(m)) scale.setTempModel(m);
+  return true;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_day1_learns_model() {
+  char what[96];
+  printf("day 1: learning (%.1f C at %02d:00, %.1f C at 14:00)\n", dayTempC(0), kStartHour,
+         dayTempC((14 - kStartHour) * kHourUs));
+  ScaleManager scale;
+  TEST_ASSERT_TRUE_MESSAGE(bootScale(scale), "scale.begin()");
+  snprintf(what, sizeof(what), "sensor %.2f C, model %.2f C", scale.temperatureC(), dayTempC(shim::nowUs()));
+  TEST_ASSERT_TRUE_MESSAGE(fabsf(scale.temperatureC() - dayTempC(shim::nowUs())) < 0.2f, what);
+
+  for (const int hour : {6, 12}) {
+    runUntil(scale, (uint64_t)(hour - kStartHour) * kHourUs, 0, false);
+    setLoad(TEMPCOMP_REF_KG * 1000.0f);
+    scale.getWeightKg(true);
+    snprintf(what, sizeof(what), "span point at %02d:00 (%.1f C)", hour, dayTempC(shim::nowUs()));
+    TEST_ASSERT_TRUE_MESSAGE(scale.addSpanPoint(TEMPCOMP_REF_KG), what);
+    setLoad(0.0f);
+  }
+  runUntil(scale, (uint64_t)(kEndHour - kStartHour) * kHourUs, 0, false);
+  scale.tempComp().printText(Serial, scale.temperatureC(), scale.calFactor());
+
+  const TempComp &tc = scale.tempComp();
+  const float zeroTruth = kZeroCountsPerC;
+  snprintf(what, sizeof(what), "zero slope %.1f counts/C (truth %.1f)", tc.zeroSlope(), zeroTruth);
+  TEST_ASSERT_TRUE_MESSAGE(tc.zeroFitted() && fabsf(tc.zeroSlope() - zeroTruth) < 0.1f * zeroTruth, what);
+  snprintf(what, sizeof(what), "span slope %.0f ppm/C (truth %.0f)", tc.spanSlope() * 1e6f, kSpanPerC * 1e6f);
+  TEST_ASSERT_TRUE_MESSAGE(tc.spanFitted() && fabsf(tc.spanSlope() - kSpanPerC) < 0.2f * fabsf(kSpanPerC), what);
+  TEST_ASSERT_TRUE_MESSAGE(TempComp::save(tc.model()), "model saved");
+}
+
+void test_day2_compensates() {
+  char what[96];
+  // Overnight, then a reboot at dawn.
+  const uint64_t day2 = kDayUs;
+  shim::advanceUs(day2 - shim::nowUs());
+  printf("\nday 2: reboot at %02d:00, model from NVS; re-tare at 14:00\n", kStartHour);
+  printf("  time   temp     empty: raw   comp     %.0f kg: raw   comp\n", TEMPCOMP_REF_KG);
+  ScaleManager scale;
+  TEST_ASSERT_TRUE_MESSAGE(bootScale(scale), "scale.begin()");
+  TEST_ASSERT_TRUE_MESSAGE(scale.tempComp().zeroFitted() && scale.tempComp().spanFitted(),
+                           "model loaded with both slopes");
+  runUntil(scale, day2 + (14 - kStartHour) * kHourUs, day2, true);
+  scale.tare(32);
+  runUntil(scale, day2 + (kEndHour - kStartHour) * kHourUs, day2, true);
+  scale.tempComp().printText(Serial, scale.temperatureC(), scale.calFactor());
+
+  printf("\n  empty scale, %u minutes: raw max %.1f g (%u outside +-%.0f g), compensated max %.1f g (%u outside)\n",
+         (unsigned)g_day.minutes, g_day.rawMaxG, (unsigned)g_day.rawOut, ZERO_THRESHOLD_KG * 1000.0f,
+         g_day.compMaxG, (unsigned)g_day.compOut);
+  printf("  %.0f kg weigh-ins: raw error max %.1f g, compensated %.1f g\n", TEMPCOMP_REF_KG, g_day.rawSpanMaxG,
+         g_day.compSpanMaxG);
+  snprintf(what, sizeof(what), "uncompensated zero leaves the band (%.1f g)", g_day.rawMaxG);
+  TEST_ASSERT_TRUE_MESSAGE(g_day.rawOut > 0, what);
+  snprintf(what, sizeof(what), "compensated zero within half the band (%.1f g)", g_day.compMaxG);
+  TEST_ASSERT_TRUE_MESSAGE(g_day.compMaxG < ZERO_THRESHOLD_KG * 1000.0f / 2, what);
+  snprintf(what, sizeof(what), "compensated %.0f kg within 5 g (%.1f g)", TEMPCOMP_REF_KG, g_day.compSpanMaxG);
+  TEST_ASSERT_TRUE_MESSAGE(g_day.compSpanMaxG < 5.0f && g_day.compSpanMaxG < g_day.rawSpanMaxG, what);
+}
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_tempcomp").string();
+  std::error_code ec;
+  std::filesystem::remove_all(fsRoot, ec);  // no model from an earlier run
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+  shim::setSerialEcho(true);  // the 'k' reports
+  shim::resetTime(0);
+  shim::loadCell() = shim::LoadCellModel();
+  shim::loadCell().tempC = dayTempC;
+  shim::loadCell().zeroCountsPerC = kZeroCountsPerC;
+  shim::loadCell().spanPerC = kSpanPerC;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_day1_learns_model);
+  RUN_TEST(test_day2_compensates);
+  const int failures = UNITY_END();
+  shim::setSerialEcho(false);
+  shim::loadCell() = shim::LoadCellModel();
+  return failures;
+}
@@ -0,0 +1,250 @@
+// Vibration analysis and notch/comb filtering on synthetic vibration.
+//
+// First the fixed-point FFT against known tones (frequency and amplitude
+// of a peak between bins). Then per scenario, on the shim's NAU7802 with a
+// 20 kg load that vibrates (force scales with the mass on the platform):
+//
+//   the 'v' diagnostic (VibAnalysis::measure at 320 SPS) finds the
+//   components, design() turns them into stages, and the same weigh-in is
+//   run through WeighFsm without and with the stages: time from the load
+//   to Stable and the error of the committed weight.
+//
+// WEIGHING_TIMEOUT_MS equals STABLE_MIN_MS in config.h, so on defaults the
+// FSM commits on the timeout whether or not the weight settles; the runs
+// here use a 20 s timeout to see when it actually becomes stable.
+//
+//   pio test -e native -f test_vib
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include "config.h"
+#include "modules/scale.h"
+#include "modules/vib_analysis.h"
+#include "modules/vib_filter.h"
+#include "modules/weigh_fsm.h"
+#include "shim.h"
+
+namespace {
+
+constexpr float kLoadG = 20000.0f;
+constexpr uint32_t kTimeoutMs = 20000;
+
+struct Tone {
+  float hz;
+  float amplitudeG;  // at kLoadG; scales with the load
+};
+
+struct Scenario {
+  const char *name;
+  std::vector<Tone> tones;
+};
+
+float vibrationG(const std::vector<Tone> &tones, float loadG, uint64_t us) {
+  float v = 0.0f;
+  for (const Tone &t : tones) {
+    v += t.amplitudeG * (loadG / kLoadG) * sinf((float)(2.0 * M_PI * fmod(t.hz * us * 1e-6, 1.0)));
+  }
+  return v;
+}
+
+void setLoad(float grams, const std::vector<Tone> &tones) {
+  shim::loadCell().loadGrams = [grams, tones](uint64_t us) { return grams + vibrationG(tones, grams, us); };
+}
+
+ScaleManager g_scale;
+
+// ---- FFT on synthetic blocks ----
+void checkFft() {
+  const float sampleHz = 320.0f;
+  const float countsPerGram = 13.48f;
+  const struct { float hz, amplitudeG; } tones[] = {{10.0f, 50.0f}, {37.3f, 5.0f}, {101.9f, 500.0f}};
+  for (const auto &t : tones) {
+    VibAnalysis::Spectrum s;
+    const uint16_t n = s.size();
+    std::vector<int32_t> block(n);
+    for (int b = 0; b < 2; ++b) {
+      for (uint16_t i = 0; i < n; ++i) {
+        const double ph = 2.0 * M_PI * t.hz * (b * n + i) / sampleHz;
+        block[i] = 8000 + (int32_t)lround(t.amplitudeG * countsPerGram * sin(ph));
+      }
+      s.addBlock(block.data());
+    }
+    const VibAnalysis::Result r = s.peaks(sampleHz, countsPerGram);
+    char what[96];
+    const bool found = r.count >= 1;
+    snprintf(what, sizeof(what), "%.1f Hz %.0f g: %.2f Hz %.1f g, %u peak(s)", t.hz, t.amplitudeG,
+             found ? r.peaks[0].hz : 0.0f, found ? r.peaks[0].amplitudeG : 0.0f, (unsigned)r.count);
+    TEST_ASSERT_TRUE_MESSAGE(found && r.count == 1 && fabsf(r.peaks[0].hz - t.hz) < 0.1f &&
+              fabsf(r.peaks[0].amplitudeG - t.amplitudeG) < 0.05f * t.amplitudeG,
+          what);
+  }
+}
+
+struct Weighing {
+  bool stable = false;
+  float ms = 0.0f;       // load placed -> Stable (or timeout)
+  float errorG = 0.0f;   // committed weight - load
+};
+
+// One weigh-in as the loop runs it: getWeightKg() then fsm.update().
+Weighing weighIn(ScaleManager &scale, const std::vector<Tone> &tones) {
+  WeighFsm::Params p;
+  p.weighingTimeoutMs = kTimeoutMs;
+  WeighFsm fsm(p);
+
+  setLoad(0.0f, tones);
+  for (int i = 0; i < 3; ++i) fsm.update(scale.getWeightKg(true), millis(), false);
+
+  // The load lands as a conversion block starts, so no average straddles
+  // the step and the buffer holds only vibration.
+  setLoad(kLoadG, tones);
+  const unsigned long placedMs = millis();
+  Weighing w;
+  for (;;) {
+    const float kg = scale.getWeightKg(true);
+    const WeighFsm::Event e = fsm.update(kg, millis(), false);
+    if (e == WeighFsm::Stable || e == WeighFsm::TimedOut) {
+      w.stable = e == WeighFsm::Stable;
+      w.ms = (float)(millis() - placedMs);
+      w.errorG = fsm.stableKg() * 1000.0f - kLoadG;
+      return w;
+    }
+    if (millis() - placedMs > 2 * kTimeoutMs) return w;
+  }
+}
+
+void printWeighing(const char *label, const Weighing &w) {
+  printf("  %-10s %s after %5.1f s, error %+7.1f g\n", label, w.stable ? "stable   " : "timed out", w.ms / 1000.0f,
+         w.errorG);
+}
+
+void runScenario(ScaleManager &scale, const Scenario &sc) {
+  TEST_MESSAGE(sc.name);
+  scale.setVibFilter(VibFilter::Config());
+  setLoad(kLoadG, sc.tones);
+  delay(500);
+
+  VibAnalysis::Result r;
+  TEST_ASSERT_TRUE_MESSAGE(VibAnalysis::measure(scale, r), "capture at 320 SPS");
+  const VibFilter::Config cfg = VibAnalysis::design(r, scale.activeHz());
+  VibAnalysis::printResult(Serial, r, cfg, scale.activeHz());
+
+  char what[96];
+  snprintf(what, sizeof(what), "capture rate %.1f Hz, %u missed", r.sampleHz, (unsigned)r.missed);
+  TEST_ASSERT_TRUE_MESSAGE(fabsf(r.sampleHz - 320.0f) < 3.2f && r.missed == 0, what);
+  for (const Tone &t : sc.tones) {
+    bool found = false;
+    for (uint8_t i = 0; i < r.count; ++i) found |= fabsf(r.peaks[i].hz - t.hz) < 0.2f;
+    snprintf(what, sizeof(what), "finds %.1f Hz (%.0f g)", t.hz, t.amplitudeG);
+    TEST_ASSERT_TRUE_MESSAGE(found, what);
+  }
+  snprintf(what, sizeof(what), "%u peak(s) for %u tone(s)", (unsigned)r.count, (unsigned)sc.tones.size());
+  TEST_ASSERT_TRUE_MESSAGE(r.count == sc.tones.size(), what);
+  if (sc.tones.empty()) TEST_ASSERT_TRUE_MESSAGE(cfg.count == 0, "quiet platform: no stages");
+
+  scale.setVibFilter(cfg);
+  scale.vibFilter().printText(Serial);
+
+  scale.setVibFilter(VibFilter::Config());
+  const Weighing plain = weighIn(scale, sc.tones);
+  scale.setVibFilter(cfg);
+  const Weighing filtered = weighIn(scale, sc.tones);
+  printWeighing("plain", plain);
+  printWeighing("filtered", filtered);
+
+  if (sc.tones.empty()) {
+    TEST_ASSERT_TRUE_MESSAGE(filtered.stable && fabsf(filtered.ms - plain.ms) < 1.0f, "no stages: weigh-in unchanged");
+  } else {
+    snprintf(what, sizeof(what), "filtered stable sooner (%.1f s vs %.1f s)", filtered.ms / 1000.0f,
+             plain.ms / 1000.0f);
+    TEST_ASSERT_TRUE_MESSAGE(filtered.stable && (!plain.stable || filtered.ms < plain.ms), what);
+  }
+  TEST_ASSERT_TRUE_MESSAGE(filtered.stable && fabsf(filtered.errorG) < 10.0f, "filtered weight within 10 g");
+
+  if (cfg.count > 0) {
+    // A new weighing rate: the stages follow the vibrations they were made for.
+    const uint16_t baseSps = (uint16_t)scale.activeHz();
+    scale.setActiveSps(40);
+    const VibFilter::Config &moved = scale.vibFilter().config();
+    bool aliased = moved.count > 0;
+    for (uint8_t i = 0; i < moved.count; ++i) {
+      const VibFilter::Stage &st = moved.stages[i];
+      const float a = VibAnalysis::aliasHz(st.sourceHz, 40.0f);
+      aliased &= st.kind == VibFilter::Kind::Comb ? fabsf(a * st.combLen - 40.0f) < 0.03f * 40.0f
+                                                  : fabsf(st.hz - a) < 0.01f;
+    }
+    scale.vibFilter().printText(Serial);
+    TEST_ASSERT_TRUE_MESSAGE(aliased, "at 40 SPS: stages re-derived from their source frequency");
+    const Weighing at40 = weighIn(scale, sc.tones);
+    printWeighing("40 SPS", at40);
+    TEST_ASSERT_TRUE_MESSAGE(at40.stable && fabsf(at40.errorG) < 10.0f, "40 SPS: stable, weight within 10 g");
+    scale.setActiveSps(baseSps);
+  }
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// Q15 FFT (VIB_FFT_LOG2N points) against known tones, peaks between bins.
+void test_fft() { checkFft(); }
+
+void test_scale_begin() { TEST_ASSERT_TRUE(g_scale.begin()); }
+
+void test_quiet_platform() { runScenario(g_scale, {"quiet platform", {}}); }
+
+void test_pontoon_sway() { runScenario(g_scale, {"pontoon sway 1.3 Hz", {{1.3f, 1500.0f}}}); }
+
+void test_generator_aliased() {
+  runScenario(g_scale, {"generator 37 Hz (aliases to 3 Hz at 20 SPS)", {{37.0f, 800.0f}}});
+}
+
+void test_engine_harmonics_comb() {
+  runScenario(g_scale, {"engine 4 Hz with harmonics (comb)", {{4.0f, 800.0f}, {8.0f, 400.0f}, {12.0f, 200.0f}}});
+}
+
+void test_two_sources() { runScenario(g_scale, {"two sources 2.4 Hz + 6.8 Hz", {{2.4f, 800.0f}, {6.8f, 500.0f}}}); }
+
+void test_nvs_round_trip() {
+  VibFilter::Config saved;
+  saved.count = 2;
+  saved.stages[0] = {VibFilter::Kind::Comb, 5, 4.0f, 0.0f, 4.0f};
+  saved.stages[1] = {VibFilter::Kind::Notch, 0, 3.0f, 3.0f, 37.0f};
+  VibFilter::Config loaded;
+  TEST_ASSERT_TRUE_MESSAGE(VibFilter::save(saved) && VibFilter::load(loaded) && loaded.count == 2 &&
+                               loaded.stages[0].kind == VibFilter::Kind::Comb && loaded.stages[0].combLen == 5 &&
+                               loaded.stages[1].hz == 3.0f && loaded.stages[1].sourceHz == 37.0f,
+                           "stages survive save/load");
+  TEST_ASSERT_TRUE_MESSAGE(VibFilter::save(VibFilter::Config()) && VibFilter::load(loaded) && loaded.count == 0,
+                           "empty config clears");
+}
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_vib").string();
+  std::error_code ec;
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+  shim::setSerialEcho(true);  // the 'v' report
+  shim::resetTime(0);
+  shim::loadCell() = shim::LoadCellModel();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_fft);
+  RUN_TEST(test_scale_begin);
+  RUN_TEST(test_quiet_platform);
+  RUN_TEST(test_pontoon_sway);
+  RUN_TEST(test_generator_aliased);
+  RUN_TEST(test_engine_harmonics_comb);
+  RUN_TEST(test_two_sources);
+  RUN_TEST(test_nvs_round_trip);
+  const int failures = UNITY_END();
+  shim::setSerialEcho(false);
+  shim::loadCell() = shim::LoadCellModel();
+  return failures;
+}
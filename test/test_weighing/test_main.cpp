@@ -0,0 +1,205 @@
+// Weigh-ins through the real setup()/loop() on the host shims, in virtual
+// time: a crate lands (overshoot, bounce, creep), a card is held, the
+// stable weight is uploaded with that card's ID, the crate is lifted.
+//
+//   pio test -e native -f test_weighing
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <unity.h>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "modules/weigh_fsm.h"
+#include "shim.h"
+
+void setup();
+void loop();
+extern WeighFsm fsm;
+
+namespace {
+
+constexpr uint64_t kSecondUs = 1000000ULL;
+
+struct Crate {
+  uint64_t placeUs;
+  uint64_t liftUs;
+  float grams;
+};
+
+struct Upload {
+  uint64_t us;
+  std::string url;
+};
+
+std::vector<Crate> g_crates;
+std::vector<Upload> g_uploads;  // directory syncs left out
+bool g_loseNext = false;        // next upload: connection lost after the GET
+
+std::string uidHex(uint32_t i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "04%06X", (unsigned)(i & 0xFFFFFF));
+  return buf;
+}
+
+void presentCard(uint32_t i, uint64_t fromUs, uint64_t toUs) {
+  shim::presentCard({0x04, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i}, fromUs, toUs);
+}
+
+float crateGrams(float grams, double t) {
+  const double bounce = 0.35 * exp(-t / 0.6) * cos(2.0 * M_PI * 3.0 * t);
+  const double creep = 0.002 * (1.0 - exp(-t / 4.0));
+  return (float)(grams * (1.0 + bounce + creep));
+}
+
+// A crate from `in` seconds from now for `holdS` seconds.
+const Crate &placeCrate(double inS, double holdS, float grams) {
+  const uint64_t at = shim::nowUs() + (uint64_t)(inS * kSecondUs);
+  g_crates.push_back({at, at + (uint64_t)(holdS * kSecondUs), grams});
+  return g_crates.back();
+}
+
+void runFor(double s) {
+  const uint64_t until = shim::nowUs() + (uint64_t)(s * kSecondUs);
+  while (shim::nowUs() < until) loop();
+}
+
+// kg uploaded for the card, < 0 if it was not.
+float uploadedKg(const Upload &u, uint32_t card) {
+  const std::string expected = "/" + uidHex(card) + "/" + std::to_string(UPLOAD_SCALE_ID) + "/";
+  const size_t at = u.url.find(expected);
+  return at == std::string::npos ? -1.0f : strtof(u.url.c_str() + at + expected.size(), nullptr);
+}
+
+} // namespace
+
+void setUp() { g_uploads.clear(); }
+void tearDown() {}
+
+// Card held while the load settles: bound in the iteration that finds the
+// weight stable, uploaded once with the settled weight.
+void test_card_while_settling() {
+  const Crate c = placeCrate(1.0, 14.0, 12500.0f);
+  presentCard(1, c.placeUs + kSecondUs, c.placeUs + 4 * kSecondUs);
+  runFor(20.0);
+  TEST_ASSERT_EQUAL_UINT32(1, g_uploads.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.125f, 12.5f, uploadedKg(g_uploads[0], 1));
+  // Stable after STABLE_MIN_MS plus one averaged read; no further read
+  // before the upload (4.2 s in the bench, 5.8 s when it waited for one).
+  TEST_ASSERT_TRUE_MESSAGE(g_uploads[0].us - c.placeUs < 5 * kSecondUs, "uploaded within 5 s of the drop");
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+}
+
+// Card shown only once the LCD asks for it.
+void test_card_after_stable() {
+  const Crate c = placeCrate(1.0, 16.0, 8000.0f);
+  runFor(7.0);
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, fsm.state());
+  TEST_ASSERT_TRUE(shim::lcdRow(2).find("Please Scan The ID") != std::string::npos);
+  TEST_ASSERT_EQUAL_UINT32(0, g_uploads.size());
+  presentCard(2, shim::nowUs(), shim::nowUs() + 3 * kSecondUs);
+  runFor(13.0);
+  TEST_ASSERT_EQUAL_UINT32(1, g_uploads.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.08f, 8.0f, uploadedKg(g_uploads[0], 2));
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+  (void)c;
+}
+
+// The fisher taps again after the bind: that scan must not wait for, and
+// bind to, the next crate, which nobody scans.
+void test_retap_not_bound_to_next_crate() {
+  const Crate a = placeCrate(1.0, 10.0, 15000.0f);
+  presentCard(3, a.placeUs + kSecondUs, a.placeUs + 3 * kSecondUs);
+  presentCard(3, a.placeUs + 7 * kSecondUs, a.placeUs + 8 * kSecondUs);  // after RFID_DUP_WINDOW_MS
+  runFor(12.0);
+  TEST_ASSERT_EQUAL_UINT32(1, g_uploads.size());
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+  placeCrate(1.0, 12.0, 9000.0f);
+  runFor(8.0);
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, fsm.state());
+  runFor(12.0);
+  TEST_ASSERT_EQUAL_UINT32(1, g_uploads.size());
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+}
+
+// A crate lifted before it was weighed takes its scan with it.
+void test_lifted_crate_drops_scan() {
+  const Crate c = placeCrate(1.0, 1.2, 11000.0f);
+  presentCard(4, c.placeUs + 200000, c.placeUs + kSecondUs);
+  runFor(4.0);
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+  placeCrate(0.5, 12.0, 7000.0f);
+  runFor(20.0);
+  TEST_ASSERT_EQUAL_UINT32(0, g_uploads.size());
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+}
+
+// No card at all: after the crate is lifted the prompts clear and the
+// station goes back to the live weight, nothing is sent.
+void test_no_card_back_to_idle() {
+  placeCrate(1.0, 10.0, 6000.0f);
+  runFor(8.0);
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, fsm.state());
+  runFor(6.0 + NO_ID_ZERO_TIMEOUT_MS / 1000.0);
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+  TEST_ASSERT_EQUAL_UINT32(0, g_uploads.size());
+  TEST_ASSERT_TRUE(shim::lcdRow(2).find("Scan") == std::string::npos);
+}
+
+// The pre-warmed connection drops after the GET went out: the server may
+// have booked it, so it is not sent again on a fresh connection.
+void test_lost_after_get_not_resent() {
+  const Crate c = placeCrate(1.0, 16.0, 9500.0f);
+  runFor(7.0);
+  TEST_ASSERT_EQUAL(WeighFsm::AskId, fsm.state());
+  g_loseNext = true;
+  presentCard(5, shim::nowUs(), shim::nowUs() + 3 * kSecondUs);
+  runFor(13.0);
+  TEST_ASSERT_EQUAL_UINT32(1, g_uploads.size());
+  TEST_ASSERT_FLOAT_WITHIN(0.08f, 9.5f, uploadedKg(g_uploads[0], 5));
+  TEST_ASSERT_EQUAL(WeighFsm::Idle, fsm.state());
+  (void)c;
+}
+
+int main(int, char **) {
+  const std::string fsRoot = (std::filesystem::temp_directory_path() / "fishcore_test_weighing").string();
+  std::error_code ec;
+  std::filesystem::remove_all(fsRoot, ec);
+  std::filesystem::create_directories(fsRoot, ec);
+  shim::setFsRoot(fsRoot);
+  shim::resetTime(0);
+  shim::setWifiAvailable(true, 300);
+  shim::setDrdyPin(SCALE_DRDY_PIN);
+  shim::setHttpHandler([](const std::string &url) {
+    if (url.rfind(ID_DIRECTORY_SYNC_URL, 0) == 0) return shim::HttpResponse{200, "v 1 full\n. 0\n", 120};
+    g_uploads.push_back({shim::nowUs(), url});
+    if (g_loseNext) {
+      g_loseNext = false;
+      return shim::HttpResponse{HTTPC_ERROR_CONNECTION_LOST, "", 90};
+    }
+    return shim::HttpResponse{200, "OK", 90};
+  });
+  shim::loadCell().loadGrams = [](uint64_t now) -> float {
+    for (const Crate &c : g_crates) {
+      if (now >= c.placeUs && now < c.liftUs) return crateGrams(c.grams, (now - c.placeUs) / 1e6);
+    }
+    return 0.0f;
+  };
+  setup();
+  runFor(5.0);  // boot, directory sync
+
+  UNITY_BEGIN();
+  RUN_TEST(test_card_while_settling);
+  RUN_TEST(test_card_after_stable);
+  RUN_TEST(test_retap_not_bound_to_next_crate);
+  RUN_TEST(test_lifted_crate_drops_scan);
+  RUN_TEST(test_no_card_back_to_idle);
+  RUN_TEST(test_lost_after_get_not_resent);
+  const int failures = UNITY_END();
+  shim::loadCell().loadGrams = [](uint64_t) { return 0.0f; };
+  shim::setHttpHandler([](const std::string &) { return shim::HttpResponse{}; });
+  return failures;
+}
@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""Local stand-in for the FishCore upload backend, for fleet load tests.
+
+Serves the two URLs the scales call:
+  GET /uploadWeightIns/<id>/<card>/<scale>/<kg>   -> 200 "OK"
+  GET /scaleDirectory/<n>?since=<version>         -> card directory (see
+      src/modules/id_directory.h): a full snapshot for an old version,
+      just the header when the scale is up to date
+and GET /stats, a plain-text summary of what the server saw (server-side
+latency percentiles, requests per second, status codes, duplicate uploads).
+GET /stats?reset=1 clears the counters after reporting.
+
+Backend behaviour is shaped on the command line:
+  --workers N           requests processed at once; the rest queue (capacity)
+  --service-ms M        median service time, log-normal ...
+  --service-p95-ms P    ... with this 95th percentile
+  --error-rate R        share of requests answered 500
+  --outage S:D[:MODE]   from S to S+D seconds after start: MODE 503 (default),
+                        hang (no answer until the client gives up) or drop
+                        (connection closed without a response); repeatable
+  --tls                 HTTPS with a throw-away self-signed certificate
+                        (or --cert/--key), like the real endpoint
+
+Usage:
+  tools/ingest_standin.py --port 8080 --workers 8 --service-ms 40 \\
+      --outage 60:30:503 &
+  .pio/build/fleet/program --server http://127.0.0.1:8080 ...
+"""
+import argparse
+import math
+import os
+import random
+import re
+import shutil
+import socket
+import ssl
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+UPLOAD_RE = re.compile(r"^/uploadWeightIns/(\d+)/([0-9A-Fa-f]+)/(\d+)/([0-9.]+)$")
+DIRECTORY_RE = re.compile(r"^/scaleDirectory/(\d+)$")
+
+
+class Backend:
+    def __init__(self, args):
+        self.args = args
+        self.start = time.monotonic()
+        self.slots = threading.BoundedSemaphore(args.workers)
+        self.lock = threading.Lock()
+        self.rng = random.Random(args.seed)
+        mu = math.log(max(args.service_ms, 0.001))
+        self.mu = mu
+        self.sigma = max(0.0, (math.log(max(args.service_p95_ms, args.service_ms)) - mu) / 1.645)
+        self.directory = self.make_directory(args.cards, args.directory_version)
+        self.reset()
+
+    @staticmethod
+    def make_directory(cards, version):
+        # Same card numbering as the fleet generator: UID "04" + 6 hex digits.
+        lines = ["v %d full" % version]
+        for i in range(cards):
+            lines.append("+04%06X %02x Fisher %d" % (i, 1 if i % 50 == 49 else 0, i))
+        lines.append(". %d" % cards)
+        return ("\n".join(lines) + "\n").encode()
+
+    def reset(self):
+        with self.lock:
+            self.latencies = []  # (kind, seconds)
+            self.per_second = {}
+            self.status = {}
+            self.kinds = {}
+            self.seen_uploads = set()
+            self.duplicates = 0
+            self.in_flight = 0
+            self.max_in_flight = 0
+
+    def now(self):
+        return time.monotonic() - self.start
+
+    def outage(self):
+        t = self.now()
+        for start, dur, mode in self.args.outage:
+            if start <= t < start + dur:
+                return mode
+        return None
+
+    def service_time(self):
+        with self.lock:
+            return self.rng.lognormvariate(self.mu, self.sigma) / 1000.0
+
+    def record(self, kind, code, seconds, path):
+        with self.lock:
+            self.latencies.append((kind, seconds))
+            sec = int(self.now())
+            self.per_second[sec] = self.per_second.get(sec, 0) + 1
+            self.status[code] = self.status.get(code, 0) + 1
+            self.kinds[kind] = self.kinds.get(kind, 0) + 1
+            if kind == "upload" and code == 200:
+                if path in self.seen_uploads:
+                    self.duplicates += 1
+                else:
+                    self.seen_uploads.add(path)
+
+    def enter(self):
+        with self.lock:
+            self.in_flight += 1
+            self.max_in_flight = max(self.max_in_flight, self.in_flight)
+
+    def leave(self):
+        with self.lock:
+            self.in_flight -= 1
+
+    def stats_text(self):
+        with self.lock:
+            lat = sorted(s for _k, s in self.latencies)
+            up = sorted(s for k, s in self.latencies if k == "upload")
+            per_second = dict(self.per_second)
+            status = dict(self.status)
+            kinds = dict(self.kinds)
+            dup = self.duplicates
+            unique = len(self.seen_uploads)
+            max_in_flight = self.max_in_flight
+        out = []
+        out.append("requests %d (%s)" % (len(lat), ", ".join("%s %d" % kv for kv in sorted(kinds.items()))))
+        out.append("status %s" % ", ".join("%s %d" % kv for kv in sorted(status.items())))
+        out.append("latency_ms all p50 %.1f p95 %.1f p99 %.1f max %.1f" % pcts(lat))
+        out.append("latency_ms upload p50 %.1f p95 %.1f p99 %.1f max %.1f" % pcts(up))
+        if per_second:
+            peak_sec = max(per_second, key=per_second.get)
+            span = max(per_second) - min(per_second) + 1
+            out.append("rps mean %.1f peak %d at %ds" % (len(lat) / span, per_second[peak_sec], peak_sec))
+        out.append("in_flight max %d (workers %d)" % (max_in_flight, self.args.workers))
+        out.append("uploads unique %d duplicate %d" % (unique, dup))
+        return "\n".join(out) + "\n"
+
+
+def pcts(values):
+    if not values:
+        return (0.0, 0.0, 0.0, 0.0)
+
+    def at(q):
+        return values[min(len(values) - 1, int(q * (len(values) - 1)))] * 1000.0
+
+    return (at(0.50), at(0.95), at(0.99), values[-1] * 1000.0)
+
+
+def make_handler(backend):
+    class Handler(BaseHTTPRequestHandler):
+        server_version = "fishcore-standin/1"
+
+        def log_message(self, fmt, *args):
+            if backend.args.verbose:
+                sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+        def reply(self, code, body, ctype="text/plain"):
+            self.send_response(code)
+            self.send_header("Content-Type", ctype)
+            self.send_header("Content-Length", str(len(body)))
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_GET(self):
+            t0 = time.monotonic()
+            path, _, query = self.path.partition("?")
+            if path == "/stats":
+                self.reply(200, backend.stats_text().encode())
+                if "reset=1" in query:
+                    backend.reset()
+                return
+
+            kind = "upload" if UPLOAD_RE.match(path) else "directory" if DIRECTORY_RE.match(path) else "other"
+            backend.enter()
+            try:
+                code = self.serve(kind, path, query)
+            finally:
+                backend.leave()
+            if code is not None:
+                backend.record(kind, code, time.monotonic() - t0, path)
+
+        def serve(self, kind, path, query):
+            mode = backend.outage()
+            if mode == "drop":
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+                return None
+            if mode == "hang":
+                time.sleep(backend.args.hang_s)
+                self.close_connection = True
+                return None
+            if mode == "503":
+                self.reply(503, b"maintenance\n")
+                return 503
+
+            # Queue for a worker slot, then take the service time.
+            with backend.slots:
+                time.sleep(backend.service_time())
+                if kind == "other":
+                    self.reply(404, b"not found\n")
+                    return 404
+                if backend.rng.random() < backend.args.error_rate:
+                    self.reply(500, b"error\n")
+                    return 500
+                if kind == "upload":
+                    self.reply(200, b"OK")
+                    return 200
+                since = re.search(r"since=(\d+)", query)
+                if since and int(since.group(1)) == backend.args.directory_version:
+                    self.reply(200, ("v %d\n" % backend.args.directory_version).encode())
+                else:
+                    self.reply(200, backend.directory)
+                return 200
+
+    return Handler
+
+
+def parse_outage(text):
+    parts = text.split(":")
+    if len(parts) not in (2, 3):
+        raise argparse.ArgumentTypeError("expected START:DURATION[:503|hang|drop]")
+    mode = parts[2] if len(parts) == 3 else "503"
+    if mode not in ("503", "hang", "drop"):
+        raise argparse.ArgumentTypeError("outage mode must be 503, hang or drop")
+    return (float(parts[0]), float(parts[1]), mode)
+
+
+def self_signed(tmpdir):
+    if shutil.which("openssl") is None:
+        sys.exit("--tls needs openssl on PATH (or pass --cert/--key)")
+    cert = os.path.join(tmpdir, "cert.pem")
+    key = os.path.join(tmpdir, "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "2", "-subj", "/CN=fishcore.ph",
+         "-keyout", key, "-out", cert],
+        check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+class Server(ThreadingHTTPServer):
+    daemon_threads = True
+    request_queue_size = 1024  # a reconnect storm should queue, not be refused
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--workers", type=int, default=8)
+    ap.add_argument("--service-ms", type=float, default=40.0)
+    ap.add_argument("--service-p95-ms", type=float, default=120.0)
+    ap.add_argument("--error-rate", type=float, default=0.0)
+    ap.add_argument("--outage", type=parse_outage, action="append", default=[])
+    ap.add_argument("--hang-s", type=float, default=30.0, help="how long a 'hang' outage holds a request")
+    ap.add_argument("--cards", type=int, default=2000)
+    ap.add_argument("--directory-version", type=int, default=7)
+    ap.add_argument("--tls", action="store_true")
+    ap.add_argument("--cert")
+    ap.add_argument("--key")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--verbose", action="store_true")
+    args = ap.parse_args()
+
+    backend = Backend(args)
+    httpd = Server((args.host, args.port), make_handler(backend))
+    scheme = "http"
+    tmpdir = None
+    if args.tls or args.cert:
+        cert, key = args.cert, args.key
+        if cert is None:
+            tmpdir = tempfile.mkdtemp(prefix="fishcore_standin_")
+            cert, key = self_signed(tmpdir)
+        ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ctx.load_cert_chain(cert, key)
+        # Handshake in the request thread, not in accept() on the main thread.
+        httpd.socket = ctx.wrap_socket(httpd.socket, server_side=True, do_handshake_on_connect=False)
+        scheme = "https"
+
+    print("standin: %s://%s:%d, %d workers, service %.0f/%.0f ms (median/p95), %d outage(s)" %
+          (scheme, args.host, args.port, args.workers, args.service_ms, args.service_p95_ms, len(args.outage)),
+          flush=True)
+    try:
+        httpd.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        httpd.server_close()
+        sys.stdout.write(backend.stats_text())
+        if tmpdir:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
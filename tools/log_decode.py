@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Decode FishCore binary event-log frames back into text.
+
+The event catalogue (ids, levels, formats) is read from
+src/modules/log_events.h, so the decoder follows the firmware it is run next
+to. Bytes outside frames (command output, boot ROM messages) are passed
+through unchanged.
+
+Usage:
+  tools/log_decode.py /dev/ttyUSB0 [--baud 115200]   # live (needs pyserial)
+  tools/log_decode.py capture.bin                     # file
+  pio device monitor --raw | tools/log_decode.py -    # stdin
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = b"\xA5\x5A"
+RECORD = struct.Struct("<IHBB3I")
+FRAME_LEN = len(SYNC) + RECORD.size + 1
+LEVELS = ["DEBUG", "INFO", "WARN", "ERROR"]
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+CATALOGUE = os.path.join(HERE, "..", "src", "modules", "log_events.h")
+
+
+def load_catalogue(path):
+    text = open(path, encoding="utf-8").read()
+    events = re.findall(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text)
+    return [(name, fmt.encode().decode("unicode_escape")) for name, _level, fmt in events]
+
+
+def format_args(fmt, args):
+    out, i, ai = [], 0, 0
+    while i < len(fmt):
+        c = fmt[i]
+        if c != "%":
+            out.append(c)
+            i += 1
+            continue
+        m = re.match(r"%(0?\d*)([duxXkI%])", fmt[i:])
+        if not m:
+            out.append(c)
+            i += 1
+            continue
+        width, conv = m.group(1), m.group(2)
+        i += len(m.group(0))
+        if conv == "%":
+            out.append("%")
+            continue
+        v = args[ai] if ai < len(args) else 0
+        ai += 1
+        if conv == "d":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            out.append(("%" + width + "d") % v)
+        elif conv in "uxX":
+            out.append(("%" + width + conv) % v)
+        elif conv == "k":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            out.append("%.2f" % (v / 100.0))
+        elif conv == "I":
+            out.append(".".join(str((v >> s) & 0xFF) for s in (0, 8, 16, 24)))
+    return "".join(out)
+
+
+def decode(stream, events, write):
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            k = buf.find(SYNC)
+            if k < 0:
+                # keep a trailing 0xA5 in case the sync is split across reads
+                keep = 1 if buf.endswith(SYNC[:1]) else 0
+                write(buf[: len(buf) - keep].decode("utf-8", "replace"))
+                buf = buf[len(buf) - keep:]
+                break
+            if k > 0:
+                write(buf[:k].decode("utf-8", "replace"))
+                buf = buf[k:]
+            if len(buf) < FRAME_LEN:
+                break
+            body = buf[len(SYNC): len(SYNC) + RECORD.size]
+            x = 0
+            for b in body:
+                x ^= b
+            if x != buf[FRAME_LEN - 1]:
+                write(buf[:1].decode("latin-1"))  # not a frame; emit and resync
+                buf = buf[1:]
+                continue
+            ms, ev, level, nargs, a0, a1, a2 = RECORD.unpack(body)
+            name, fmt = events[ev] if ev < len(events) else ("event%d" % ev, "")
+            lvl = LEVELS[level] if level < len(LEVELS) else str(level)
+            text = format_args(fmt, [a0, a1, a2][:nargs])
+            write("[%10d] %-5s %s: %s\n" % (ms, lvl, name, text))
+            buf = buf[FRAME_LEN:]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="serial port, capture file or '-' for stdin")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--catalogue", default=CATALOGUE)
+    args = ap.parse_args()
+
+    events = load_catalogue(args.catalogue)
+
+    def write(s):
+        sys.stdout.write(s)
+        sys.stdout.flush()
+
+    if args.source == "-":
+        decode(sys.stdin.buffer, events, write)
+    elif os.path.isfile(args.source):
+        with open(args.source, "rb") as f:
+            decode(f, events, write)
+    else:
+        import serial  # pyserial
+
+        with serial.Serial(args.source, args.baud, timeout=0.1) as port:
+            class Reader:
+                def read(self, n):
+                    while True:
+                        data = port.read(n)
+                        if data:
+                            return data
+
+            decode(Reader(), events, write)
+
+
+if __name__ == "__main__":
+    main()
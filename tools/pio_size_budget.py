@@ -0,0 +1,33 @@
+"""PlatformIO extra script: linker map plus the `size_budget` target.
+
+Adds -Wl,-Map,$BUILD_DIR/firmware.map to the link and a custom target that
+runs tools/size_budget.py on it with the env's `custom_size_budget` lines
+(one "NAME FLASH_KIB DRAM_KIB" per line, '-' for no limit):
+
+  pio run -e esp32dev -t size_budget
+"""
+import os
+
+Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+
+MAP = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+TOOL = os.path.join(env.subst("$PROJECT_DIR"), "tools", "size_budget.py")
+
+env.Append(LINKFLAGS=["-Wl,-Map," + MAP])
+
+budget_args = []
+for line in env.GetProjectOption("custom_size_budget", "").splitlines():
+    fields = line.split("#", 1)[0].split()
+    if not fields:
+        continue
+    if len(fields) != 3:
+        raise SystemExit("custom_size_budget: expected 'NAME FLASH_KIB DRAM_KIB', got %r" % line)
+    budget_args.append('--budget "%s=%s/%s"' % tuple(fields))
+
+env.AddCustomTarget(
+    name="size_budget",
+    dependencies="$BUILD_DIR/${PROGNAME}.elf",
+    actions=['"$PYTHONEXE" "%s" "%s" %s' % (TOOL, MAP, " ".join(budget_args))],
+    title="Size budget",
+    description="Per-module flash/RAM from the linker map, checked against custom_size_budget",
+)
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Per-module flash/RAM report from a GNU ld map file, with budgets.
+
+Every input section placed by the linker is charged to the object it came
+from, then grouped: firmware sources by module (src/modules/uploader.cpp.o ->
+uploader, src/main.cpp.o -> main, all of them together -> app), library and
+framework archives by name (libmbedtls.a -> mbedtls), anything else -> other.
+
+Columns (bytes):
+  flash  what the group puts in the app image (code, rodata, initialised data,
+         IRAM code)
+  iram   instruction RAM (ESP32 .iram0.*)
+  dram   static data RAM (.data + .bss); every byte here is a byte less heap
+
+The map comes from the [env:esp32dev] link (tools/pio_size_budget.py adds
+-Wl,-Map and the target):
+  pio run -e esp32dev -t size_budget
+  tools/size_budget.py .pio/build/esp32dev/firmware.map [--budget app=160/40] [--top 25]
+
+A budget is NAME=FLASH_KIB/DRAM_KIB ('-' leaves one side open); NAME is a
+group or "total". The exit status is 1 when any budget is exceeded.
+"""
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+# Output sections by where their bytes end up. ESP32 first; the plain ELF
+# names cover the host build's map.
+FLASH_ONLY = (".flash.text", ".flash.rodata", ".flash.appdesc", ".text", ".rodata", ".init", ".fini",
+              ".eh_frame", ".gcc_except_table", ".init_array", ".fini_array", ".data.rel.ro")
+IRAM = (".iram0.vectors", ".iram0.text", ".iram0.data")
+DRAM_LOADED = (".dram0.data", ".data", ".rtc.data")
+DRAM_ZERO = (".dram0.bss", ".bss", ".noinit", ".rtc.bss")
+
+OUT_SECTION = re.compile(r"^(\.[\w.$-]+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?")
+IN_ONE_LINE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+IN_NAME_ONLY = re.compile(r"^ (\S+)$")
+IN_CONTINUATION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+FILL = re.compile(r"^ \*fill\*\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)")
+ARCHIVE = re.compile(r"^(.*?)([^/\\]+)\.a\((.+)\)$")
+
+
+def kind_of(section):
+    for names, kind in ((FLASH_ONLY, "flash"), (IRAM, "iram"), (DRAM_LOADED, "data"), (DRAM_ZERO, "bss")):
+        for n in names:
+            if section == n or section.startswith(n + "."):
+                return kind
+    return None
+
+
+def object_name(name):
+    for ext in (".cpp.o", ".c.o", ".S.o", ".o", ".cpp.obj", ".c.obj", ".S.obj", ".obj"):
+        if name.endswith(ext):
+            return name[: -len(ext)]
+    return name
+
+
+def group_of(path, expand):
+    """(group, member) for one input file path from the map."""
+    path = path.strip()
+    m = ARCHIVE.match(path)
+    if m:
+        lib = m.group(2)
+        lib = lib[3:] if lib.startswith("lib") else lib
+        if lib in expand:
+            return lib + ":" + object_name(m.group(3)), lib
+        return lib, lib
+    norm = path.replace("\\", "/")
+    if ("/src/" in norm or norm.startswith("src/")) and norm.endswith(".o"):
+        return object_name(norm.rsplit("/", 1)[1]), "app"
+    return "other", "other"
+
+
+def parse(path, expand=()):
+    """{group: {"flash","iram","dram"}}, {group: parent} from one map file."""
+    sizes = defaultdict(lambda: {"flash": 0, "iram": 0, "dram": 0})
+    parents = {}
+    kind = None
+    pending = None
+    in_map = False
+
+    def charge(size, source):
+        if kind is None or size == 0:
+            return
+        group, parent = group_of(source, expand)
+        parents[group] = parent
+        s = sizes[group]
+        if kind == "flash":
+            s["flash"] += size
+        elif kind == "iram":
+            s["iram"] += size
+            s["flash"] += size
+        elif kind == "data":
+            s["dram"] += size
+            s["flash"] += size
+        else:  # bss: RAM only
+            s["dram"] += size
+
+    last_source = "other"
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_map:
+                in_map = line.startswith("Linker script and memory map")
+                continue
+            if pending is not None:
+                m = IN_CONTINUATION.match(line)
+                pending = None
+                if m:
+                    last_source = m.group(3)
+                    charge(int(m.group(2), 16), last_source)
+                    continue
+            if line and not line[0].isspace():
+                m = OUT_SECTION.match(line)
+                kind = kind_of(m.group(1)) if m else None
+                continue
+            m = IN_ONE_LINE.match(line)
+            if m:
+                last_source = m.group(4)
+                charge(int(m.group(3), 16), last_source)
+                continue
+            m = FILL.match(line)
+            if m:
+                # Alignment padding belongs to whoever came just before it.
+                charge(int(m.group(1), 16), last_source)
+                continue
+            if IN_NAME_ONLY.match(line):
+                pending = line
+    if not in_map:
+        raise ValueError("%s: no 'Linker script and memory map' section (not an ld map?)" % path)
+    return sizes, parents
+
+
+def parse_budget(spec):
+    name, _, limits = spec.partition("=")
+    flash, _, dram = limits.partition("/")
+
+    def kib(v):
+        v = v.strip()
+        return None if v in ("", "-") else int(float(v) * 1024)
+
+    if not name or not limits:
+        raise argparse.ArgumentTypeError("budget must be NAME=FLASH_KIB/DRAM_KIB, got %r" % spec)
+    return name.strip(), kib(flash), kib(dram)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("map", help="linker map file")
+    ap.add_argument("--budget", action="append", type=parse_budget, default=[], metavar="NAME=FLASH/DRAM",
+                    help="KiB limits for a group or 'total' (repeatable)")
+    ap.add_argument("--top", type=int, default=20, help="library/other rows to list (default 20)")
+    ap.add_argument("--expand", action="append", default=[], metavar="LIB",
+                    help="list this archive per object (e.g. FrameworkArduino)")
+    args = ap.parse_args()
+
+    try:
+        sizes, parents = parse(args.map, set(args.expand))
+    except (OSError, ValueError) as e:
+        print("size_budget: %s" % e, file=sys.stderr)
+        return 2
+
+    total = {"flash": 0, "iram": 0, "dram": 0}
+    app = {"flash": 0, "iram": 0, "dram": 0}
+    for g, s in sizes.items():
+        for k in total:
+            total[k] += s[k]
+            if parents.get(g) == "app":
+                app[k] += s[k]
+    groups = dict(sizes)
+    groups["app"] = app
+    groups["total"] = total
+
+    def row(name, s):
+        print("%-28s %9d %8d %8d" % (name, s["flash"], s["iram"], s["dram"]))
+
+    print("%-28s %9s %8s %8s" % ("group", "flash", "iram", "dram"))
+    mods = sorted((g for g in sizes if parents.get(g) == "app"), key=lambda g: -sizes[g]["flash"])
+    for g in mods:
+        row("  " + g, sizes[g])
+    row("app (src/)", app)
+    libs = sorted((g for g in sizes if parents.get(g) != "app"), key=lambda g: -sizes[g]["flash"])
+    for g in libs[: args.top]:
+        row(g, sizes[g])
+    if len(libs) > args.top:
+        rest = {"flash": 0, "iram": 0, "dram": 0}
+        for g in libs[args.top:]:
+            for k in rest:
+                rest[k] += sizes[g][k]
+        row("(%d more)" % (len(libs) - args.top), rest)
+    row("total", total)
+
+    failed = 0
+    if args.budget:
+        print()
+    for name, flash, dram in args.budget:
+        s = groups.get(name)
+        if s is None:
+            print("budget %-20s no such group" % name)
+            failed += 1
+            continue
+        for label, used, limit in (("flash", s["flash"], flash), ("dram", s["dram"], dram)):
+            if limit is None:
+                continue
+            over = used > limit
+            failed += over
+            print("budget %-20s %-5s %8d / %8d  %s" % (name, label, used, limit, "OVER" if over else "ok"))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Empty-scale drift before and after temperature compensation, from logs.
+
+Every zero point the firmware learns (TEMPCOMP_SAMPLE_MS while idle) is
+logged as a TempZero event: the temperature, the empty reading against the
+tare alone (raw) and with the learned zero slope (compensated). This reads
+a log capture (binary frames or text, decoded with log_decode.py), splits it
+into runs at each reboot (the timestamp goes back) and reports per run the
+drift range, the points outside the zero band and the drift per temperature
+bin.
+
+Usage:
+  tools/temp_drift.py capture.bin [more captures...] [--band-g 20] [--bin-c 2]
+  pio device monitor --raw | tools/temp_drift.py -
+"""
+import argparse
+import io
+import math
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import log_decode  # noqa: E402
+
+LINE = re.compile(
+    r"\[\s*(\d+)\].*?zero point at (-?\d+) cC: raw (-?\d+) dg, compensated (-?\d+) dg"
+)
+
+
+def points(stream, events):
+    """(ms, C, raw g, compensated g) per TempZero line."""
+    text = io.StringIO()
+    log_decode.decode(stream, events, text.write)
+    for line in text.getvalue().splitlines():
+        m = LINE.search(line)
+        if m:
+            ms, cc, raw, comp = (int(v) for v in m.groups())
+            yield ms, cc / 100.0, raw / 10.0, comp / 10.0
+
+
+def split_runs(pts):
+    runs, cur, last = [], [], None
+    for p in pts:
+        if last is not None and p[0] < last:
+            runs.append(cur)
+            cur = []
+        cur.append(p)
+        last = p[0]
+    if cur:
+        runs.append(cur)
+    return runs
+
+
+def summary(values, band):
+    peak = max(abs(v) for v in values)
+    rms = math.sqrt(sum(v * v for v in values) / len(values))
+    out = sum(1 for v in values if abs(v) > band)
+    return "%+7.1f..%+6.1f g  max %5.1f  rms %5.1f  %4d outside" % (min(values), max(values), peak, rms, out)
+
+
+def report(run, index, band, bin_c):
+    hours = (run[-1][0] - run[0][0]) / 3.6e6
+    temps = [p[1] for p in run]
+    print("run %d: %d zero points over %.1f h, %.1f..%.1f C" % (index, len(run), hours, min(temps), max(temps)))
+    print("  raw          %s" % summary([p[2] for p in run], band))
+    print("  compensated  %s" % summary([p[3] for p in run], band))
+    bins = {}
+    for _ms, c, raw, comp in run:
+        bins.setdefault(math.floor(c / bin_c), []).append((raw, comp))
+    print("  %-13s %6s %10s %12s" % ("temperature", "points", "raw mean", "comp mean"))
+    for b in sorted(bins):
+        rows = bins[b]
+        print("  %5.1f..%-5.1f %6d %+9.1f g %+11.1f g" % (
+            b * bin_c, (b + 1) * bin_c, len(rows),
+            sum(r for r, _ in rows) / len(rows), sum(c for _, c in rows) / len(rows)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("captures", nargs="+", help="log captures (binary or text), '-' for stdin")
+    ap.add_argument("--band-g", type=float, default=20.0, help="zero band (ZERO_THRESHOLD_KG) in grams")
+    ap.add_argument("--bin-c", type=float, default=2.0, help="temperature bin width")
+    ap.add_argument("--catalogue", default=log_decode.CATALOGUE)
+    args = ap.parse_args()
+
+    events = log_decode.load_catalogue(args.catalogue)
+    runs = []
+    for path in args.captures:
+        if path == "-":
+            runs += split_runs(points(sys.stdin.buffer, events))
+        else:
+            with open(path, "rb") as f:
+                runs += split_runs(points(f, events))
+    if not runs:
+        print("no TempZero events (temperature compensation logs at INFO)")
+        return 1
+    for i, run in enumerate(runs, 1):
+        report(run, i, args.band_g, args.bin_c)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())